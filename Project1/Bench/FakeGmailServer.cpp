@@ -0,0 +1,755 @@
+#include "../Bench/FakeGmailServer.h"
+
+static const char* GMAIL_PREFIX = "/gmail/v1/users/me/";
+static const size_t MAX_HEADER_BYTES = 64 * 1024;
+static const size_t MAX_BODY_BYTES = 64 * 1024 * 1024;
+static const size_t MAX_BATCH_CALLS = 100;      // Gmail's limit per batch request
+
+static string lowercase(string text) {
+    transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+static string trim(const string& text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+FakeGmailServer::FakeGmailServer(int port)
+    : port(port), listenSocket(INVALID_SOCKET), running(false), account("bench@fake.local"),
+      latencyMs(0), replayTiming(false), nextId(1), tokensIssued(0), requests(0) {
+}
+
+FakeGmailServer::~FakeGmailServer() {
+    stop();
+}
+
+bool FakeGmailServer::start() {
+    if (running) return true;
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        cerr << "Fake Gmail: failed to initialize WinSock" << endl;
+        return false;
+    }
+
+    listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        cerr << "Fake Gmail: failed to create socket" << endl;
+        WSACleanup();
+        return false;
+    }
+
+#ifndef _WIN32
+    // Rebinding right after a restart would otherwise wait out TIME_WAIT
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+    sockaddr_in serverAddr = {};
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(static_cast<u_short>(port));
+    inet_pton(AF_INET, "127.0.0.1", &serverAddr.sin_addr);
+
+    if (bind(listenSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR ||
+        listen(listenSocket, SOMAXCONN) == SOCKET_ERROR) {
+        cerr << "Fake Gmail: failed to listen on port " << port << endl;
+        closesocket(listenSocket);
+        listenSocket = INVALID_SOCKET;
+        WSACleanup();
+        return false;
+    }
+
+    running = true;
+    acceptThread = thread(&FakeGmailServer::acceptLoop, this);
+    cout << "Fake Gmail API at " << baseUrl() << endl;
+    return true;
+}
+
+void FakeGmailServer::stop() {
+    if (!running.exchange(false)) return;
+
+    shutdown(listenSocket, SD_BOTH);
+    closesocket(listenSocket);
+    listenSocket = INVALID_SOCKET;
+    if (acceptThread.joinable()) {
+        acceptThread.join();
+    }
+
+    // Wake the keep-alive connections; each thread closes its own socket
+    vector<thread> finished;
+    {
+        lock_guard<mutex> lock(connectionMutex);
+        for (SOCKET clientSocket : openSockets) {
+            shutdown(clientSocket, SD_BOTH);
+        }
+        finished.swap(connections);
+    }
+    for (auto& connection : finished) {
+        if (connection.joinable()) connection.join();
+    }
+    WSACleanup();
+}
+
+string FakeGmailServer::baseUrl() const {
+    return "http://127.0.0.1:" + to_string(port);
+}
+
+void FakeGmailServer::setAccount(const string& email) {
+    lock_guard<mutex> lock(mailMutex);
+    account = email;
+}
+
+void FakeGmailServer::setLatency(int milliseconds) {
+    lock_guard<mutex> lock(mailMutex);
+    latencyMs = max(milliseconds, 0);
+}
+
+bool FakeGmailServer::loadReplay(const string& path, bool recordedTiming) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        cerr << "Fake Gmail: cannot open capture " << path << endl;
+        return false;
+    }
+
+    lock_guard<mutex> lock(mailMutex);
+    replayTiming = recordedTiming;
+    size_t loaded = 0;
+    string line;
+    while (getline(file, line)) {
+        RecordedExchange exchange;
+        if (!TrafficRecorder::parse(line, exchange)) continue;
+        string path = exchange.path.substr(0, exchange.path.find('?'));
+        // Replies are always taken live, so the driver can see them
+        if (path == string(GMAIL_PREFIX) + "messages/send") continue;
+        replay[exchange.method + " " + path].push_back(exchange);
+        loaded++;
+    }
+    cout << "Fake Gmail: loaded " << loaded << " recorded responses from " << path << endl;
+    return loaded > 0;
+}
+
+string FakeGmailServer::inject(const string& from, const string& subject, const string& content) {
+    FakeMessage message;
+    message.from = from;
+    message.subject = subject;
+    message.content = content;
+    message.internalDate = chrono::duration_cast<chrono::milliseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+
+    lock_guard<mutex> lock(mailMutex);
+    message.id = "fake" + to_string(nextId++);
+    messageIndex[message.id] = inbox.size();
+    inbox.push_back(message);
+    return message.id;
+}
+
+void FakeGmailServer::onSent(SentListener listener) {
+    lock_guard<mutex> lock(mailMutex);
+    sentListener = listener;
+}
+
+void FakeGmailServer::onDelivered(DeliveredListener listener) {
+    lock_guard<mutex> lock(mailMutex);
+    deliveredListener = listener;
+}
+
+size_t FakeGmailServer::sentCount() const {
+    lock_guard<mutex> lock(mailMutex);
+    return sent.size();
+}
+
+map<string, long long> FakeGmailServer::requestsByEndpoint() const {
+    lock_guard<mutex> lock(mailMutex);
+    return endpointCounts;
+}
+
+void FakeGmailServer::acceptLoop() {
+    while (running) {
+        SOCKET clientSocket = accept(listenSocket, NULL, NULL);
+        if (clientSocket == INVALID_SOCKET) {
+            if (!running) break;
+            continue;
+        }
+
+        lock_guard<mutex> lock(connectionMutex);
+        if (!running) {
+            closesocket(clientSocket);
+            break;
+        }
+        openSockets.push_back(clientSocket);
+        connections.emplace_back(&FakeGmailServer::serveConnection, this, clientSocket);
+    }
+}
+
+void FakeGmailServer::serveConnection(SOCKET clientSocket) {
+    // curl keeps connections alive, so serve requests until the client hangs up
+    string pending;
+    string method, target, body;
+    map<string, string> headers;
+    while (running && readRequest(clientSocket, pending, method, target, headers, body)) {
+        Response response = handle(method, target, headers, body);
+
+        int latency;
+        {
+            lock_guard<mutex> lock(mailMutex);
+            latency = latencyMs;
+        }
+        long long delayMicros = latency * 1000LL + response.delayMicros;
+        if (delayMicros > 0) {
+            this_thread::sleep_for(chrono::microseconds(delayMicros));
+        }
+
+        bool keepAlive = lowercase(headers["connection"]) != "close";
+        string reply =
+            "HTTP/1.1 " + to_string(response.status) + " " + statusText(response.status) + "\r\n"
+            "Content-Type: " + response.contentType + "\r\n"
+            "Content-Length: " + to_string(response.body.size()) + "\r\n"
+            "Connection: " + (keepAlive ? "keep-alive" : "close") + "\r\n"
+            "\r\n" + response.body;
+        if (!sendAll(clientSocket, reply) || !keepAlive) break;
+    }
+
+    closesocket(clientSocket);
+    lock_guard<mutex> lock(connectionMutex);
+    openSockets.erase(remove(openSockets.begin(), openSockets.end(), clientSocket), openSockets.end());
+}
+
+bool FakeGmailServer::readRequest(SOCKET clientSocket, string& pending, string& method, string& target,
+    map<string, string>& headers, string& body) {
+    char buffer[16384];
+    size_t headerEnd;
+    while ((headerEnd = pending.find("\r\n\r\n")) == string::npos) {
+        if (pending.size() > MAX_HEADER_BYTES) return false;
+        int received = recv(clientSocket, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        pending.append(buffer, received);
+    }
+
+    istringstream head(pending.substr(0, headerEnd));
+    string line;
+    getline(head, line);
+    istringstream requestLine(line);
+    requestLine >> method >> target;
+    headers.clear();
+    while (getline(head, line)) {
+        size_t colon = line.find(':');
+        if (colon != string::npos) {
+            headers[lowercase(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+        }
+    }
+
+    size_t length = static_cast<size_t>(strtoull(headers["content-length"].c_str(), nullptr, 10));
+    if (length > MAX_BODY_BYTES) return false;
+    size_t total = headerEnd + 4 + length;
+
+    // curl holds large bodies back until it is told to go ahead
+    if (pending.size() < total && lowercase(headers["expect"]) == "100-continue") {
+        if (!sendAll(clientSocket, "HTTP/1.1 100 Continue\r\n\r\n")) return false;
+    }
+    while (pending.size() < total) {
+        int received = recv(clientSocket, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        pending.append(buffer, received);
+    }
+
+    body = pending.substr(headerEnd + 4, length);
+    pending.erase(0, total);
+    return true;
+}
+
+bool FakeGmailServer::sendAll(SOCKET clientSocket, const string& data) {
+    size_t sentBytes = 0;
+    while (sentBytes < data.size()) {
+        int result = send(clientSocket, data.c_str() + sentBytes, static_cast<int>(data.size() - sentBytes), 0);
+        if (result == SOCKET_ERROR || result == 0) return false;
+        sentBytes += result;
+    }
+    return true;
+}
+
+FakeGmailServer::Response FakeGmailServer::handle(const string& method, const string& target,
+    const map<string, string>& headers, const string& body) {
+    requests++;
+    size_t question = target.find('?');
+    string path = target.substr(0, question);
+    string query = question == string::npos ? "" : target.substr(question + 1);
+
+    string endpoint = "other";
+    Response response;
+    if (path == "/token" && method == "POST") {
+        endpoint = "token";
+        response = token(body);
+    }
+    else if (path == "/batch/gmail/v1" && method == "POST") {
+        endpoint = "batch";
+        response = batch(headers, body);
+    }
+    else if (path.compare(0, strlen(GMAIL_PREFIX), GMAIL_PREFIX) == 0) {
+        string resource = path.substr(strlen(GMAIL_PREFIX));
+        auto authorization = headers.find("authorization");
+        bool authorized = authorization != headers.end() &&
+            authorization->second.size() > 7 && authorization->second.compare(0, 7, "Bearer ") == 0;
+
+        if (resource == "messages/send") endpoint = "messages.send";
+        else if (resource == "messages") endpoint = "messages.list";
+        else if (resource.compare(0, 9, "messages/") == 0) endpoint = "messages.get";
+        else if (resource == "profile") endpoint = "profile";
+
+        if (!authorized) {
+            response = error(401, "Request is missing required authentication credential.", "UNAUTHENTICATED");
+        }
+        else if (endpoint != "messages.send" && replayed(method, path, response)) {
+            if (endpoint == "messages.get") {
+                // Tell the driver whose command this was, as for live mail
+                Json::Value message;
+                Json::CharReaderBuilder reader;
+                string errors;
+                istringstream stream(response.body);
+                DeliveredListener listener;
+                {
+                    lock_guard<mutex> lock(mailMutex);
+                    listener = deliveredListener;
+                }
+                if (listener && Json::parseFromStream(reader, stream, &message, &errors)) {
+                    for (const auto& header : message["payload"]["headers"]) {
+                        if (header["name"].asString() == "From") {
+                            listener(message["id"].asString(), header["value"].asString());
+                        }
+                    }
+                }
+            }
+        }
+        else if (endpoint == "messages.send" && method == "POST") {
+            response = sendMessage(body);
+        }
+        else if (endpoint == "messages.list") {
+            response = listMessages(query);
+        }
+        else if (endpoint == "messages.get" && method == "GET") {
+            response = getMessage(resource.substr(9));
+        }
+        else if (endpoint == "profile" && method == "GET") {
+            response = profile();
+        }
+        else {
+            response = error(404, "Not Found", "NOT_FOUND");
+        }
+    }
+    else {
+        response = error(404, "Not Found", "NOT_FOUND");
+    }
+
+    lock_guard<mutex> lock(mailMutex);
+    endpointCounts[endpoint]++;
+    return response;
+}
+
+bool FakeGmailServer::replayed(const string& method, const string& path, Response& response) {
+    lock_guard<mutex> lock(mailMutex);
+    auto it = replay.find(method + " " + path);
+    if (it == replay.end() || it->second.empty()) return false;
+
+    // Each recorded response is served once; afterwards the live fake answers
+    const RecordedExchange& exchange = it->second.front();
+    response.status = static_cast<int>(exchange.status);
+    response.body = exchange.response;
+    response.delayMicros = replayTiming ? exchange.durationMicros : 0;
+    it->second.pop_front();
+    return true;
+}
+
+FakeGmailServer::Response FakeGmailServer::listMessages(const string& query) {
+    // Supports the terms EmailFetcher sends: subject:, after:<epoch seconds> and after:yyyy/mm/dd
+    istringstream terms(urlDecode(formValue(query, "q")));
+    string term;
+    string subject;
+    long long afterMillis = 0;
+    while (terms >> term) {
+        if (term.compare(0, 8, "subject:") == 0) {
+            subject = lowercase(term.substr(8));
+        }
+        else if (term.compare(0, 6, "after:") == 0) {
+            string value = term.substr(6);
+            if (value.find('/') != string::npos) {
+                tm date = {};
+                istringstream(value) >> get_time(&date, "%Y/%m/%d");
+                afterMillis = static_cast<long long>(mktime(&date)) * 1000;
+            }
+            else {
+                afterMillis = strtoll(value.c_str(), nullptr, 10) * 1000;
+            }
+        }
+    }
+    size_t pageSize = DEFAULT_PAGE_SIZE;
+    string maxResults = formValue(query, "maxResults");
+    if (!maxResults.empty()) {
+        pageSize = max<size_t>(1, min<size_t>(500, strtoul(maxResults.c_str(), nullptr, 10)));
+    }
+
+    Json::Value result;
+    Json::Value messages(Json::arrayValue);
+    {
+        lock_guard<mutex> lock(mailMutex);
+        // Newest first, as Gmail lists them; after: includes its own second
+        for (auto it = inbox.rbegin(); it != inbox.rend() && messages.size() < pageSize; ++it) {
+            if (it->internalDate < afterMillis) continue;
+            if (!subject.empty() && lowercase(it->subject).find(subject) == string::npos) continue;
+            Json::Value entry;
+            entry["id"] = it->id;
+            entry["threadId"] = it->id;
+            messages.append(entry);
+        }
+    }
+    // Gmail leaves the messages array out of an empty result
+    if (!messages.empty()) {
+        result["messages"] = messages;
+    }
+    result["resultSizeEstimate"] = messages.size();
+
+    Response response;
+    response.body = toJson(result);
+    return response;
+}
+
+FakeGmailServer::Response FakeGmailServer::getMessage(const string& id) {
+    FakeMessage message;
+    string to;
+    DeliveredListener listener;
+    {
+        lock_guard<mutex> lock(mailMutex);
+        auto it = messageIndex.find(id);
+        if (it == messageIndex.end()) {
+            return error(404, "Requested entity was not found.", "NOT_FOUND");
+        }
+        message = inbox[it->second];
+        to = account;
+        listener = deliveredListener;
+    }
+
+    time_t seconds = static_cast<time_t>(message.internalDate / 1000);
+    tm utc;
+    gmtime_s(&utc, &seconds);
+    char date[64];
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S +0000", &utc);
+
+    Json::Value headers(Json::arrayValue);
+    const pair<const char*, string> values[] = {
+        { "From", message.from }, { "To", to }, { "Subject", message.subject }, { "Date", date }
+    };
+    for (const auto& value : values) {
+        Json::Value header;
+        header["name"] = value.first;
+        header["value"] = value.second;
+        headers.append(header);
+    }
+
+    Json::Value result;
+    result["id"] = message.id;
+    result["threadId"] = message.id;
+    result["labelIds"].append("INBOX");
+    result["labelIds"].append("UNREAD");
+    result["snippet"] = message.content;
+    result["internalDate"] = to_string(message.internalDate);
+    result["sizeEstimate"] = static_cast<Json::UInt64>(message.content.size() + message.subject.size() + 512);
+    result["payload"]["mimeType"] = "text/plain";
+    result["payload"]["headers"] = headers;
+    result["payload"]["body"]["size"] = static_cast<Json::UInt64>(message.content.size());
+    result["payload"]["body"]["data"] = base64UrlEncode(message.content);
+
+    if (listener) {
+        listener(message.id, message.from);
+    }
+    Response response;
+    response.body = toJson(result);
+    return response;
+}
+
+FakeGmailServer::Response FakeGmailServer::sendMessage(const string& body) {
+    Json::Value request;
+    Json::CharReaderBuilder reader;
+    string errors;
+    istringstream stream(body);
+    if (!Json::parseFromStream(reader, stream, &request, &errors) || !request["raw"].isString()) {
+        return error(400, "Invalid value for ByteString", "INVALID_ARGUMENT");
+    }
+
+    // Only the headers are needed, so decode just the start of the message
+    const string& raw = request["raw"].asString();
+    string prefix = raw.substr(0, min<size_t>(raw.size(), 8192));
+    prefix.resize(prefix.size() - prefix.size() % 4);
+    string mime = base64Decode(prefix);
+
+    SentMessage message;
+    message.rawBytes = raw.size();
+    message.receivedAt = chrono::steady_clock::now();
+    istringstream lines(mime);
+    string line;
+    while (getline(lines, line)) {
+        line = trim(line);
+        if (line.empty()) break;
+        size_t colon = line.find(':');
+        if (colon == string::npos) continue;
+        string name = lowercase(line.substr(0, colon));
+        if (name == "to") message.to = trim(line.substr(colon + 1));
+        else if (name == "subject") message.subject = trim(line.substr(colon + 1));
+    }
+    if (message.to.empty()) {
+        return error(400, "Recipient address required", "INVALID_ARGUMENT");
+    }
+
+    SentListener listener;
+    {
+        lock_guard<mutex> lock(mailMutex);
+        message.id = "sent" + to_string(nextId++);
+        sent.push_back(message);
+        listener = sentListener;
+    }
+    if (listener) {
+        listener(message);
+    }
+
+    Json::Value result;
+    result["id"] = message.id;
+    result["threadId"] = message.id;
+    result["labelIds"].append("SENT");
+    Response response;
+    response.body = toJson(result);
+    return response;
+}
+
+FakeGmailServer::Response FakeGmailServer::profile() {
+    Json::Value result;
+    {
+        lock_guard<mutex> lock(mailMutex);
+        result["emailAddress"] = account;
+        result["messagesTotal"] = static_cast<Json::UInt64>(inbox.size() + sent.size());
+        result["threadsTotal"] = static_cast<Json::UInt64>(inbox.size() + sent.size());
+        result["historyId"] = to_string(nextId);
+    }
+    Response response;
+    response.body = toJson(result);
+    return response;
+}
+
+FakeGmailServer::Response FakeGmailServer::token(const string& body) {
+    string grant = formValue(body, "grant_type");
+    Response response;
+    if (grant == "refresh_token" && formValue(body, "refresh_token").empty()) {
+        response.status = 400;
+        response.body = "{\"error\":\"invalid_grant\",\"error_description\":\"Missing refresh token\"}";
+        return response;
+    }
+    if (grant != "refresh_token" && grant != "authorization_code") {
+        response.status = 400;
+        response.body = "{\"error\":\"unsupported_grant_type\"}";
+        return response;
+    }
+
+    long long issued;
+    {
+        lock_guard<mutex> lock(mailMutex);
+        issued = ++tokensIssued;
+    }
+    Json::Value result;
+    result["access_token"] = "fake-access-" + to_string(issued);
+    result["expires_in"] = 3599;
+    result["token_type"] = "Bearer";
+    result["scope"] = "https://www.googleapis.com/auth/gmail.modify";
+    // Like Google, only the code exchange hands out a refresh token
+    if (grant == "authorization_code") {
+        result["refresh_token"] = "fake-refresh";
+    }
+    response.body = toJson(result);
+    return response;
+}
+
+FakeGmailServer::Response FakeGmailServer::batch(const map<string, string>& headers, const string& body) {
+    auto contentType = headers.find("content-type");
+    string boundary;
+    if (contentType != headers.end()) {
+        size_t at = contentType->second.find("boundary=");
+        if (at != string::npos) {
+            boundary = contentType->second.substr(at + 9);
+            boundary = boundary.substr(0, boundary.find(';'));
+            boundary.erase(remove(boundary.begin(), boundary.end(), '"'), boundary.end());
+        }
+    }
+    if (boundary.empty()) {
+        return error(400, "Batch requests must be multipart/mixed", "INVALID_ARGUMENT");
+    }
+
+    // Split the body into the parts between boundary lines
+    vector<string> parts;
+    string delimiter = "--" + boundary;
+    size_t at = body.find(delimiter);
+    while (at != string::npos) {
+        size_t start = at + delimiter.size();
+        if (body.compare(start, 2, "--") == 0) break;
+        size_t next = body.find(delimiter, start);
+        if (next == string::npos) break;
+        parts.push_back(body.substr(start, next - start));
+        at = next;
+    }
+    if (parts.size() > MAX_BATCH_CALLS) {
+        return error(400, "Too many requests in batch", "INVALID_ARGUMENT");
+    }
+
+    const string responseBoundary = "batch_fakegmail";
+    Response response;
+    response.contentType = "multipart/mixed; boundary=" + responseBoundary;
+    for (const auto& part : parts) {
+        // Part headers, a blank line, then the embedded HTTP request
+        size_t split = part.find("\r\n\r\n");
+        if (split == string::npos) continue;
+        string contentId;
+        istringstream partHeaders(part.substr(0, split));
+        string line;
+        while (getline(partHeaders, line)) {
+            size_t colon = line.find(':');
+            if (colon != string::npos && lowercase(trim(line.substr(0, colon))) == "content-id") {
+                contentId = trim(line.substr(colon + 1));
+                contentId.erase(remove(contentId.begin(), contentId.end(), '<'), contentId.end());
+                contentId.erase(remove(contentId.begin(), contentId.end(), '>'), contentId.end());
+            }
+        }
+
+        string embedded = part.substr(split + 4);
+        size_t embeddedSplit = embedded.find("\r\n\r\n");
+        string embeddedHead = embedded.substr(0, embeddedSplit);
+        string embeddedBody = embeddedSplit == string::npos ? "" : trim(embedded.substr(embeddedSplit + 4));
+
+        istringstream head(embeddedHead);
+        getline(head, line);
+        string innerMethod, innerTarget;
+        istringstream(line) >> innerMethod >> innerTarget;
+        map<string, string> innerHeaders = headers;
+        while (getline(head, line)) {
+            size_t colon = line.find(':');
+            if (colon != string::npos) {
+                innerHeaders[lowercase(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+            }
+        }
+
+        Response inner = handle(innerMethod, innerTarget, innerHeaders, embeddedBody);
+        response.delayMicros = max(response.delayMicros, inner.delayMicros);
+        response.body +=
+            "--" + responseBoundary + "\r\n"
+            "Content-Type: application/http\r\n" +
+            (contentId.empty() ? string() : "Content-ID: <response-" + contentId + ">\r\n") +
+            "\r\n"
+            "HTTP/1.1 " + to_string(inner.status) + " " + statusText(inner.status) + "\r\n"
+            "Content-Type: " + inner.contentType + "\r\n"
+            "Content-Length: " + to_string(inner.body.size()) + "\r\n"
+            "\r\n" + inner.body + "\r\n";
+    }
+    response.body += "--" + responseBoundary + "--\r\n";
+    return response;
+}
+
+FakeGmailServer::Response FakeGmailServer::error(int status, const string& message, const string& reason) {
+    Json::Value result;
+    result["error"]["code"] = status;
+    result["error"]["message"] = message;
+    result["error"]["status"] = reason;
+    Response response;
+    response.status = status;
+    response.body = toJson(result);
+    return response;
+}
+
+string FakeGmailServer::statusText(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Status";
+    }
+}
+
+string FakeGmailServer::formValue(const string& form, const string& name) {
+    istringstream pairs(form);
+    string pair;
+    while (getline(pairs, pair, '&')) {
+        size_t equals = pair.find('=');
+        if (equals != string::npos && pair.compare(0, equals, name) == 0) {
+            return pair.substr(equals + 1);
+        }
+    }
+    return "";
+}
+
+string FakeGmailServer::urlDecode(const string& text) {
+    string decoded;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '+') {
+            decoded += ' ';
+        }
+        else if (text[i] == '%' && i + 2 < text.size()) {
+            decoded += static_cast<char>(strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        }
+        else {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+string FakeGmailServer::base64UrlEncode(const string& data) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    string encoded;
+    encoded.reserve((data.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t triple = (static_cast<unsigned char>(data[i]) << 16) |
+            (static_cast<unsigned char>(data[i + 1]) << 8) | static_cast<unsigned char>(data[i + 2]);
+        encoded += alphabet[(triple >> 18) & 0x3F];
+        encoded += alphabet[(triple >> 12) & 0x3F];
+        encoded += alphabet[(triple >> 6) & 0x3F];
+        encoded += alphabet[triple & 0x3F];
+    }
+    if (i < data.size()) {
+        uint32_t triple = static_cast<unsigned char>(data[i]) << 16;
+        if (i + 1 < data.size()) triple |= static_cast<unsigned char>(data[i + 1]) << 8;
+        encoded += alphabet[(triple >> 18) & 0x3F];
+        encoded += alphabet[(triple >> 12) & 0x3F];
+        if (i + 1 < data.size()) encoded += alphabet[(triple >> 6) & 0x3F];
+    }
+    return encoded;
+}
+
+string FakeGmailServer::base64Decode(const string& data) {
+    // Accepts both alphabets: EmailFetcher sends standard base64
+    string decoded;
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : data) {
+        int value;
+        if (c >= 'A' && c <= 'Z') value = c - 'A';
+        else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') value = c - '0' + 52;
+        else if (c == '+' || c == '-') value = 62;
+        else if (c == '/' || c == '_') value = 63;
+        else continue;
+        buffer = (buffer << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            decoded += static_cast<char>((buffer >> bits) & 0xFF);
+        }
+    }
+    return decoded;
+}
+
+string FakeGmailServer::toJson(const Json::Value& value) {
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    return Json::writeString(writer, value);
+}
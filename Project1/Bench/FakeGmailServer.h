@@ -0,0 +1,114 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../GmailAPI/TrafficRecorder.h"
+
+struct FakeMessage {
+    string id;
+    string from;
+    string subject;
+    string content;
+    long long internalDate = 0;   // Milliseconds since the epoch, as Gmail reports it
+};
+
+// A reply the server posted to messages.send
+struct SentMessage {
+    string id;
+    string to;
+    string subject;
+    size_t rawBytes = 0;
+    chrono::steady_clock::time_point receivedAt;
+};
+
+// Local stand-in for the Gmail REST API and Google's OAuth token endpoint, on
+// plain HTTP at 127.0.0.1. It serves what EmailFetcher and TokenManager use:
+// messages list/get/send, profile, token and the batch endpoint. Point
+// Endpoints at baseUrl() to run the whole server against it.
+//
+// A capture written by TrafficRecorder can be loaded for replay: recorded
+// responses are served once each, in capture order and with their recorded
+// timing, for matching method and path. Sends are always handled live so
+// replies can be observed.
+class FakeGmailServer {
+public:
+    static const int DEFAULT_PORT = 8787;
+    static const size_t DEFAULT_PAGE_SIZE = 100;   // Gmail's maxResults default
+    typedef function<void(const SentMessage&)> SentListener;
+    // A message's details were served; for replayed mail this is the first
+    // point at which its sender is known
+    typedef function<void(const string& messageId, const string& from)> DeliveredListener;
+
+    explicit FakeGmailServer(int port = DEFAULT_PORT);
+    ~FakeGmailServer();
+
+    bool start();
+    void stop();
+    string baseUrl() const;
+
+    void setAccount(const string& email);
+    // Added to every response, to stand in for Google's round trip
+    void setLatency(int milliseconds);
+    bool loadReplay(const string& path, bool recordedTiming = true);
+
+    // Delivers a message to the inbox now; returns its id
+    string inject(const string& from, const string& subject, const string& content);
+    void onSent(SentListener listener);
+    void onDelivered(DeliveredListener listener);
+
+    size_t sentCount() const;
+    long long requestCount() const { return requests; }
+    map<string, long long> requestsByEndpoint() const;
+
+private:
+    struct Response {
+        int status = 200;
+        string contentType = "application/json; charset=UTF-8";
+        string body;
+        long long delayMicros = 0;
+    };
+
+    int port;
+    SOCKET listenSocket;
+    atomic<bool> running;
+    thread acceptThread;
+    vector<thread> connections;
+    vector<SOCKET> openSockets;
+    mutex connectionMutex;
+
+    mutable mutex mailMutex;
+    string account;
+    int latencyMs;
+    bool replayTiming;
+    vector<FakeMessage> inbox;
+    map<string, size_t> messageIndex;
+    vector<SentMessage> sent;
+    map<string, deque<RecordedExchange>> replay;   // "METHOD /path" without the query
+    map<string, long long> endpointCounts;
+    long long nextId;
+    long long tokensIssued;
+    atomic<long long> requests;
+    SentListener sentListener;
+    DeliveredListener deliveredListener;
+
+    void acceptLoop();
+    void serveConnection(SOCKET clientSocket);
+    static bool readRequest(SOCKET clientSocket, string& pending, string& method, string& target,
+        map<string, string>& headers, string& body);
+    static bool sendAll(SOCKET clientSocket, const string& data);
+
+    Response handle(const string& method, const string& target, const map<string, string>& headers, const string& body);
+    bool replayed(const string& method, const string& path, Response& response);
+    Response listMessages(const string& query);
+    Response getMessage(const string& id);
+    Response sendMessage(const string& body);
+    Response profile();
+    Response token(const string& body);
+    Response batch(const map<string, string>& headers, const string& body);
+
+    static Response error(int status, const string& message, const string& reason);
+    static string statusText(int status);
+    static string formValue(const string& form, const string& name);
+    static string urlDecode(const string& text);
+    static string base64UrlEncode(const string& data);
+    static string base64Decode(const string& data);
+    static string toJson(const Json::Value& value);
+};
@@ -0,0 +1,240 @@
+#include "../Bench/LoadDriver.h"
+#include "../GmailAPI/Endpoints.h"
+#include "../GmailAPI/GmailAPI.h"
+#include "../Server/ServerManager.h"
+#include "../Platform/Platform.h"
+
+const char* LoadDriver::TOKEN_STORE = "bench_token.json";
+const char* LoadDriver::SENDER_DOMAIN = "loadtest.local";
+static const char* ACCESS_LIST = "access_list.json";   // Read by ServerManager::loadAccessList
+
+LoadOptions LoadOptions::parse(const vector<string>& args) {
+    LoadOptions options;
+    for (size_t i = 0; i < args.size(); i++) {
+        const string& flag = args[i];
+        if (flag == "--bench") continue;
+        if (i + 1 >= args.size()) {
+            throw invalid_argument("Missing value for " + flag);
+        }
+        const string& value = args[++i];
+        if (flag == "--commands") options.commands = max(atoi(value.c_str()), 1);
+        else if (flag == "--command") options.command = value;
+        else if (flag == "--content") options.content = value;
+        else if (flag == "--rate") options.injectPerSecond = max(atoi(value.c_str()), 0);
+        else if (flag == "--latency") options.latencyMs = max(atoi(value.c_str()), 0);
+        else if (flag == "--poll") options.pollIntervalMs = max(atoi(value.c_str()), 1);
+        else if (flag == "--timeout") options.timeoutSeconds = max(atoi(value.c_str()), 1);
+        else if (flag == "--port") options.port = atoi(value.c_str());
+        else if (flag == "--replay") options.replayFile = value;
+        else if (flag == "--backend") options.backend = value;
+        else throw invalid_argument("Unknown option " + flag);
+    }
+    return options;
+}
+
+string LoadReport::toText() const {
+    ostringstream out;
+    out << fixed << setprecision(1);
+    out << "Load test: " << injected << " commands" << endl;
+    out << "  completed " << completed << ", refused " << refused << ", unanswered " << unanswered
+        << ", extra replies " << extraReplies << endl;
+    out << "  " << seconds << " s, " << commandsPerSecond << " commands/sec" << endl;
+    out << "  latency ms: p50 " << p50Ms << ", p90 " << p90Ms << ", p99 " << p99Ms << ", max " << maxMs << endl;
+    out << "  Gmail API requests: " << apiRequests;
+    for (const auto& endpoint : requestsByEndpoint) {
+        out << ", " << endpoint.first << " " << endpoint.second;
+    }
+    out << endl;
+    return out.str();
+}
+
+LoadDriver::LoadDriver(const LoadOptions& options)
+    : options(options), completed(0), refused(0), extraReplies(0) {
+}
+
+string LoadDriver::senderAddress(int index) {
+    return "bench" + to_string(index) + "@" + SENDER_DOMAIN;
+}
+
+double LoadDriver::percentile(vector<double>& sorted, double quantile) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(ceil(quantile * sorted.size()));
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+// Writes the original access list plus the given senders
+static void writeAccessList(const Json::Value& original, const set<string>& senders) {
+    Json::Value root = original.isArray() ? original : Json::Value(Json::arrayValue);
+    for (const auto& sender : senders) {
+        Json::Value entry;
+        entry["email"] = sender;
+        entry["grantedTime"] = Json::Value::Int64(time(nullptr));
+        root.append(entry);
+    }
+    ofstream file(ACCESS_LIST);
+    file << root.toStyledString();
+}
+
+void LoadDriver::onReply(const SentMessage& message) {
+    // Deferral notices come before the real reply
+    if (message.subject == "Command Deferred") return;
+    bool refusal = message.subject == "Server Busy" || message.subject == "Rate Limited" ||
+        message.subject == "Access Denied";
+
+    lock_guard<mutex> lock(resultMutex);
+    auto it = pending.find(message.to);
+    if (it == pending.end() || it->second.empty()) {
+        if (answered.count(message.to)) extraReplies++;
+        return;
+    }
+
+    chrono::duration<double, milli> latency = message.receivedAt - it->second.front();
+    it->second.pop_front();
+    answered[message.to]++;
+    if (refusal) {
+        refused++;
+    }
+    else {
+        completed++;
+        latenciesMs.push_back(latency.count());
+    }
+    lastReply = message.receivedAt;
+    finished.notify_all();
+}
+
+LoadReport LoadDriver::run() {
+    bool replaying = !options.replayFile.empty();
+    unique_ptr<Platform> platform = Platform::create(options.backend);
+    FakeGmailServer fake(options.port);
+    fake.setLatency(options.latencyMs);
+    if (replaying && !fake.loadReplay(options.replayFile)) {
+        throw runtime_error("Cannot replay " + options.replayFile);
+    }
+    if (!fake.start()) {
+        throw runtime_error("Cannot start the fake Gmail server on port " + to_string(options.port));
+    }
+
+    string savedApiBase = Endpoints::apiBase();
+    string savedOAuthBase = Endpoints::oauthBase();
+    Endpoints::setApiBase(fake.baseUrl());
+    Endpoints::setOAuthBase(fake.baseUrl());
+
+    // The run's senders are approved on top of whatever is already there
+    Json::Value originalAccess;
+    bool hadAccessList = false;
+    {
+        ifstream file(ACCESS_LIST);
+        if (file.is_open()) {
+            Json::Reader reader;
+            hadAccessList = reader.parse(file, originalAccess);
+        }
+    }
+    set<string> approved;
+
+    fake.onSent([this](const SentMessage& message) { onReply(message); });
+    auto started = chrono::steady_clock::now();
+    auto lastActivity = started;
+    if (replaying) {
+        // Recorded senders are only known once their mail is fetched
+        fake.onDelivered([&](const string&, const string& from) {
+            string address = from.substr(from.find('<') == string::npos ? 0 : from.find('<') + 1);
+            address = address.substr(0, address.find('>'));
+            lock_guard<mutex> lock(resultMutex);
+            if (approved.insert(address).second) {
+                writeAccessList(originalAccess, approved);
+            }
+            pending[address].push_back(chrono::steady_clock::now());
+            lastActivity = chrono::steady_clock::now();
+        });
+    }
+
+    LoadReport report;
+    {
+        MyCurlWrapper curl(3);
+        GmailAPI api("bench-client", "bench-secret", "http://localhost:8080", curl, TOKEN_STORE, "");
+        api.authenticate("bench-code");
+        api.setPollInterval(0);
+
+        if (!replaying) {
+            for (int i = 0; i < options.commands; i++) {
+                approved.insert(senderAddress(i));
+            }
+            writeAccessList(originalAccess, approved);
+        }
+
+        ServerManager server(api, nullptr, "", platform.get());
+        server.externalPolling = true;
+        atomic<bool> polling(true);
+        thread poller([&] {
+            while (polling) {
+                server.processCommands();
+                this_thread::sleep_for(chrono::milliseconds(options.pollIntervalMs));
+            }
+        });
+
+        started = chrono::steady_clock::now();
+        if (!replaying) {
+            for (int i = 0; i < options.commands; i++) {
+                if (options.injectPerSecond > 0) {
+                    this_thread::sleep_until(started + chrono::microseconds(1000000LL * i / options.injectPerSecond));
+                }
+                string sender = senderAddress(i);
+                {
+                    lock_guard<mutex> lock(resultMutex);
+                    pending[sender].push_back(chrono::steady_clock::now());
+                }
+                fake.inject(sender, "Command::" + options.command, options.content);
+            }
+            report.injected = options.commands;
+        }
+
+        auto deadline = started + chrono::seconds(options.timeoutSeconds);
+        unique_lock<mutex> lock(resultMutex);
+        while (chrono::steady_clock::now() < deadline) {
+            size_t waiting = 0;
+            for (const auto& sender : pending) waiting += sender.second.size();
+            if (!replaying && completed + refused >= report.injected) break;
+            // A replay is over once everything fetched is answered and the capture has gone quiet
+            if (replaying && waiting == 0 && chrono::steady_clock::now() - lastActivity > chrono::seconds(2)) break;
+            finished.wait_for(lock, chrono::milliseconds(200));
+        }
+        lock.unlock();
+
+        polling = false;
+        poller.join();
+    }
+
+    Endpoints::setApiBase(savedApiBase);
+    Endpoints::setOAuthBase(savedOAuthBase);
+    fake.stop();
+
+    lock_guard<mutex> lock(resultMutex);
+    if (hadAccessList) {
+        writeAccessList(originalAccess, set<string>());
+    }
+    else {
+        remove(ACCESS_LIST);
+    }
+    remove(TOKEN_STORE);
+
+    if (replaying) {
+        report.injected = 0;
+        for (const auto& sender : answered) report.injected += sender.second;
+    }
+    for (const auto& sender : pending) report.unanswered += static_cast<int>(sender.second.size());
+    report.injected += replaying ? report.unanswered : 0;
+    report.completed = completed;
+    report.refused = refused;
+    report.extraReplies = extraReplies;
+    report.seconds = completed + refused > 0 ? chrono::duration<double>(lastReply - started).count() : 0;
+    report.commandsPerSecond = report.seconds > 0 ? completed / report.seconds : 0;
+
+    sort(latenciesMs.begin(), latenciesMs.end());
+    report.p50Ms = percentile(latenciesMs, 0.50);
+    report.p90Ms = percentile(latenciesMs, 0.90);
+    report.p99Ms = percentile(latenciesMs, 0.99);
+    report.maxMs = latenciesMs.empty() ? 0 : latenciesMs.back();
+    report.apiRequests = fake.requestCount();
+    report.requestsByEndpoint = fake.requestsByEndpoint();
+    return report;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Bench/FakeGmailServer.h"
+
+struct LoadOptions {
+    int commands = 200;               // Command emails to inject
+    string command = "listProcess";   // Sent as "Command::<command>"
+    string content;                   // Body of every command email
+    int injectPerSecond = 0;          // 0 injects them all at once
+    int latencyMs = 0;                // Simulated Gmail round trip per request
+    int pollIntervalMs = 100;
+    int timeoutSeconds = 300;
+    int port = FakeGmailServer::DEFAULT_PORT;
+    string replayFile;                // Serve a TrafficRecorder capture instead of injecting
+    string backend = "native";        // Platform the handlers act on: "native" or "mock"
+
+    // "--commands 500 --command listFile --rate 50 --latency 80 --backend mock ..."
+    static LoadOptions parse(const vector<string>& args);
+};
+
+struct LoadReport {
+    int injected = 0;
+    int completed = 0;     // Got their reply
+    int refused = 0;       // Answered with Server Busy, Rate Limited or Access Denied
+    int unanswered = 0;    // Still waiting at the timeout
+    int extraReplies = 0;  // More than one final reply for one command
+    double seconds = 0;    // First injection to last reply
+    double commandsPerSecond = 0;
+    double p50Ms = 0, p90Ms = 0, p99Ms = 0, maxMs = 0;
+    long long apiRequests = 0;
+    map<string, long long> requestsByEndpoint;
+
+    string toText() const;
+};
+
+// Drives the real EmailMonitor -> ServerManager -> reply pipeline against
+// FakeGmailServer. Every injected command comes from its own sender
+// (bench<N>@loadtest.local), so its reply can be matched to it exactly and
+// per-sender rate limits do not skew the run. Latency runs from injection to
+// the final reply being posted to messages.send.
+//
+// The senders are approved through access_list.json in the working directory
+// for the length of the run, and tokens go to bench_token.json; run it from a
+// scratch directory.
+class LoadDriver {
+public:
+    static const char* TOKEN_STORE;
+    static const char* SENDER_DOMAIN;
+
+    explicit LoadDriver(const LoadOptions& options);
+    LoadReport run();
+
+private:
+    LoadOptions options;
+
+    mutex resultMutex;
+    condition_variable finished;
+    map<string, deque<chrono::steady_clock::time_point>> pending;   // Sender -> commands awaiting a reply
+    map<string, int> answered;                                      // Sender -> final replies seen
+    vector<double> latenciesMs;
+    chrono::steady_clock::time_point lastReply;
+    int completed;
+    int refused;
+    int extraReplies;
+
+    void onReply(const SentMessage& message);
+    static string senderAddress(int index);
+    static double percentile(vector<double>& sorted, double quantile);
+};
@@ -0,0 +1,158 @@
+#ifndef _WIN32
+#include "../Bench/ProcScanBench.h"
+#include <dirent.h>
+
+ProcScanOptions ProcScanOptions::parse(const vector<string>& args) {
+    ProcScanOptions options;
+    for (size_t i = 0; i < args.size(); i++) {
+        const string& flag = args[i];
+        if (flag == "--bench-procfs") continue;
+        if (i + 1 >= args.size()) {
+            throw invalid_argument("Missing value for " + flag);
+        }
+        const string& value = args[++i];
+        if (flag == "--iterations") options.iterations = max(atoi(value.c_str()), 1);
+        else if (flag == "--synthetic") options.synthetic = max(atoi(value.c_str()), 0);
+        else throw invalid_argument("Unknown option " + flag);
+    }
+    return options;
+}
+
+string ProcScanReport::toText() const {
+    ostringstream out;
+    out << fixed << setprecision(3);
+    out << "Process scan of " << root << ": " << processes << " processes, " << iterations << " iterations" << endl;
+    out << "  ProcFsReader: median " << fastMedianMs << " ms, best " << fastBestMs << " ms" << endl;
+    out << "  ifstream:     median " << naiveMedianMs << " ms, best " << naiveBestMs << " ms" << endl;
+    if (fastMedianMs > 0) {
+        out << setprecision(1) << "  speedup " << naiveMedianMs / fastMedianMs << "x" << endl;
+    }
+    out << "  records differing: " << mismatches << endl;
+    return out.str();
+}
+
+ProcScanBench::ProcScanBench(const ProcScanOptions& options) : options(options) {
+}
+
+size_t ProcScanBench::naiveScan(const string& root, vector<ProcessInfo>& processes) {
+    processes = vector<ProcessInfo>();
+    DIR* dir = opendir(root.c_str());
+    if (!dir) return 0;
+
+    while (dirent* entry = readdir(dir)) {
+        string pid = entry->d_name;
+        if (pid.empty() || pid.find_first_not_of("0123456789") != string::npos) continue;
+
+        ifstream statFile(root + "/" + pid + "/stat");
+        string line;
+        if (!getline(statFile, line)) continue;
+        size_t open = line.find('(');
+        size_t close = line.rfind(')');
+        if (open == string::npos || close == string::npos) continue;
+
+        // Walk the fields the way ProcFsReader keeps them
+        istringstream fields(line.substr(close + 2));
+        string state;
+        long long parentPid = 0, userTicks = 0, systemTicks = 0, threads = 0, startTicks = 0, skip = 0;
+        fields >> state >> parentPid;
+        for (int field = 5; field <= 13; field++) fields >> skip;
+        fields >> userTicks >> systemTicks;
+        for (int field = 16; field <= 19; field++) fields >> skip;
+        fields >> threads >> skip >> startTicks;
+
+        ifstream statm(root + "/" + pid + "/statm");
+        unsigned long long size = 0, resident = 0;
+        statm >> size >> resident;
+
+        ProcessInfo info;
+        info.name = line.substr(open + 1, close - open - 1);
+        info.processId = static_cast<DWORD>(stoul(pid));
+        info.memoryUsage = static_cast<SIZE_T>(resident * sysconf(_SC_PAGESIZE));
+        processes.push_back(info);
+    }
+    closedir(dir);
+
+    sort(processes.begin(), processes.end(),
+        [](const ProcessInfo& a, const ProcessInfo& b) {
+            return a.memoryUsage > b.memoryUsage;
+        });
+    return processes.size();
+}
+
+string ProcScanBench::createSyntheticTree(int count) {
+    string root = "/tmp/procbench_" + to_string(getpid());
+    _mkdir(root.c_str());
+    mt19937 random(7);
+    for (int i = 0; i < count; i++) {
+        int pid = 100 + i;
+        string dir = root + "/" + to_string(pid);
+        _mkdir(dir.c_str());
+        // Field layout of a real stat line, as far as starttime and a little past
+        unsigned residentPages = random() % 50000;
+        ofstream(dir + "/stat") << pid << " (worker-" << i % 97 << ") S 1 " << pid << " " << pid
+            << " 0 -1 4194560 " << random() % 100000 << " 0 12 0 " << random() % 50000 << " "
+            << random() % 20000 << " 0 0 20 0 " << 1 + random() % 64 << " 0 " << 1000 + i
+            << " 123456789 " << residentPages << " 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 0 0 17 3 0 0 0 0 0\n";
+        ofstream(dir + "/statm") << 30000 + random() % 100000 << " " << residentPages << " "
+            << random() % 4000 << " 100 0 9000 0\n";
+    }
+    return root;
+}
+
+void ProcScanBench::removeSyntheticTree(const string& root, int count) {
+    for (int i = 0; i < count; i++) {
+        string dir = root + "/" + to_string(100 + i);
+        remove((dir + "/stat").c_str());
+        remove((dir + "/statm").c_str());
+        rmdir(dir.c_str());
+    }
+    rmdir(root.c_str());
+}
+
+static double median(vector<double>& samples) {
+    sort(samples.begin(), samples.end());
+    return samples.empty() ? 0 : samples[samples.size() / 2];
+}
+
+ProcScanReport ProcScanBench::run() {
+    ProcScanReport report;
+    report.iterations = options.iterations;
+    report.root = options.synthetic > 0 ? createSyntheticTree(options.synthetic) : "/proc";
+
+    ProcFsReader reader(report.root);
+    vector<ProcessInfo> fast, naive;
+    vector<double> fastMs, naiveMs;
+    // Alternate the two so cache state and process churn hit both alike
+    for (int i = 0; i < options.iterations; i++) {
+        auto start = chrono::steady_clock::now();
+        reader.enumerate(fast);
+        auto middle = chrono::steady_clock::now();
+        naiveScan(report.root, naive);
+        auto end = chrono::steady_clock::now();
+        fastMs.push_back(chrono::duration<double, milli>(middle - start).count());
+        naiveMs.push_back(chrono::duration<double, milli>(end - middle).count());
+    }
+    report.processes = fast.size();
+
+    auto byPid = [](const ProcessInfo& a, const ProcessInfo& b) { return a.processId < b.processId; };
+    sort(fast.begin(), fast.end(), byPid);
+    sort(naive.begin(), naive.end(), byPid);
+    report.mismatches = max(fast.size(), naive.size()) - min(fast.size(), naive.size());
+    for (size_t i = 0; i < min(fast.size(), naive.size()); i++) {
+        if (fast[i].processId != naive[i].processId || fast[i].name != naive[i].name ||
+            fast[i].memoryUsage != naive[i].memoryUsage) {
+            report.mismatches++;
+        }
+    }
+
+    if (options.synthetic > 0) {
+        removeSyntheticTree(report.root, options.synthetic);
+    }
+
+    report.fastBestMs = *min_element(fastMs.begin(), fastMs.end());
+    report.naiveBestMs = *min_element(naiveMs.begin(), naiveMs.end());
+    report.fastMedianMs = median(fastMs);
+    report.naiveMedianMs = median(naiveMs);
+    return report;
+}
+#endif
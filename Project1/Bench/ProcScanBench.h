@@ -0,0 +1,41 @@
+#pragma once
+#ifndef _WIN32
+#include "../Libs/Header.h"
+#include "../Platform/ProcFs.h"
+
+struct ProcScanOptions {
+    int iterations = 20;
+    int synthetic = 0;   // Generate this many fake /proc entries instead of scanning /proc
+
+    // "--bench-procfs --iterations 50 --synthetic 10000"
+    static ProcScanOptions parse(const vector<string>& args);
+};
+
+struct ProcScanReport {
+    string root;
+    size_t processes = 0;
+    int iterations = 0;
+    double fastMedianMs = 0, fastBestMs = 0;
+    double naiveMedianMs = 0, naiveBestMs = 0;
+    size_t mismatches = 0;   // Records that differ on the last pass; live processes churn
+
+    string toText() const;
+};
+
+// Times ProcFsReader::enumerate against the obvious reader: an ifstream per
+// stat and statm file, parsed with istringstream into a fresh vector. Both
+// build the same ProcessInfo list, and the report says whether they agreed.
+class ProcScanBench {
+public:
+    explicit ProcScanBench(const ProcScanOptions& options);
+    ProcScanReport run();
+
+    static size_t naiveScan(const string& root, vector<ProcessInfo>& processes);
+
+private:
+    ProcScanOptions options;
+
+    static string createSyntheticTree(int count);
+    static void removeSyntheticTree(const string& root, int count);
+};
+#endif
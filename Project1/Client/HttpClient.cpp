@@ -1,5 +1,5 @@
-﻿#include "..\Client\HttpClient.h"
-#include "..\GmailAPI\CurlWrapper.h"
+﻿#include "../Client/HttpClient.h"
+#include "../GmailAPI/CurlWrapper.h"
 
 void HttpClient::makeRequest(const string& url, const string& postFields) {
     // Hàm này phải được triển khai bởi các lớp dẫn xuất
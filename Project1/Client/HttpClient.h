@@ -1,6 +1,6 @@
 ﻿#pragma once
-#include "..\Libs\Header.h"
-#include "..\GmailAPI\TokenInfo.h"
+#include "../Libs/Header.h"
+#include "../GmailAPI/TokenInfo.h"
 
 class HttpClient {
 public:
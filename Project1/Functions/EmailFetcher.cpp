@@ -1,8 +1,12 @@
-﻿#include "..\Libs\Header.h"
-#include "..\Functions\EmailFetcher.h"
-
-EmailFetcher::EmailFetcher(CurlWrapper& curl, TokenManager& tokenManager)
-    : curl(curl), tokenManager(tokenManager), serverStartTime(time(nullptr)), lastFetchedTime(time(nullptr)), lastCheckTime(time(nullptr))
+﻿#include "../Libs/Header.h"
+#include "../Functions/EmailFetcher.h"
+#include "../GmailAPI/Endpoints.h"
+#include "../Server/Metrics.h"
+#include "../Server/Tracing.h"
+
+EmailFetcher::EmailFetcher(CurlWrapper& curl, TokenManager& tokenManager, const string& checkpointPath)
+    : curl(curl), tokenManager(tokenManager), serverStartTime(time(nullptr)), lastFetchedTime(time(nullptr)), lastCheckTime(time(nullptr)),
+    checkpointPath(checkpointPath)
 {
     static bool isFirstCall = true;
     if (isFirstCall) {
@@ -11,6 +15,31 @@ EmailFetcher::EmailFetcher(CurlWrapper& curl, TokenManager& tokenManager)
         cout << "Server started at: " << timeStr;
         isFirstCall = false;
     }
+    loadCheckpoint();
+}
+
+void EmailFetcher::loadCheckpoint() {
+    if (checkpointPath.empty()) return;
+
+    ifstream file(checkpointPath);
+    if (!file.is_open()) return;
+
+    Json::Value checkpoint;
+    Json::Reader reader;
+    if (reader.parse(file, checkpoint) && checkpoint.isMember("lastFetchedTime")) {
+        lastFetchedTime = checkpoint["lastFetchedTime"].asInt64();
+    }
+}
+
+void EmailFetcher::saveCheckpoint() const {
+    if (checkpointPath.empty()) return;
+
+    ofstream file(checkpointPath);
+    if (!file.is_open()) return;
+
+    Json::Value checkpoint;
+    checkpoint["lastFetchedTime"] = Json::Value::Int64(lastFetchedTime);
+    file << checkpoint.toStyledString();
 }
 
 string EmailFetcher::getMyEmail() {
@@ -23,7 +52,7 @@ string EmailFetcher::getMyEmail() {
     };
 
     string response = curl.performRequestWithRetry(
-        "https://gmail.googleapis.com/gmail/v1/users/me/profile",
+        Endpoints::gmail("/profile"),
         "GET",
         "",
         headers
@@ -155,26 +184,15 @@ string EmailFetcher::createEmailContentMultipleAttachments(
     return content;
 }
 
-bool EmailFetcher::sendEmailWithAttachments(const string& to, const string& subject, const string& body, const vector<string>& attachmentPaths) {
-    if (!tokenManager.hasValidToken()) {
-        tokenManager.refreshToken();
-    }
-
-    // Create vector of path + encoded content pairs
-    vector<pair<string, string>> attachments;
-    for (const auto& path : attachmentPaths) {
-        string attachmentContent;
-        if (!readAttachmentFile(path, attachmentContent)) {
-            return false;
-        }
-        attachments.push_back({ path, base64EncodeContent(attachmentContent) });
-    }
-
-    string emailContent = createEmailContentMultipleAttachments(to, subject, body, attachments);
-    string encodedEmail = base64EncodeContent(emailContent);
+string EmailFetcher::postMessage(const string& encodedEmail) {
+    static Counter& uploadedBytes = Metrics().counter("remotecontrol_upload_bytes_total",
+        "Bytes of message payload posted to messages.send");
+    static Counter& messagesSent = Metrics().counter("remotecontrol_messages_sent_total",
+        "Messages posted to messages.send");
 
     Json::Value requestBody;
     requestBody["raw"] = encodedEmail;
+    string payload = requestBody.toStyledString();
 
     vector<string> headers = {
         "Authorization: Bearer " + tokenManager.getCurrentToken().access_token,
@@ -183,12 +201,43 @@ bool EmailFetcher::sendEmailWithAttachments(const string& to, const string& subj
     };
 
     string response = curl.performRequestWithRetry(
-        "https://gmail.googleapis.com/gmail/v1/users/me/messages/send",
+        Endpoints::gmail("/messages/send"),
         "POST",
-        requestBody.toStyledString(),
+        payload,
         headers
     );
 
+    uploadedBytes.inc(payload.size());
+    if (!response.empty()) {
+        messagesSent.inc();
+    }
+    return response;
+}
+
+bool EmailFetcher::sendEmailWithAttachments(const string& to, const string& subject, const string& body, const vector<string>& attachmentPaths) {
+    if (!tokenManager.hasValidToken()) {
+        tokenManager.refreshToken();
+    }
+
+    string encodedEmail;
+    {
+        Span mimeSpan("mimeBuild");
+
+        // Create vector of path + encoded content pairs
+        vector<pair<string, string>> attachments;
+        for (const auto& path : attachmentPaths) {
+            string attachmentContent;
+            if (!readAttachmentFile(path, attachmentContent)) {
+                return false;
+            }
+            attachments.push_back({ path, base64EncodeContent(attachmentContent) });
+        }
+
+        string emailContent = createEmailContentMultipleAttachments(to, subject, body, attachments);
+        encodedEmail = base64EncodeContent(emailContent);
+    }
+
+    string response = postMessage(encodedEmail);
     return !response.empty();
 }
 
@@ -199,39 +248,28 @@ bool EmailFetcher::sendEmail(const string& to, const string& subject, const stri
         tokenManager.refreshToken();
     }
 
-    // 2. Read attachment file
-    string attachmentContent;
-    if (!readAttachmentFile(attachmentPath, attachmentContent)) {
-        return false;
-    }
+    string encodedEmail;
+    {
+        Span mimeSpan("mimeBuild");
 
-    // 3. Encode attachment
-    string encodedAttachment = base64EncodeContent(attachmentContent);
+        // 2. Read attachment file
+        string attachmentContent;
+        if (!readAttachmentFile(attachmentPath, attachmentContent)) {
+            return false;
+        }
 
-    // 4. Create email content
-    string emailContent = createEmailContent(to, subject, body, attachmentPath, encodedAttachment);
+        // 3. Encode attachment
+        string encodedAttachment = base64EncodeContent(attachmentContent);
 
-    // 5. Encode email
-    string encodedEmail = base64EncodeContent(emailContent);
+        // 4. Create email content
+        string emailContent = createEmailContent(to, subject, body, attachmentPath, encodedAttachment);
 
-    // 6. Create request body
-    Json::Value requestBody;
-    requestBody["raw"] = encodedEmail;
-
-    // 7. Send request
-    vector<string> headers = {
-        "Authorization: Bearer " + tokenManager.getCurrentToken().access_token,
-        "Content-Type: application/json",
-        "Accept: application/json"
-    };
-
-    string response = curl.performRequestWithRetry(
-        "https://gmail.googleapis.com/gmail/v1/users/me/messages/send",
-        "POST",
-        requestBody.toStyledString(),
-        headers
-    );
+        // 5. Encode email
+        encodedEmail = base64EncodeContent(emailContent);
+    }
 
+    // 6. Send request
+    string response = postMessage(encodedEmail);
     return !response.empty();
 }
 
@@ -244,36 +282,25 @@ bool EmailFetcher::sendSimpleEmail(const string& to, const string& subject, cons
         tokenManager.refreshToken();
     }
 
-    // 2. Create email content
-    cout << "\nCreating email content...\n";
-    cout << "To: " << to << "\nSubject: " << subject << endl;
-    string emailContent = createSimpleEmailContent(to, subject, body);
-    cout << "Email content size: " << emailContent.length() << " bytes\n";
-
-    // 3. Encode email
-    cout << "\nEncoding email to base64...\n";
-    string encodedEmail = base64EncodeContent(emailContent);
-    cout << "Encoded email size: " << encodedEmail.length() << " bytes\n";
+    string encodedEmail;
+    {
+        Span mimeSpan("mimeBuild");
 
-    // 4. Create request body
-    cout << "\nPreparing request...\n";
-    Json::Value requestBody;
-    requestBody["raw"] = encodedEmail;
+        // 2. Create email content
+        cout << "\nCreating email content...\n";
+        cout << "To: " << to << "\nSubject: " << subject << endl;
+        string emailContent = createSimpleEmailContent(to, subject, body);
+        cout << "Email content size: " << emailContent.length() << " bytes\n";
 
-    // 5. Send request
-    vector<string> headers = {
-        "Authorization: Bearer " + tokenManager.getCurrentToken().access_token,
-        "Content-Type: application/json",
-        "Accept: application/json"
-    };
+        // 3. Encode email
+        cout << "\nEncoding email to base64...\n";
+        encodedEmail = base64EncodeContent(emailContent);
+        cout << "Encoded email size: " << encodedEmail.length() << " bytes\n";
+    }
 
+    // 4. Send request
     cout << "\nSending request to Gmail API...\n";
-    string response = curl.performRequestWithRetry(
-        "https://gmail.googleapis.com/gmail/v1/users/me/messages/send",
-        "POST",
-        requestBody.toStyledString(),
-        headers
-    );
+    string response = postMessage(encodedEmail);
 
     cout << "\n=== Response ===\n";
     cout << "Response length: " << response.length() << " bytes\n";
@@ -283,14 +310,22 @@ bool EmailFetcher::sendSimpleEmail(const string& to, const string& subject, cons
     return !response.empty();
 }
 
-vector<string> EmailFetcher::getEmailNow() {
+vector<string> EmailFetcher::getEmailNow(const Admission& admit) {
     time_t currentTime = time(nullptr);
 
-    if (difftime(currentTime, lastCheckTime) < CHECK_INTERVAL) {
+    if (difftime(currentTime, lastCheckTime) < pollIntervalSeconds) {
         return vector<string>();  // Too soon to check
     }
     lastCheckTime = currentTime;
 
+    static Histogram& pollLatency = Metrics().histogram("remotecontrol_poll_duration_seconds",
+        "Time to list and fetch new command emails");
+    static Counter& messagesFetched = Metrics().counter("remotecontrol_messages_fetched_total",
+        "Command emails fetched from the mailbox");
+    ScopedTimer pollTimer(pollLatency);
+    Span pollSpan("getEmailNow");
+    long long pollStartMicros = Tracer::nowMicros();
+
     if (!tokenManager.hasValidToken()) {
         tokenManager.refreshToken();
     }
@@ -299,7 +334,7 @@ vector<string> EmailFetcher::getEmailNow() {
         "Authorization: Bearer " + tokenManager.getCurrentToken().access_token
     };
 
-    string query = "https://www.googleapis.com/gmail/v1/users/me/messages?q=subject:Command::+after:"
+    string query = Endpoints::gmail("/messages?q=subject:Command::+after:")
         + to_string(lastFetchedTime)
         + "&format=full";
     string response = curl.performRequestWithRetry(query, "GET", "", headers);
@@ -319,41 +354,114 @@ vector<string> EmailFetcher::getEmailNow() {
 
         
         if (jsonData.isMember("messages")) {
-            
-            for (const auto& message : jsonData["messages"]) {
+            vector<shared_ptr<Trace>> traces;
+            time_t fetchedBefore = lastFetchedTime;
+            set<string> listed;
+            time_t heldSince = (numeric_limits<time_t>::max)();
+
+            // Gmail lists newest first; mail is admitted oldest first
+            const Json::Value& messages = jsonData["messages"];
+            for (Json::ArrayIndex i = messages.size(); i-- > 0;) {
+                string messageId = messages[i]["id"].asString();
+                listed.insert(messageId);
+                // after: is inclusive, so mail from the cursor's second comes back on the next poll
+                if (deliveredIds.count(messageId)) {
+                    continue;
+                }
+
                 Json::Value emailData;
-                emailData["id"] = message["id"].asString();
-                emailData["internalDate"] = currentTime;
-                string emailDetails = getEmailDetails(message["id"].asString());
-
-                vector<string> emailDetailsParts;
-                size_t pos = 0;
-                string token;
-                while ((pos = emailDetails.find("\n")) != string::npos) {
-                    token = emailDetails.substr(0, pos);
-                    emailDetailsParts.push_back(token);
-                    emailDetails.erase(0, pos + 1);
+                auto held = heldBack.find(messageId);
+                if (held != heldBack.end()) {
+                    emailData = held->second;
                 }
-                emailDetailsParts.push_back(emailDetails);
-
-                Json::Value emailDetailsObject;
-                for (const auto& part : emailDetailsParts) {
-                    size_t colonPos = part.find(":");
-                    if (colonPos != string::npos) {
-                        string key = part.substr(0, colonPos);
-                        string value = part.substr(colonPos + 1);
-                        value.erase(0, value.find_first_not_of(" "));
-                        emailDetailsObject[key] = value;
+                else {
+                    messagesFetched.inc();
+                    emailData["id"] = messageId;
+
+                    // The dispatcher picks the trace up by message id
+                    shared_ptr<Trace> trace = Tracer::instance().begin(messageId);
+                    traces.push_back(trace);
+                    long long internalDate = 0;
+                    string emailDetails;
+                    {
+                        TraceScope traceScope(trace);
+                        emailDetails = getEmailDetails(messageId, &internalDate);
+                    }
+                    emailData["internalDate"] = Json::Value::Int64(internalDate);
+                    if (internalDate > 0) {
+                        trace->setOrigin(internalDate * 1000);
+                    }
+
+                    vector<string> emailDetailsParts;
+                    size_t pos = 0;
+                    string token;
+                    while ((pos = emailDetails.find("\n")) != string::npos) {
+                        token = emailDetails.substr(0, pos);
+                        emailDetailsParts.push_back(token);
+                        emailDetails.erase(0, pos + 1);
                     }
+                    emailDetailsParts.push_back(emailDetails);
+
+                    Json::Value emailDetailsObject;
+                    for (const auto& part : emailDetailsParts) {
+                        size_t colonPos = part.find(":");
+                        if (colonPos != string::npos) {
+                            string key = part.substr(0, colonPos);
+                            string value = part.substr(colonPos + 1);
+                            value.erase(0, value.find_first_not_of(" "));
+                            emailDetailsObject[key] = value;
+                        }
+                    }
+
+                    emailData["emailDetails"] = emailDetailsObject;
                 }
 
-                emailData["emailDetails"] = emailDetailsObject;
+                long long internalDate = emailData["internalDate"].asInt64();
+                if (admit && !admit(emailData)) {
+                    heldBack[messageId] = emailData;
+                    heldSince = min(heldSince, static_cast<time_t>(internalDate / 1000));
+                    continue;
+                }
+                heldBack.erase(messageId);
+                deliveredIds[messageId] = internalDate;
 
                 emails.push_back(emailData.toStyledString());
                 cout << emailData.toStyledString() << endl;
-                lastFetchedTime = max(lastFetchedTime, emailData["internalDate"].asInt());
             }
+            // Held mail that is no longer listed was deleted or answered elsewhere
+            for (auto it = heldBack.begin(); it != heldBack.end();) {
+                if (!listed.count(it->first)) {
+                    it = heldBack.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+
+            // The query cursor stays on poll time, and never passes the second of
+            // mail held back, so the next listing still returns it; internalDate
+            // is otherwise kept for tracing
+            time_t cursor = emails.empty() ? lastFetchedTime : currentTime;
+            lastFetchedTime = max(lastFetchedTime, min(cursor, heldSince));
 			//lastFetchedTime = 0;
+            // A restart resumes from here instead of from its own start time
+            if (lastFetchedTime != fetchedBefore) saveCheckpoint();
+
+            // Ids older than the cursor cannot be listed again
+            for (auto it = deliveredIds.begin(); it != deliveredIds.end();) {
+                if (it->second < static_cast<long long>(lastFetchedTime) * 1000) {
+                    it = deliveredIds.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+
+            // Every trace shares the poll that found it
+            long long pollMicros = Tracer::nowMicros() - pollStartMicros;
+            for (const auto& trace : traces) {
+                trace->addSpan({ "getEmailNow", pollStartMicros, pollMicros, Tracer::threadId() });
+            }
             return emails;
         }
         else {
@@ -396,7 +504,7 @@ vector<string> EmailFetcher::getRecentEmails() {
     };
 
     string response = curl.performRequestWithRetry(
-        "https://www.googleapis.com/gmail/v1/users/me/messages?q=" + dateQuery,
+        Endpoints::gmail("/messages?q=" + dateQuery),
         "POST",
         "",
         headers
@@ -474,13 +582,15 @@ string EmailFetcher::parseEmailContent(const Json::Value& emailData) {
     return result.str();
 }
 
-string EmailFetcher::getEmailDetails(const string& messageId) {
+string EmailFetcher::getEmailDetails(const string& messageId, long long* internalDate) {
+    Span detailsSpan("getEmailDetails");
+
     vector<string> headers = {
         "Authorization: Bearer " + tokenManager.getCurrentToken().access_token
     };
 
     string response = curl.performRequestWithRetry(
-        "https://www.googleapis.com/gmail/v1/users/me/messages/" + messageId,
+        Endpoints::gmail("/messages/" + messageId),
         "GET",
         "",
         headers
@@ -495,5 +605,10 @@ string EmailFetcher::getEmailDetails(const string& messageId) {
         throw runtime_error("Failed to parse email details");
     }
 
+    // Gmail reports internalDate as milliseconds since the epoch, in a string
+    if (internalDate && emailData.isMember("internalDate")) {
+        *internalDate = strtoll(emailData["internalDate"].asString().c_str(), nullptr, 10);
+    }
+
     return parseEmailContent(emailData);
 }
\ No newline at end of file
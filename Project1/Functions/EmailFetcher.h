@@ -1,7 +1,7 @@
 #pragma once
-#include "..\Libs\Header.h"
-#include "..\GmailAPI\CurlWrapper.h"
-#include "..\GmailAPI\TokenManager.h"
+#include "../Libs/Header.h"
+#include "../GmailAPI/CurlWrapper.h"
+#include "../GmailAPI/TokenManager.h"
 
 class EmailFetcher {
 private:
@@ -10,7 +10,13 @@ private:
     time_t serverStartTime;
     time_t lastFetchedTime;
     time_t lastCheckTime;
-    const int CHECK_INTERVAL = 5;  // 5 seconds
+    int pollIntervalSeconds = 5;   // Minimum time between two mailbox listings
+    map<string, long long> deliveredIds;  // Message id -> internalDate, for ids still at or after the cursor
+    map<string, Json::Value> heldBack;    // Fetched but not admitted yet; the cursor stays on the oldest
+    string checkpointPath;         // Sync checkpoint file, empty to start from now on every run
+
+    void loadCheckpoint();
+    void saveCheckpoint() const;
 
     string decodeBase64(const string& encoded);
     string parseEmailContent(const Json::Value& emailData);
@@ -18,6 +24,7 @@ private:
     string base64EncodeContent(const string& content);
     string createEmailContent(const string& to, const string& subject, const string& body,
         const string& attachmentPath, const string& encodedAttachment);
+    string postMessage(const string& encodedEmail);
     string createSimpleEmailContent(const string& to, const string& subject, const string& body);
     string createEmailContentMultipleAttachments(
         const string& to,
@@ -27,11 +34,17 @@ private:
     );
 
 public:
+    // Decides, oldest first, which fetched mail to hand out now; the rest is
+    // kept and offered again on the next poll
+    typedef function<bool(const Json::Value& emailData)> Admission;
+
     string getMyEmail();
-    EmailFetcher(CurlWrapper& curl, TokenManager& tokenManager);
-    vector<string> getEmailNow();
+    EmailFetcher(CurlWrapper& curl, TokenManager& tokenManager, const string& checkpointPath = "");
+    vector<string> getEmailNow(const Admission& admit = nullptr);
+    void setPollInterval(int seconds) { pollIntervalSeconds = max(seconds, 0); }
     vector<string> getRecentEmails();
-    string getEmailDetails(const string& messageId);
+    // internalDate, when given, receives Gmail's delivery time in milliseconds
+    string getEmailDetails(const string& messageId, long long* internalDate = nullptr);
     bool sendEmail(const string& to, const string& subject, const string& body, const string& attachmentPath);
     bool sendEmailWithAttachments(const string& to, const string& subject, const string& body, const vector<string>& attachmentPaths);
     bool sendSimpleEmail(const string& to, const string& subject, const string& body);
@@ -1,4 +1,5 @@
 #include "FileList.h"
+#include "../Platform/DirectoryWalker.h"
 
 std::wstring FileList::GetDocumentsPath() {
     WCHAR path[MAX_PATH];
@@ -38,6 +39,12 @@ bool FileList::writeFilesToFile(const std::string& filename) {
     std::ofstream outFile(filename);
     if (!outFile.is_open()) return false;
 
+    bool written = writeFilesToStream(outFile);
+    outFile.close();
+    return written;
+}
+
+bool FileList::writeFilesToStream(std::ostream& outFile) {
     // Set fixed width for columns
     const int nameWidth = 30;
     const int pathWidth = 50;
@@ -50,6 +57,16 @@ bool FileList::writeFilesToFile(const std::string& filename) {
         << std::setw(sizeWidth) << "Size (MB)" << std::endl;
     outFile << std::string(nameWidth + pathWidth + sizeWidth + 6, '-') << std::endl;
 
+    return enumerateFiles([&](const FileInfo& file) {
+        double sizeMB = file.sizeBytes / (1024.0 * 1024.0);
+        outFile << std::left
+            << std::setw(nameWidth) << file.name << " | "
+            << std::setw(pathWidth) << (file.label + ": " + file.path) << " | "
+            << std::setw(sizeWidth) << std::fixed << std::setprecision(2) << sizeMB << std::endl;
+    });
+}
+
+bool FileList::enumerateFiles(const std::function<void(const FileInfo&)>& visit) {
     // Define directories with labels
     struct DirInfo {
         std::wstring path;
@@ -65,6 +82,7 @@ bool FileList::writeFilesToFile(const std::string& filename) {
     };
 
     // Scan each directory
+    FileInfo info;
     for (const auto& dirInfo : directories) {
         WIN32_FIND_DATAW findData;
         HANDLE hFind = FindFirstFileW((dirInfo.path + L"\\*").c_str(), &findData);
@@ -75,24 +93,211 @@ bool FileList::writeFilesToFile(const std::string& filename) {
                     LARGE_INTEGER fileSize;
                     fileSize.LowPart = findData.nFileSizeLow;
                     fileSize.HighPart = findData.nFileSizeHigh;
-                    double sizeMB = fileSize.QuadPart / (1024.0 * 1024.0);
 
                     std::wstring wFileName = findData.cFileName;
-                    std::string fileName(wFileName.begin(), wFileName.end());
                     std::wstring wDirPath = dirInfo.path + L"\\" + findData.cFileName;
-                    std::string fullPath(wDirPath.begin(), wDirPath.end());
-
-                    outFile << std::left
-                        << std::setw(nameWidth) << fileName << " | "
-                        << std::setw(pathWidth) << (dirInfo.label + ": " + fullPath) << " | "
-                        << std::setw(sizeWidth) << std::fixed << std::setprecision(2) << sizeMB << std::endl;
+                    info.name.assign(wFileName.begin(), wFileName.end());
+                    info.path.assign(wDirPath.begin(), wDirPath.end());
+                    info.label = dirInfo.label;
+                    info.sizeBytes = static_cast<unsigned long long>(fileSize.QuadPart);
+                    info.modified = FileList::unixTime(findData.ftLastWriteTime);
+                    info.attributes = findData.dwFileAttributes;
+                    visit(info);
                 }
             } while (FindNextFileW(hFind, &findData));
             FindClose(hFind);
         }
     }
 
-    outFile.close();
+    return true;
+}
+
+namespace {
+
+std::wstring widen(const std::string& text) {
+    if (text.empty()) return std::wstring();
+    int size = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, nullptr, 0);
+    std::wstring wide(size, 0);
+    MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, &wide[0], size);
+    wide.resize(size > 0 ? size - 1 : 0);
+    return wide;
+}
+
+std::string narrow(const wchar_t* wide) {
+    int size = WideCharToMultiByte(CP_UTF8, 0, wide, -1, nullptr, 0, nullptr, nullptr);
+    std::string text(size, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wide, -1, &text[0], size, nullptr, nullptr);
+    text.resize(size > 0 ? size - 1 : 0);
+    return text;
+}
+
+// Paths past MAX_PATH only open with the \\?\ prefix
+std::wstring longPath(const std::string& path) {
+    std::wstring wide = widen(path);
+    if (wide.size() < MAX_PATH - 12 || wide.compare(0, 4, L"\\\\?\\") == 0) return wide;
+    if (wide.compare(0, 2, L"\\\\") == 0) return L"\\\\?\\UNC\\" + wide.substr(2);
+    return L"\\\\?\\" + wide;
+}
+
+// FindFirstFileExW without short names, fetching large blocks at a time.
+// Symbolic links and junctions are links; other reparse points, such as
+// cloud placeholders, are ordinary files and folders.
+class WindowsDirectorySource : public DirectorySource {
+public:
+    bool read(const std::string& path, std::vector<DirectoryEntry>& entries) override {
+        WIN32_FIND_DATAW findData;
+        HANDLE hFind = FindFirstFileExW((longPath(path) + L"\\*").c_str(), FindExInfoBasic, &findData,
+            FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+        if (hFind == INVALID_HANDLE_VALUE) return false;
+
+        DirectoryEntry entry;
+        do {
+            const wchar_t* name = findData.cFileName;
+            if (name[0] == L'.' && (name[1] == L'\0' || (name[1] == L'.' && name[2] == L'\0'))) continue;
+            entry.name = narrow(name);
+            entry.directory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            entry.link = (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0 &&
+                (findData.dwReserved0 == IO_REPARSE_TAG_SYMLINK || findData.dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT);
+            LARGE_INTEGER fileSize;
+            fileSize.LowPart = findData.nFileSizeLow;
+            fileSize.HighPart = findData.nFileSizeHigh;
+            entry.sizeBytes = entry.directory ? 0 : static_cast<unsigned long long>(fileSize.QuadPart);
+            entry.modified = FileList::unixTime(findData.ftLastWriteTime);
+            entry.attributes = findData.dwFileAttributes;
+            entries.push_back(entry);
+        } while (FindNextFileW(hFind, &findData));
+        FindClose(hFind);
+        return true;
+    }
+
+    // Volume serial number and file index, through the link to its target
+    std::string identity(const std::string& path) override {
+        HANDLE handle = CreateFileW(longPath(path).c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+        if (handle == INVALID_HANDLE_VALUE) return "";
+        BY_HANDLE_FILE_INFORMATION information;
+        std::string key;
+        if (GetFileInformationByHandle(handle, &information)) {
+            key = std::to_string(information.dwVolumeSerialNumber) + ":" +
+                std::to_string((static_cast<unsigned long long>(information.nFileIndexHigh) << 32) | information.nFileIndexLow);
+        }
+        CloseHandle(handle);
+        return key;
+    }
+
+    char separator() const override { return '\\'; }
+};
+
+}
+
+long long FileList::unixTime(const FILETIME& time) {
+    // FILETIME counts 100 ns steps from 1601
+    ULARGE_INTEGER ticks;
+    ticks.LowPart = time.dwLowDateTime;
+    ticks.HighPart = time.dwHighDateTime;
+    return static_cast<long long>(ticks.QuadPart / 10000000ULL) - 11644473600LL;
+}
+
+std::vector<std::pair<std::string, std::string>> FileList::usualFolders() {
+    std::pair<std::wstring, const char*> folders[] = {
+        { GetDocumentsPath(), "Documents" },
+        { GetDownloadsPath(), "Downloads" },
+        { GetDesktopPath(), "Desktop" },
+        { GetAppDataPath(), "AppData" },
+        { GetProgramFilesPath(), "Program Files" }
+    };
+    std::vector<std::pair<std::string, std::string>> roots;
+    for (const auto& folder : folders) roots.emplace_back(narrow(folder.first.c_str()), folder.second);
+    return roots;
+}
+
+WalkStats FileList::walkFiles(const WalkOptions& options, const std::function<void(const FileInfo&)>& visit) {
+    std::vector<std::pair<std::string, std::string>> roots;
+    for (const auto& root : options.roots) roots.emplace_back(root, "");
+    if (roots.empty()) roots = usualFolders();
+    WindowsDirectorySource source;
+    return DirectoryWalker(source, options).run(roots, visit);
+}
+
+bool FileList::watchFiles(const std::vector<std::string>& roots,
+    const std::function<void(const std::vector<std::string>& paths)>& changed, const std::atomic<bool>& stop) {
+    // One overlapped ReadDirectoryChangesW per root, covering its whole subtree
+    struct Watch {
+        std::string root;
+        HANDLE directory;
+        OVERLAPPED overlapped;
+        std::vector<DWORD> buffer;   // DWORD-aligned, as the call requires
+    };
+    const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+        FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_ATTRIBUTES;
+    std::vector<std::unique_ptr<Watch>> watches;
+    auto arm = [&](Watch& watch) {
+        ResetEvent(watch.overlapped.hEvent);
+        return ReadDirectoryChangesW(watch.directory, watch.buffer.data(),
+            static_cast<DWORD>(watch.buffer.size() * sizeof(DWORD)), TRUE, filter, NULL, &watch.overlapped, NULL) != 0;
+    };
+    for (const auto& root : roots) {
+        HANDLE directory = CreateFileW(longPath(root).c_str(), FILE_LIST_DIRECTORY,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+            FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+        if (directory == INVALID_HANDLE_VALUE) continue;
+        std::unique_ptr<Watch> watch(new Watch());
+        watch->root = root;
+        watch->directory = directory;
+        ZeroMemory(&watch->overlapped, sizeof(watch->overlapped));
+        watch->overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+        watch->buffer.resize(64 * 1024 / sizeof(DWORD));
+        if (!watch->overlapped.hEvent || !arm(*watch)) {
+            if (watch->overlapped.hEvent) CloseHandle(watch->overlapped.hEvent);
+            CloseHandle(directory);
+            continue;
+        }
+        watches.push_back(std::move(watch));
+    }
+    if (watches.empty()) return false;
+
+    std::vector<HANDLE> events;
+    for (const auto& watch : watches) events.push_back(watch->overlapped.hEvent);
+    std::vector<std::string> paths;
+    while (!stop) {
+        // Wakes twice a second to notice stop
+        DWORD result = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, 500);
+        if (result == WAIT_TIMEOUT) continue;
+        if (result >= WAIT_OBJECT_0 + events.size()) break;
+
+        Watch& watch = *watches[result - WAIT_OBJECT_0];
+        DWORD bytes = 0;
+        paths.clear();
+        if (!GetOverlappedResult(watch.directory, &watch.overlapped, &bytes, FALSE) || bytes == 0) {
+            // The buffer overflowed, so what changed is unknown
+            paths.push_back(watch.root);
+        }
+        else {
+            const char* at = reinterpret_cast<const char*>(watch.buffer.data());
+            while (true) {
+                const FILE_NOTIFY_INFORMATION* note = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(at);
+                std::wstring name(note->FileName, note->FileNameLength / sizeof(WCHAR));
+                std::string path = watch.root + "\\" + narrow(name.c_str());
+                // A folder is modified whenever its entries change, which are reported themselves
+                DWORD attributes = note->Action == FILE_ACTION_MODIFIED ?
+                    GetFileAttributesW(longPath(path).c_str()) : INVALID_FILE_ATTRIBUTES;
+                bool folderWrite = attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+                if (!folderWrite) paths.push_back(path);
+                if (note->NextEntryOffset == 0) break;
+                at += note->NextEntryOffset;
+            }
+        }
+        if (!arm(watch)) paths.push_back(watch.root);
+        changed(paths);
+    }
+
+    for (const auto& watch : watches) {
+        CancelIoEx(watch->directory, &watch->overlapped);
+        DWORD bytes = 0;
+        GetOverlappedResult(watch->directory, &watch->overlapped, &bytes, TRUE);
+        CloseHandle(watch->overlapped.hEvent);
+        CloseHandle(watch->directory);
+    }
     return true;
 }
 
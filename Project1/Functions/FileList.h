@@ -1,5 +1,6 @@
 #pragma once
 #include "..\Libs\Header.h"
+#include "..\Platform\Platform.h"
 
 class FileList {
 private:
@@ -23,6 +24,16 @@ public:
 
     // Simple file writing method
     bool writeFilesToFile(const std::string& filename);
+    bool writeFilesToStream(std::ostream& outFile);
+    bool enumerateFiles(const std::function<void(const FileInfo&)>& visit);
+    // The five folders above, with their labels
+    std::vector<std::pair<std::string, std::string>> usualFolders();
+    // Walks options.roots, or the five folders, on DirectoryWalker's threads
+    WalkStats walkFiles(const WalkOptions& options, const std::function<void(const FileInfo&)>& visit);
+    // See FileBackend::watchFiles
+    bool watchFiles(const std::vector<std::string>& roots,
+        const std::function<void(const std::vector<std::string>& paths)>& changed, const std::atomic<bool>& stop);
+    static long long unixTime(const FILETIME& time);
     // Delete files method
     bool deleteFiles(const std::vector<std::string>& filePaths, std::string& logFileName);
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 const vector<wstring> RunningApps::shortcutLocations = {
     L"C:\\ProgramData\\Microsoft\\Windows\\Start Menu\\Programs",
+    L"%APPDATA%\\Microsoft\\Windows\\Start Menu\\Programs",
     L"C:\\Users\\Default\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\Programs",
     L"C:\\Users\\Public\\Desktop"
 };
@@ -18,40 +19,98 @@ std::string RunningApps::WCharToString(const WCHAR* wchar) {
     int size = WideCharToMultiByte(CP_UTF8, 0, wchar, -1, nullptr, 0, nullptr, nullptr);
     std::string str(size, 0);
     WideCharToMultiByte(CP_UTF8, 0, wchar, -1, &str[0], size, nullptr, nullptr);
+    str.resize(size > 0 ? size - 1 : 0);   // Drop the terminator the count included
     return str;
 }
 
-wstring RunningApps::FindShortcutPath(const string& appName) {
-    // Expand environment variables in paths
-    wchar_t expandedPath[MAX_PATH];
+void RunningApps::WCharToString(const WCHAR* wchar, std::string& str) {
+    int size = WideCharToMultiByte(CP_UTF8, 0, wchar, -1, nullptr, 0, nullptr, nullptr);
+    str.resize(size > 0 ? size : 1);
+    WideCharToMultiByte(CP_UTF8, 0, wchar, -1, &str[0], size, nullptr, nullptr);
+    str.resize(size > 0 ? size - 1 : 0);
+}
 
+static unsigned long long fileTimeValue(const FILETIME& time) {
+    return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+}
+
+wstring RunningApps::StringToWString(const std::string& str) {
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0);
+    wstring wstr(size > 0 ? size : 1, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &wstr[0], size);
+    wstr.resize(size > 0 ? size - 1 : 0);
+    return wstr;
+}
+
+vector<wstring> RunningApps::expandedShortcutLocations() {
+    vector<wstring> roots;
+    wchar_t expandedPath[MAX_PATH];
     for (const auto& location : shortcutLocations) {
-        // Expand environment variables
         ExpandEnvironmentStringsW(location.c_str(), expandedPath, MAX_PATH);
-
-        // Check access rights
-        DWORD attributes = GetFileAttributesW(expandedPath);
-        if (attributes == INVALID_FILE_ATTRIBUTES) {
-            DWORD error = GetLastError();
+        if (GetFileAttributesW(expandedPath) == INVALID_FILE_ATTRIBUTES) {
             continue; // Skip inaccessible locations
         }
+        roots.push_back(expandedPath);
+    }
+    return roots;
+}
 
-        wstring searchPattern = expandedPath + wstring(L"\\*") +
-            wstring(appName.begin(), appName.end()) + L"*.lnk";
+void RunningApps::scanShortcutDirectory(const wstring& directory, vector<ShortcutEntry>& entries, int depth) {
+    WIN32_FIND_DATAW findData;
+    HANDLE hFind = FindFirstFileW((directory + L"\\*").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE) return;
 
-        WIN32_FIND_DATAW findData;
-        HANDLE hFind = FindFirstFileW(searchPattern.c_str(), &findData);
+    do {
+        wstring fileName = findData.cFileName;
+        if (fileName == L"." || fileName == L"..") continue;
+        wstring fullPath = directory + L"\\" + fileName;
 
-        if (hFind != INVALID_HANDLE_VALUE) {
-            wstring fullPath = expandedPath + wstring(L"\\") + findData.cFileName;
-            FindClose(hFind);
-            return fullPath;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            // Start Menu folders nest a few levels at most; the cap guards against junction loops
+            if (depth < 8 && !(findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+                scanShortcutDirectory(fullPath, entries, depth + 1);
+            }
         }
-        if (hFind != INVALID_HANDLE_VALUE) {
-            FindClose(hFind);
+        else if (fileName.size() > 4 && _wcsicmp(fileName.c_str() + fileName.size() - 4, L".lnk") == 0) {
+            ShortcutEntry entry;
+            entry.name = WCharToString(fileName.substr(0, fileName.size() - 4).c_str());
+            entry.path = WCharToString(fullPath.c_str());
+            entries.push_back(move(entry));
         }
+    } while (FindNextFileW(hFind, &findData));
+    FindClose(hFind);
+}
+
+void RunningApps::scanShortcuts(vector<ShortcutEntry>& entries) {
+    for (const auto& root : expandedShortcutLocations()) {
+        scanShortcutDirectory(root, entries, 0);
     }
-    return L"";
+}
+
+void RunningApps::watchShortcutLocations(vector<wstring> roots) {
+    vector<HANDLE> handles;
+    for (const auto& root : roots) {
+        HANDLE handle = FindFirstChangeNotificationW(root.c_str(), TRUE,
+            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+        if (handle != INVALID_HANDLE_VALUE) handles.push_back(handle);
+    }
+
+    while (!handles.empty()) {
+        DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE);
+        if (result >= WAIT_OBJECT_0 + handles.size()) break;
+        shortcutIndex().invalidate();
+        if (!FindNextChangeNotification(handles[result - WAIT_OBJECT_0])) break;
+    }
+
+    for (HANDLE handle : handles) FindCloseChangeNotification(handle);
+}
+
+ShortcutIndex& RunningApps::shortcutIndex() {
+    static ShortcutIndex index(&RunningApps::scanShortcuts);
+    static once_flag watching;
+    // The watcher lives as long as the process, like the index
+    call_once(watching, [] { thread(&RunningApps::watchShortcutLocations, expandedShortcutLocations()).detach(); });
+    return index;
 }
 
 vector<ProcessInfo> RunningApps::getRunningApps() {
@@ -64,6 +123,7 @@ vector<ProcessInfo> RunningApps::getRunningApps() {
 
     PROCESSENTRY32W processEntry;
     processEntry.dwSize = sizeof(processEntry);
+    apps.reserve(512);
 
     if (Process32FirstW(snapshot, &processEntry)) {
         do {
@@ -73,18 +133,10 @@ vector<ProcessInfo> RunningApps::getRunningApps() {
             if (processHandle) {
                 ProcessInfo info;
                 info.processId = processEntry.th32ProcessID;
-                info.name = string(begin(processEntry.szExeFile),
-                    end(processEntry.szExeFile));
+                info.name = WCharToString(processEntry.szExeFile);
                 info.memoryUsage = getProcessMemoryUsage(processHandle);
 
-                // Convert process name from wide string
-                char processName[MAX_PATH];
-                size_t numChars;
-                wcstombs_s(&numChars, processName, MAX_PATH,
-                    processEntry.szExeFile, wcslen(processEntry.szExeFile));
-                info.name = processName;
-
-                apps.push_back(info);
+                apps.push_back(move(info));
                 CloseHandle(processHandle);
             }
         } while (Process32NextW(snapshot, &processEntry));
@@ -101,93 +153,342 @@ vector<ProcessInfo> RunningApps::getRunningApps() {
     return apps;
 }
 
-void RunningApps::startAppsFromShortcuts(const vector<string>& appNames, const string& logFileName) {
-    ofstream logFile(logFileName, ios::app);
-    time_t now = time(nullptr);
-    char timeStr[26];
-    ctime_s(timeStr, sizeof(timeStr), &now);
-    logFile << "\n=== App Launch Log " << timeStr << "===\n";
+bool RunningApps::sampleProcesses(vector<ProcessCounters>& counters) {
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) {
+        return false;
+    }
 
-    for (const auto& appName : appNames) {
-        wstring shortcutPath = FindShortcutPath(appName);
+    PROCESSENTRY32W processEntry;
+    processEntry.dwSize = sizeof(processEntry);
+    size_t count = 0;
+
+    if (Process32FirstW(snapshot, &processEntry)) {
+        do {
+            if (count == counters.size()) counters.emplace_back();
+            ProcessCounters& sample = counters[count++];
+            WCharToString(processEntry.szExeFile, sample.name);
+            sample.processId = processEntry.th32ProcessID;
+            sample.parentProcessId = processEntry.th32ParentProcessID;
+            sample.threads = processEntry.cntThreads;
+
+            // Limited rights open more processes than PROCESS_QUERY_INFORMATION
+            // and still cover times, memory, I/O and handle counts. Protected
+            // processes stay in with zero counters, so trees do not break at them.
+            HANDLE processHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION,
+                FALSE, processEntry.th32ProcessID);
+            if (!processHandle) {
+                sample.startTime = 0;
+                sample.cpuMicroseconds = 0;
+                sample.handles = 0;
+                sample.privateBytes = 0;
+                sample.workingSet = 0;
+                sample.readBytes = 0;
+                sample.writeBytes = 0;
+                continue;
+            }
+
+            FILETIME created, exited, kernel, user;
+            if (GetProcessTimes(processHandle, &created, &exited, &kernel, &user)) {
+                sample.startTime = fileTimeValue(created);
+                sample.cpuMicroseconds = (fileTimeValue(kernel) + fileTimeValue(user)) / 10;
+            }
+            else {
+                sample.startTime = 0;
+                sample.cpuMicroseconds = 0;
+            }
+
+            DWORD handleCount = 0;
+            sample.handles = GetProcessHandleCount(processHandle, &handleCount) ? handleCount : 0;
+
+            PROCESS_MEMORY_COUNTERS_EX memory;
+            if (GetProcessMemoryInfo(processHandle, reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memory), sizeof(memory))) {
+                sample.privateBytes = memory.PrivateUsage;
+                sample.workingSet = memory.WorkingSetSize;
+            }
+            else {
+                sample.privateBytes = 0;
+                sample.workingSet = 0;
+            }
+
+            IO_COUNTERS io;
+            if (GetProcessIoCounters(processHandle, &io)) {
+                sample.readBytes = io.ReadTransferCount;
+                sample.writeBytes = io.WriteTransferCount;
+            }
+            else {
+                sample.readBytes = 0;
+                sample.writeBytes = 0;
+            }
+
+            CloseHandle(processHandle);
+        } while (Process32NextW(snapshot, &processEntry));
+    }
+
+    CloseHandle(snapshot);
+    counters.resize(count);
+    return true;
+}
+
+bool RunningApps::writeAppsToStream(ostream& out) {
+    vector<ProcessInfo> processes = getRunningApps();
+    for (const auto& process : processes) {
+        out << "Process Name: " << process.name << endl;
+        out << "Process ID: " << process.processId << endl;
+        out << "Memory Usage: " << process.memoryUsage << " bytes" << endl;
+        out << endl;
+    }
+    return true;
+}
+
+struct WindowSearch {
+    DWORD processId;
+    bool found;
+};
+
+static BOOL CALLBACK findVisibleWindow(HWND window, LPARAM param) {
+    WindowSearch* search = reinterpret_cast<WindowSearch*>(param);
+    DWORD owner = 0;
+    GetWindowThreadProcessId(window, &owner);
+    if (owner == search->processId && IsWindowVisible(window) && GetWindow(window, GW_OWNER) == NULL) {
+        search->found = true;
+        return FALSE;
+    }
+    return TRUE;
+}
 
-        if (shortcutPath.empty()) {
-            logFile << "Failed to find shortcut for: " << appName << "\n";
+// A visible top-level window that belongs to the process
+static bool hasVisibleWindow(DWORD processId) {
+    WindowSearch search = { processId, false };
+    EnumWindows(findVisibleWindow, reinterpret_cast<LPARAM>(&search));
+    return search.found;
+}
+
+void RunningApps::waitUntilReady(HANDLE process, chrono::steady_clock::time_point launchedAt, LaunchResult& result) {
+    result.processId = GetProcessId(process);
+    auto deadline = launchedAt + chrono::milliseconds(ProcessBackend::LAUNCH_READY_MS);
+
+    while (true) {
+        auto remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        // Short slices, so a main window shown before the first idle also counts
+        DWORD idle = WaitForInputIdle(process, static_cast<DWORD>(max<long long>(0, min<long long>(remaining, 50))));
+
+        if (WaitForSingleObject(process, 0) == WAIT_OBJECT_0) {
+            DWORD exitCode = 0;
+            GetExitCodeProcess(process, &exitCode);
+            result.readiness = "exited";
+            result.exitCode = static_cast<int>(exitCode);
+        }
+        else if (idle == 0) {
+            result.readiness = "input idle";
+        }
+        else if (idle == WAIT_FAILED) {
+            // Console programs have no message queue to go idle; running is as ready as they get
+            result.readiness = "console";
+        }
+        else if (hasVisibleWindow(result.processId)) {
+            result.readiness = "window";
+        }
+        else if (remaining <= 0) {
+            result.readiness = "timed out";
+        }
+        else {
             continue;
         }
+        break;
+    }
+    result.readyMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - launchedAt).count();
+}
+
+void RunningApps::launchShortcut(wstring shortcutPath, LaunchResult& result) {
+    // Shortcuts can be resolved through COM, so each launcher thread has its own apartment
+    HRESULT com = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
 
-        HINSTANCE result = ShellExecuteW(
-            NULL,           // Parent window
-            L"open",       // Operation
-            shortcutPath.c_str(),  // File to execute
-            NULL,          // Parameters
-            NULL,          // Working directory
-            SW_SHOWNORMAL  // Show command
-        );
+    SHELLEXECUTEINFOW info = { sizeof(info) };
+    info.fMask = SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI;
+    info.lpVerb = L"open";
+    info.lpFile = shortcutPath.c_str();
+    info.nShow = SW_SHOWNORMAL;
 
-        if ((INT_PTR)result > 32) {
-            logFile << "Successfully launched: " << appName << "\n";
+    auto launchedAt = chrono::steady_clock::now();
+    if (!ShellExecuteExW(&info)) {
+        result.error = GetLastError();
+    }
+    else {
+        result.started = true;
+        if (info.hProcess) {
+            waitUntilReady(info.hProcess, launchedAt, result);
+            CloseHandle(info.hProcess);
         }
         else {
-            DWORD error = GetLastError();
-            logFile << "Failed to launch: " << appName
-                << " (Error code: " << error << ")\n";
+            // DDE and single-instance apps take the request into a process we get no handle to
+            result.readiness = "unknown";
         }
     }
 
-    logFile << "=== End of Log ===\n\n";
-    logFile.close();
+    if (SUCCEEDED(com)) CoUninitialize();
 }
 
-void RunningApps::endSelectedTasks(const vector<string>& appNames, const string& logFileName) {
+void RunningApps::startAppsFromShortcuts(const vector<string>& appNames, const string& logFileName) {
     ofstream logFile(logFileName, ios::app);
     time_t now = time(nullptr);
     char timeStr[26];
     ctime_s(timeStr, sizeof(timeStr), &now);
-    logFile << "\n=== Task Termination Log " << timeStr << "===\n";
+    logFile << "\n=== App Launch Log " << timeStr << "===\n";
+
+    auto started = chrono::steady_clock::now();
+    vector<LaunchResult> results(appNames.size());
+    vector<thread> launchers;
+    for (size_t i = 0; i < appNames.size(); i++) {
+        LaunchResult& result = results[i];
+        result.name = appNames[i];
+
+        ShortcutMatch match;
+        if (!shortcutIndex().lookup(appNames[i], match)) {
+            for (const auto& suggestion : shortcutIndex().suggest(appNames[i], 3)) {
+                result.suggestions.push_back(suggestion.entry.name);
+            }
+            continue;
+        }
+        if (strcmp(match.kind, "exact") != 0) {
+            result.note = match.entry.name + ", " + match.kind + " match";
+        }
+        // One thread per app, so the batch takes as long as its slowest app
+        launchers.emplace_back(&RunningApps::launchShortcut, StringToWString(match.entry.path), ref(result));
+    }
+    for (auto& launcher : launchers) launcher.join();
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+    writeLaunchResults(logFile, results, elapsed);
+    logFile << "=== End of Log ===\n\n";
+    logFile.close();
+}
+
+void RunningApps::endSelectedTasks(const vector<string>& appNames, const string& logFileName) {
+    // Requested names, case-folded once, so each process is one hash lookup
+    unordered_set<string> wanted;
+    for (const auto& appName : appNames) {
+        string name = appName;
+        transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        wanted.insert(name);
+    }
 
     HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
     if (snapshot == INVALID_HANDLE_VALUE) {
+        ofstream logFile(logFileName, ios::app);
+        time_t now = time(nullptr);
+        char timeStr[26];
+        ctime_s(timeStr, sizeof(timeStr), &now);
+        logFile << "\n=== Task Termination Log " << timeStr << "===\n";
         logFile << "Failed to create process snapshot\n";
         return;
     }
 
+    vector<ProcessTarget> targets;
     PROCESSENTRY32W processEntry;
     processEntry.dwSize = sizeof(processEntry);
+    string processName;
 
     if (Process32FirstW(snapshot, &processEntry)) {
         do {
-            string processName = WCharToString(processEntry.szExeFile);
-
-            for (const auto& appName : appNames) {
-                if (_stricmp(processName.c_str(), appName.c_str()) == 0) {
-                    HANDLE processHandle = OpenProcess(PROCESS_TERMINATE, FALSE, processEntry.th32ProcessID);
-
-                    if (processHandle) {
-                        if (TerminateProcess(processHandle, 1)) {
-                            logFile << "Successfully terminated " << appName
-                                << " (PID: " << processEntry.th32ProcessID << ")\n";
-                        }
-                        else {
-                            DWORD error = GetLastError();
-                            logFile << "Failed to terminate " << appName
-                                << " (PID: " << processEntry.th32ProcessID
-                                << ") - Error code: " << error << "\n";
-                        }
-                        CloseHandle(processHandle);
-                    }
-                    else {
-                        DWORD error = GetLastError();
-                        logFile << "Failed to open process " << appName
-                            << " (PID: " << processEntry.th32ProcessID
-                            << ") - Error code: " << error << "\n";
-                    }
-                }
-            }
+            WCharToString(processEntry.szExeFile, processName);
+            for (auto& c : processName) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+            if (wanted.find(processName) == wanted.end()) continue;
+
+            ProcessTarget target;
+            target.name = WCharToString(processEntry.szExeFile);
+            target.processId = processEntry.th32ProcessID;
+            targets.push_back(target);
         } while (Process32NextW(snapshot, &processEntry));
     }
-
     CloseHandle(snapshot);
+
+    terminateProcesses(targets, logFileName);
+}
+
+void RunningApps::terminateProcesses(const vector<ProcessTarget>& targets, const string& logFileName) {
+    ofstream logFile(logFileName, ios::app);
+    time_t now = time(nullptr);
+    char timeStr[26];
+    ctime_s(timeStr, sizeof(timeStr), &now);
+    logFile << "\n=== Task Termination Log " << timeStr << "===\n";
+
+    struct Termination {
+        string name;
+        DWORD processId;
+        HANDLE handle;
+        FILETIME issuedAt;
+    };
+    vector<Termination> terminations;
+    auto started = chrono::steady_clock::now();
+
+    // TerminateProcess only starts the exit, so every kill is in flight before the first wait
+    for (const auto& target : targets) {
+        HANDLE processHandle = OpenProcess(PROCESS_TERMINATE | SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION,
+            FALSE, target.processId);
+        if (!processHandle) {
+            DWORD error = GetLastError();
+            logFile << "Failed to open process " << target.name
+                << " (PID: " << target.processId
+                << ") - Error code: " << error << "\n";
+            continue;
+        }
+
+        FILETIME created, exited, kernel, user;
+        if (target.startTime != 0 &&
+            (!GetProcessTimes(processHandle, &created, &exited, &kernel, &user) || fileTimeValue(created) != target.startTime)) {
+            logFile << "Skipped " << target.name << " (PID: " << target.processId
+                << ") - the PID now belongs to another process\n";
+            CloseHandle(processHandle);
+            continue;
+        }
+
+        FILETIME issuedAt;
+        GetSystemTimeAsFileTime(&issuedAt);
+        if (!TerminateProcess(processHandle, 1)) {
+            DWORD error = GetLastError();
+            logFile << "Failed to terminate " << target.name
+                << " (PID: " << target.processId
+                << ") - Error code: " << error << "\n";
+            CloseHandle(processHandle);
+            continue;
+        }
+        terminations.push_back({ target.name, target.processId, processHandle, issuedAt });
+    }
+
+    // One deadline for the whole set, waited in groups of MAXIMUM_WAIT_OBJECTS
+    auto deadline = started + chrono::milliseconds(ProcessBackend::TERMINATE_WAIT_MS);
+    for (size_t first = 0; first < terminations.size(); first += MAXIMUM_WAIT_OBJECTS) {
+        vector<HANDLE> group;
+        for (size_t i = first; i < min(terminations.size(), first + MAXIMUM_WAIT_OBJECTS); i++) {
+            group.push_back(terminations[i].handle);
+        }
+        auto remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        WaitForMultipleObjects(static_cast<DWORD>(group.size()), group.data(), TRUE, static_cast<DWORD>(max<long long>(remaining, 0)));
+    }
+
+    // The kernel records each exit time, so time-to-exit needs no per-process wait
+    size_t confirmed = 0;
+    for (const auto& termination : terminations) {
+        FILETIME creation, exit, kernel, user;
+        if (WaitForSingleObject(termination.handle, 0) == WAIT_OBJECT_0 &&
+            GetProcessTimes(termination.handle, &creation, &exit, &kernel, &user)) {
+            long long exitMs = (static_cast<long long>(fileTimeValue(exit)) - static_cast<long long>(fileTimeValue(termination.issuedAt))) / 10000;
+            logFile << "Successfully terminated " << termination.name
+                << " (PID: " << termination.processId << ") - exited in " << max<long long>(exitMs, 0) << " ms\n";
+            confirmed++;
+        }
+        else {
+            logFile << "Termination requested for " << termination.name
+                << " (PID: " << termination.processId << ") - still running after "
+                << ProcessBackend::TERMINATE_WAIT_MS << " ms\n";
+        }
+        CloseHandle(termination.handle);
+    }
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+    logFile << "Confirmed " << confirmed << " of " << terminations.size()
+        << " terminations in " << elapsed << " ms\n";
     logFile << "=== End of Log ===\n\n";
     logFile.close();
 }
@@ -1,22 +1,34 @@
 #pragma once
 #include "..\Libs\Header.h"
-
-struct ProcessInfo {
-    string name;
-    DWORD processId;
-    SIZE_T memoryUsage;
-};
+#include "..\Platform\Platform.h"
+#include "..\Platform\ShortcutIndex.h"
 
 class RunningApps {
 public:
     static vector<ProcessInfo> getRunningApps();
+    // Toolhelp snapshot plus one limited-rights handle per process
+    static bool sampleProcesses(vector<ProcessCounters>& counters);
+    static bool writeAppsToStream(ostream& out);
     static void startAppsFromShortcuts(const vector<string>& appNames, const string& logFileName);
     static void endSelectedTasks(const vector<string>& appNames, const string& logFileName);
+    static void terminateProcesses(const vector<ProcessTarget>& targets, const string& logFileName);
 private:
     static SIZE_T getProcessMemoryUsage(HANDLE process);
     static std::string WCharToString(const WCHAR* wchar);
+    static void WCharToString(const WCHAR* wchar, std::string& str);   // Into str's existing buffer
     
-    static wstring FindShortcutPath(const string& appName);
+    static wstring StringToWString(const std::string& str);
+
+    // Opens one shortcut and waits for its app to come up; runs on its own thread
+    static void launchShortcut(wstring shortcutPath, LaunchResult& result);
+    static void waitUntilReady(HANDLE process, chrono::steady_clock::time_point launchedAt, LaunchResult& result);
+
+    // Start Menu shortcuts, scanned once and rescanned after a change notification
+    static ShortcutIndex& shortcutIndex();
+    static vector<wstring> expandedShortcutLocations();
+    static void scanShortcuts(vector<ShortcutEntry>& entries);
+    static void scanShortcutDirectory(const wstring& directory, vector<ShortcutEntry>& entries, int depth);
+    static void watchShortcutLocations(vector<wstring> roots);
 
     // Common locations for shortcuts
     static const vector<wstring> shortcutLocations;
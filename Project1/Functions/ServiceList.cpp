@@ -1,78 +1,61 @@
 #include "ServiceList.h"
+#include "../Server/Metrics.h"
+#include "../Platform/ServiceController.h"
+
+namespace {
+
+// "Failed to open Service Control Manager: Access is denied. (error 5)"
+string describeError(const string& what, DWORD error) {
+    char text[256] = "";
+    FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+        NULL, error, 0, text, sizeof(text), NULL);
+    string message(text);
+    while (!message.empty() && isspace(static_cast<unsigned char>(message.back()))) message.pop_back();
+    return what + ": " + message + " (error " + to_string(error) + ")";
+}
 
-ServiceList::ServiceList() {
-    // Use checkAdminRights() instead of inline check
-    if (!checkAdminRights()) {
-        DWORD error = GetLastError();
-        wchar_t msg[256];
-        wchar_t errorMsg[256];
-
-        FormatMessageW(
-            FORMAT_MESSAGE_FROM_SYSTEM,
-            NULL,
-            error,
-            0,
-            errorMsg,
-            256,
-            NULL
-        );
-
-        swprintf_s(msg, L"Application must run as administrator.\nError Code: %lu\nDescription: %s",
-            error, errorMsg);
-        MessageBoxW(NULL, msg, L"Admin Rights Required", MB_ICONERROR);
-        return;
-    }
+}
 
-    // Use elevatePrivileges() to get required access
-    if (!elevatePrivileges()) {
-        DWORD error = GetLastError();
-        wchar_t msg[256];
-        wchar_t errorMsg[256];
-
-        FormatMessageW(
-            FORMAT_MESSAGE_FROM_SYSTEM,
-            NULL,
-            error,
-            0,
-            errorMsg,
-            256,
-            NULL
-        );
-
-        swprintf_s(msg, L"Failed to obtain required privileges.\nError Code: %lu\nDescription: %s",
-            error, errorMsg);
-        MessageBoxW(NULL, msg, L"Privilege Error", MB_ICONERROR);
-        return;
-    }
+ScmSession::ScmSession() : manager(NULL), privilegesChecked(false) {
+}
 
-    // Try to open SCManager with retry
-    for (int i = 0; i < 3; i++) {
-        schSCManager = OpenSCManager(NULL, NULL, SC_MANAGER_ALL_ACCESS);
-        if (schSCManager) break;
-        Sleep(1000);
-    }
+ScmSession::~ScmSession() {
+    if (manager) CloseServiceHandle(manager);
+}
 
-    if (!schSCManager) {
-        DWORD error = GetLastError();
-        wchar_t msg[256];
-        wchar_t errorMsg[256];
-
-        FormatMessageW(
-            FORMAT_MESSAGE_FROM_SYSTEM,
-            NULL,
-            error,
-            0,
-            errorMsg,
-            256,
-            NULL
-        );
-
-        swprintf_s(msg, L"Failed to open Service Control Manager.\nError Code: %lu\nDescription: %s",
-            error, errorMsg);
-        MessageBoxW(NULL, msg, L"Error", MB_ICONERROR);
+ScmSession& ScmSession::shared() {
+    static ScmSession session;
+    return session;
+}
+
+SC_HANDLE ScmSession::handle() {
+    lock_guard<mutex> lock(sessionMutex);
+    if (manager) return manager;
+
+    // The token keeps both for the life of the process, so they are checked once
+    if (!privilegesChecked) {
+        privilegesChecked = true;
+        if (!checkAdminRights()) privilegeError = describeError("The server must run as administrator", GetLastError());
+        else if (!elevatePrivileges()) privilegeError = describeError("Failed to obtain required privileges", GetLastError());
     }
+    if (!privilegeError.empty()) throw runtime_error(privilegeError);
+
+    auto now = chrono::steady_clock::now();
+    if (!openError.empty() && now < retryAt) throw runtime_error(openError);
+    manager = OpenSCManagerW(NULL, NULL, SC_MANAGER_ALL_ACCESS);
+    if (!manager) {
+        openError = describeError("Failed to open Service Control Manager", GetLastError());
+        retryAt = now + chrono::seconds(RETRY_SECONDS);
+        cout << openError << endl;
+        throw runtime_error(openError);
+    }
+    openError.clear();
+    cout << "Service Control Manager session opened in "
+        << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - now).count() << " ms" << endl;
+    return manager;
 }
-bool ServiceList::checkAdminRights() {
+
+bool ScmSession::checkAdminRights() {
     BOOL isAdmin = FALSE;
     PSID adminGroup;
     SID_IDENTIFIER_AUTHORITY ntAuthority = SECURITY_NT_AUTHORITY;
@@ -101,7 +84,7 @@ bool ServiceList::checkAdminRights() {
     return false;
 }
 
-bool ServiceList::elevatePrivileges() {
+bool ScmSession::elevatePrivileges() {
     HANDLE hToken;
     if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken)) {
         return false;
@@ -134,10 +117,6 @@ bool ServiceList::elevatePrivileges() {
     return success;
 }
 
-ServiceList::~ServiceList() {
-    if (schSCManager) CloseServiceHandle(schSCManager);
-}
-
 std::string ServiceList::getServiceStatusString(DWORD dwCurrentState) {
     switch (dwCurrentState) {
     case SERVICE_STOPPED: return "Stopped";
@@ -151,19 +130,108 @@ std::string ServiceList::getServiceStatusString(DWORD dwCurrentState) {
     }
 }
 
+std::string ServiceList::getStartTypeString(DWORD dwStartType) {
+    switch (dwStartType) {
+    case SERVICE_AUTO_START: return "Auto";
+    case SERVICE_DEMAND_START: return "Manual";
+    case SERVICE_DISABLED: return "Disabled";
+    case SERVICE_BOOT_START: return "Boot";
+    case SERVICE_SYSTEM_START: return "System";
+    default: return "Unknown";
+    }
+}
+
 // Implement wcharToString
 std::string ServiceList::wcharToString(LPWSTR wstr) {
     if (!wstr) return "";
     int size = WideCharToMultiByte(CP_UTF8, 0, wstr, -1, nullptr, 0, nullptr, nullptr);
     std::string str(size, 0);
     WideCharToMultiByte(CP_UTF8, 0, wstr, -1, &str[0], size, nullptr, nullptr);
+    str.resize(size > 0 ? size - 1 : 0);   // Drop the terminator, or filters never match
     return str;
 }
 
+// Shared by every ServiceList, which handlers create per command
+static ServiceConfigCache& configCache() {
+    static ServiceConfigCache cache(ServiceConfigCache::DEFAULT_FILE);
+    return cache;
+}
+
+// The snapshot refresher, queries and deltas enumerate at the same time, but a
+// pass's seen marks and counts must stay its own until it has saved
+static mutex configPassMutex;
+
 bool ServiceList::writeServicesToFile(const std::string& filename) {
     std::ofstream file(filename);
     if (!file.is_open()) return false;
 
+    bool written = writeServicesToStream(file);
+    file.close();
+    return written;
+}
+
+bool ServiceList::writeServicesToStream(std::ostream& file) {
+    file << "=== Windows Services List ===\n\n";
+    int index = 0;
+    bool listed = enumerateServices([&](const ServiceInfo& service) {
+        file << "Service #" << ++index << "\n";
+        file << "==================\n";
+        file << "System Name: " << service.name << "\n";
+        file << "Display Name: " << service.displayName << "\n";
+        file << "Status: " << service.status << "\n";
+        file << "Description: " << (service.description.empty() ?
+            "No description available" : service.description) << "\n";
+        file << "Process ID: " << service.processId << "\n";
+        file << "------------------\n\n";
+    });
+    if (listed) file << configCache().describe() << "\n";
+    return listed;
+}
+
+// The service's registry key changes whenever its configuration or description
+// does, and reading the key's write time needs no round trip to the SCM
+static unsigned long long configMarker(HKEY servicesKey, LPCWSTR serviceName) {
+    HKEY serviceKey = NULL;
+    if (!servicesKey || RegOpenKeyExW(servicesKey, serviceName, 0, KEY_QUERY_VALUE, &serviceKey) != ERROR_SUCCESS) {
+        return 0;
+    }
+    FILETIME written = {};
+    LONG result = RegQueryInfoKeyW(serviceKey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &written);
+    RegCloseKey(serviceKey);
+    if (result != ERROR_SUCCESS) return 0;
+    return (static_cast<unsigned long long>(written.dwHighDateTime) << 32) | written.dwLowDateTime;
+}
+
+bool ServiceList::queryConfig(SC_HANDLE schSCManager, LPCWSTR serviceName, ServiceConfig& config,
+    vector<BYTE>& description, vector<BYTE>& buffer) {
+    SC_HANDLE hService = OpenServiceW(schSCManager, serviceName, SERVICE_QUERY_CONFIG);
+    if (!hService) return false;
+
+    DWORD needed = 0;
+    config.description.clear();
+    QueryServiceConfig2W(hService, SERVICE_CONFIG_DESCRIPTION, NULL, 0, &needed);
+    if (needed > description.size()) description.resize(needed);
+    if (needed && QueryServiceConfig2W(hService, SERVICE_CONFIG_DESCRIPTION,
+        description.data(), static_cast<DWORD>(description.size()), &needed)) {
+        LPSERVICE_DESCRIPTIONW psd = (LPSERVICE_DESCRIPTIONW)description.data();
+        if (psd->lpDescription) config.description = wcharToString(psd->lpDescription);
+    }
+
+    config.startType = "Unknown";
+    QueryServiceConfigW(hService, NULL, 0, &needed);
+    if (needed > buffer.size()) buffer.resize(needed);
+    if (needed && QueryServiceConfigW(hService, (LPQUERY_SERVICE_CONFIGW)buffer.data(),
+        static_cast<DWORD>(buffer.size()), &needed)) {
+        config.startType = getStartTypeString(((LPQUERY_SERVICE_CONFIGW)buffer.data())->dwStartType);
+    }
+
+    CloseServiceHandle(hService);
+    return true;
+}
+
+bool ServiceList::enumerateServices(const function<void(const ServiceInfo&)>& visit) {
+    SC_HANDLE schSCManager = ScmSession::shared().handle();
+
     DWORD bytesNeeded = 0;
     DWORD servicesReturned = 0;
     DWORD resumeHandle = 0;
@@ -172,51 +240,82 @@ bool ServiceList::writeServicesToFile(const std::string& filename) {
         SERVICE_STATE_ALL, NULL, 0, &bytesNeeded, &servicesReturned,
         &resumeHandle, NULL);
 
-    LPBYTE buffer = new BYTE[bytesNeeded];
+    vector<BYTE> buffer(bytesNeeded);
     LPENUM_SERVICE_STATUS_PROCESS services =
-        (LPENUM_SERVICE_STATUS_PROCESS)buffer;
+        (LPENUM_SERVICE_STATUS_PROCESS)buffer.data();
 
-    if (EnumServicesStatusEx(schSCManager, SC_ENUM_PROCESS_INFO, SERVICE_WIN32,
-        SERVICE_STATE_ALL, buffer, bytesNeeded, &bytesNeeded,
+    if (!EnumServicesStatusEx(schSCManager, SC_ENUM_PROCESS_INFO, SERVICE_WIN32,
+        SERVICE_STATE_ALL, buffer.data(), bytesNeeded, &bytesNeeded,
         &servicesReturned, &resumeHandle, NULL)) {
+        return false;
+    }
 
-        file << "=== Windows Services List ===\n\n";
-        for (DWORD i = 0; i < servicesReturned; i++) {
-            SC_HANDLE hService = OpenServiceW(schSCManager,
-                services[i].lpServiceName,
-                SERVICE_QUERY_CONFIG);
-
-            if (hService) {
-                DWORD bytesNeeded;
-                QueryServiceConfig2W(hService, SERVICE_CONFIG_DESCRIPTION,
-                    NULL, 0, &bytesNeeded);
-                LPSERVICE_DESCRIPTION psd = (LPSERVICE_DESCRIPTION)LocalAlloc(
-                    LPTR, bytesNeeded);
-
-                if (QueryServiceConfig2W(hService, SERVICE_CONFIG_DESCRIPTION,
-                    (LPBYTE)psd, bytesNeeded, &bytesNeeded)) {
-
-                    file << "Service #" << (i + 1) << "\n";
-                    file << "==================\n";
-                    file << "System Name: " << wcharToString(services[i].lpServiceName) << "\n";
-                    file << "Display Name: " << wcharToString(services[i].lpDisplayName) << "\n";
-                    file << "Status: " << getServiceStatusString(
-                        services[i].ServiceStatusProcess.dwCurrentState) << "\n";
-                    file << "Description: " << (psd->lpDescription ?
-                        wcharToString(psd->lpDescription) : "No description available") << "\n";
-                    file << "Process ID: " <<
-                        services[i].ServiceStatusProcess.dwProcessId << "\n";
-                    file << "------------------\n\n";
-                }
-
-                LocalFree(psd);
-                CloseServiceHandle(hService);
+    // Status comes with the enumeration; configs come from the cache when the marker still matches
+    ServiceConfigCache& cache = configCache();
+    unique_lock<mutex> pass(configPassMutex);
+    cache.beginPass();
+    HKEY servicesKey = NULL;
+    RegOpenKeyExW(HKEY_LOCAL_MACHINE, L"SYSTEM\\CurrentControlSet\\Services", 0, KEY_READ, &servicesKey);
+
+    vector<ServiceInfo> infos(servicesReturned);
+    vector<unsigned long long> markers(servicesReturned);
+    vector<char> readable(servicesReturned, 1);
+    vector<DWORD> misses;
+    ServiceConfig config;
+    for (DWORD i = 0; i < servicesReturned; i++) {
+        ServiceInfo& info = infos[i];
+        info.name = wcharToString(services[i].lpServiceName);
+        info.displayName = wcharToString(services[i].lpDisplayName);
+        info.status = getServiceStatusString(services[i].ServiceStatusProcess.dwCurrentState);
+        info.processId = services[i].ServiceStatusProcess.dwProcessId;
+
+        markers[i] = configMarker(servicesKey, services[i].lpServiceName);
+        if (cache.lookup(info.name, markers[i], config)) {
+            info.description = config.description;
+            info.startType = config.startType;
+        }
+        else {
+            misses.push_back(i);
+        }
+    }
+    if (servicesKey) RegCloseKey(servicesKey);
+
+    // The rest are SCM round trips, spread over a few threads with their own buffers
+    atomic<size_t> next(0);
+    auto queryMisses = [&]() {
+        vector<BYTE> description, configBuffer;
+        ServiceConfig queried;
+        for (size_t at = next++; at < misses.size(); at = next++) {
+            DWORD i = misses[at];
+            if (!queryConfig(schSCManager, services[i].lpServiceName, queried, description, configBuffer)) {
+                readable[i] = 0;
+                continue;
             }
+            infos[i].description = queried.description;
+            infos[i].startType = queried.startType;
+            cache.store(infos[i].name, markers[i], queried);
         }
+    };
+    size_t threadCount = min<size_t>(CONFIG_QUERY_THREADS, misses.size());
+    vector<thread> workers;
+    for (size_t t = 1; t < threadCount; t++) workers.emplace_back(queryMisses);
+    queryMisses();
+    for (auto& worker : workers) worker.join();
+
+    cache.save();
+    static Counter& cacheHits = Metrics().counter("remotecontrol_service_config_cache_total",
+        "Service configs read for listService, by where they came from", MetricsRegistry::label("result", "hit"));
+    static Counter& cacheMisses = Metrics().counter("remotecontrol_service_config_cache_total",
+        "Service configs read for listService, by where they came from", MetricsRegistry::label("result", "miss"));
+    cacheHits.inc(static_cast<long long>(cache.hits()));
+    cacheMisses.inc(static_cast<long long>(cache.misses()));
+    cout << cache.describe() << endl;
+    pass.unlock();
+
+    // Services whose config could not be opened are left out, as before
+    for (DWORD i = 0; i < servicesReturned; i++) {
+        if (readable[i]) visit(infos[i]);
     }
-
-    delete[] buffer;
-    file.close();
     return true;
 }
 
@@ -226,93 +325,175 @@ bool ServiceList::isCriticalService(const wchar_t* serviceName) {
         != CRITICAL_SERVICES.end();
 }
 
-bool ServiceList::startService(const vector<string>& serviceNames, const string& logFileName) {
-    ofstream logFile(logFileName, ios::app);
-    time_t now = time(nullptr);
-    char timeStr[26];
-    ctime_s(timeStr, sizeof(timeStr), &now);
-    logFile << "\n=== Service Start Operation Log " << timeStr << "===\n";
-
-    bool allSuccess = true;
+// The SCM side of ServiceController. Dependencies come from each service's
+// configuration. Each requested service is watched with
+// NotifyServiceStatusChangeW; its callback arrives as an APC while
+// waitForChange sleeps alertably, so the thread wakes on the change itself.
+// A service the SCM will not watch is queried again every POLL_MS instead.
+class ScmServiceDriver : public ServiceControlDriver {
+public:
+    explicit ScmServiceDriver(SC_HANDLE manager) : manager(manager) {}
+
+    ~ScmServiceDriver() {
+        // Closing a handle cancels its notification; run any callback already queued
+        for (auto& watch : watches) CloseServiceHandle(watch->service);
+        SleepEx(0, TRUE);
+    }
 
-    for (const auto& serviceName : serviceNames) {
-        wstring wServiceName(serviceName.begin(), serviceName.end());
-        logFile << "Attempting to start service: " << serviceName << "\n";
+    unsigned long request(const string& name, bool start) override {
+        wstring wideName(name.begin(), name.end());
+        SC_HANDLE service = OpenServiceW(manager, wideName.c_str(),
+            SERVICE_START | SERVICE_STOP | SERVICE_QUERY_STATUS);
+        if (!service) return GetLastError();
 
-        if (isCriticalService(wServiceName.c_str())) {
-            logFile << "Cannot modify critical service: " << serviceName << "\n";
-            allSuccess = false;
-            continue;
+        BOOL sent;
+        SERVICE_STATUS status;
+        if (start) sent = ::StartServiceW(service, 0, NULL);
+        else sent = ControlService(service, SERVICE_CONTROL_STOP, &status);
+        DWORD error = sent ? ERROR_SUCCESS : GetLastError();
+        // Already where it was asked to go: the watch reports it at once
+        if (error == ERROR_SERVICE_ALREADY_RUNNING || error == ERROR_SERVICE_NOT_ACTIVE) error = ERROR_SUCCESS;
+        if (error != ERROR_SUCCESS) {
+            CloseServiceHandle(service);
+            return error;
         }
 
-        SC_HANDLE schService = OpenServiceW(schSCManager, wServiceName.c_str(),
-            SERVICE_START | SERVICE_QUERY_STATUS);
-        if (!schService) {
-            DWORD error = GetLastError();
-            logFile << "Failed to open service. Error code: " << error << "\n";
-            allSuccess = false;
-            continue;
+        unique_ptr<Watch> watch(new Watch());
+        watch->service = service;
+        refresh(*watch);
+        arm(*watch);
+        byName[name] = watch.get();
+        watches.push_back(move(watch));
+        return 0;
+    }
+
+    string state(const string& name) override {
+        auto it = byName.find(name);
+        return it == byName.end() ? "" : stateName(it->second->state);
+    }
+
+    vector<string> dependencies(const string& name) override {
+        vector<string> names;
+        wstring wideName(name.begin(), name.end());
+        SC_HANDLE service = OpenServiceW(manager, wideName.c_str(), SERVICE_QUERY_CONFIG);
+        if (!service) return names;
+
+        DWORD needed = 0;
+        QueryServiceConfigW(service, NULL, 0, &needed);
+        vector<BYTE> buffer(needed);
+        LPQUERY_SERVICE_CONFIGW config = reinterpret_cast<LPQUERY_SERVICE_CONFIGW>(buffer.data());
+        if (needed > 0 && QueryServiceConfigW(service, config, needed, &needed) && config->lpDependencies) {
+            // Double-null-terminated; load order groups are marked with SC_GROUP_IDENTIFIERW
+            for (LPWSTR entry = config->lpDependencies; *entry; entry += wcslen(entry) + 1) {
+                if (*entry != SC_GROUP_IDENTIFIERW) names.push_back(ServiceList::wcharToString(entry));
+            }
         }
+        CloseServiceHandle(service);
+        return names;
+    }
 
-        if (::StartServiceW(schService, 0, NULL)) {
-            logFile << "Successfully started service: " << serviceName << "\n";
+    void waitForChange(chrono::steady_clock::time_point deadline) override {
+        bool polling = any_of(watches.begin(), watches.end(),
+            [](const unique_ptr<Watch>& watch) { return watch->polled; });
+        auto now = chrono::steady_clock::now();
+        if (now < deadline) {
+            long long waitMs = chrono::duration_cast<chrono::milliseconds>(deadline - now).count() + 1;
+            if (polling) waitMs = min(waitMs, static_cast<long long>(POLL_MS));
+            // Returns early with WAIT_IO_COMPLETION once a callback has run
+            SleepEx(static_cast<DWORD>(waitMs), TRUE);
         }
-        else {
-            DWORD error = GetLastError();
-            logFile << "Failed to start service. Error code: " << error << "\n";
-            allSuccess = false;
+        for (auto& watch : watches) {
+            if (watch->polled) refresh(*watch);
         }
-
-        CloseServiceHandle(schService);
     }
 
-    logFile << "=== End of Log ===\n\n";
-    logFile.close();
-    return allSuccess;
-}
+private:
+    static const DWORD POLL_MS = 250;
 
-bool ServiceList::stopService(const vector<string>& serviceNames, const string& logFileName) {
-    ofstream logFile(logFileName, ios::app);
-    time_t now = time(nullptr);
-    char timeStr[26];
-    ctime_s(timeStr, sizeof(timeStr), &now);
-    logFile << "\n=== Service Stop Operation Log " << timeStr << "===\n";
+    struct Watch {
+        SC_HANDLE service = NULL;
+        SERVICE_NOTIFYW notify = {};
+        DWORD state = 0;
+        bool polled = false;
+    };
 
-    bool allSuccess = true;
+    SC_HANDLE manager;
+    vector<unique_ptr<Watch>> watches;
+    map<string, Watch*> byName;
+
+    static string stateName(DWORD state) {
+        switch (state) {
+        case SERVICE_STOPPED: return "Stopped";
+        case SERVICE_START_PENDING: return "Start Pending";
+        case SERVICE_STOP_PENDING: return "Stop Pending";
+        case SERVICE_RUNNING: return "Running";
+        case SERVICE_CONTINUE_PENDING: return "Continue Pending";
+        case SERVICE_PAUSE_PENDING: return "Pause Pending";
+        case SERVICE_PAUSED: return "Paused";
+        default: return "";
+        }
+    }
 
-    for (const auto& serviceName : serviceNames) {
-        wstring wServiceName(serviceName.begin(), serviceName.end());
-        logFile << "Attempting to stop service: " << serviceName << "\n";
+    static VOID CALLBACK onStatusChange(PVOID parameter) {
+        PSERVICE_NOTIFYW notify = static_cast<PSERVICE_NOTIFYW>(parameter);
+        Watch* watch = static_cast<Watch*>(notify->pContext);
+        if (notify->dwNotificationStatus == ERROR_SUCCESS) watch->state = notify->ServiceStatus.dwCurrentState;
+        else watch->polled = true;
+    }
 
-        if (isCriticalService(wServiceName.c_str())) {
-            logFile << "Cannot modify critical service: " << serviceName << "\n";
-            allSuccess = false;
-            continue;
+    static void refresh(Watch& watch) {
+        SERVICE_STATUS_PROCESS status;
+        DWORD needed = 0;
+        if (QueryServiceStatusEx(watch.service, SC_STATUS_PROCESS_INFO,
+            reinterpret_cast<LPBYTE>(&status), sizeof(status), &needed)) {
+            watch.state = status.dwCurrentState;
         }
+    }
 
-        SC_HANDLE schService = OpenServiceW(schSCManager, wServiceName.c_str(),
-            SERVICE_STOP | SERVICE_QUERY_STATUS);
-        if (!schService) {
-            DWORD error = GetLastError();
-            logFile << "Failed to open service. Error code: " << error << "\n";
-            allSuccess = false;
-            continue;
-        }
+    static void arm(Watch& watch) {
+        watch.notify.dwVersion = SERVICE_NOTIFY_STATUS_CHANGE;
+        watch.notify.pfnNotifyCallback = onStatusChange;
+        watch.notify.pContext = &watch;
+        DWORD mask = SERVICE_NOTIFY_RUNNING | SERVICE_NOTIFY_STOPPED | SERVICE_NOTIFY_PAUSED;
+        if (NotifyServiceStatusChangeW(watch.service, mask, &watch.notify) != ERROR_SUCCESS) watch.polled = true;
+    }
+};
 
-        SERVICE_STATUS status;
-        if (ControlService(schService, SERVICE_CONTROL_STOP, &status)) {
-            logFile << "Successfully stopped service: " << serviceName << "\n";
-        }
-        else {
-            DWORD error = GetLastError();
-            logFile << "Failed to stop service. Error code: " << error << "\n";
-            allSuccess = false;
-        }
+bool ServiceList::controlServices(bool start, const vector<string>& serviceNames, const string& logFileName) {
+    SC_HANDLE schSCManager = ScmSession::shared().handle();
+    ofstream logFile(logFileName, ios::app);
+    time_t now = time(nullptr);
+    char timeStr[26];
+    ctime_s(timeStr, sizeof(timeStr), &now);
+    logFile << "\n=== Service " << (start ? "Start" : "Stop") << " Operation Log " << timeStr << "===\n";
+
+    vector<ServiceOperation> operations(serviceNames.size());
+    for (size_t i = 0; i < serviceNames.size(); i++) {
+        wstring wServiceName(serviceNames[i].begin(), serviceNames[i].end());
+        operations[i].name = serviceNames[i];
+        operations[i].start = start;
+        if (isCriticalService(wServiceName.c_str())) operations[i].refused = "Cannot modify critical service";
+    }
 
-        CloseServiceHandle(schService);
+    auto started = chrono::steady_clock::now();
+    ServiceSchedule schedule;
+    {
+        ScmServiceDriver driver(schSCManager);
+        schedule = ServiceController(driver).run(operations, chrono::milliseconds(ServiceBackend::STATE_WAIT_MS));
     }
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
 
+    writeServiceResults(logFile, operations, schedule, ServiceBackend::STATE_WAIT_MS, elapsed);
     logFile << "=== End of Log ===\n\n";
     logFile.close();
-    return allSuccess;
-}
\ No newline at end of file
+    return all_of(operations.begin(), operations.end(),
+        [](const ServiceOperation& operation) { return operation.reached; });
+}
+
+bool ServiceList::startService(const vector<string>& serviceNames, const string& logFileName) {
+    return controlServices(true, serviceNames, logFileName);
+}
+
+bool ServiceList::stopService(const vector<string>& serviceNames, const string& logFileName) {
+    return controlServices(false, serviceNames, logFileName);
+}
@@ -1,21 +1,56 @@
 #pragma once
 #include "..\Libs\Header.h"
+#include "..\Platform\Platform.h"
+#include "..\Platform\ServiceConfigCache.h"
 
+// The server's one connection to the Service Control Manager, shared by every
+// ServiceList and opened on first use. The admin check and the privilege
+// adjustment run once, since the process token keeps both. A failed open is
+// not retried on the spot: the error goes back to the command, and a command
+// after RETRY_SECONDS tries again. The handle may be used from any thread.
+class ScmSession {
+public:
+    static const int RETRY_SECONDS = 10;
+
+    static ScmSession& shared();
+    // The manager handle; throws runtime_error saying why there is none
+    SC_HANDLE handle();
+
+private:
+    ScmSession();
+    ~ScmSession();
+
+    mutex sessionMutex;
+    SC_HANDLE manager;
+    bool privilegesChecked;
+    string privilegeError;   // Kept for good: rights do not change while the process runs
+    string openError;
+    chrono::steady_clock::time_point retryAt;
+
+    bool checkAdminRights();
+    bool elevatePrivileges();
+};
+
+// Every call reaches the SCM through ScmSession, and throws runtime_error
+// when the session cannot be opened
 class ServiceList {
+    friend class ScmServiceDriver;
 public:
-    ServiceList();
-    ~ServiceList();
     bool writeServicesToFile(const std::string& filename);
+    bool writeServicesToStream(std::ostream& file);
+    bool enumerateServices(const function<void(const ServiceInfo&)>& visit);
     bool startService(const vector<string>& serviceNames, const string& logFileName);
     bool stopService(const vector<string>& serviceNames, const string& logFileName);
 
+    static const size_t CONFIG_QUERY_THREADS = 4;   // For services the config cache has no current entry for
+
 private:
-    SC_HANDLE schSCManager;
-    bool isAdmin;  // Add flag to track admin status
-    bool checkAdminRights();  // Add function to check admin rights
-    bool elevatePrivileges(); // Add function to elevate privileges
     std::string getServiceStatusString(DWORD dwCurrentState);
-    std::string wcharToString(LPWSTR wstr);  // Add declaration
+    std::string getStartTypeString(DWORD dwStartType);
+    static std::string wcharToString(LPWSTR wstr);  // Add declaration
+    // Description and start type, through the service's own handle
+    bool queryConfig(SC_HANDLE schSCManager, LPCWSTR serviceName, ServiceConfig& config,
+        vector<BYTE>& description, vector<BYTE>& buffer);
     const std::vector<std::wstring> CRITICAL_SERVICES = {
         L"wuauserv",      // Windows Update
         L"WinDefend",     // Windows Defender
@@ -28,4 +63,6 @@ private:
         L"EventLog"       // Event Log
     };
     bool isCriticalService(const wchar_t* serviceName);
+    // Sends every request at once and waits on the SCM's change notifications
+    bool controlServices(bool start, const vector<string>& serviceNames, const string& logFileName);
 };
\ No newline at end of file
@@ -1,8 +1,20 @@
 #include "RemoteControlApp.h"
+#include "../../Bench/LoadDriver.h"
 
 // App Initialization
 bool RemoteControlApp::OnInit() {
 
+    // Benchmark against the fake Gmail server instead of serving a mailbox
+    if (argc > 1 && argv[1] == "--bench") {
+        return RunLoadTest();
+    }
+
+    // Several control mailboxes in one process when mailboxes.json is present
+    if (MailboxHub::hasConfig()) {
+        return StartMailboxHub();
+    }
+    StartMetrics(MetricsServer::DEFAULT_PORT);
+
     // Read client secrets
     auto secrets = GmailAPI::ReadClientSecrets("C:\\Users\\GIGABYTE\\Downloads\\Client3.json");
     m_api = new GmailAPI(
@@ -36,4 +48,84 @@ bool RemoteControlApp::OnInit() {
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+bool RemoteControlApp::StartMailboxHub() {
+    try {
+        m_hub = new MailboxHub();
+    }
+    catch (const std::exception& e) {
+        wxMessageBox(wxString::Format("Failed to load %s: %s", MailboxHub::CONFIG_FILE, e.what()),
+            "Error", wxOK | wxICON_ERROR);
+        return false;
+    }
+
+    StartMetrics(m_hub->getMetricsPort());
+
+    m_sysInfo = new SystemInfo();
+    for (size_t i = 0; i < m_hub->size(); i++) {
+        Mailbox& mailbox = m_hub->at(i);
+        try {
+            mailbox.api->loadSavedTokens();
+        }
+        catch (const std::exception&) {
+            // No saved tokens yet, authenticate below
+        }
+
+        if (mailbox.api->hasValidToken()) {
+            OpenMailboxMonitor(i);
+        }
+        else {
+            AuthenticationFrame* authFrame = new AuthenticationFrame(*mailbox.api,
+                [this, i] { OpenMailboxMonitor(i); });
+            authFrame->SetTitle("Gmail Remote Control - Authentication (" + mailbox.config.name + ")");
+            authFrame->Show(true);
+        }
+    }
+
+    m_hub->start();
+    return true;
+}
+
+void RemoteControlApp::OpenMailboxMonitor(size_t index) {
+    Mailbox& mailbox = m_hub->at(index);
+    m_hub->activate(index);
+
+    ServerMonitorFrame* monitorFrame = new ServerMonitorFrame(*mailbox.api, *mailbox.server, *m_sysInfo);
+    monitorFrame->Show(true);
+}
+
+bool RemoteControlApp::RunLoadTest() {
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        args.push_back(argv[i].ToStdString());
+    }
+
+    try {
+        LoadReport report = LoadDriver(LoadOptions::parse(args)).run();
+        ofstream("bench_report.txt") << report.toText();
+        wxMessageBox(report.toText(), "Load test", wxOK | wxICON_INFORMATION);
+    }
+    catch (const std::exception& e) {
+        wxMessageBox(wxString::Format("Load test failed: %s", e.what()), "Error", wxOK | wxICON_ERROR);
+    }
+    // Nothing else to run
+    return false;
+}
+
+void RemoteControlApp::StartMetrics(int port) {
+    // Metrics are optional: the server keeps running if the port is taken
+    m_metrics = new MetricsServer(port);
+    if (!m_metrics->start()) {
+        delete m_metrics;
+        m_metrics = nullptr;
+    }
+}
+
+int RemoteControlApp::OnExit() {
+    delete m_hub;
+    m_hub = nullptr;
+    delete m_metrics;
+    m_metrics = nullptr;
+    return wxApp::OnExit();
+}
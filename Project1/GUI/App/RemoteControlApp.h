@@ -2,6 +2,8 @@
 #pragma once
 #include <wx/wx.h>
 #include "../../Server/ServerManager.h"
+#include "../../Server/MailboxHub.h"
+#include "../../Server/MetricsServer.h"
 #include "../../RemoteControl/SystemInfo.h"
 #include "../Frames/AuthenticationFrame.h"
 #include "../Frames/ServerMonitorFrame.h"
@@ -11,7 +13,15 @@ private:
     GmailAPI* m_api;
     ServerManager* m_server;
     SystemInfo* m_sysInfo;
+    MailboxHub* m_hub = nullptr;
+    MetricsServer* m_metrics = nullptr;
+
+    void StartMetrics(int port);
+    bool RunLoadTest();
+    bool StartMailboxHub();
+    void OpenMailboxMonitor(size_t index);
 
 public:
     virtual bool OnInit() override;
+    virtual int OnExit() override;
 };
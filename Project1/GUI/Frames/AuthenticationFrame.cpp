@@ -1,10 +1,10 @@
 #include "AuthenticationFrame.h"
 
 //Authentication Frame Implementation
-AuthenticationFrame::AuthenticationFrame(GmailAPI& api)
+AuthenticationFrame::AuthenticationFrame(GmailAPI& api, std::function<void()> onAuthenticated)
     : wxFrame(nullptr, wxID_ANY, "Gmail Remote Control - Authentication",
         wxDefaultPosition, wxSize(500, 600)),
-    m_api(api) {
+    m_api(api), m_onAuthenticated(onAuthenticated) {
 
     wxImage::AddHandler(new wxPNGHandler());
     wxIcon appIcon;
@@ -163,19 +163,27 @@ void AuthenticationFrame::ShowManualAuthControls(bool show) {
     Update();
 }
 
-void AuthenticationFrame::OnAuthenticate(wxCommandEvent& event) {
-    try {
-        m_api.authenticate(m_authCodeCtrl->GetValue().ToStdString());
-
+void AuthenticationFrame::OpenServerMonitor() {
+    if (m_onAuthenticated) {
+        m_onAuthenticated();
+    }
+    else {
         // Create and show ServerMonitorFrame
         SystemInfo* sysInfo = new SystemInfo();
         ServerManager* server = new ServerManager(m_api);
 
         ServerMonitorFrame* monitorFrame = new ServerMonitorFrame(m_api, *server, *sysInfo);
         monitorFrame->Show(true);
+    }
 
-        // Close authentication frame
-        Close();
+    // Close authentication frame
+    Close();
+}
+
+void AuthenticationFrame::OnAuthenticate(wxCommandEvent& event) {
+    try {
+        m_api.authenticate(m_authCodeCtrl->GetValue().ToStdString());
+        OpenServerMonitor();
     }
     catch (const std::exception& e) {
         wxMessageBox(wxString::Format("Authentication Failed: %s", e.what()),
@@ -191,15 +199,7 @@ void AuthenticationFrame::OnAutoAuthenticate(wxCommandEvent& event) {
 
     try {
         if (m_api.authenticateAutomatically()) {
-            // Create and show ServerMonitorFrame
-            SystemInfo* sysInfo = new SystemInfo();
-            ServerManager* server = new ServerManager(m_api);
-
-            ServerMonitorFrame* monitorFrame = new ServerMonitorFrame(m_api, *server, *sysInfo);
-            monitorFrame->Show(true);
-
-            // Close authentication frame
-            Close();
+            OpenServerMonitor();
         }
         else {
             wxMessageBox("Automatic authentication failed. Please try manual authentication.",
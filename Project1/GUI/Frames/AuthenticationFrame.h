@@ -17,13 +17,15 @@ private:
     wxPanel* m_manualAuthPanel;
     wxStaticBitmap* m_logoImage;
     wxStaticText* m_titleText;
+    std::function<void()> m_onAuthenticated;  // Replaces the default monitor frame when set
 
     void OnAuthenticate(wxCommandEvent& event);        // Event handler for manual authentication
     void OnCopyURL(wxHyperlinkEvent& event);          // Event handler for URL copying
     void OnAutoAuthenticate(wxCommandEvent& event);    // Event handler for automatic authentication
     void OnManualAuthenticate(wxCommandEvent& event);  // Event handler for showing manual controls
     void ShowManualAuthControls(bool show);           // Helper method to show/hide manual controls
+    void OpenServerMonitor();                          // Continue once tokens are stored
 
 public:
-    AuthenticationFrame(GmailAPI& api);
+    AuthenticationFrame(GmailAPI& api, std::function<void()> onAuthenticated = nullptr);
 };
\ No newline at end of file
@@ -13,6 +13,10 @@ ServerMonitorFrame::ServerMonitorFrame(GmailAPI& api, ServerManager& server, Sys
         wxDefaultPosition, wxSize(800, 600)),
     m_api(api), m_server(server), m_sysInfo(sysInfo) {
 
+    if (!m_server.config.mailboxName.empty()) {
+        SetTitle("Gmail Remote Control - Server Monitor (" + m_server.config.mailboxName + ")");
+    }
+
     wxImage::AddHandler(new wxPNGHandler());
     wxIcon appIcon;
     if (appIcon.LoadFile("imgs/hcmus-logo.png", wxBITMAP_TYPE_PNG))
@@ -126,10 +130,17 @@ ServerMonitorFrame::ServerMonitorFrame(GmailAPI& api, ServerManager& server, Sys
 void ServerMonitorFrame::UpdateCommandInfo() {
     if (m_blinkCounter >= m_maxBlinkCount) {
         m_blinkCounter = 0;
-        m_server.processCommands();
+        // In multi-mailbox mode the MailboxHub polls on its worker threads
+        if (!m_server.externalPolling) {
+            m_server.processCommands();
+        }
         m_accessRequesting = false;
     }
 
+    // Skip this refresh while a hub worker is running a command for this mailbox
+    std::unique_lock<std::mutex> commandLock(m_server.commandMutex, std::try_to_lock);
+    if (!commandLock.owns_lock()) return;
+
     if (!m_server.currentCommand.content.empty()) {
         // Update command display with animation
         
@@ -231,12 +242,19 @@ void ServerMonitorFrame::OnUpdateTimer(wxTimerEvent& event) {
 }
 
 void ServerMonitorFrame::OnAccessRequest(wxCommandEvent& event) {
-    AccessRequestDialog dialog(this, m_server.currentCommand.from, m_accessRequesting);
+    std::string fromEmail;
+    {
+        std::lock_guard<std::mutex> commandLock(m_server.commandMutex);
+        fromEmail = m_server.currentCommand.from;
+    }
+
+    AccessRequestDialog dialog(this, fromEmail, m_accessRequesting);
     int result = dialog.ShowModal();
 
+    std::unique_lock<std::mutex> commandLock(m_server.commandMutex);
     if (result == wxID_YES) {
         AccessInfo access;
-        access.email = m_server.currentCommand.from;
+        access.email = fromEmail;
         access.grantedTime = time(nullptr);
         m_server.approvedAccess.push_back(access);
         m_server.saveAccessList();
@@ -262,12 +280,13 @@ void ServerMonitorFrame::OnAccessRequest(wxCommandEvent& event) {
 		m_messageContentText->SetLabel(m_server.currentCommand.message);
     }
     else {
-        m_server.gmail.sendSimpleEmail(m_server.currentCommand.from, "Access Denied",
+        m_server.gmail.sendSimpleEmail(fromEmail, "Access Denied",
             "Your access request was denied.");
 
         // Explicitly update labels
 		m_server.currentCommand.content = "Access request (Denied)";
 		m_server.currentCommand.message = "Access request was denied";
+		m_server.currentCommand.from = fromEmail;
         m_currentCommandLabel->SetLabel(m_server.currentCommand.content);
         m_currentCommandLabel->SetForegroundColour(UIColors::STATUS_RED);
         m_fromLabelText->SetLabel("From: ");
@@ -280,6 +299,7 @@ void ServerMonitorFrame::OnAccessRequest(wxCommandEvent& event) {
     //m_server.currentCommand.content.clear();
 	m_blinkCounter = 0;
 	m_accessRequesting = false;
+	commandLock.unlock();
 
 	UpdateCommandInfo();
 }
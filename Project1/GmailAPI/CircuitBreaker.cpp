@@ -0,0 +1,76 @@
+#include "../GmailAPI/CircuitBreaker.h"
+#include "../Server/Metrics.h"
+
+CircuitBreaker::CircuitBreaker()
+    : state(BreakerState::Closed), consecutiveFailures(0), openings(0), probeInFlight(false) {
+}
+
+const char* CircuitBreaker::stateName(BreakerState state) {
+    switch (state) {
+    case BreakerState::Closed: return "closed";
+    case BreakerState::HalfOpen: return "half-open";
+    default: return "open";
+    }
+}
+
+void CircuitBreaker::transition(BreakerState next) {
+    static Gauge& stateGauge = Metrics().gauge("remotecontrol_gmail_circuit_state",
+        "Gmail API circuit breaker: 0 closed, 1 half-open, 2 open");
+    if (state == next) return;
+
+    cout << "Gmail circuit breaker " << stateName(state) << " -> " << stateName(next) << endl;
+    Metrics().counter("remotecontrol_gmail_circuit_transitions_total", "Gmail API circuit breaker state changes",
+        MetricsRegistry::label("to", stateName(next))).inc();
+    state = next;
+    stateGauge.set(static_cast<long long>(next));
+}
+
+bool CircuitBreaker::allowRequest() {
+    static Counter& rejected = Metrics().counter("remotecontrol_gmail_circuit_rejected_total",
+        "Gmail API requests failed fast by the open circuit breaker");
+
+    lock_guard<mutex> lock(breakerMutex);
+    if (state == BreakerState::Open && chrono::steady_clock::now() >= reopenAt) {
+        transition(BreakerState::HalfOpen);
+    }
+    if (state == BreakerState::Closed) return true;
+    if (state == BreakerState::HalfOpen && !probeInFlight) {
+        probeInFlight = true;
+        return true;
+    }
+    rejected.inc();
+    return false;
+}
+
+void CircuitBreaker::recordSuccess() {
+    lock_guard<mutex> lock(breakerMutex);
+    consecutiveFailures = 0;
+    openings = 0;
+    probeInFlight = false;
+    transition(BreakerState::Closed);
+}
+
+void CircuitBreaker::recordFailure() {
+    lock_guard<mutex> lock(breakerMutex);
+    if (state == BreakerState::Open) return;  // A request that started before the trip
+    consecutiveFailures++;
+    bool failedProbe = state == BreakerState::HalfOpen;
+    probeInFlight = false;
+    if (!failedProbe && consecutiveFailures < FAILURE_THRESHOLD) return;
+
+    // Each trip without a recovery in between doubles the cooldown
+    int cooldown = min(BASE_COOLDOWN_SECONDS << min(openings, 5), static_cast<int>(MAX_COOLDOWN_SECONDS));
+    openings++;
+    reopenAt = chrono::steady_clock::now() + chrono::seconds(cooldown);
+    transition(BreakerState::Open);
+}
+
+void CircuitBreaker::releaseProbe() {
+    lock_guard<mutex> lock(breakerMutex);
+    probeInFlight = false;
+}
+
+BreakerState CircuitBreaker::getState() const {
+    lock_guard<mutex> lock(breakerMutex);
+    return state;
+}
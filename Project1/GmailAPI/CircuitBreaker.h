@@ -0,0 +1,43 @@
+#pragma once
+#include "../Libs/Header.h"
+
+enum class BreakerState {
+    Closed = 0,    // Requests flow normally
+    HalfOpen = 1,  // One probe request is allowed through to test recovery
+    Open = 2       // Requests fail immediately until the cooldown passes
+};
+
+// Trips after FAILURE_THRESHOLD consecutive failed attempts (network errors,
+// 429 and 5xx answers), so a Gmail outage costs one failed call per cooldown
+// instead of a retry storm from every poller and handler. After the cooldown a
+// single probe is let through; its success closes the breaker, its failure
+// reopens it for a longer cooldown.
+class CircuitBreaker {
+public:
+    static const int FAILURE_THRESHOLD = 5;
+    static const int BASE_COOLDOWN_SECONDS = 15;
+    static const int MAX_COOLDOWN_SECONDS = 300;
+
+    CircuitBreaker();
+
+    // False while open, and for everyone but the probe while half-open
+    bool allowRequest();
+    void recordSuccess();
+    void recordFailure();
+    // A request that never went out, e.g. curl could not start: tells nothing
+    // about Gmail, but lets the next request probe if this one was the probe
+    void releaseProbe();
+
+    BreakerState getState() const;
+    static const char* stateName(BreakerState state);
+
+private:
+    BreakerState state;
+    int consecutiveFailures;
+    int openings;               // Consecutive trips without a recovery, for the cooldown
+    bool probeInFlight;
+    chrono::steady_clock::time_point reopenAt;
+    mutable mutex breakerMutex;
+
+    void transition(BreakerState next);
+};
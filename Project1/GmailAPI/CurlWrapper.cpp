@@ -1,5 +1,8 @@
-﻿#include "..\Libs\Header.h"
-#include "..\GmailAPI\CurlWrapper.h"
+﻿#include "../Libs/Header.h"
+#include "../GmailAPI/CurlWrapper.h"
+#include "../Server/Metrics.h"
+#include "../Server/Tracing.h"
+#include "../GmailAPI/TrafficRecorder.h"
 
 size_t CurlWrapper::WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
     // Mã code để lưu trữ dữ liệu vào biến userp
@@ -9,100 +12,251 @@ size_t CurlWrapper::WriteCallback(void* contents, size_t size, size_t nmemb, voi
     return size * nmemb;
 }
 
-CurlWrapper::CurlWrapper(int maxRetries) : MAX_RETRIES(maxRetries) {}
+CurlWrapper::CurlWrapper(int maxRetries) : MAX_RETRIES(maxRetries) {
+    static once_flag globalInit;
+    call_once(globalInit, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
 
-string CurlWrapper::performRequestWithRetry(const string& url, const string& method,
-    const string& postFields, const vector<string>& headers, int retryCount) {
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+}
+
+CurlWrapper::~CurlWrapper() {
+    lock_guard<mutex> lock(poolMutex);
+    for (CURL* handle : idleHandles) {
+        curl_easy_cleanup(handle);
+    }
+    idleHandles.clear();
+    curl_share_cleanup(share);
+}
+
+void CurlWrapper::lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userp) {
+    static_cast<CurlWrapper*>(userp)->shareLocks[data].lock();
+}
+
+void CurlWrapper::unlockShare(CURL* handle, curl_lock_data data, void* userp) {
+    static_cast<CurlWrapper*>(userp)->shareLocks[data].unlock();
+}
+
+CURL* CurlWrapper::acquireHandle() {
+    {
+        lock_guard<mutex> lock(poolMutex);
+        if (!idleHandles.empty()) {
+            CURL* handle = idleHandles.back();
+            idleHandles.pop_back();
+            // Reset options but keep the handle's live connections and caches
+            curl_easy_reset(handle);
+            curl_easy_setopt(handle, CURLOPT_SHARE, share);
+            return handle;
+        }
+    }
+
+    CURL* handle = curl_easy_init();
+    if (handle) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    }
+    return handle;
+}
 
+void CurlWrapper::releaseHandle(CURL* handle) {
+    lock_guard<mutex> lock(poolMutex);
+    idleHandles.push_back(handle);
+}
+
+size_t CurlWrapper::HeaderCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    size_t length = size * nitems;
+    string line(buffer, length);
+    const string name = "retry-after:";
+    if (line.size() > name.size()) {
+        string prefix = line.substr(0, name.size());
+        transform(prefix.begin(), prefix.end(), prefix.begin(), ::tolower);
+        // Google sends the delay in seconds; the HTTP-date form is left to the backoff
+        if (prefix == name) {
+            *static_cast<long*>(userp) = strtol(line.c_str() + name.size(), nullptr, 10);
+        }
+    }
+    return length;
+}
+
+chrono::milliseconds CurlWrapper::backoffDelay(int attempt, long retryAfterSeconds) {
+    // Jitter anywhere up to the exponential ceiling, so callers that failed
+    // together do not retry together
+    static thread_local mt19937 random(random_device{}());
+    long long ceiling = BASE_BACKOFF_MS << min(attempt, 16);
+    if (ceiling > MAX_BACKOFF_MS) ceiling = MAX_BACKOFF_MS;
+    long long delay = uniform_int_distribution<long long>(BASE_BACKOFF_MS / 2, ceiling)(random);
+    if (retryAfterSeconds > 0) {
+        delay = max(delay, retryAfterSeconds * 1000LL);
+    }
+    return chrono::milliseconds(delay);
+}
+
+CURLcode CurlWrapper::performOnce(const string& url, const string& method, const string& postFields,
+    const vector<string>& headers, string& readBuffer, long& status, long& retryAfterSeconds) {
     CURL* curl;
     CURLcode res;
-    string readBuffer;
     struct curl_slist* headers_list = NULL;
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
-    if (curl) {
-        // SSL/TLS Options
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
-        curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
-        //curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-
-        // Basic setup
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-
-        // Headers
-        for (const auto& header : headers) {
-            headers_list = curl_slist_append(headers_list, header.c_str());
-        }
-        if (headers_list) {
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers_list);
-        }
+    curl = acquireHandle();
+    if (!curl) {
+        return CURLE_FAILED_INIT;
+    }
 
-        // Post data handling
-        if (!postFields.empty()) {
-            // Add content length header
-            string contentLength = "Content-Length: " + to_string(postFields.length());
-            headers_list = curl_slist_append(headers_list, contentLength.c_str());
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postFields.c_str());
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, postFields.length());
-        }
+    // SSL/TLS Options
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
+    //curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
 
-        // Debug output
-        /*curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, [](CURL* handle, curl_infotype type,
-            char* data, size_t size, void* userp) -> int {
-                string text(data, size);
-                switch (type) {
-                case CURLINFO_TEXT:
-                    cout << "* " << text;
-                    break;
-                case CURLINFO_HEADER_OUT:
-                    cout << "> " << text;
-                    break;
-                case CURLINFO_HEADER_IN:
-                    cout << "< " << text;
-                    break;
-                case CURLINFO_SSL_DATA_IN:
-                case CURLINFO_SSL_DATA_OUT:
-                    cout << "* SSL/TLS traffic\n";
-                    break;
-                default:
-                    break;
-                }
-                return 0;
-            });*/
-
-        // Method setting
-        if (method == "POST") {
-            curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        }
-        else if (method == "GET") {
-            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    // Basic setup
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &retryAfterSeconds);
+
+    // Headers
+    for (const auto& header : headers) {
+        headers_list = curl_slist_append(headers_list, header.c_str());
+    }
+    if (headers_list) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers_list);
+    }
+
+    // Post data handling
+    if (!postFields.empty()) {
+        // Add content length header
+        string contentLength = "Content-Length: " + to_string(postFields.length());
+        headers_list = curl_slist_append(headers_list, contentLength.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postFields.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, postFields.length());
+    }
+
+    // Debug output
+    /*curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, [](CURL* handle, curl_infotype type,
+        char* data, size_t size, void* userp) -> int {
+            string text(data, size);
+            switch (type) {
+            case CURLINFO_TEXT:
+                cout << "* " << text;
+                break;
+            case CURLINFO_HEADER_OUT:
+                cout << "> " << text;
+                break;
+            case CURLINFO_HEADER_IN:
+                cout << "< " << text;
+                break;
+            case CURLINFO_SSL_DATA_IN:
+            case CURLINFO_SSL_DATA_OUT:
+                cout << "* SSL/TLS traffic\n";
+                break;
+            default:
+                break;
+            }
+            return 0;
+        });*/
+
+    // Method setting
+    if (method == "POST") {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    }
+    else if (method == "GET") {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    }
+    else if (method == "PUT") {
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+    }
+    else if (method == "DELETE") {
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+    }
+
+    static Histogram& requestLatency = Metrics().histogram("remotecontrol_http_request_duration_seconds",
+        "Gmail API request latency including transfer");
+    auto started = chrono::steady_clock::now();
+    {
+        ScopedTimer requestTimer(requestLatency);
+        res = curl_easy_perform(curl);
+    }
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+        TrafficRecorder& recorder = TrafficRecorder::instance();
+        if (recorder.enabled()) {
+            RecordedExchange exchange;
+            exchange.method = method;
+            exchange.path = TrafficRecorder::pathOf(url);
+            exchange.status = status;
+            exchange.response = readBuffer;
+            exchange.requestBytes = postFields.size();
+            exchange.durationMicros = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - started).count();
+            recorder.record(exchange);
         }
-        else if (method == "PUT") {
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+    }
+
+    if (headers_list) curl_slist_free_all(headers_list);
+    releaseHandle(curl);
+    return res;
+}
+
+string CurlWrapper::performRequestWithRetry(const string& url, const string& method,
+    const string& postFields, const vector<string>& headers, int retryCount) {
+
+    static Counter& retries = Metrics().counter("remotecontrol_curl_retries_total",
+        "Gmail API requests retried after a curl error, 429 or 5xx");
+    Span requestSpan("performRequestWithRetry");
+    GmailMethod gmailMethod = QuotaLimiter::methodFor(url, method);
+
+    for (int attempt = retryCount; ; attempt++) {
+        if (!breaker.allowRequest()) {
+            cout << "Gmail API circuit open, failing fast: " << url << endl;
+            return "";
         }
-        else if (method == "DELETE") {
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+        quota.acquire(gmailMethod);
+
+        string readBuffer;
+        long status = 0;
+        long retryAfterSeconds = 0;
+        CURLcode res = performOnce(url, method, postFields, headers, readBuffer, status, retryAfterSeconds);
+        if (res == CURLE_FAILED_INIT) {
+            // Nothing reached Gmail; a half-open breaker must not wait on this probe forever
+            breaker.releaseProbe();
+            return "";
         }
 
-        res = curl_easy_perform(curl);
+        // Other 4xx answers are the caller's problem, not an outage, and are
+        // returned as before
+        if (res == CURLE_OK && status != 429 && status < 500) {
+            breaker.recordSuccess();
+            return readBuffer;
+        }
 
-        // Error handling
         if (res != CURLE_OK) {
+            Metrics().counter("remotecontrol_curl_errors_total", "Gmail API requests failed by curl",
+                MetricsRegistry::label("error", curl_easy_strerror(res))).inc();
             cout << "CURL error: " << curl_easy_strerror(res) << endl;
-            if (headers_list) curl_slist_free_all(headers_list);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
-            return performRequestWithRetry(url, method, postFields, headers, retryCount + 1);
         }
+        else {
+            Metrics().counter("remotecontrol_http_errors_total", "Gmail API requests answered with 429 or 5xx",
+                MetricsRegistry::label("status", to_string(status))).inc();
+            cout << "HTTP " << status << " from " << url << endl;
+        }
+        breaker.recordFailure();
 
-        if (headers_list) curl_slist_free_all(headers_list);
-        curl_easy_cleanup(curl);
-    }
+        if (attempt >= MAX_RETRIES) {
+            cout << "Giving up after " << attempt + 1 << " attempts: " << url << endl;
+            return "";
+        }
+        if (retryAfterSeconds > MAX_RETRY_AFTER_SECONDS) {
+            cout << "Retry-After of " << retryAfterSeconds << "s is too long to wait: " << url << endl;
+            return "";
+        }
 
-    curl_global_cleanup();
-    return readBuffer;
-}
\ No newline at end of file
+        retries.inc();
+        this_thread::sleep_for(backoffDelay(attempt, retryAfterSeconds));
+    }
+}
@@ -1,16 +1,49 @@
 ﻿#pragma once
-#include "..\Libs\Header.h"
-#include "..\GmailAPI\TokenManager.h"
+#include "../Libs/Header.h"
+#include "../GmailAPI/TokenManager.h"
+#include "../GmailAPI/QuotaLimiter.h"
+#include "../GmailAPI/CircuitBreaker.h"
 
 
+// One CurlWrapper can be shared by several GmailAPI instances: easy handles are
+// pooled and reused, and connections, DNS and TLS sessions go through one share handle.
+// The quota limiter and circuit breaker are shared the same way, so in multi-mailbox
+// mode the mailboxes stay under one user's quota together, which errs on the safe side.
 class CurlWrapper : public HttpClient {
+private:
+    CURLSH* share;
+    mutex shareLocks[CURL_LOCK_DATA_LAST];
+    mutex poolMutex;
+    vector<CURL*> idleHandles;
+
+    static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userp);
+    static void unlockShare(CURL* handle, curl_lock_data data, void* userp);
+    CURL* acquireHandle();
+    void releaseHandle(CURL* handle);
+
+    QuotaLimiter quota;
+    CircuitBreaker breaker;
+
+    static const long long BASE_BACKOFF_MS = 500;
+    static const long long MAX_BACKOFF_MS = 32000;
+    static const long MAX_RETRY_AFTER_SECONDS = 60;   // Longer waits fail the request instead of holding a lane
+
+    static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userp);
+    static chrono::milliseconds backoffDelay(int attempt, long retryAfterSeconds);
+    CURLcode performOnce(const string& url, const string& method, const string& postFields,
+        const vector<string>& headers, string& readBuffer, long& status, long& retryAfterSeconds);
+
 public:
     static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
     const int MAX_RETRIES;
     CurlWrapper(int maxRetries = 3);
+    virtual ~CurlWrapper();
 
     // Sử dụng inheritance
     using HttpClient::performRequest;
+    // Retries network errors, 429 and 5xx up to MAX_RETRIES times with jittered
+    // exponential backoff, waiting at least as long as Retry-After asks. Returns
+    // an empty string when the request failed or the circuit breaker is open.
     string performRequestWithRetry(const string& url, const string& method, const string& postFields,
         const vector<string>& headers, int retryCount = 0);
 };
@@ -0,0 +1,61 @@
+#include "../GmailAPI/Endpoints.h"
+
+const char* Endpoints::DEFAULT_API_BASE = "https://gmail.googleapis.com";
+const char* Endpoints::DEFAULT_OAUTH_BASE = "https://oauth2.googleapis.com";
+mutex Endpoints::endpointMutex;
+
+static string trimSlash(string base) {
+    while (!base.empty() && base.back() == '/') {
+        base.pop_back();
+    }
+    return base;
+}
+
+string Endpoints::fromEnvironment(const char* name, const char* fallback) {
+    char* value = nullptr;
+    size_t length = 0;
+    string result = fallback;
+    if (_dupenv_s(&value, &length, name) == 0 && value) {
+        if (*value) result = value;
+        free(value);
+    }
+    return trimSlash(result);
+}
+
+string& Endpoints::apiBaseValue() {
+    static string base = fromEnvironment("GMAIL_API_BASE", DEFAULT_API_BASE);
+    return base;
+}
+
+string& Endpoints::oauthBaseValue() {
+    static string base = fromEnvironment("GMAIL_OAUTH_BASE", DEFAULT_OAUTH_BASE);
+    return base;
+}
+
+string Endpoints::apiBase() {
+    lock_guard<mutex> lock(endpointMutex);
+    return apiBaseValue();
+}
+
+string Endpoints::oauthBase() {
+    lock_guard<mutex> lock(endpointMutex);
+    return oauthBaseValue();
+}
+
+string Endpoints::gmail(const string& path) {
+    return apiBase() + "/gmail/v1/users/me" + path;
+}
+
+string Endpoints::oauthToken() {
+    return oauthBase() + "/token";
+}
+
+void Endpoints::setApiBase(const string& base) {
+    lock_guard<mutex> lock(endpointMutex);
+    apiBaseValue() = trimSlash(base);
+}
+
+void Endpoints::setOAuthBase(const string& base) {
+    lock_guard<mutex> lock(endpointMutex);
+    oauthBaseValue() = trimSlash(base);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// Base URLs of the Google services we call. They default to Google and can be
+// pointed elsewhere, e.g. at FakeGmailServer, with the GMAIL_API_BASE and
+// GMAIL_OAUTH_BASE environment variables or the setters below.
+class Endpoints {
+public:
+    static const char* DEFAULT_API_BASE;
+    static const char* DEFAULT_OAUTH_BASE;
+
+    static string apiBase();     // Without a trailing slash, e.g. "https://gmail.googleapis.com"
+    static string oauthBase();
+
+    // ".../gmail/v1/users/me" + path
+    static string gmail(const string& path);
+    static string oauthToken();
+
+    static void setApiBase(const string& base);
+    static void setOAuthBase(const string& base);
+
+private:
+    static mutex endpointMutex;
+    static string& apiBaseValue();
+    static string& oauthBaseValue();
+    static string fromEnvironment(const char* name, const char* fallback);
+};
@@ -1,15 +1,25 @@
-﻿#include "..\Libs\Header.h"
-#include "..\GmailAPI\GmailAPI.h"
+﻿#include "../Libs/Header.h"
+#include "../GmailAPI/GmailAPI.h"
 
 GmailAPI::GmailAPI(const std::string& client_id, const std::string& client_secret, const std::string& redirect_uri)
     : curl(new MyCurlWrapper(3)),
+    ownsCurl(true),
     tokenManager(new MyTokenManager(client_id, client_secret, redirect_uri)),
     emailFetcher(*curl, *tokenManager),
     scope("https://www.googleapis.com/auth/gmail.modify") 
 {};
 
+GmailAPI::GmailAPI(const std::string& client_id, const std::string& client_secret, const std::string& redirect_uri,
+    CurlWrapper& sharedCurl, const std::string& tokenStore, const std::string& checkpoint)
+    : curl(&sharedCurl),
+    ownsCurl(false),
+    tokenManager(new MyTokenManager(client_id, client_secret, redirect_uri, tokenStore)),
+    emailFetcher(*curl, *tokenManager, checkpoint),
+    scope("https://www.googleapis.com/auth/gmail.modify")
+{};
+
 GmailAPI::~GmailAPI() {
-    delete curl;
+    if (ownsCurl) delete curl;
     delete tokenManager;
 };
 
@@ -78,8 +88,8 @@ std::vector<std::string> GmailAPI::getRecentEmails() {
     return emailFetcher.getRecentEmails();
 }
 
-std::vector<std::string> GmailAPI::getEmailNow() {
-    return emailFetcher.getEmailNow();
+std::vector<std::string> GmailAPI::getEmailNow(const EmailFetcher::Admission& admit) {
+    return emailFetcher.getEmailNow(admit);
 }
 
 bool GmailAPI::hasValidToken() const {
@@ -87,14 +97,21 @@ bool GmailAPI::hasValidToken() const {
 }
 
 void GmailAPI::loadSavedTokens() {
-    tokenManager->loadSavedTokens("token_storage.json");
+    tokenManager->loadSavedTokens(tokenManager->getTokenStore());
 }
 
 
 bool GmailAPI::authenticateAutomatically() {
     // Open the default browser with the auth URL
     std::string authUrl = getAuthorizationUrl();
+#ifdef _WIN32
     ShellExecuteA(NULL, "open", authUrl.c_str(), NULL, NULL, SW_SHOWNORMAL);
+#else
+    // Headless machines have no browser to open, so print the URL as well
+    std::cout << "Open this URL to authorize: " << authUrl << std::endl;
+    int launched = system(("xdg-open '" + authUrl + "' >/dev/null 2>&1 &").c_str());
+    (void)launched;
+#endif
 
     // Wait for and capture the auth code
     std::string authCode = waitForAuthCode();
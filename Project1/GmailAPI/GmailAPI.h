@@ -1,17 +1,20 @@
 #pragma once
-#include "..\Libs\Header.h"
-#include "..\GmailAPI\TokenInfo.h"
-#include "..\GmailAPI\CurlWrapper.h"
-#include "..\GmailAPI\TokenManager.h"
-#include "..\Functions\EmailFetcher.h"
+#include "../Libs/Header.h"
+#include "../GmailAPI/TokenInfo.h"
+#include "../GmailAPI/CurlWrapper.h"
+#include "../GmailAPI/TokenManager.h"
+#include "../Functions/EmailFetcher.h"
 
+#ifdef _WIN32
 #include <WinSock2.h>
 #include <ws2tcpip.h>
 #pragma comment(lib, "ws2_32.lib")
+#endif
 
 class GmailAPI {
 private:
     CurlWrapper* curl;
+    bool ownsCurl;       // False when the connection pool is shared with other mailboxes
     HttpClient* http_client;
     TokenManager* tokenManager;
     EmailFetcher emailFetcher;
@@ -24,11 +27,14 @@ private:
 
 public:
     GmailAPI(const std::string& client_id="", const std::string& client_secret="", const std::string& redirect_uri="");
+    GmailAPI(const std::string& client_id, const std::string& client_secret, const std::string& redirect_uri,
+        CurlWrapper& sharedCurl, const std::string& tokenStore, const std::string& checkpoint);
     ~GmailAPI();  
     static Json::Value ReadClientSecrets(const std::string& path);
     std::string getAuthorizationUrl() const;
     void authenticate(const std::string& authCode);
-    std::vector<std::string> getEmailNow();
+    std::vector<std::string> getEmailNow(const EmailFetcher::Admission& admit = nullptr);
+    void setPollInterval(int seconds) { emailFetcher.setPollInterval(seconds); }
     std::vector<std::string> getRecentEmails();
     bool hasValidToken() const;
     void loadSavedTokens();
@@ -0,0 +1,71 @@
+#include "../GmailAPI/QuotaLimiter.h"
+#include "../Server/Metrics.h"
+
+GmailMethod QuotaLimiter::methodFor(const string& url, const string& httpMethod) {
+    string path = url.substr(0, url.find('?'));
+    if (path.find("/gmail/v1/users/") == string::npos) return GmailMethod::Other;
+    if (path.find("/messages/send") != string::npos) return GmailMethod::Send;
+    if (path.find("/profile") != string::npos) return GmailMethod::Profile;
+
+    size_t messages = path.find("/messages");
+    if (messages == string::npos) return GmailMethod::Other;
+    // ".../messages" lists, ".../messages/<id>" fetches one
+    bool hasId = path.size() > messages + 10 && path[messages + 9] == '/';
+    return hasId && httpMethod == "GET" ? GmailMethod::Get : GmailMethod::List;
+}
+
+int QuotaLimiter::unitsFor(GmailMethod method) {
+    switch (method) {
+    case GmailMethod::List: return 5;
+    case GmailMethod::Get: return 5;
+    case GmailMethod::Send: return 100;
+    case GmailMethod::Profile: return 1;
+    default: return 0;
+    }
+}
+
+const char* QuotaLimiter::methodName(GmailMethod method) {
+    switch (method) {
+    case GmailMethod::List: return "list";
+    case GmailMethod::Get: return "get";
+    case GmailMethod::Send: return "send";
+    case GmailMethod::Profile: return "profile";
+    default: return "other";
+    }
+}
+
+QuotaLimiter::QuotaLimiter(double unitsPerSecond)
+    : unitsPerSecond(max(unitsPerSecond, 1.0)), available(max(unitsPerSecond, 1.0)),
+      updated(chrono::steady_clock::now()) {
+}
+
+void QuotaLimiter::acquire(GmailMethod method) {
+    int units = unitsFor(method);
+    if (units == 0) return;
+
+    Metrics().counter("remotecontrol_gmail_quota_units_total", "Gmail quota units spent",
+        MetricsRegistry::label("method", methodName(method))).inc(units);
+    static Gauge& availableUnits = Metrics().gauge("remotecontrol_gmail_quota_available_units",
+        "Gmail quota units left in the client-side bucket");
+    static Histogram& quotaWait = Metrics().histogram("remotecontrol_gmail_quota_wait_seconds",
+        "Time requests waited for Gmail quota units");
+
+    double wait;
+    {
+        lock_guard<mutex> lock(limiterMutex);
+        auto now = chrono::steady_clock::now();
+        double elapsed = chrono::duration<double>(now - updated).count();
+        available = min(unitsPerSecond, available + elapsed * unitsPerSecond);
+        updated = now;
+
+        // The units are taken now; a negative balance is paid off by waiting
+        available -= units;
+        wait = available >= 0 ? 0 : -available / unitsPerSecond;
+        availableUnits.set(static_cast<long long>(available));
+    }
+
+    quotaWait.observe(wait);
+    if (wait > 0) {
+        this_thread::sleep_for(chrono::duration<double>(wait));
+    }
+}
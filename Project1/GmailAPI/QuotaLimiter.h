@@ -0,0 +1,35 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// Gmail API methods, by the quota units Google charges for them
+enum class GmailMethod {
+    List,      // messages.list, 5 units
+    Get,       // messages.get, 5 units
+    Send,      // messages.send, 100 units
+    Profile,   // getProfile, 1 unit
+    Other      // OAuth and anything else not charged against Gmail quota
+};
+
+// Client-side token bucket in Gmail quota units. Google allows 250 units per
+// user per second; staying under it keeps us from being answered with 429s
+// instead of spending requests to find out. A request that finds the bucket
+// short reserves its units and sleeps until they have refilled.
+class QuotaLimiter {
+public:
+    static const int DEFAULT_UNITS_PER_SECOND = 250;
+
+    static GmailMethod methodFor(const string& url, const string& httpMethod);
+    static int unitsFor(GmailMethod method);
+    static const char* methodName(GmailMethod method);
+
+    explicit QuotaLimiter(double unitsPerSecond = DEFAULT_UNITS_PER_SECOND);
+
+    // Charges the request's units, blocking until they are available
+    void acquire(GmailMethod method);
+
+private:
+    double unitsPerSecond;
+    double available;
+    chrono::steady_clock::time_point updated;
+    mutex limiterMutex;
+};
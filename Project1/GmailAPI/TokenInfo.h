@@ -1,5 +1,5 @@
 #pragma once
-#include "..\Libs\Header.h"
+#include "../Libs/Header.h"
 
 struct TokenInfo {
     string access_token;
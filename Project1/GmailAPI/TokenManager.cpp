@@ -1,24 +1,38 @@
-﻿#include "..\GmailAPI\TokenManager.h"
-#include "..\Client\HttpClient.h"
+﻿#include "../GmailAPI/TokenManager.h"
+#include "../Client/HttpClient.h"
+#include "../Server/Metrics.h"
+#include "../GmailAPI/Endpoints.h"
 
 TokenManager::TokenManager(const string& clientId, const string& clientSecret,
-    const string& redirectUri)
-    : client_id(clientId), client_secret(clientSecret), redirect_uri(redirectUri) {
+    const string& redirectUri, const string& tokenStore)
+    : client_id(clientId), client_secret(clientSecret), redirect_uri(redirectUri), token_store(tokenStore) {
 }
 
 void TokenManager::authenticate(const string& authCode) {
-    current_token = TokenLogic::getInitialTokens(authCode, client_id, client_secret, redirect_uri, *this);
-    TokenLogic::saveTokens("token_storage.json", current_token); // Lưu trữ token vào file
+    TokenInfo new_token = TokenLogic::getInitialTokens(authCode, client_id, client_secret, redirect_uri, *this);
+    lock_guard<mutex> lock(tokenMutex);
+    current_token = new_token;
+    TokenLogic::saveTokens(token_store, current_token); // Lưu trữ token vào file
 }
 
 void TokenManager::refreshToken() {
-    string postFields = "grant_type=refresh_token&refresh_token=" + current_token.refresh_token +
+    static Counter& refreshes = Metrics().counter("remotecontrol_token_refreshes_total",
+        "OAuth access token refreshes");
+    lock_guard<mutex> refreshLock(refreshMutex);
+    refreshes.inc();
+
+    string postFields = "grant_type=refresh_token&refresh_token=" + getCurrentToken().refresh_token +
         "&client_id=" + client_id + "&client_secret=" + client_secret;
-    string response = performRequest("https://oauth2.googleapis.com/token", postFields, {}, "POST");
+    string response = performRequest(Endpoints::oauthToken(), postFields, {}, "POST");
 
     TokenInfo new_token = TokenLogic::parseAndValidateToken(response);
+    lock_guard<mutex> lock(tokenMutex);
+    // Refresh responses carry no refresh_token; keep the one we have
+    if (new_token.refresh_token.empty()) {
+        new_token.refresh_token = current_token.refresh_token;
+    }
     current_token = new_token;
-    TokenLogic::saveTokens("token_storage.json", current_token); // Lưu trữ token vào file
+    TokenLogic::saveTokens(token_store, current_token); // Lưu trữ token vào file
 }
 
 void TokenManager::loadSavedTokens(const string& path) {
@@ -30,6 +44,8 @@ void TokenManager::loadSavedTokens(const string& path) {
     Json::Value tokens;
     file >> tokens;
 
+    lock_guard<mutex> lock(tokenMutex);
+
     // Ví dụ: đọc access token và refresh token
     current_token.access_token = tokens["access_token"].asString();
 	cout << "Access token: " << current_token.access_token << endl;
@@ -42,15 +58,17 @@ void TokenManager::loadSavedTokens(const string& path) {
 }
 
 bool TokenManager::hasValidToken() const {
+    lock_guard<mutex> lock(tokenMutex);
     return !current_token.access_token.empty();
 }
 
-const TokenInfo& TokenManager::getCurrentToken() const {
+TokenInfo TokenManager::getCurrentToken() const {
+    lock_guard<mutex> lock(tokenMutex);
     return current_token;
 }
 
 TokenInfo TokenManager::TokenLogic::getInitialTokens(const string& authCode, const string& clientId, const string& clientSecret, const string& redirectUri, HttpClient& httpClient) {
-    string url = "https://oauth2.googleapis.com/token";
+    string url = Endpoints::oauthToken();
     string body = "code=" + authCode + "&client_id=" + clientId + "&client_secret=" + clientSecret + "&redirect_uri=" + redirectUri + "&grant_type=authorization_code";
 
     string response = httpClient.sendRequest(url, body, "POST");
@@ -1,28 +1,32 @@
 #pragma once
-#include "..\Libs\Header.h"
-#include "..\GmailAPI\TokenInfo.h"
-#include "..\Client\HttpClient.h"
+#include "../Libs/Header.h"
+#include "../GmailAPI/TokenInfo.h"
+#include "../Client/HttpClient.h"
 
 class TokenManager : public HttpClient {
 private:
     TokenInfo current_token;
+    mutable mutex tokenMutex;   // Command lanes and the poller share one token
+    mutex refreshMutex;         // One refresh at a time
     string client_id;
     string client_secret;
     string redirect_uri;
+    string token_store;  // Each mailbox keeps its tokens in its own file
 
 public:
     TokenManager(const string& clientId, const string& clientSecret,
-        const string& redirectUri);
+        const string& redirectUri, const string& tokenStore = "token_storage.json");
 
     void authenticate(const string& authCode);
     void refreshToken();
     bool hasValidToken() const;
     void loadSavedTokens(const string& path);
-    const TokenInfo& getCurrentToken() const;
+    TokenInfo getCurrentToken() const;
 
 
     string getClientId() const { return client_id; }
     string getRedirectUri() const { return redirect_uri; }
+    string getTokenStore() const { return token_store; }
 
     // Tch ring logic token
     class TokenLogic {
@@ -35,8 +39,9 @@ public:
 
 class MyTokenManager : public TokenManager {
 public:
-    MyTokenManager(const std::string& client_id, const std::string& client_secret, const std::string& redirect_uri)
-        : TokenManager(client_id, client_secret, redirect_uri) {}
+    MyTokenManager(const std::string& client_id, const std::string& client_secret, const std::string& redirect_uri,
+        const std::string& token_store = "token_storage.json")
+        : TokenManager(client_id, client_secret, redirect_uri, token_store) {}
 
     // Override hm makeRequest()
     virtual void makeRequest(const string& url, const string& postFields)  {}
@@ -0,0 +1,79 @@
+#include "../GmailAPI/TrafficRecorder.h"
+
+TrafficRecorder& TrafficRecorder::instance() {
+    static TrafficRecorder recorder;
+    return recorder;
+}
+
+TrafficRecorder::TrafficRecorder() : recording(false) {
+    char* path = nullptr;
+    size_t length = 0;
+    if (_dupenv_s(&path, &length, "GMAIL_RECORD_FILE") == 0 && path) {
+        if (*path) start(path);
+        free(path);
+    }
+}
+
+bool TrafficRecorder::start(const string& path) {
+    lock_guard<mutex> lock(fileMutex);
+    if (file.is_open()) file.close();
+    file.open(path, ios::app);
+    recording = file.is_open();
+    if (!recording) {
+        cerr << "Failed to open traffic capture " << path << endl;
+    }
+    return recording;
+}
+
+void TrafficRecorder::stop() {
+    lock_guard<mutex> lock(fileMutex);
+    recording = false;
+    file.close();
+}
+
+string TrafficRecorder::pathOf(const string& url) {
+    size_t scheme = url.find("://");
+    if (scheme == string::npos) return url;
+    size_t path = url.find('/', scheme + 3);
+    return path == string::npos ? "/" : url.substr(path);
+}
+
+void TrafficRecorder::record(const RecordedExchange& exchange) {
+    if (!recording) return;
+
+    Json::Value entry;
+    entry["method"] = exchange.method;
+    entry["path"] = exchange.path;
+    entry["status"] = Json::Value::Int64(exchange.status);
+    entry["response"] = exchange.response;
+    entry["requestBytes"] = Json::Value::UInt64(exchange.requestBytes);
+    entry["durationMicros"] = Json::Value::Int64(exchange.durationMicros);
+
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    string line = Json::writeString(writer, entry);
+
+    lock_guard<mutex> lock(fileMutex);
+    if (file.is_open()) {
+        file << line << "\n";
+        file.flush();
+    }
+}
+
+bool TrafficRecorder::parse(const string& line, RecordedExchange& exchange) {
+    Json::Value entry;
+    Json::CharReaderBuilder reader;
+    string errors;
+    istringstream stream(line);
+    if (!Json::parseFromStream(reader, stream, &entry, &errors) || !entry.isObject()) {
+        return false;
+    }
+
+    exchange.method = entry["method"].asString();
+    exchange.path = entry["path"].asString();
+    exchange.status = static_cast<long>(entry["status"].asInt64());
+    exchange.response = entry["response"].asString();
+    exchange.requestBytes = static_cast<size_t>(entry["requestBytes"].asUInt64());
+    exchange.durationMicros = entry["durationMicros"].asInt64();
+    return !exchange.method.empty() && !exchange.path.empty();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// One captured API exchange. Paths are kept without scheme and host, so a
+// capture taken against Google replays against FakeGmailServer.
+struct RecordedExchange {
+    string method;
+    string path;          // e.g. "/gmail/v1/users/me/messages?q=..."
+    long status = 0;
+    string response;
+    size_t requestBytes = 0;
+    long long durationMicros = 0;
+};
+
+// Appends every Gmail API exchange to a JSON-lines file while enabled. Set
+// GMAIL_RECORD_FILE, or call start(), to capture live traffic; request bodies
+// and headers, which hold outgoing mail and the bearer token, are not written.
+class TrafficRecorder {
+public:
+    static TrafficRecorder& instance();
+
+    bool start(const string& path);
+    void stop();
+    bool enabled() const { return recording; }
+
+    void record(const RecordedExchange& exchange);
+
+    static string pathOf(const string& url);
+    static bool parse(const string& line, RecordedExchange& exchange);
+
+private:
+    TrafficRecorder();
+
+    atomic<bool> recording;
+    ofstream file;
+    mutex fileMutex;
+};
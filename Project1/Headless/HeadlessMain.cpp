@@ -0,0 +1,160 @@
+#include "../Libs/Header.h"
+#include "../Bench/LoadDriver.h"
+#include "../Bench/ProcScanBench.h"
+#include "../GmailAPI/GmailAPI.h"
+#include "../Platform/Platform.h"
+#include "../Server/MailboxHub.h"
+#include "../Server/MetricsServer.h"
+#include "../Server/ServerManager.h"
+#include <csignal>
+
+// Console entry point for the core library: serves a mailbox without the GUI,
+// or runs the load test. Stops cleanly on Ctrl+C.
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+static void printUsage() {
+    cout << "Usage:" << endl
+        << "  remotecontrol-headless [--secrets client.json] [--backend native|mock]" << endl
+        << "                         [--interval ms] [--metrics-port port]" << endl
+        << "  remotecontrol-headless --bench [--backend native|mock] [--commands N] [--command name]" << endl
+        << "                         [--content text] [--rate N] [--latency ms] [--poll ms]" << endl
+        << "                         [--timeout s] [--port port] [--replay capture.jsonl]" << endl
+#ifndef _WIN32
+        << "  remotecontrol-headless --bench-procfs [--iterations N] [--synthetic processes]" << endl
+#endif
+        ;
+}
+
+static int runBench(const vector<string>& args) {
+    LoadReport report = LoadDriver(LoadOptions::parse(args)).run();
+    cout << report.toText();
+    ofstream("bench_report.txt") << report.toText();
+    return report.unanswered == 0 ? 0 : 1;
+}
+
+static void waitForStop() {
+    while (!stopRequested) {
+        this_thread::sleep_for(chrono::milliseconds(200));
+    }
+}
+
+static int serveHub() {
+    MailboxHub hub;
+    MetricsServer metrics(hub.getMetricsPort());
+    metrics.start();
+
+    for (size_t i = 0; i < hub.size(); i++) {
+        Mailbox& mailbox = hub.at(i);
+        try {
+            mailbox.api->loadSavedTokens();
+        }
+        catch (const exception&) {
+            // Reported below
+        }
+        if (mailbox.api->hasValidToken()) {
+            hub.activate(i);
+        }
+        else {
+            cerr << "Mailbox " << mailbox.config.name << " has no valid tokens; authorize it from the GUI first" << endl;
+        }
+    }
+
+    hub.start();
+    waitForStop();
+    hub.stop();
+    return 0;
+}
+
+static int serveMailbox(const map<string, string>& options) {
+    auto option = [&](const string& name, const string& fallback) {
+        auto it = options.find(name);
+        return it == options.end() ? fallback : it->second;
+    };
+
+    MetricsServer metrics(atoi(option("--metrics-port", to_string(MetricsServer::DEFAULT_PORT)).c_str()));
+    metrics.start();
+
+    auto secrets = GmailAPI::ReadClientSecrets(option("--secrets", "client_secret.json"));
+    GmailAPI api(
+        secrets["installed"]["client_id"].asString(),
+        secrets["installed"]["client_secret"].asString(),
+        "http://localhost:8080"
+    );
+
+    try {
+        api.loadSavedTokens();
+    }
+    catch (const exception&) {
+        // Falls through to the browser flow
+    }
+    if (!api.hasValidToken() && !api.authenticateAutomatically()) {
+        cerr << "Authentication failed" << endl;
+        return 1;
+    }
+
+    unique_ptr<Platform> platform = Platform::create(option("--backend", "native"));
+    ServerManager server(api, nullptr, "", platform.get());
+    server.config.checkInterval = max(atoi(option("--interval", "10000").c_str()), 100);
+    cout << "Serving " << api.getServerName() << " on the " << platform->name << " platform" << endl;
+
+    // Poll here rather than in start(), so a signal ends the loop promptly
+    server.running = true;
+    while (!stopRequested) {
+        server.processCommands();
+        auto nextPoll = chrono::steady_clock::now() + chrono::milliseconds(server.config.checkInterval);
+        while (!stopRequested && chrono::steady_clock::now() < nextPoll) {
+            this_thread::sleep_for(chrono::milliseconds(100));
+        }
+    }
+    server.stop();
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> args(argv + 1, argv + argc);
+#ifndef _WIN32
+    // A peer closing its connection must not kill the process
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    try {
+        if (!args.empty() && (args[0] == "--help" || args[0] == "-h")) {
+            printUsage();
+            return 0;
+        }
+        if (!args.empty() && args[0] == "--bench") {
+            return runBench(args);
+        }
+#ifndef _WIN32
+        if (!args.empty() && args[0] == "--bench-procfs") {
+            cout << ProcScanBench(ProcScanOptions::parse(args)).run().toText();
+            return 0;
+        }
+#endif
+        // The load test runs to completion; serving stops on Ctrl+C
+        signal(SIGINT, requestStop);
+        signal(SIGTERM, requestStop);
+        if (MailboxHub::hasConfig()) {
+            return serveHub();
+        }
+
+        map<string, string> options;
+        for (size_t i = 0; i < args.size(); i += 2) {
+            if (i + 1 >= args.size()) {
+                throw invalid_argument("Missing value for " + args[i]);
+            }
+            options[args[i]] = args[i + 1];
+        }
+        return serveMailbox(options);
+    }
+    catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        printUsage();
+        return 2;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+// POSIX stand-ins for the Winsock and MSVC CRT calls used by the portable
+// core, so the same sources build on Linux. Header.h includes this instead of
+// the Windows headers when _WIN32 is not defined.
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+typedef int SOCKET;
+typedef unsigned short u_short;
+typedef unsigned long DWORD;
+typedef size_t SIZE_T;
+
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define SD_RECEIVE SHUT_RD
+#define SD_SEND SHUT_WR
+#define SD_BOTH SHUT_RDWR
+#define MAKEWORD(low, high) ((unsigned short)(((low) & 0xff) | (((high) & 0xff) << 8)))
+
+struct WSADATA {
+    unsigned short wVersion;
+};
+
+// Sockets need no library setup on POSIX
+inline int WSAStartup(unsigned short, WSADATA* data) {
+    if (data) data->wVersion = MAKEWORD(2, 2);
+    return 0;
+}
+
+inline int WSACleanup() {
+    return 0;
+}
+
+inline int closesocket(SOCKET s) {
+    return close(s);
+}
+
+// The MSVC "secure" CRT functions, with their argument order
+inline int localtime_s(struct tm* result, const time_t* time) {
+    return localtime_r(time, result) ? 0 : errno;
+}
+
+inline int gmtime_s(struct tm* result, const time_t* time) {
+    return gmtime_r(time, result) ? 0 : errno;
+}
+
+inline int ctime_s(char* buffer, size_t size, const time_t* time) {
+    if (!buffer || size < 26) return EINVAL;
+    return ctime_r(time, buffer) ? 0 : errno;
+}
+
+inline int _dupenv_s(char** buffer, size_t* length, const char* name) {
+    *buffer = nullptr;
+    if (length) *length = 0;
+    const char* value = getenv(name);
+    if (!value) return 0;
+    *buffer = strdup(value);
+    if (!*buffer) return ENOMEM;
+    if (length) *length = strlen(value) + 1;
+    return 0;
+}
+
+inline int _mkdir(const char* path) {
+    return mkdir(path, 0755);
+}
@@ -1,4 +1,5 @@
 #pragma once
+#ifdef _WIN32
 #pragma comment(lib, "gdi32.lib")
 #pragma comment(lib, "user32.lib")
 #pragma comment(lib, "ws2_32.lib")
@@ -18,15 +19,15 @@
 #define CURL_STATICLIB
 #define _CRTDBG_MAP_ALLOC
 #define ZLIB_WINAPI
+#endif
 #define DEBUG_LOG(msg) cout << "[DEBUG] " << msg << endl
 
-using namespace std;
-
 
 #include <json/json.h>
 #include <curl/curl.h>
 #include <iostream>
 
+#ifdef _WIN32
 #include <winsock2.h>
 #include <windows.h>
 #include <ws2tcpip.h>
@@ -34,6 +35,10 @@ using namespace std;
 
 #include <tlhelp32.h>
 #include <psapi.h>
+#else
+// Everything outside Functions/ and the GUI also builds on POSIX
+#include "Compat.h"
+#endif
 #include <algorithm>
 
 #include <limits>
@@ -42,35 +47,54 @@ using namespace std;
 #include <openssl/evp.h>
 #include <openssl/buffer.h>
 
+#ifdef _WIN32
 #include <eh.h>
 
 #include <gdiplus.h>
+#endif
 #include <vector>
 #include <filesystem>
-#include <direct.h> 
+#ifdef _WIN32
+#include <direct.h>
+#endif
 
 #include <fstream>
 #include <string>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <atomic>
+#include <deque>
+#include <random>
 
 #include <chrono>
 #include <cstdlib>
+#include <cmath>
 
 #include <locale>
 #include <codecvt>
 #include <sstream>
 
 #include <stdlib.h>
+#ifdef _WIN32
 #include <crtdbg.h>
+#endif
 
 #include <ctime>
 
+#ifdef _WIN32
 #include <dshow.h>
 #include <atlbase.h>
 #include <atlconv.h>
 #include <strmif.h>
 
-#include <mferror.h>  
+#include <mferror.h>
 #include <mfapi.h>
 #include <mfidl.h>
 #include <mfreadwrite.h>
@@ -80,14 +104,19 @@ using namespace std;
 #include <winsvc.h>
 
 #include <shlobj.h>
+#endif
 #include <system_error>
 
 #include <iomanip>
 
-#include <powrprof.h> 
+#ifdef _WIN32
+#include <powrprof.h>
 
 #include <Guiddef.h>
 
 #include <ShlObj.h>
 
-#include <ShellScalingApi.h>
\ No newline at end of file
+#include <ShellScalingApi.h>
+#endif
+
+using namespace std;
@@ -0,0 +1,394 @@
+#include "../Platform/ContentSearch.h"
+#include "../Platform/MappedFile.h"
+#include <cstring>
+
+const size_t ContentSearch::BINARY_PROBE;
+const size_t ContentSearch::MAX_QUEUED;
+const size_t ContentSearch::MAX_SHOWN_LINE;
+const size_t ContentSearch::MAX_REGEX_LINE;
+
+namespace {
+
+size_t parseCount(const string& key, const string& value, size_t most) {
+    char* end = nullptr;
+    long count = strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || count < 0) throw invalid_argument("Invalid " + key + ": " + value);
+    return min(static_cast<size_t>(count), most);
+}
+
+char fold(char c) {
+    return static_cast<char>(tolower(static_cast<unsigned char>(c)));
+}
+
+// The longest run of plain characters that every match of the regex must
+// contain. Empty when the pattern has alternatives, since no run is then
+// certain, or when every character is a class, an anchor or optional.
+// Groups are passed over, as their quantifier may make them optional.
+string requiredLiteral(const string& pattern) {
+    if (pattern.find('|') != string::npos) return "";
+    string best, run;
+    auto endRun = [&] {
+        if (run.size() > best.size()) best = run;
+        run.clear();
+    };
+
+    int depth = 0;
+    size_t n = pattern.size();
+    for (size_t i = 0; i < n; i++) {
+        char c = pattern[i];
+        char literal;
+        if (c == '[') {
+            // A class: skip to its end
+            endRun();
+            i++;
+            if (i < n && pattern[i] == '^') i++;
+            if (i < n && pattern[i] == ']') i++;
+            while (i < n && pattern[i] != ']') {
+                if (pattern[i] == '\\') i++;
+                i++;
+            }
+            continue;
+        }
+        if (c == '\\') {
+            if (i + 1 >= n) break;
+            char escaped = pattern[++i];
+            if (isalnum(static_cast<unsigned char>(escaped))) {
+                // \d, \b, \x41, \1 and the like stand for something else
+                endRun();
+                if (escaped == 'x') i += 2;
+                else if (escaped == 'u') i += 4;
+                else if (escaped == 'c') i += 1;
+                else if (isdigit(static_cast<unsigned char>(escaped))) {
+                    while (i + 1 < n && isdigit(static_cast<unsigned char>(pattern[i + 1]))) i++;
+                }
+                continue;
+            }
+            literal = escaped;
+        }
+        else if (c == '(' || c == ')') {
+            endRun();
+            depth += c == '(' ? 1 : -1;
+            continue;
+        }
+        else if (c == '{') {
+            endRun();
+            while (i + 1 < n && pattern[i] != '}') i++;
+            continue;
+        }
+        else if (strchr("^$.*+?}", c) != nullptr) {
+            endRun();
+            continue;
+        }
+        else {
+            literal = c;
+        }
+
+        if (depth > 0) continue;
+        char next = i + 1 < n ? pattern[i + 1] : '\0';
+        if (next == '*' || next == '?' || next == '{') {
+            // Optional or repeated: not there as written
+            endRun();
+            continue;
+        }
+        run += literal;
+        // Needed once, but a repeat may come between it and what follows
+        if (next == '+') endRun();
+    }
+    endRun();
+    return best;
+}
+
+void writeLine(string& block, size_t number, char marker, const char* begin, const char* end) {
+    if (end > begin && end[-1] == '\r') end--;
+    block += "  ";
+    block += to_string(number);
+    block += marker;
+    block += ' ';
+    if (static_cast<size_t>(end - begin) > ContentSearch::MAX_SHOWN_LINE) {
+        block.append(begin, ContentSearch::MAX_SHOWN_LINE);
+        block += "...";
+    }
+    else {
+        block.append(begin, end);
+    }
+    block += '\n';
+}
+
+}
+
+SearchOptions SearchOptions::parse(const string& content) {
+    SearchOptions search;
+    size_t at = content.find_first_not_of(" \t\r\n");
+    if (at == string::npos) throw invalid_argument("Nothing to search for: put the text first, in quotes when it has spaces");
+
+    size_t rest;
+    if (content[at] == '"') {
+        size_t close = content.find('"', at + 1);
+        if (close == string::npos) throw invalid_argument("Missing closing quote after the search text");
+        search.text = content.substr(at + 1, close - at - 1);
+        rest = close + 1;
+    }
+    else {
+        rest = content.find_first_of(" \t\r\n", at);
+        if (rest == string::npos) rest = content.size();
+        search.text = content.substr(at, rest - at);
+    }
+    if (search.text.empty()) throw invalid_argument("The search text is empty");
+
+    map<string, string> walkOptions;
+    istringstream words(content.substr(rest));
+    string word;
+    while (words >> word) {
+        size_t equals = word.find('=');
+        if (equals == string::npos) {
+            if (word == "regex") search.regex = true;
+            else if (word == "icase") search.ignoreCase = true;
+            else if (word == "fresh") search.fresh = true;
+            else throw invalid_argument("Unknown searchFile option: " + word);
+            continue;
+        }
+        string key = word.substr(0, equals);
+        string value = word.substr(equals + 1);
+        if (key == "context") search.context = parseCount(key, value, MAX_CONTEXT);
+        else if (key == "limit") search.limit = max<size_t>(parseCount(key, value, MAX_LIMIT), 1);
+        else {
+            // Repeated roots and globs add up, as in listFile
+            string& existing = walkOptions[key];
+            existing += (existing.empty() ? "" : ",") + value;
+        }
+    }
+    for (const auto& option : walkOptions) {
+        static const set<string> walkKeys = { "root", "depth", "include", "exclude", "links", "threads" };
+        if (!walkKeys.count(option.first)) throw invalid_argument("Unknown searchFile option: " + option.first + "=");
+    }
+    search.walk = WalkOptions::parse(walkOptions);
+    return search;
+}
+
+string SearchStats::describe() const {
+    ostringstream text;
+    text << matches << (matches == 1 ? " match" : " matches") << " in " << filesMatched << " of "
+        << filesSearched << " files (" << fixed << setprecision(1) << bytesSearched / (1024.0 * 1024.0)
+        << " MB) in " << elapsedMs << " ms on " << threads << " threads";
+    if (limitReached) text << ", stopped at the match limit";
+    if (binarySkipped > 0) text << ", " << binarySkipped << " binary skipped";
+    if (unreadable > 0) text << ", " << unreadable << " unreadable";
+    return text.str();
+}
+
+ContentSearch::ContentSearch(const SearchOptions& options, ostream& out)
+    : options(options), out(out), started(chrono::steady_clock::now()), closed(false), matchCount(0), limitReached(false) {
+    if (options.regex) {
+        auto flags = regex::ECMAScript | regex::optimize;
+        if (options.ignoreCase) flags |= regex::icase;
+        try {
+            expression.reset(new regex(options.text, flags));
+        }
+        catch (const regex_error& e) {
+            throw invalid_argument("Invalid regex: " + string(e.what()));
+        }
+        literal = requiredLiteral(options.text);
+    }
+    else {
+        literal = options.text;
+    }
+    if (options.ignoreCase) transform(literal.begin(), literal.end(), literal.begin(), fold);
+
+    size_t threadCount = options.walk.threads;
+    if (threadCount == 0) threadCount = min<size_t>(max<size_t>(thread::hardware_concurrency(), 2), 16);
+    totals.threads = threadCount;
+    for (size_t i = 0; i < threadCount; i++) pool.emplace_back(&ContentSearch::work, this);
+}
+
+ContentSearch::~ContentSearch() {
+    finish();
+}
+
+bool ContentSearch::add(const string& path) {
+    unique_lock<mutex> lock(queueMutex);
+    queueRoom.wait(lock, [this] { return queue.size() < MAX_QUEUED || limitReached; });
+    if (limitReached) return false;
+    queue.push_back(path);
+    queueReady.notify_one();
+    return true;
+}
+
+SearchStats ContentSearch::finish() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        closed = true;
+    }
+    queueReady.notify_all();
+    for (auto& worker : pool) {
+        if (worker.joinable()) worker.join();
+    }
+
+    lock_guard<mutex> lock(outMutex);
+    totals.matches = min(matchCount.load(), options.limit);
+    totals.limitReached = limitReached;
+    totals.elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+    return totals;
+}
+
+void ContentSearch::work() {
+    SearchStats stats;
+    string block;
+    vector<Found> found;
+    while (true) {
+        string path;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueReady.wait(lock, [this] { return !queue.empty() || closed; });
+            if (queue.empty()) break;
+            path = move(queue.front());
+            queue.pop_front();
+        }
+        queueRoom.notify_one();
+        if (limitReached) continue;
+
+        block.clear();
+        search(path, block, found, stats);
+        if (!block.empty()) {
+            lock_guard<mutex> lock(outMutex);
+            out << block << flush;
+        }
+    }
+
+    lock_guard<mutex> lock(outMutex);
+    totals.filesSearched += stats.filesSearched;
+    totals.filesMatched += stats.filesMatched;
+    totals.binarySkipped += stats.binarySkipped;
+    totals.unreadable += stats.unreadable;
+    totals.bytesSearched += stats.bytesSearched;
+}
+
+bool ContentSearch::literalAt(const char* at) const {
+    size_t length = literal.size();
+    if (!options.ignoreCase) {
+        return length == 1 || (at[1] == literal[1] && memcmp(at + 2, literal.data() + 2, length - 2) == 0);
+    }
+    for (size_t i = 1; i < length; i++) {
+        if (fold(at[i]) != literal[i]) return false;
+    }
+    return true;
+}
+
+const char* ContentSearch::findLiteral(const char* from, const char* end) const {
+    size_t length = literal.size();
+    if (static_cast<size_t>(end - from) < length) return end;
+    const char* last = end - length;   // The last place a match can start
+
+    // Each candidate byte keeps the next place it occurs; the nearer one is tried first
+    char bytes[2] = { literal[0], static_cast<char>(toupper(static_cast<unsigned char>(literal[0]))) };
+    size_t kinds = options.ignoreCase && bytes[1] != bytes[0] ? 2 : 1;
+    const char* next[2] = { nullptr, nullptr };
+    auto seek = [&](size_t kind, const char* at) {
+        next[kind] = at > last ? nullptr : static_cast<const char*>(memchr(at, bytes[kind], last - at + 1));
+    };
+    for (size_t kind = 0; kind < kinds; kind++) seek(kind, from);
+
+    while (true) {
+        size_t kind = 0;
+        if (kinds == 2 && (!next[0] || (next[1] && next[1] < next[0]))) kind = 1;
+        const char* at = next[kind];
+        if (!at) return end;
+        if (literalAt(at)) return at;
+        seek(kind, at + 1);
+    }
+}
+
+bool ContentSearch::lineMatches(const char* begin, const char* end) const {
+    if (!expression) return true;
+    if (static_cast<size_t>(end - begin) > MAX_REGEX_LINE) end = begin + MAX_REGEX_LINE;
+    return regex_search(begin, end, *expression);
+}
+
+void ContentSearch::search(const string& path, string& block, vector<Found>& found, SearchStats& stats) {
+    MappedFile file;
+    if (!file.open(path)) {
+        stats.unreadable++;
+        return;
+    }
+    stats.filesSearched++;
+    if (file.size() == 0) return;
+    const char* data = file.data();
+    const char* end = data + file.size();
+    if (memchr(data, '\0', min(file.size(), BINARY_PROBE)) != nullptr) {
+        stats.filesSearched--;
+        stats.binarySkipped++;
+        return;
+    }
+    stats.bytesSearched += file.size();
+
+    found.clear();
+    size_t number = 1;
+    const char* counted = data;   // Line numbers are counted up to here
+    const char* at = data;        // Always the start of a line
+    while (at < end) {
+        const char* lineBegin = at;
+        if (!literal.empty()) {
+            const char* hit = findLiteral(at, end);
+            if (hit == end) break;
+            lineBegin = hit;
+            while (lineBegin > at && lineBegin[-1] != '\n') lineBegin--;
+        }
+        const char* lineEnd = static_cast<const char*>(memchr(lineBegin, '\n', end - lineBegin));
+        if (!lineEnd) lineEnd = end;
+
+        if (lineMatches(lineBegin, lineEnd)) {
+            if (matchCount++ >= options.limit) {
+                limitReached = true;
+                queueRoom.notify_all();
+                break;
+            }
+            number += count(counted, lineBegin, '\n');
+            counted = lineBegin;
+            found.push_back(Found{ lineBegin, lineEnd, number });
+        }
+        if (lineEnd == end) break;
+        at = lineEnd + 1;
+    }
+
+    if (found.empty()) return;
+    stats.filesMatched++;
+    render(path, data, end, found, block);
+}
+
+void ContentSearch::render(const string& path, const char* data, const char* end,
+    const vector<Found>& found, string& block) const {
+    // grep's layout: ':' marks a matching line, '-' a line of context, "--" a gap
+    block += path;
+    block += '\n';
+    const char* written = data;   // Everything before has been written, or skipped for good
+    for (size_t i = 0; i < found.size(); i++) {
+        const Found& match = found[i];
+
+        const char* from = match.begin;
+        size_t fromNumber = match.number;
+        for (size_t taken = 0; taken < options.context && from > written; taken++) {
+            const char* previous = from - 1;
+            while (previous > written && previous[-1] != '\n') previous--;
+            from = previous;
+            fromNumber--;
+        }
+        if (i > 0 && from > written) block += "  --\n";
+        while (from < match.begin) {
+            const char* lineEnd = static_cast<const char*>(memchr(from, '\n', match.begin - from));
+            writeLine(block, fromNumber++, '-', from, lineEnd);
+            from = lineEnd + 1;
+        }
+        writeLine(block, match.number, ':', match.begin, match.end);
+        if (match.end == end) break;
+
+        written = match.end + 1;
+        const char* stop = i + 1 < found.size() ? found[i + 1].begin : end;
+        size_t number = match.number + 1;
+        for (size_t taken = 0; taken < options.context && written < stop; taken++) {
+            const char* lineEnd = static_cast<const char*>(memchr(written, '\n', end - written));
+            if (!lineEnd) lineEnd = end;
+            writeLine(block, number++, '-', written, lineEnd);
+            written = lineEnd == end ? end : lineEnd + 1;
+        }
+    }
+    block += '\n';
+}
@@ -0,0 +1,284 @@
+#include "../Platform/DirectoryWalker.h"
+#include "../Platform/InventoryQuery.h"
+
+namespace {
+
+vector<string> commaList(const string& value) {
+    vector<string> items;
+    istringstream list(value);
+    string item;
+    while (getline(list, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+}
+
+bool matchesAnyGlob(const vector<string>& globs, const string& name, const string& path) {
+    for (const auto& glob : globs) {
+        bool wholePath = glob.find_first_of("/\\") != string::npos;
+        if (globMatch(glob.c_str(), wholePath ? path.c_str() : name.c_str())) return true;
+    }
+    return false;
+}
+
+bool WalkOptions::requested(const map<string, string>& options) {
+    static const char* keys[] = { "root", "depth", "include", "exclude", "links", "threads" };
+    for (const char* key : keys) {
+        if (options.count(key)) return true;
+    }
+    return false;
+}
+
+WalkOptions WalkOptions::parse(const map<string, string>& options) {
+    WalkOptions walk;
+    auto find = [&](const char* key) -> const string* {
+        auto it = options.find(key);
+        return it == options.end() ? nullptr : &it->second;
+    };
+
+    if (const string* roots = find("root")) walk.roots = commaList(*roots);
+    if (const string* include = find("include")) walk.include = commaList(*include);
+    if (const string* exclude = find("exclude")) walk.exclude = commaList(*exclude);
+    if (const string* depth = find("depth")) {
+        char* end = nullptr;
+        long value = strtol(depth->c_str(), &end, 10);
+        if (*end != '\0' || value < 0) throw invalid_argument("Invalid depth: " + *depth);
+        walk.maxDepth = static_cast<int>(min(value, 1000L));
+    }
+    if (const string* links = find("links")) {
+        if (*links == "skip") walk.links = LinkPolicy::Skip;
+        else if (*links == "list") walk.links = LinkPolicy::List;
+        else if (*links == "follow") walk.links = LinkPolicy::Follow;
+        else throw invalid_argument("links must be skip, list or follow: " + *links);
+    }
+    if (const string* threads = find("threads")) {
+        char* end = nullptr;
+        long value = strtol(threads->c_str(), &end, 10);
+        if (*end != '\0' || value <= 0) throw invalid_argument("Invalid threads: " + *threads);
+        walk.threads = static_cast<size_t>(min(value, 64L));
+    }
+    return walk;
+}
+
+string WalkStats::describe() const {
+    ostringstream text;
+    text << "walked " << directories << " directories and " << files << " files in " << elapsedMs
+        << " ms on " << threads << " threads";
+    if (unreadable > 0) text << ", " << unreadable << " unreadable";
+    if (linksSkipped > 0) text << ", " << linksSkipped << " links skipped";
+    return text.str();
+}
+
+DirectoryWalker::DirectoryWalker(DirectorySource& source, const WalkOptions& options)
+    : source(source), options(options), queued(0), outstanding(0), idlers(0), stopped(false),
+    workersRunning(0), directories(0), unreadable(0), linksSkipped(0) {
+}
+
+void DirectoryWalker::push(size_t worker, Task task) {
+    outstanding++;
+    queued++;
+    {
+        lock_guard<mutex> lock(workers[worker]->dequeMutex);
+        workers[worker]->tasks.push_back(move(task));
+    }
+    if (idlers > 0) {
+        lock_guard<mutex> lock(idleMutex);
+        idle.notify_one();
+    }
+}
+
+bool DirectoryWalker::take(size_t worker, Task& task) {
+    {
+        Worker& own = *workers[worker];
+        lock_guard<mutex> lock(own.dequeMutex);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    for (size_t step = 1; step < workers.size(); step++) {
+        Worker& victim = *workers[(worker + step) % workers.size()];
+        lock_guard<mutex> lock(victim.dequeMutex);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DirectoryWalker::firstVisit(const string& path) {
+    string key = source.identity(path);
+    if (key.empty()) return true;
+    lock_guard<mutex> lock(seenMutex);
+    return seenDirectories.insert(key).second;
+}
+
+bool DirectoryWalker::excluded(const string& name, const string& path) const {
+    return !options.exclude.empty() && matchesAnyGlob(options.exclude, name, path);
+}
+
+bool DirectoryWalker::included(const string& name, const string& path) const {
+    return options.include.empty() || matchesAnyGlob(options.include, name, path);
+}
+
+void DirectoryWalker::hand(vector<FileInfo>& batch) {
+    if (batch.empty()) return;
+    unique_lock<mutex> lock(outputMutex);
+    outputRoom.wait(lock, [this] { return output.size() < MAX_BATCHES || stopped; });
+    if (stopped) {
+        batch.clear();
+        return;
+    }
+    output.push_back(move(batch));
+    batch = vector<FileInfo>();
+    batch.reserve(BATCH_SIZE);
+    outputReady.notify_one();
+}
+
+void DirectoryWalker::walk(size_t worker, const Task& task, vector<DirectoryEntry>& entries, vector<FileInfo>& batch) {
+    entries.clear();
+    if (!source.read(task.path, entries)) {
+        unreadable++;
+        return;
+    }
+    directories++;
+
+    string prefix = task.path;
+    if (prefix.empty() || prefix.back() != source.separator()) prefix += source.separator();
+    for (const auto& entry : entries) {
+        string path = prefix + entry.name;
+        if (excluded(entry.name, path)) continue;
+
+        bool enter = entry.directory;
+        if (entry.link) {
+            if (options.links == LinkPolicy::Skip) {
+                linksSkipped++;
+                continue;
+            }
+            if (options.links == LinkPolicy::List) enter = false;
+        }
+
+        if (enter) {
+            bool deepEnough = options.maxDepth >= 0 && task.depth >= options.maxDepth;
+            if (deepEnough) continue;
+            if (options.links == LinkPolicy::Follow && !firstVisit(path)) continue;
+            push(worker, Task{ path, task.depth + 1, task.root });
+            continue;
+        }
+        if (entry.directory && !entry.link) continue;
+        if (!included(entry.name, path)) continue;
+
+        FileInfo info;
+        info.name = entry.name;
+        info.label = roots[task.root].second;
+        info.path = move(path);
+        info.sizeBytes = entry.sizeBytes;
+        info.modified = entry.modified;
+        info.attributes = entry.attributes;
+        batch.push_back(move(info));
+        if (batch.size() >= BATCH_SIZE) hand(batch);
+    }
+}
+
+void DirectoryWalker::work(size_t worker) {
+    vector<DirectoryEntry> entries;
+    vector<FileInfo> batch;
+    batch.reserve(BATCH_SIZE);
+
+    while (!stopped) {
+        Task task;
+        if (take(worker, task)) {
+            walk(worker, task, entries, batch);
+            if (--outstanding == 0) {
+                lock_guard<mutex> lock(idleMutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        // Nothing to steal: pass on what this worker holds, then sleep until there is
+        hand(batch);
+        unique_lock<mutex> lock(idleMutex);
+        idlers++;
+        idle.wait(lock, [this] { return queued > 0 || outstanding == 0 || stopped; });
+        idlers--;
+        if (outstanding == 0) break;
+    }
+    hand(batch);
+
+    lock_guard<mutex> lock(outputMutex);
+    workersRunning--;
+    outputReady.notify_all();
+}
+
+WalkStats DirectoryWalker::run(const vector<pair<string, string>>& labelledRoots,
+    const function<void(const FileInfo&)>& visit) {
+    auto started = chrono::steady_clock::now();
+    WalkStats stats;
+    size_t threadCount = options.threads;
+    if (threadCount == 0) threadCount = min<size_t>(max<size_t>(2 * thread::hardware_concurrency(), 4), 32);
+    stats.threads = threadCount;
+
+    roots = labelledRoots;
+    for (auto& root : roots) {
+        if (root.second.empty()) root.second = root.first;
+    }
+    for (size_t i = 0; i < threadCount; i++) workers.emplace_back(new Worker());
+    for (size_t i = 0; i < roots.size(); i++) {
+        if (options.links == LinkPolicy::Follow && !firstVisit(roots[i].first)) continue;
+        push(i % threadCount, Task{ roots[i].first, 0, i });
+    }
+
+    vector<thread> pool;
+    if (outstanding > 0) {
+        workersRunning = threadCount;
+        for (size_t i = 0; i < threadCount; i++) pool.emplace_back(&DirectoryWalker::work, this, i);
+    }
+
+    auto stopWorkers = [&] {
+        stopped = true;
+        {
+            lock_guard<mutex> lock(outputMutex);
+            outputRoom.notify_all();
+        }
+        {
+            lock_guard<mutex> lock(idleMutex);
+            idle.notify_all();
+        }
+        for (auto& worker : pool) worker.join();
+    };
+
+    try {
+        while (true) {
+            vector<FileInfo> batch;
+            {
+                unique_lock<mutex> lock(outputMutex);
+                outputReady.wait(lock, [this] { return !output.empty() || workersRunning == 0; });
+                if (output.empty()) break;
+                batch = move(output.front());
+                output.pop_front();
+                outputRoom.notify_one();
+            }
+            for (const auto& file : batch) visit(file);
+            stats.files += batch.size();
+        }
+    }
+    catch (...) {
+        stopWorkers();
+        throw;
+    }
+    for (auto& worker : pool) worker.join();
+
+    stats.directories = directories;
+    stats.unreadable = unreadable;
+    stats.linksSkipped = linksSkipped;
+    stats.elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+    return stats;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Platform/Platform.h"
+
+// One entry as a directory read reports it
+struct DirectoryEntry {
+    string name;
+    bool directory = false;    // For a link, whether its target is a directory
+    bool link = false;         // Symbolic link, junction or mount point
+    unsigned long long sizeBytes = 0;
+    long long modified = 0;
+    unsigned attributes = 0;
+};
+
+// Whether name, or path for a glob with a separator in it, matches any of globs
+bool matchesAnyGlob(const vector<string>& globs, const string& name, const string& path);
+
+// Reads directories for DirectoryWalker: the file system on each OS, or the
+// mock's model. Called from every worker thread at once.
+class DirectorySource {
+public:
+    virtual ~DirectorySource() {}
+    // Fills entries, without "." and ".."; false when the directory cannot be opened
+    virtual bool read(const string& path, vector<DirectoryEntry>& entries) = 0;
+    // Equal for every path that reaches the same directory; only asked for
+    // when links are followed. Empty when it cannot be told.
+    virtual string identity(const string& path) = 0;
+    virtual char separator() const = 0;
+};
+
+// Walks directory trees on a pool of threads. Each worker keeps its own
+// deque of directories: it takes the newest from its own end, so it goes
+// depth first and the deques stay short, and an idle worker steals the
+// oldest from another's, which is usually the biggest subtree left. Files
+// are handed over in batches through a queue that holds at most MAX_BATCHES;
+// when the caller falls behind, the workers wait. Memory therefore depends
+// on the thread count and the tree's depth, not on the tree's size.
+class DirectoryWalker {
+public:
+    static const size_t BATCH_SIZE = 256;   // Files per hand-over
+    static const size_t MAX_BATCHES = 64;   // Hand-overs waiting for the caller
+
+    DirectoryWalker(DirectorySource& source, const WalkOptions& options);
+
+    // Calls visit on the calling thread for every file, while the walk goes
+    // on. Roots without a label are labelled with their own path. If visit
+    // throws, the workers stop and the exception is passed on.
+    WalkStats run(const vector<pair<string, string>>& labelledRoots, const function<void(const FileInfo&)>& visit);
+
+private:
+    struct Task {
+        string path;
+        int depth;      // Depth of the entries inside
+        size_t root;
+    };
+    struct Worker {
+        mutex dequeMutex;
+        deque<Task> tasks;
+    };
+
+    DirectorySource& source;
+    WalkOptions options;
+    vector<pair<string, string>> roots;   // Path and label
+    vector<unique_ptr<Worker>> workers;
+
+    atomic<size_t> queued;        // Tasks in the deques
+    atomic<size_t> outstanding;   // Tasks queued or being read
+    atomic<size_t> idlers;
+    atomic<bool> stopped;
+    mutex idleMutex;
+    condition_variable idle;
+
+    mutex outputMutex;
+    condition_variable outputReady;
+    condition_variable outputRoom;
+    deque<vector<FileInfo>> output;
+    size_t workersRunning;
+
+    mutex seenMutex;
+    unordered_set<string> seenDirectories;   // Identities, when links are followed
+
+    atomic<size_t> directories;
+    atomic<size_t> unreadable;
+    atomic<size_t> linksSkipped;
+
+    void push(size_t worker, Task task);
+    bool take(size_t worker, Task& task);
+    bool firstVisit(const string& path);
+    bool excluded(const string& name, const string& path) const;
+    bool included(const string& name, const string& path) const;
+    void work(size_t worker);
+    void walk(size_t worker, const Task& task, vector<DirectoryEntry>& entries, vector<FileInfo>& batch);
+    void hand(vector<FileInfo>& batch);
+};
@@ -0,0 +1,571 @@
+#include "../Platform/FileIndex.h"
+#include "../Platform/DirectoryWalker.h"
+#include "../Platform/InventoryQuery.h"
+#include <cstdint>
+
+const char* FileIndex::DEFAULT_FILE = "file_index.bin";
+const int FileIndex::RECONCILE_MINUTES;
+const int FileIndex::UNWATCHED_RECONCILE_MINUTES;
+const size_t FileIndex::COMPACT_AT;
+const size_t FileIndex::MAX_PENDING;
+const int FileIndex::SETTLE_MS;
+
+// One file in the table; the path is in the text block after the table
+struct FileIndex::Record {
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t nameAt;       // Where the file name starts in the path
+    uint64_t sizeBytes;
+    int64_t modified;
+    uint32_t attributes;
+    uint32_t root;
+};
+
+namespace {
+
+const char MAGIC[4] = { 'R', 'C', 'F', 'I' };
+const uint32_t VERSION = 1;
+
+// The file: this header, the roots as "path\tlabel\n" lines, the records
+// sorted by path, then the paths back to back
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t rootsOffset;
+    uint64_t rootsBytes;
+    uint64_t recordsOffset;
+    uint64_t textOffset;
+    uint64_t textBytes;
+    int64_t builtAt;
+};
+
+// The order std::string sorts in, so the table and the overlay agree
+int comparePath(const char* path, size_t length, const string& other) {
+    int order = memcmp(path, other.data(), min(length, other.size()));
+    if (order != 0) return order;
+    return length < other.size() ? -1 : length > other.size() ? 1 : 0;
+}
+
+bool startsWith(const string& text, const string& prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+string describeSeconds(long long seconds) {
+    if (seconds < 120) return to_string(seconds) + " s";
+    if (seconds < 7200) return to_string(seconds / 60) + " min";
+    return to_string(seconds / 3600) + " h";
+}
+
+}
+
+FileIndex& Platform::fileIndex() {
+    lock_guard<mutex> lock(fileIndexMutex);
+    if (!fileIndexInstance) {
+        // The mock makes up a new machine every run, so a file from an earlier one would be wrong
+        string indexPath = name == "mock" ? "" : FileIndex::DEFAULT_FILE;
+        fileIndexInstance = make_shared<FileIndex>(*files, indexPath, files->usualFolders());
+        fileIndexInstance->start();
+    }
+    return *fileIndexInstance;
+}
+
+FileIndex::FileIndex(FileBackend& files, const string& path, const vector<pair<string, string>>& roots)
+    : files(files), path(path), roots(roots), separator(files.pathSeparator()), records(nullptr), text(nullptr),
+    count(0), loaded(false), generation(0), fileCount(0), builtAt(0), updatedAt(0), overflowed(false),
+    stopping(false), watched(true) {
+}
+
+FileIndex::~FileIndex() {
+    stop();
+}
+
+void FileIndex::start() {
+    {
+        lock_guard<mutex> lock(indexMutex);
+        if (!path.empty() && mapped.open(path) && adopt(mapped.data(), mapped.size())) {
+            loaded = true;
+            recount();
+        }
+        else {
+            mapped.close();
+        }
+    }
+    watcher = thread(&FileIndex::watch, this);
+    maintainer = thread(&FileIndex::maintain, this);
+}
+
+void FileIndex::stop() {
+    stopping = true;
+    {
+        lock_guard<mutex> lock(pendingMutex);
+        pendingReady.notify_all();
+    }
+    if (watcher.joinable()) watcher.join();
+    if (maintainer.joinable()) maintainer.join();
+}
+
+bool FileIndex::ready() {
+    lock_guard<mutex> lock(indexMutex);
+    return loaded;
+}
+
+bool FileIndex::waitUntilReady(chrono::milliseconds timeout) {
+    unique_lock<mutex> lock(indexMutex);
+    return readyChanged.wait_for(lock, timeout, [this] { return loaded; });
+}
+
+bool FileIndex::walk(const WalkOptions& options, const function<void(const FileInfo&)>& visit) {
+    if (options.links != LinkPolicy::Skip) return false;
+    vector<pair<string, string>> wanted;   // Directory and label, as the walk would label them
+    for (const auto& root : options.roots) {
+        if (rootOf(root) < 0) return false;
+        wanted.emplace_back(root, root);
+    }
+    if (wanted.empty()) wanted = roots;
+
+    lock_guard<mutex> lock(indexMutex);
+    if (!loaded) return false;
+    FileInfo info;
+    for (const auto& directory : wanted) {
+        string prefix = under(directory.first);
+        forEachUnder(prefix, [&](const string& known, const Entry& entry) {
+            // The walk's rules: depth counts the directories between the root
+            // and the file, and nothing under an excluded directory is seen
+            int depth = 0;
+            size_t start = prefix.size();
+            while (true) {
+                size_t end = known.find(separator, start);
+                if (!options.exclude.empty()) {
+                    string upTo = end == string::npos ? known : known.substr(0, end);
+                    if (matchesAnyGlob(options.exclude, upTo.substr(start), upTo)) return;
+                }
+                if (end == string::npos) break;
+                if (options.maxDepth >= 0 && ++depth > options.maxDepth) return;
+                start = end + 1;
+            }
+            if (!options.include.empty() && !matchesAnyGlob(options.include, known.substr(start), known)) return;
+
+            info.name = known.substr(start);
+            info.label = directory.second;
+            info.path = known;
+            info.sizeBytes = entry.sizeBytes;
+            info.modified = entry.modified;
+            info.attributes = entry.attributes;
+            visit(info);
+        });
+    }
+    return true;
+}
+
+bool FileIndex::expand(const string& pattern, size_t limit, vector<string>& paths) {
+    lock_guard<mutex> lock(indexMutex);
+    if (!loaded) return false;
+    auto collect = [&](const string& prefix) {
+        forEachUnder(prefix, [&](const string& known, const Entry&) {
+            if (paths.size() < limit && globMatch(pattern.c_str(), known.c_str())) paths.push_back(known);
+        });
+    };
+    // The sorted table narrows the search to the pattern's fixed start. Globs
+    // ignore case, which the table does not, so on Windows a miss there
+    // falls back to every path.
+    collect(pattern.substr(0, pattern.find_first_of("*?")));
+    if (paths.empty() && separator == '\\') collect("");
+    return true;
+}
+
+void FileIndex::forget(const string& path) {
+    lock_guard<mutex> lock(indexMutex);
+    Entry entry;
+    if (!lookup(path, entry)) return;
+    entry.removed = true;
+    record(path, entry, true);
+}
+
+string FileIndex::describe() {
+    lock_guard<mutex> lock(indexMutex);
+    long long age = max(0LL, static_cast<long long>(time(nullptr) - updatedAt));
+    return "file index of " + to_string(fileCount) + " files, updated " + describeSeconds(age) + " ago";
+}
+
+void FileIndex::watch() {
+    vector<string> paths;
+    for (const auto& root : roots) paths.push_back(root.first);
+    if (!files.watchFiles(paths, [this](const vector<string>& changed) { enqueue(changed); }, stopping)) {
+        watched = false;
+        cout << "File index: the folders cannot be watched; walking them every "
+            << UNWATCHED_RECONCILE_MINUTES << " minutes instead" << endl;
+    }
+}
+
+void FileIndex::enqueue(const vector<string>& paths) {
+    lock_guard<mutex> lock(pendingMutex);
+    if (!overflowed) {
+        pendingPaths.insert(paths.begin(), paths.end());
+        if (pendingPaths.size() > MAX_PENDING) {
+            pendingPaths.clear();
+            overflowed = true;
+        }
+    }
+    pendingReady.notify_all();
+}
+
+void FileIndex::maintain() {
+    typedef chrono::steady_clock Clock;
+    try {
+        reconcile();
+        Clock::time_point nextReconcile =
+            Clock::now() + chrono::minutes(watched ? RECONCILE_MINUTES : UNWATCHED_RECONCILE_MINUTES);
+        while (!stopping) {
+            set<string> paths;
+            bool lost = false;
+            {
+                unique_lock<mutex> lock(pendingMutex);
+                pendingReady.wait_until(lock, nextReconcile,
+                    [this] { return stopping || overflowed || !pendingPaths.empty(); });
+                if (stopping) break;
+                if (!pendingPaths.empty()) {
+                    pendingReady.wait_for(lock, chrono::milliseconds(SETTLE_MS), [this] { return stopping.load(); });
+                }
+                paths.swap(pendingPaths);
+                lost = overflowed;
+                overflowed = false;
+            }
+
+            // A walk that starts now sees every change queued before it
+            if (lost || Clock::now() >= nextReconcile) {
+                reconcile();
+                nextReconcile = Clock::now() + chrono::minutes(watched ? RECONCILE_MINUTES : UNWATCHED_RECONCILE_MINUTES);
+                continue;
+            }
+            apply(paths);
+
+            bool large;
+            {
+                lock_guard<mutex> lock(indexMutex);
+                large = overlay.size() >= COMPACT_AT;
+            }
+            if (large) compact();
+        }
+    }
+    catch (const exception& e) {
+        if (!stopping) cout << "File index stopped updating: " << e.what() << endl;
+    }
+}
+
+void FileIndex::apply(const set<string>& paths) {
+    // A changed path's directory has its own files read again. A path that
+    // is not a file may be a directory that appeared or went, or a root
+    // whose changes were lost, so it is read again as a tree; reading one
+    // that no longer exists drops what the index held under it. Watchers
+    // only report a directory when it appears or goes, so the deep reads
+    // stay rare.
+    set<string> deep, shallow;
+    for (const auto& changed : paths) {
+        int root = rootOf(changed);
+        if (root < 0) continue;
+        if (changed == roots[root].first || !files.isRegularFile(changed)) deep.insert(changed);
+        if (changed != roots[root].first) shallow.insert(changed.substr(0, changed.rfind(separator)));
+    }
+
+    auto coveredByDeep = [&](const string& directory, bool itself) {
+        if (itself && deep.count(directory)) return true;
+        for (size_t cut = directory.rfind(separator); cut != string::npos && cut > 0;
+            cut = directory.rfind(separator, cut - 1)) {
+            if (deep.count(directory.substr(0, cut))) return true;
+        }
+        return false;
+    };
+    for (const auto& directory : deep) {
+        if (!coveredByDeep(directory, false)) refresh(directory, true);
+    }
+    for (const auto& directory : shallow) {
+        if (!coveredByDeep(directory, true)) refresh(directory, false);
+    }
+}
+
+void FileIndex::refresh(const string& directory, bool deep) {
+    WalkOptions options;
+    options.roots.push_back(directory);
+    options.maxDepth = deep ? -1 : 0;
+    // Changed trees are mostly small; a pool per change would cost more than the walk
+    options.threads = 1;
+    map<string, Entry> found;
+    files.walkFiles(options, [&](const FileInfo& file) {
+        if (stopping) throw runtime_error("File index stopped");
+        Entry entry;
+        entry.sizeBytes = file.sizeBytes;
+        entry.modified = file.modified;
+        entry.attributes = file.attributes;
+        entry.root = static_cast<unsigned>(max(rootOf(file.path), 0));
+        found.emplace(file.path, entry);
+    });
+
+    lock_guard<mutex> lock(indexMutex);
+    string prefix = under(directory);
+    map<string, Entry> known;
+    forEachUnder(prefix, [&](const string& file, const Entry& entry) {
+        if (deep || file.find(separator, prefix.size()) == string::npos) known.emplace(file, entry);
+    });
+    for (const auto& file : known) {
+        if (found.count(file.first)) continue;
+        Entry gone = file.second;
+        gone.removed = true;
+        record(file.first, gone, true);
+    }
+    for (const auto& file : found) {
+        auto before = known.find(file.first);
+        bool same = before != known.end() && before->second.sizeBytes == file.second.sizeBytes &&
+            before->second.modified == file.second.modified && before->second.attributes == file.second.attributes;
+        if (!same) record(file.first, file.second, before != known.end());
+    }
+}
+
+void FileIndex::reconcile() {
+    unsigned long long startStamp;
+    {
+        lock_guard<mutex> lock(indexMutex);
+        startStamp = generation;
+    }
+    time_t startedAt = time(nullptr);
+
+    WalkOptions options;
+    for (const auto& root : roots) options.roots.push_back(root.first);
+    vector<pair<string, Entry>> entries;
+    files.walkFiles(options, [&](const FileInfo& file) {
+        if (stopping) throw runtime_error("File index stopped");
+        Entry entry;
+        entry.sizeBytes = file.sizeBytes;
+        entry.modified = file.modified;
+        entry.attributes = file.attributes;
+        entry.root = static_cast<unsigned>(max(rootOf(file.path), 0));
+        entries.emplace_back(file.path, entry);
+    });
+    sort(entries.begin(), entries.end(),
+        [](const pair<string, Entry>& a, const pair<string, Entry>& b) { return a.first < b.first; });
+    // Nested roots find some files twice
+    entries.erase(unique(entries.begin(), entries.end(),
+        [](const pair<string, Entry>& a, const pair<string, Entry>& b) { return a.first == b.first; }), entries.end());
+
+    replaceBase(entries, startedAt, startStamp);
+    lock_guard<mutex> lock(indexMutex);
+    updatedAt = max(updatedAt, startedAt);
+}
+
+void FileIndex::compact() {
+    vector<pair<string, Entry>> entries;
+    unsigned long long foldedStamp;
+    time_t walkedAt;
+    {
+        lock_guard<mutex> lock(indexMutex);
+        foldedStamp = generation;
+        walkedAt = builtAt;
+        entries.reserve(fileCount);
+        forEachUnder("", [&](const string& file, const Entry& entry) { entries.emplace_back(file, entry); });
+    }
+    replaceBase(entries, walkedAt, foldedStamp);
+}
+
+void FileIndex::replaceBase(vector<pair<string, Entry>>& entries, time_t walkedAt, unsigned long long foldedStamp) {
+    // Laid out in memory first, then written beside the old file and swapped in
+    string rootsBlock = rootsText();
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.count = entries.size();
+    header.rootsOffset = sizeof(Header);
+    header.rootsBytes = rootsBlock.size();
+    header.recordsOffset = (header.rootsOffset + header.rootsBytes + 7) / 8 * 8;
+    header.textOffset = header.recordsOffset + header.count * sizeof(Record);
+    for (const auto& entry : entries) header.textBytes += entry.first.size();
+    header.builtAt = walkedAt;
+
+    vector<char> built(static_cast<size_t>(header.textOffset + header.textBytes));
+    memcpy(&built[0], &header, sizeof(header));
+    memcpy(&built[header.rootsOffset], rootsBlock.data(), rootsBlock.size());
+    Record* table = reinterpret_cast<Record*>(&built[header.recordsOffset]);
+    char* out = built.data() + header.textOffset;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const string& file = entries[i].first;
+        const Entry& entry = entries[i].second;
+        size_t cut = file.rfind(separator);
+        table[i].pathOffset = offset;
+        table[i].pathLength = static_cast<uint32_t>(file.size());
+        table[i].nameAt = cut == string::npos ? 0 : static_cast<uint32_t>(cut + 1);
+        table[i].sizeBytes = entry.sizeBytes;
+        table[i].modified = entry.modified;
+        table[i].attributes = entry.attributes;
+        table[i].root = entry.root;
+        memcpy(out + offset, file.data(), file.size());
+        offset += file.size();
+    }
+    vector<pair<string, Entry>>().swap(entries);
+
+    string temporary = path + ".tmp";
+    bool written = false;
+    if (!path.empty()) {
+        ofstream file(temporary, ios::binary | ios::trunc);
+        if (file.is_open()) {
+            file.write(built.data(), static_cast<streamsize>(built.size()));
+            written = file.good();
+        }
+    }
+
+    lock_guard<mutex> lock(indexMutex);
+    // Windows will not replace a file that is mapped
+    mapped.close();
+    records = nullptr;
+    text = nullptr;
+    count = 0;
+    bool fromFile = false;
+    if (written) {
+        remove(path.c_str());
+        fromFile = rename(temporary.c_str(), path.c_str()) == 0 && mapped.open(path) &&
+            adopt(mapped.data(), mapped.size());
+        if (!fromFile) {
+            mapped.close();
+            remove(temporary.c_str());
+        }
+    }
+    if (fromFile) {
+        vector<char>().swap(image);
+    }
+    else {
+        // Kept in memory until a later write succeeds
+        if (!path.empty()) cout << "File index: could not write " << path << "; keeping the index in memory" << endl;
+        image.swap(built);
+        adopt(image.data(), image.size());
+    }
+
+    for (auto it = overlay.begin(); it != overlay.end();) {
+        if (it->second.stamp <= foldedStamp) it = overlay.erase(it);
+        else ++it;
+    }
+    recount();
+    builtAt = walkedAt;
+    updatedAt = max(updatedAt, walkedAt);
+    loaded = true;
+    readyChanged.notify_all();
+}
+
+bool FileIndex::adopt(const char* data, size_t size) {
+    if (!data || size < sizeof(Header)) return false;
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+
+    // Every offset is checked, so a torn or foreign file is turned away rather than read past
+    if (header.rootsOffset > size || header.rootsBytes > size - header.rootsOffset) return false;
+    if (string(data + header.rootsOffset, static_cast<size_t>(header.rootsBytes)) != rootsText()) return false;
+    if (header.recordsOffset % 8 != 0 || header.recordsOffset > size ||
+        header.count > (size - header.recordsOffset) / sizeof(Record)) return false;
+    if (header.textOffset > size || header.textBytes > size - header.textOffset) return false;
+    const Record* table = reinterpret_cast<const Record*>(data + header.recordsOffset);
+    for (uint64_t i = 0; i < header.count; i++) {
+        const Record& record = table[i];
+        if (record.pathOffset > header.textBytes || record.pathLength > header.textBytes - record.pathOffset ||
+            record.nameAt > record.pathLength || record.root >= roots.size()) return false;
+    }
+
+    records = table;
+    text = data + header.textOffset;
+    count = static_cast<size_t>(header.count);
+    builtAt = static_cast<time_t>(header.builtAt);
+    updatedAt = max(updatedAt, builtAt);
+    return true;
+}
+
+void FileIndex::forEachUnder(const string& prefix, const function<void(const string& path, const Entry& entry)>& visit) {
+    const Record* end = records + count;
+    const Record* at = lower_bound(records, end, prefix, [this](const Record& record, const string& key) {
+        return comparePath(text + record.pathOffset, record.pathLength, key) < 0;
+    });
+    auto changed = overlay.lower_bound(prefix);
+
+    // Two sorted runs merged; an overlay entry replaces the record with its path
+    string current;
+    Entry entry;
+    while (true) {
+        bool inBase = at != end && at->pathLength >= prefix.size() &&
+            memcmp(text + at->pathOffset, prefix.data(), prefix.size()) == 0;
+        bool inOverlay = changed != overlay.end() && startsWith(changed->first, prefix);
+        if (!inBase && !inOverlay) break;
+        int order = !inBase ? 1 : !inOverlay ? -1 : comparePath(text + at->pathOffset, at->pathLength, changed->first);
+        if (order < 0) {
+            current.assign(text + at->pathOffset, at->pathLength);
+            entry.sizeBytes = at->sizeBytes;
+            entry.modified = at->modified;
+            entry.attributes = at->attributes;
+            entry.root = at->root;
+            visit(current, entry);
+            ++at;
+            continue;
+        }
+        if (!changed->second.removed) visit(changed->first, changed->second);
+        if (order == 0) ++at;
+        ++changed;
+    }
+}
+
+const FileIndex::Record* FileIndex::findBase(const string& path) const {
+    const Record* end = records + count;
+    const Record* at = lower_bound(records, end, path, [this](const Record& record, const string& key) {
+        return comparePath(text + record.pathOffset, record.pathLength, key) < 0;
+    });
+    if (at == end || comparePath(text + at->pathOffset, at->pathLength, path) != 0) return nullptr;
+    return at;
+}
+
+bool FileIndex::lookup(const string& path, Entry& entry) {
+    auto changed = overlay.find(path);
+    if (changed != overlay.end()) {
+        entry = changed->second;
+        return !entry.removed;
+    }
+    const Record* record = findBase(path);
+    if (!record) return false;
+    entry = Entry();
+    entry.sizeBytes = record->sizeBytes;
+    entry.modified = record->modified;
+    entry.attributes = record->attributes;
+    entry.root = record->root;
+    return true;
+}
+
+void FileIndex::record(const string& path, const Entry& entry, bool existed) {
+    Entry& stored = overlay[path];
+    stored = entry;
+    stored.stamp = ++generation;
+    if (existed && entry.removed) fileCount--;
+    if (!existed && !entry.removed) fileCount++;
+    updatedAt = time(nullptr);
+}
+
+void FileIndex::recount() {
+    fileCount = count;
+    for (const auto& change : overlay) {
+        bool inBase = findBase(change.first) != nullptr;
+        if (change.second.removed && inBase) fileCount--;
+        if (!change.second.removed && !inBase) fileCount++;
+    }
+}
+
+int FileIndex::rootOf(const string& path) const {
+    for (size_t i = 0; i < roots.size(); i++) {
+        if (path == roots[i].first || startsWith(path, under(roots[i].first))) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+string FileIndex::under(const string& directory) const {
+    if (!directory.empty() && directory.back() == separator) return directory;
+    return directory + separator;
+}
+
+string FileIndex::rootsText() const {
+    string lines;
+    for (const auto& root : roots) lines += root.first + "\t" + root.second + "\n";
+    return lines;
+}
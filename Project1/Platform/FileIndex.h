@@ -0,0 +1,119 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Platform/Platform.h"
+#include "../Platform/MappedFile.h"
+
+// Path, size, last write and attributes of every file under a few roots,
+// normally the backend's usual folders, so listFile queries and the
+// patterns in sendFile are answered without touching the disk.
+//
+// The index is a file of fixed-size records sorted by path, mapped into
+// memory: loading it parses nothing, and the files under any directory are
+// one binary search away. Changes since the file was written sit in a small
+// sorted overlay that every query merges in as it goes. A watcher thread
+// passes the backend's change notifications to a maintenance thread, which
+// reads each changed directory again and records only what differs. At
+// start, and every RECONCILE_MINUTES after, the maintenance thread walks
+// the roots from scratch and writes a new file, which also catches whatever
+// the notifications missed. An overlay past COMPACT_AT entries is folded
+// into a new file early.
+class FileIndex {
+public:
+    static const char* DEFAULT_FILE;
+    static const int RECONCILE_MINUTES = 30;
+    static const int UNWATCHED_RECONCILE_MINUTES = 5;   // When the roots cannot be watched
+    static const size_t COMPACT_AT = 8192;               // Overlay entries
+    static const size_t MAX_PENDING = 65536;             // Changed paths queued; past it, the roots are walked again
+    static const int SETTLE_MS = 200;                    // Lets a burst of notifications gather
+
+    // roots holds path and label; files are labelled with their root's. With
+    // an empty path, the index lives in memory only.
+    FileIndex(FileBackend& files, const string& path, const vector<pair<string, string>>& roots);
+    ~FileIndex();
+
+    // Maps the file an earlier run left, when it covers the same roots, and
+    // starts the threads. Until the first walk ends, queries are answered
+    // from that file, or not at all without one.
+    void start();
+    void stop();
+
+    bool ready();
+    bool waitUntilReady(chrono::milliseconds timeout);
+
+    // Calls visit, in path order, with every indexed file the walk would
+    // find. False, with nothing visited, when the index cannot stand in for
+    // the walk: it is not ready, a root lies outside its roots, or links are
+    // not skipped.
+    bool walk(const WalkOptions& options, const function<void(const FileInfo&)>& visit);
+    // Up to limit indexed paths that match the glob as a whole, in path
+    // order; false when the index is not ready
+    bool expand(const string& pattern, size_t limit, vector<string>& paths);
+    // The file is gone; recorded now rather than when the watcher says so
+    void forget(const string& path);
+
+    // "file index of 88113 files, updated 3 s ago"
+    string describe();
+
+private:
+    struct Entry {
+        unsigned long long sizeBytes = 0;
+        long long modified = 0;
+        unsigned attributes = 0;
+        unsigned root = 0;
+        bool removed = false;          // In the overlay: the file is gone
+        unsigned long long stamp = 0;  // In the overlay: when it was recorded
+    };
+    struct Record;
+
+    FileBackend& files;
+    string path;
+    vector<pair<string, string>> roots;
+    char separator;
+
+    // The base table, in the mapped file or, when it could not be written,
+    // in memory; guarded by indexMutex like everything below
+    mutex indexMutex;
+    MappedFile mapped;
+    vector<char> image;
+    const Record* records;
+    const char* text;
+    size_t count;
+    bool loaded;
+    map<string, Entry> overlay;
+    unsigned long long generation;   // Stamps overlay entries
+    size_t fileCount;
+    time_t builtAt;     // When the walk behind the base table began
+    time_t updatedAt;   // When the index last took in a change, or builtAt
+    condition_variable readyChanged;
+
+    mutex pendingMutex;
+    condition_variable pendingReady;
+    set<string> pendingPaths;
+    bool overflowed;
+
+    atomic<bool> stopping;
+    atomic<bool> watched;
+    thread watcher;
+    thread maintainer;
+
+    void watch();
+    void maintain();
+    void enqueue(const vector<string>& paths);
+    void apply(const set<string>& paths);
+    void refresh(const string& directory, bool deep);
+    void reconcile();
+    void compact();
+    void replaceBase(vector<pair<string, Entry>>& entries, time_t walkedAt, unsigned long long foldedStamp);
+
+    // Caller holds indexMutex
+    bool adopt(const char* data, size_t size);
+    void forEachUnder(const string& prefix, const function<void(const string& path, const Entry& entry)>& visit);
+    const Record* findBase(const string& path) const;
+    bool lookup(const string& path, Entry& entry);
+    void record(const string& path, const Entry& entry, bool existed);
+    void recount();
+
+    int rootOf(const string& path) const;
+    string under(const string& directory) const;   // With a separator on the end
+    string rootsText() const;
+};
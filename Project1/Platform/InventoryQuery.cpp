@@ -0,0 +1,255 @@
+#include "../Platform/InventoryQuery.h"
+
+namespace {
+
+string formatNumber(double value, int precision) {
+    ostringstream out;
+    out << fixed << setprecision(precision) << value;
+    return out.str();
+}
+
+// Options of a listFile walk; see WalkOptions
+bool isWalkKey(const string& key) {
+    return key == "root" || key == "depth" || key == "include" || key == "exclude" || key == "links" || key == "threads";
+}
+
+string localTime(long long seconds) {
+    time_t at = static_cast<time_t>(seconds);
+    struct tm timeinfo;
+    localtime_s(&timeinfo, &at);
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M", &timeinfo);
+    return text;
+}
+
+string megabytes(double bytes) { return formatNumber(bytes / (1024.0 * 1024.0), 1); }
+string kilobytesPerSecond(double bytes) { return formatNumber(bytes / 1024.0, 1); }
+
+}
+
+string QueryCondition::toText() const {
+    static const char* operators[] = { "=", "!=", "<", "<=", ">", ">=" };
+    return field + operators[op] + value;
+}
+
+bool QuerySpec::empty() const {
+    return conditions.empty() && sortField.empty() && top == 0 && fields.empty() && options.empty();
+}
+
+bool QuerySpec::mentions(const string& field) const {
+    if (sortField == field) return true;
+    for (const auto& condition : conditions) {
+        if (condition.field == field) return true;
+    }
+    return find(fields.begin(), fields.end(), field) != fields.end();
+}
+
+QuerySpec QuerySpec::parse(const string& content) {
+    QuerySpec spec;
+    istringstream iss(content);
+    string token;
+    while (iss >> token) {
+        if (token == "fresh") {
+            spec.fresh = true;
+            continue;
+        }
+
+        // Other words are left alone, as they always were; the body may carry a
+        // signature, or quoted text whose lines start with '>'
+        size_t at = token.find_first_of("=!<>");
+        if (at == string::npos || at == 0) continue;
+        string key = token.substr(0, at);
+        transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+
+        QueryCondition condition;
+        condition.field = key;
+        size_t valueAt = at + 1;
+        char first = token[at];
+        bool hasEquals = valueAt < token.size() && token[valueAt] == '=';
+        if (first == '!' && hasEquals) { condition.op = QueryCondition::NotEqual; valueAt++; }
+        else if (first == '<' && hasEquals) { condition.op = QueryCondition::LessEqual; valueAt++; }
+        else if (first == '>' && hasEquals) { condition.op = QueryCondition::GreaterEqual; valueAt++; }
+        else if (first == '<') condition.op = QueryCondition::Less;
+        else if (first == '>') condition.op = QueryCondition::Greater;
+        else if (first == '=') condition.op = QueryCondition::Equal;
+        else throw invalid_argument("Unknown operator in " + token);
+        condition.value = token.substr(valueAt);
+        if (condition.value.empty()) {
+            throw invalid_argument("Missing value in " + token);
+        }
+
+        bool option = condition.op == QueryCondition::Equal &&
+            (key == "sort" || key == "top" || key == "fields" || key == "interval" || isWalkKey(key));
+        if (!option) {
+            spec.conditions.push_back(condition);
+        }
+        else if (key == "sort") {
+            size_t colon = condition.value.find(':');
+            spec.sortField = condition.value.substr(0, colon);
+            if (colon != string::npos) {
+                spec.sortOrder = condition.value.substr(colon + 1);
+                if (spec.sortOrder != "asc" && spec.sortOrder != "desc") {
+                    throw invalid_argument("Sort order must be asc or desc: " + condition.value);
+                }
+            }
+        }
+        else if (key == "top") {
+            char* end = nullptr;
+            long top = strtol(condition.value.c_str(), &end, 10);
+            if (*end != '\0' || top <= 0) throw invalid_argument("Invalid top: " + condition.value);
+            spec.top = static_cast<size_t>(top);
+        }
+        else if (key == "fields") {
+            istringstream names(condition.value);
+            string name;
+            while (getline(names, name, ',')) {
+                if (!name.empty()) spec.fields.push_back(name);
+            }
+        }
+        else if (spec.options.count(key) && (key == "root" || key == "include" || key == "exclude")) {
+            // Repeating a list option adds to it
+            spec.options[key] += "," + condition.value;
+        }
+        else {
+            spec.options[key] = condition.value;
+        }
+    }
+    return spec;
+}
+
+bool globMatch(const char* pattern, const char* text) {
+    // Greedy match that backtracks only to the last '*'
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*text) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = text;
+        }
+        else if (*pattern == '?' ||
+            tolower(static_cast<unsigned char>(*pattern)) == tolower(static_cast<unsigned char>(*text))) {
+            pattern++;
+            text++;
+        }
+        else if (star) {
+            pattern = star + 1;
+            text = ++resume;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
+
+double parseQuantity(const string& value) {
+    char* end = nullptr;
+    double number = strtod(value.c_str(), &end);
+    if (end == value.c_str()) throw invalid_argument("Expected a number: " + value);
+
+    string unit = end;
+    transform(unit.begin(), unit.end(), unit.begin(), [](unsigned char c) { return static_cast<char>(toupper(c)); });
+    if (unit.empty() || unit == "B" || unit == "%") return number;
+    if (unit == "K" || unit == "KB") return number * 1024;
+    if (unit == "M" || unit == "MB") return number * 1024 * 1024;
+    if (unit == "G" || unit == "GB") return number * 1024 * 1024 * 1024;
+    // Ages, in seconds
+    if (unit == "S") return number;
+    if (unit == "H") return number * 3600;
+    if (unit == "D") return number * 86400;
+    if (unit == "W") return number * 7 * 86400;
+    throw invalid_argument("Unknown unit in " + value + " (use KB, MB or GB, or s, h, d or w for ages)");
+}
+
+const InventoryQuery<ProcessInfo>::Schema& processFields() {
+    static const InventoryQuery<ProcessInfo>::Schema fields = {
+        { "name", "Name", 32, true, nullptr,
+            [](const ProcessInfo& p) { return p.name; } },
+        { "pid", "PID", 8, true,
+            [](const ProcessInfo& p) { return static_cast<double>(p.processId); },
+            [](const ProcessInfo& p) { return to_string(p.processId); } },
+        { "memory", "Memory (MB)", 12, true,
+            [](const ProcessInfo& p) { return static_cast<double>(p.memoryUsage); },
+            [](const ProcessInfo& p) { return megabytes(static_cast<double>(p.memoryUsage)); } }
+    };
+    return fields;
+}
+
+const InventoryQuery<ProcessUsage>::Schema& sampledProcessFields() {
+    static const InventoryQuery<ProcessUsage>::Schema fields = {
+        { "pid", "PID", 8, true,
+            [](const ProcessUsage& p) { return static_cast<double>(p.processId); },
+            [](const ProcessUsage& p) { return to_string(p.processId); } },
+        { "name", "Name", 28, true, nullptr,
+            [](const ProcessUsage& p) { return p.name; } },
+        { "cpu", "CPU %", 7, true,
+            [](const ProcessUsage& p) { return p.cpuPercent; },
+            [](const ProcessUsage& p) { return formatNumber(p.cpuPercent, 1); } },
+        { "threads", "Threads", 8, true,
+            [](const ProcessUsage& p) { return static_cast<double>(p.threads); },
+            [](const ProcessUsage& p) { return to_string(p.threads); } },
+        { "handles", "Handles", 8, true,
+            [](const ProcessUsage& p) { return static_cast<double>(p.handles); },
+            [](const ProcessUsage& p) { return to_string(p.handles); } },
+        { "private", "Private (MB)", 12, true,
+            [](const ProcessUsage& p) { return static_cast<double>(p.privateBytes); },
+            [](const ProcessUsage& p) { return megabytes(static_cast<double>(p.privateBytes)); } },
+        { "memory", "Memory (MB)", 12, true,
+            [](const ProcessUsage& p) { return static_cast<double>(p.workingSet); },
+            [](const ProcessUsage& p) { return megabytes(static_cast<double>(p.workingSet)); } },
+        { "read", "Read KB/s", 10, true,
+            [](const ProcessUsage& p) { return p.readBytesPerSecond; },
+            [](const ProcessUsage& p) { return kilobytesPerSecond(p.readBytesPerSecond); } },
+        { "write", "Write KB/s", 10, true,
+            [](const ProcessUsage& p) { return p.writeBytesPerSecond; },
+            [](const ProcessUsage& p) { return kilobytesPerSecond(p.writeBytesPerSecond); } },
+        { "io", "I/O KB/s", 10, false,
+            [](const ProcessUsage& p) { return p.readBytesPerSecond + p.writeBytesPerSecond; },
+            [](const ProcessUsage& p) { return kilobytesPerSecond(p.readBytesPerSecond + p.writeBytesPerSecond); } },
+        { "new", "New", 4, false,
+            [](const ProcessUsage& p) { return p.started ? 1.0 : 0.0; },
+            [](const ProcessUsage& p) { return string(p.started ? "yes" : "no"); } }
+    };
+    return fields;
+}
+
+const InventoryQuery<ServiceInfo>::Schema& serviceFields() {
+    static const InventoryQuery<ServiceInfo>::Schema fields = {
+        { "name", "Name", 28, true, nullptr,
+            [](const ServiceInfo& s) { return s.name; } },
+        { "status", "Status", 10, true, nullptr,
+            [](const ServiceInfo& s) { return s.status; } },
+        { "start", "Start", 9, true, nullptr,
+            [](const ServiceInfo& s) { return s.startType; } },
+        { "pid", "PID", 7, true,
+            [](const ServiceInfo& s) { return static_cast<double>(s.processId); },
+            [](const ServiceInfo& s) { return to_string(s.processId); } },
+        { "display", "Display Name", 40, true, nullptr,
+            [](const ServiceInfo& s) { return s.displayName; } },
+        { "description", "Description", 60, false, nullptr,
+            [](const ServiceInfo& s) { return s.description; } }
+    };
+    return fields;
+}
+
+const InventoryQuery<FileInfo>::Schema& fileFields() {
+    static const InventoryQuery<FileInfo>::Schema fields = {
+        { "name", "File Name", 30, true, nullptr,
+            [](const FileInfo& f) { return f.name; } },
+        { "dir", "Directory", 14, true, nullptr,
+            [](const FileInfo& f) { return f.label; } },
+        { "size", "Size (MB)", 10, true,
+            [](const FileInfo& f) { return static_cast<double>(f.sizeBytes); },
+            [](const FileInfo& f) { return megabytes(static_cast<double>(f.sizeBytes)); } },
+        { "path", "Path", 50, true, nullptr,
+            [](const FileInfo& f) { return f.path; } },
+        { "modified", "Modified", 17, false,
+            [](const FileInfo& f) { return static_cast<double>(f.modified); },
+            [](const FileInfo& f) { return localTime(f.modified); } },
+        { "age", "Age (days)", 10, false,
+            [](const FileInfo& f) { return static_cast<double>(time(nullptr) - f.modified); },
+            [](const FileInfo& f) { return formatNumber((time(nullptr) - f.modified) / 86400.0, 1); } }
+    };
+    return fields;
+}
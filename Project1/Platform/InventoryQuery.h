@@ -0,0 +1,265 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Platform/Platform.h"
+#include "../Platform/ProcessSampler.h"
+
+// Filter and sort expressions for the inventory commands, applied to each row
+// as the backend enumerates it, so rows that do not match are never
+// formatted or mailed. A command body such as
+//
+//   name=chrome* memory>500MB sort=memory top=10 fields=name,pid,memory
+//
+// holds any number of conditions, which must all hold, plus these options:
+//   field=glob, field!=glob   case-insensitive, with * and ?
+//   field<n, <=, >, >=, =, != on number fields; n may end in KB, MB or GB,
+//                             or for ages in s, h, d or w
+//   sort=field[:asc|:desc]    numbers sort largest first unless told otherwise
+//   top=K                     keep the first K rows after sorting
+//   fields=a,b,c              columns to print, in this order
+// Words without an operator, or without a field before it, are ignored.
+// listFile also takes the walk options
+// root=, depth=, include=, exclude=, links= and threads= (see WalkOptions);
+// root, include and exclude may be repeated.
+
+struct QueryCondition {
+    enum Op { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+    string field;
+    Op op = Equal;
+    string value;
+
+    string toText() const;   // Back to "field>value"
+};
+
+// The body as written, before field names are checked against a row type
+struct QuerySpec {
+    vector<QueryCondition> conditions;
+    string sortField;
+    string sortOrder;              // "", "asc" or "desc"
+    size_t top = 0;                // 0 keeps every match
+    vector<string> fields;
+    map<string, string> options;   // Command-specific settings, like interval=
+    bool fresh = false;            // The snapshot flag; not a query term on its own
+
+    bool empty() const;
+    bool mentions(const string& field) const;
+
+    // Throws invalid_argument with a message fit to mail back
+    static QuerySpec parse(const string& content);
+};
+
+bool globMatch(const char* pattern, const char* text);
+// "500MB" -> 524288000, "7d" -> 604800; throws invalid_argument
+double parseQuantity(const string& value);
+
+// A column of Row that queries can filter, sort and print
+template <typename Row>
+struct InventoryField {
+    const char* name;
+    const char* heading;
+    int width;
+    bool shownByDefault;
+    double (*number)(const Row&);   // Null on text fields
+    string (*text)(const Row&);     // What the report shows; text fields also match on it
+};
+
+template <typename Row>
+class InventoryQuery {
+public:
+    typedef vector<InventoryField<Row>> Schema;
+
+    // Resolves the spec's names against the schema; throws invalid_argument
+    // on an unknown field or a comparison the field cannot make
+    InventoryQuery(const QuerySpec& spec, const Schema& schema, const string& defaultSort);
+
+    bool matches(const Row& row) const;
+    // Counts the row and keeps a copy if it matches
+    void offer(const Row& row);
+    // Sorts the kept rows and cuts them to top
+    const vector<Row>& finish();
+    void writeTable(ostream& out) const;
+
+    // For rows written as they arrive, unsorted, instead of kept: counts the
+    // row like offer and says whether to write it
+    bool pass(const Row& row);
+    void writeHeader(ostream& out) const;
+    void writeRow(ostream& out, const Row& row) const;
+
+    size_t seen() const { return seenRows; }
+    size_t matched() const { return matchedRows; }
+
+private:
+    struct Condition {
+        const InventoryField<Row>* field;
+        QueryCondition::Op op;
+        double number;
+        string text;
+    };
+
+    const Schema& schema;
+    vector<Condition> conditions;
+    const InventoryField<Row>* sortField;
+    bool descending;
+    size_t top;
+    vector<const InventoryField<Row>*> columns;
+    vector<Row> rows;
+    size_t seenRows;
+    size_t matchedRows;
+
+    const InventoryField<Row>* find(const string& name) const;
+    bool before(const Row& a, const Row& b) const;
+    void trim();
+};
+
+// The columns of each inventory
+const InventoryQuery<ProcessInfo>::Schema& processFields();
+const InventoryQuery<ProcessUsage>::Schema& sampledProcessFields();
+const InventoryQuery<ServiceInfo>::Schema& serviceFields();
+const InventoryQuery<FileInfo>::Schema& fileFields();
+
+template <typename Row>
+InventoryQuery<Row>::InventoryQuery(const QuerySpec& spec, const Schema& schema, const string& defaultSort)
+    : schema(schema), sortField(nullptr), descending(false), top(spec.top), seenRows(0), matchedRows(0) {
+    for (const auto& term : spec.conditions) {
+        Condition condition;
+        condition.field = find(term.field);
+        condition.op = term.op;
+        condition.number = 0;
+        if (condition.field->number) {
+            condition.number = parseQuantity(term.value);
+        }
+        else if (term.op != QueryCondition::Equal && term.op != QueryCondition::NotEqual) {
+            throw invalid_argument(string(condition.field->name) + " is text; use = or != with a pattern");
+        }
+        condition.text = term.value;
+        conditions.push_back(condition);
+    }
+
+    sortField = find(spec.sortField.empty() ? defaultSort : spec.sortField);
+    descending = spec.sortOrder.empty() ? sortField->number != nullptr : spec.sortOrder == "desc";
+
+    if (spec.fields.empty()) {
+        for (const auto& field : schema) {
+            if (field.shownByDefault) columns.push_back(&field);
+        }
+    }
+    else {
+        for (const auto& name : spec.fields) columns.push_back(find(name));
+    }
+}
+
+template <typename Row>
+const InventoryField<Row>* InventoryQuery<Row>::find(const string& name) const {
+    for (const auto& field : schema) {
+        if (name == field.name) return &field;
+    }
+    string known;
+    for (const auto& field : schema) known += (known.empty() ? "" : ", ") + string(field.name);
+    throw invalid_argument("Unknown field " + name + " (fields: " + known + ")");
+}
+
+template <typename Row>
+bool InventoryQuery<Row>::matches(const Row& row) const {
+    for (const auto& condition : conditions) {
+        bool holds;
+        if (condition.field->number) {
+            double value = condition.field->number(row);
+            switch (condition.op) {
+            case QueryCondition::Equal: holds = value == condition.number; break;
+            case QueryCondition::NotEqual: holds = value != condition.number; break;
+            case QueryCondition::Less: holds = value < condition.number; break;
+            case QueryCondition::LessEqual: holds = value <= condition.number; break;
+            case QueryCondition::Greater: holds = value > condition.number; break;
+            default: holds = value >= condition.number; break;
+            }
+        }
+        else {
+            holds = globMatch(condition.text.c_str(), condition.field->text(row).c_str());
+            if (condition.op == QueryCondition::NotEqual) holds = !holds;
+        }
+        if (!holds) return false;
+    }
+    return true;
+}
+
+template <typename Row>
+bool InventoryQuery<Row>::before(const Row& a, const Row& b) const {
+    if (sortField->number) {
+        double left = sortField->number(a);
+        double right = sortField->number(b);
+        return descending ? left > right : left < right;
+    }
+    string left = sortField->text(a);
+    string right = sortField->text(b);
+    return descending ? left > right : left < right;
+}
+
+template <typename Row>
+void InventoryQuery<Row>::trim() {
+    // Only the first top rows can survive, so the rest go
+    auto order = [this](const Row& a, const Row& b) { return before(a, b); };
+    nth_element(rows.begin(), rows.begin() + (top - 1), rows.end(), order);
+    rows.resize(top);
+}
+
+template <typename Row>
+void InventoryQuery<Row>::offer(const Row& row) {
+    seenRows++;
+    if (!matches(row)) return;
+    matchedRows++;
+    rows.push_back(row);
+    // With a top, memory stays within twice that however many rows match
+    if (top > 0 && rows.size() >= 2 * top) trim();
+}
+
+template <typename Row>
+const vector<Row>& InventoryQuery<Row>::finish() {
+    if (top > 0 && rows.size() > top) trim();
+    stable_sort(rows.begin(), rows.end(), [this](const Row& a, const Row& b) { return before(a, b); });
+    return rows;
+}
+
+template <typename Row>
+bool InventoryQuery<Row>::pass(const Row& row) {
+    seenRows++;
+    if (!matches(row)) return false;
+    matchedRows++;
+    return true;
+}
+
+template <typename Row>
+void InventoryQuery<Row>::writeHeader(ostream& out) const {
+    size_t totalWidth = 0;
+    for (size_t i = 0; i < columns.size(); i++) {
+        const auto* column = columns[i];
+        bool last = i + 1 == columns.size();
+        if (column->number) out << right << setw(column->width);
+        else out << left << setw(last ? 0 : column->width);
+        out << column->heading << (last ? "" : "  ");
+        totalWidth += column->width + 2;
+    }
+    out << endl << string(totalWidth, '-') << endl;
+}
+
+template <typename Row>
+void InventoryQuery<Row>::writeRow(ostream& out, const Row& row) const {
+    for (size_t i = 0; i < columns.size(); i++) {
+        const auto* column = columns[i];
+        string value = column->text(row);
+        bool last = i + 1 == columns.size();
+        // Long text is cut to its column, except in the last one
+        if (!last && value.size() >= static_cast<size_t>(column->width)) {
+            value = value.substr(0, column->width - 1);
+        }
+        if (column->number) out << right << setw(column->width);
+        else out << left << setw(last ? 0 : column->width);
+        out << value << (last ? "" : "  ");
+    }
+    out << '\n';
+}
+
+template <typename Row>
+void InventoryQuery<Row>::writeTable(ostream& out) const {
+    writeHeader(out);
+    for (const auto& row : rows) writeRow(out, row);
+}
@@ -0,0 +1,982 @@
+#ifndef _WIN32
+#include "../Platform/Platform.h"
+#include "../Platform/DirectoryWalker.h"
+#include "../Platform/ProcFs.h"
+#include "../Platform/ServiceController.h"
+#include "../Platform/ShortcutIndex.h"
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <strings.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+// Linux backends on /proc (through ProcFsReader), systemd and the home
+// directory. There is no desktop to capture, so the screen backend reports
+// itself unavailable.
+
+namespace {
+
+string logHeader(const string& title) {
+    time_t now = time(nullptr);
+    char timeStr[26];
+    ctime_s(timeStr, sizeof(timeStr), &now);
+    return "\n=== " + title + " " + timeStr + "===\n";
+}
+
+// Names go on a shell command line, so only unit-name characters pass
+bool safeUnitName(const string& name) {
+    if (name.empty() || name[0] == '-') return false;
+    for (char c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && !strchr("@._-:", c)) return false;
+    }
+    return true;
+}
+
+int runCommand(const string& commandLine) {
+    int status = system((commandLine + " >/dev/null 2>&1").c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// One blocking systemctl per service, each on its own thread. systemctl waits
+// for its job through systemd's JobRemoved signal, so nothing here polls; a
+// finished job wakes the controller through the condition variable.
+class SystemdServiceDriver : public ServiceControlDriver {
+public:
+    SystemdServiceDriver() : jobs(make_shared<Jobs>()), seenVersion(0) {}
+
+    unsigned long request(const string& name, bool start) override {
+        {
+            lock_guard<mutex> lock(jobs->jobsMutex);
+            Job& job = jobs->byName[name];
+            job.start = start;
+            job.done = false;
+        }
+        // The jobs outlive this driver when a service times out
+        shared_ptr<Jobs> shared = jobs;
+        thread([shared, name, start] {
+            int exitCode = runCommand(string("systemctl ") + (start ? "start " : "stop ") + name);
+            lock_guard<mutex> lock(shared->jobsMutex);
+            Job& job = shared->byName[name];
+            job.done = true;
+            job.exitCode = exitCode;
+            shared->version++;
+            shared->changed.notify_all();
+        }).detach();
+        return 0;
+    }
+
+    string state(const string& name) override {
+        lock_guard<mutex> lock(jobs->jobsMutex);
+        auto it = jobs->byName.find(name);
+        if (it == jobs->byName.end()) return "";
+        const Job& job = it->second;
+        if (!job.done) return job.start ? "Start Pending" : "Stop Pending";
+        if (job.exitCode == 0) return job.start ? "Running" : "Stopped";
+        return "Failed (systemctl exit code " + to_string(job.exitCode) + ")";
+    }
+
+    void waitForChange(chrono::steady_clock::time_point deadline) override {
+        unique_lock<mutex> lock(jobs->jobsMutex);
+        jobs->changed.wait_until(lock, deadline, [this] { return jobs->version != seenVersion; });
+        seenVersion = jobs->version;
+    }
+
+    // The hard dependencies, as on Windows; Wants= and targets do not hold a start back
+    vector<string> dependencies(const string& name) override {
+        vector<string> names;
+        if (!safeUnitName(name)) return names;
+        string command = "systemctl show -p Requires -p Requisite -p BindsTo --value " + name + " 2>/dev/null";
+        FILE* pipe = popen(command.c_str(), "r");
+        if (!pipe) return names;
+        char line[4096];
+        while (fgets(line, sizeof(line), pipe)) {
+            istringstream units(line);
+            string unit;
+            const string suffix = ".service";
+            while (units >> unit) {
+                if (unit.size() > suffix.size() && unit.compare(unit.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                    names.push_back(unit.substr(0, unit.size() - suffix.size()));
+                }
+            }
+        }
+        pclose(pipe);
+        return names;
+    }
+
+private:
+    struct Job {
+        bool start = true;
+        bool done = false;
+        int exitCode = 0;
+    };
+    struct Jobs {
+        mutex jobsMutex;
+        condition_variable changed;
+        map<string, Job> byName;
+        unsigned long long version = 0;
+    };
+
+    shared_ptr<Jobs> jobs;
+    unsigned long long seenVersion;
+};
+
+// Where desktop entries live, in the order a name is looked up
+vector<string> applicationDirectories() {
+    vector<string> directories = { "/usr/share/applications", "/usr/local/share/applications" };
+    const char* home = getenv("HOME");
+    if (home && *home) directories.push_back(string(home) + "/.local/share/applications");
+    return directories;
+}
+
+// Exec= split into words, with quoting undone and field codes like %U dropped
+vector<string> execArguments(const string& exec) {
+    vector<string> arguments;
+    string word;
+    bool inWord = false, quoted = false;
+    for (size_t i = 0; i < exec.size(); i++) {
+        char c = exec[i];
+        if (c == '"') {
+            quoted = !quoted;
+            inWord = true;
+        }
+        else if (c == '\\' && quoted && i + 1 < exec.size()) {
+            word += exec[++i];
+        }
+        else if (isspace(static_cast<unsigned char>(c)) && !quoted) {
+            if (inWord) arguments.push_back(word);
+            word.clear();
+            inWord = false;
+        }
+        else {
+            word += c;
+            inWord = true;
+        }
+    }
+    if (inWord) arguments.push_back(word);
+
+    vector<string> kept;
+    for (auto& argument : arguments) {
+        if (argument.size() == 2 && argument[0] == '%') continue;
+        kept.push_back(move(argument));
+    }
+    return kept;
+}
+
+// Name= and Exec= from the [Desktop Entry] group; hidden entries are skipped
+void readDesktopEntry(const string& path, const string& stem, vector<ShortcutEntry>& entries) {
+    ifstream file(path);
+    string line, name, exec;
+    bool inEntry = false, hidden = false;
+    while (getline(file, line)) {
+        if (!line.empty() && line[0] == '[') {
+            inEntry = line.compare(0, 15, "[Desktop Entry]") == 0;
+            continue;
+        }
+        if (!inEntry) continue;
+        if (line.compare(0, 5, "Name=") == 0 && name.empty()) name = line.substr(5);
+        else if (line.compare(0, 5, "Exec=") == 0 && exec.empty()) exec = line.substr(5);
+        else if (line == "NoDisplay=true" || line == "Hidden=true") hidden = true;
+    }
+    if (exec.empty() || hidden) return;
+
+    ShortcutEntry entry;
+    entry.path = path;
+    entry.command = exec;
+    // Both "Firefox Web Browser" and "firefox" should find it
+    if (!name.empty()) {
+        entry.name = name;
+        entries.push_back(entry);
+    }
+    entry.name = stem;
+    entries.push_back(entry);
+}
+
+void scanApplications(vector<ShortcutEntry>& entries) {
+    for (const auto& directory : applicationDirectories()) {
+        DIR* dir = opendir(directory.c_str());
+        if (!dir) continue;
+        while (dirent* item = readdir(dir)) {
+            string fileName = item->d_name;
+            const size_t suffix = strlen(".desktop");
+            if (fileName.size() <= suffix || fileName.compare(fileName.size() - suffix, suffix, ".desktop") != 0) continue;
+            readDesktopEntry(directory + "/" + fileName, fileName.substr(0, fileName.size() - suffix), entries);
+        }
+        closedir(dir);
+    }
+}
+
+class LinuxProcesses : public ProcessBackend {
+public:
+    LinuxProcesses() : ticksPerSecond(sysconf(_SC_CLK_TCK)), shortcuts(scanApplications), watching(false) {
+        if (ticksPerSecond <= 0) ticksPerSecond = 100;
+        sampleReader.setReadStatm(true);
+        sampleReader.setReadIo(true);
+        sampleReader.setCountHandles(true);
+    }
+
+    ~LinuxProcesses() {
+        watching = false;
+        if (watcher.joinable()) watcher.join();
+    }
+
+    bool listProcesses(vector<ProcessInfo>& processes) override {
+        lock_guard<mutex> lock(readerMutex);
+        reader.enumerate(processes);
+        return true;
+    }
+
+    bool writeProcesses(ostream& out) override {
+        lock_guard<mutex> lock(readerMutex);
+        reader.enumerate(reported);
+        for (const auto& process : reported) {
+            out << "Process Name: " << process.name << endl;
+            out << "Process ID: " << process.processId << endl;
+            out << "Memory Usage: " << process.memoryUsage << " bytes" << endl;
+            out << endl;
+        }
+        return true;
+    }
+
+    bool sampleProcesses(vector<ProcessCounters>& counters) override {
+        lock_guard<mutex> lock(sampleMutex);
+        sampleReader.scan(sampleStats);
+        unsigned long long pageBytes = static_cast<unsigned long long>(sampleReader.pageSize());
+
+        counters.resize(sampleStats.size());
+        for (size_t i = 0; i < sampleStats.size(); i++) {
+            const ProcStat& stat = sampleStats[i];
+            ProcessCounters& sample = counters[i];
+            sample.name.assign(stat.name);
+            sample.processId = static_cast<DWORD>(stat.pid);
+            sample.parentProcessId = static_cast<DWORD>(stat.parentPid);
+            sample.startTime = stat.startTicks;
+            sample.cpuMicroseconds = (stat.userTicks + stat.systemTicks) * 1000000ULL / ticksPerSecond;
+            sample.threads = static_cast<unsigned>(stat.threads);
+            sample.handles = static_cast<unsigned>(stat.handles);
+            // Resident pages not shared with anything else, the nearest to Windows' private bytes
+            sample.privateBytes = (stat.residentPages - min(stat.sharedPages, stat.residentPages)) * pageBytes;
+            sample.workingSet = stat.residentPages * pageBytes;
+            sample.readBytes = stat.readBytes;
+            sample.writeBytes = stat.writeBytes;
+        }
+        return true;
+    }
+
+    void startProcesses(const vector<string>& names, const string& logFileName) override {
+        ofstream logFile(logFileName, ios::app);
+        logFile << logHeader("App Launch Log");
+
+        startWatching();
+        auto started = chrono::steady_clock::now();
+        vector<LaunchResult> results(names.size());
+        vector<chrono::steady_clock::time_point> launchedAt(names.size());
+        for (size_t i = 0; i < names.size(); i++) {
+            const string& appName = names[i];
+            LaunchResult& result = results[i];
+            result.name = appName;
+
+            // A desktop entry's command when one matches, else the name as a program
+            ShortcutMatch match;
+            bool found = shortcuts.lookup(appName, match);
+            vector<string> arguments = found ? execArguments(match.entry.command) : vector<string>();
+            if (arguments.empty()) arguments.push_back(appName);
+            if (found && strcmp(match.kind, "exact") != 0) {
+                result.note = match.entry.name + ", " + match.kind + " match";
+            }
+
+            vector<char*> argv;
+            for (auto& argument : arguments) argv.push_back(&argument[0]);
+            argv.push_back(nullptr);
+
+            // posix_spawnp returns once the exec is done, so every app starts before any wait
+            pid_t pid = 0;
+            launchedAt[i] = chrono::steady_clock::now();
+            int error = posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+            if (error == 0) {
+                result.started = true;
+                result.processId = static_cast<DWORD>(pid);
+            }
+            else {
+                result.error = static_cast<DWORD>(error);
+                if (!found) {
+                    for (const auto& suggestion : shortcuts.suggest(appName, 3)) {
+                        result.suggestions.push_back(suggestion.entry.name);
+                    }
+                }
+            }
+        }
+
+        waitUntilReady(results, launchedAt);
+        for (const auto& result : results) {
+            if (!result.started || result.readiness == "exited") continue;
+            // Reap it whenever it exits
+            pid_t pid = static_cast<pid_t>(result.processId);
+            thread([pid] { waitpid(pid, nullptr, 0); }).detach();
+        }
+
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+        writeLaunchResults(logFile, results, elapsed);
+        logFile << "=== End of Log ===\n\n";
+    }
+
+    void endProcesses(const vector<string>& names, const string& logFileName) override {
+        // comm is cut at 15 characters, so the requested names are too
+        unordered_set<string> wanted;
+        for (const auto& appName : names) wanted.insert(foldName(appName).substr(0, 15));
+
+        vector<ProcessInfo> processes;
+        listProcesses(processes);
+        vector<ProcessTarget> targets;
+        for (const auto& process : processes) {
+            if (wanted.find(foldName(process.name)) == wanted.end()) continue;
+            ProcessTarget target;
+            target.name = process.name;
+            target.processId = process.processId;
+            targets.push_back(target);
+        }
+        terminateProcesses(targets, logFileName);
+    }
+
+    void terminateProcesses(const vector<ProcessTarget>& targets, const string& logFileName) override {
+        ofstream logFile(logFileName, ios::app);
+        logFile << logHeader("Task Termination Log");
+
+        vector<Termination> terminations;
+        auto started = chrono::steady_clock::now();
+        for (const auto& target : targets) {
+            pid_t pid = static_cast<pid_t>(target.processId);
+            // Opened before the check and the signal, which then reach this process even if the number is reused
+            int pidfd = openPidFd(pid);
+            ProcStat stat;
+            if (target.startTime != 0 && (!readStat(pid, stat) || stat.startTicks != target.startTime)) {
+                logFile << "Skipped " << target.name << " (PID: " << target.processId
+                    << ") - the PID now belongs to another process\n";
+                if (pidfd >= 0) close(pidfd);
+                continue;
+            }
+            if (sendSignal(pid, pidfd, SIGTERM) != 0) {
+                logFile << "Failed to terminate " << target.name
+                    << " (PID: " << target.processId
+                    << ") - Error code: " << errno << "\n";
+                if (pidfd >= 0) close(pidfd);
+                continue;
+            }
+            terminations.push_back({ target.name, pid, pidfd, chrono::steady_clock::now(), -1 });
+        }
+
+        waitForExits(terminations, started + chrono::milliseconds(TERMINATE_WAIT_MS));
+
+        size_t confirmed = 0;
+        for (const auto& termination : terminations) {
+            if (termination.exitMs >= 0) {
+                logFile << "Successfully terminated " << termination.name
+                    << " (PID: " << termination.pid << ") - exited in " << termination.exitMs << " ms\n";
+                confirmed++;
+            }
+            else {
+                logFile << "Termination requested for " << termination.name
+                    << " (PID: " << termination.pid << ") - still running after "
+                    << TERMINATE_WAIT_MS << " ms\n";
+            }
+            if (termination.pidfd >= 0) close(termination.pidfd);
+        }
+
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+        logFile << "Confirmed " << confirmed << " of " << terminations.size()
+            << " terminations in " << elapsed << " ms\n";
+        logFile << "=== End of Log ===\n\n";
+    }
+
+private:
+    struct Termination {
+        string name;
+        pid_t pid;
+        int pidfd;                                  // -1 on kernels before 5.3
+        chrono::steady_clock::time_point issuedAt;
+        long long exitMs;                           // -1 until the exit is seen
+    };
+
+    // Linux has no input-idle signal, so an app counts as ready once it has
+    // blocked in the kernel (state S) on two checks 10 ms apart, which is
+    // where an event loop waits. Children that exit are reaped here.
+    static void waitUntilReady(vector<LaunchResult>& results, const vector<chrono::steady_clock::time_point>& launchedAt) {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(LAUNCH_READY_MS);
+        vector<int> idleChecks(results.size(), 0);
+        while (true) {
+            auto now = chrono::steady_clock::now();
+            bool pending = false;
+            for (size_t i = 0; i < results.size(); i++) {
+                LaunchResult& result = results[i];
+                if (!result.started || !result.readiness.empty()) continue;
+                pid_t pid = static_cast<pid_t>(result.processId);
+                long long elapsedMs = chrono::duration_cast<chrono::milliseconds>(now - launchedAt[i]).count();
+
+                int status = 0;
+                if (waitpid(pid, &status, WNOHANG) == pid) {
+                    result.readiness = "exited";
+                    result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                    result.readyMs = elapsedMs;
+                    continue;
+                }
+                idleChecks[i] = processState(pid) == 'S' ? idleChecks[i] + 1 : 0;
+                if (idleChecks[i] == 2) {
+                    result.readiness = "idle";
+                    result.readyMs = elapsedMs;
+                }
+                else if (now >= deadline) {
+                    result.readiness = "timed out";
+                    result.readyMs = elapsedMs;
+                }
+                else {
+                    pending = true;
+                }
+            }
+            if (!pending) break;
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+    }
+
+    // One process's /proc/<pid>/stat, outside a full scan
+    static bool readStat(pid_t pid, ProcStat& stat) {
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+        FILE* file = fopen(path, "r");
+        if (!file) return false;
+        char line[1024];
+        size_t length = fread(line, 1, sizeof(line) - 1, file);
+        fclose(file);
+        line[length] = 0;
+        return ProcFsReader::parseStat(line, length, stat);
+    }
+
+    // The state letter, or 0 when the process cannot be read
+    static char processState(pid_t pid) {
+        ProcStat stat;
+        return readStat(pid, stat) ? stat.state : 0;
+    }
+
+    static string foldName(const string& name) {
+        string folded = name;
+        for (auto& c : folded) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        return folded;
+    }
+
+    static int openPidFd(pid_t pid) {
+#ifdef SYS_pidfd_open
+        return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+        (void)pid;
+        return -1;
+#endif
+    }
+
+    static int sendSignal(pid_t pid, int pidfd, int signal) {
+#ifdef SYS_pidfd_send_signal
+        if (pidfd >= 0) return static_cast<int>(syscall(SYS_pidfd_send_signal, pidfd, signal, nullptr, 0));
+#else
+        (void)pidfd;
+#endif
+        return kill(pid, signal);
+    }
+
+    // One poll over every pidfd until all have exited or the deadline passes.
+    // Without pidfds, the remaining PIDs are probed with signal 0 every 10 ms.
+    static void waitForExits(vector<Termination>& terminations, chrono::steady_clock::time_point deadline) {
+        size_t pending = terminations.size();
+        vector<pollfd> waits;
+        vector<size_t> owners;
+        while (pending > 0) {
+            auto now = chrono::steady_clock::now();
+            if (now >= deadline) break;
+
+            waits.clear();
+            owners.clear();
+            bool probing = false;
+            for (size_t i = 0; i < terminations.size(); i++) {
+                Termination& termination = terminations[i];
+                if (termination.exitMs >= 0) continue;
+                if (termination.pidfd >= 0) {
+                    waits.push_back({ termination.pidfd, POLLIN, 0 });
+                    owners.push_back(i);
+                }
+                else if (kill(termination.pid, 0) != 0 && errno == ESRCH) {
+                    termination.exitMs = chrono::duration_cast<chrono::milliseconds>(now - termination.issuedAt).count();
+                    pending--;
+                }
+                else {
+                    probing = true;
+                }
+            }
+            if (pending == 0) break;
+
+            int timeout = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(deadline - now).count());
+            if (probing) timeout = min(timeout, 10);
+            if (waits.empty()) {
+                this_thread::sleep_for(chrono::milliseconds(timeout));
+                continue;
+            }
+            if (poll(waits.data(), waits.size(), timeout) <= 0) continue;
+
+            auto seen = chrono::steady_clock::now();
+            for (size_t j = 0; j < waits.size(); j++) {
+                if (!waits[j].revents) continue;
+                Termination& termination = terminations[owners[j]];
+                termination.exitMs = chrono::duration_cast<chrono::milliseconds>(seen - termination.issuedAt).count();
+                pending--;
+            }
+        }
+    }
+
+    // Snapshot refreshes and handlers can scan at the same time
+    mutex readerMutex;
+    ProcFsReader reader;
+    vector<ProcessInfo> reported;   // Reused between reports
+
+    // The sampler reads three more files per process, so it has its own reader
+    mutex sampleMutex;
+    ProcFsReader sampleReader;
+    vector<ProcStat> sampleStats;
+    long ticksPerSecond;
+
+    // Desktop entries, rescanned after inotify reports a change
+    ShortcutIndex shortcuts;
+    once_flag watchStarted;
+    atomic<bool> watching;
+    thread watcher;
+
+    // Started by the first launch, so servers that never launch never watch
+    void startWatching() {
+        call_once(watchStarted, [this] {
+            watching = true;
+            watcher = thread(&LinuxProcesses::watchApplications, this);
+        });
+    }
+
+    void watchApplications() {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return;
+        for (const auto& directory : applicationDirectories()) {
+            inotify_add_watch(fd, directory.c_str(), IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO);
+        }
+
+        char events[4096];
+        pollfd waitFor = { fd, POLLIN, 0 };
+        while (watching) {
+            // Wakes twice a second to notice shutdown
+            if (poll(&waitFor, 1, 500) <= 0) continue;
+            bool changed = false;
+            while (read(fd, events, sizeof(events)) > 0) changed = true;
+            if (changed) shortcuts.invalidate();
+        }
+        close(fd);
+    }
+};
+
+class LinuxServices : public ServiceBackend {
+public:
+    bool writeServices(ostream& out) override {
+        out << "=== Linux Services List ===\n\n";
+        int index = 0;
+        return enumerateServices([&](const ServiceInfo& service) {
+            out << "Service #" << ++index << "\n";
+            out << "==================\n";
+            out << "System Name: " << service.name << "\n";
+            out << "Display Name: " << service.displayName << "\n";
+            out << "Status: " << service.status << "\n";
+            out << "Description: " << (service.description.empty() ? "No description available" : service.description) << "\n";
+            out << "------------------\n\n";
+        });
+    }
+
+    bool enumerateServices(const function<void(const ServiceInfo&)>& visit) override {
+        map<string, string> startTypes = readStartTypes();
+        FILE* pipe = popen("systemctl list-units --type=service --all --plain --no-legend --no-pager 2>/dev/null", "r");
+        if (!pipe) return false;
+
+        char line[1024];
+        ServiceInfo info;
+        while (fgets(line, sizeof(line), pipe)) {
+            // UNIT LOAD ACTIVE SUB DESCRIPTION...
+            istringstream fields(line);
+            string unit, load, active, sub;
+            if (!(fields >> unit >> load >> active >> sub)) continue;
+            info.description.clear();
+            getline(fields >> ws, info.description);
+
+            info.name = unit.substr(0, unit.rfind(".service"));
+            info.displayName = unit;
+            info.status = statusText(active, sub);
+            auto startType = startTypes.find(unit);
+            info.startType = startType != startTypes.end() ? startType->second : "Manual";
+            visit(info);
+        }
+        return pclose(pipe) == 0;
+    }
+
+    bool startServices(const vector<string>& names, const string& logFileName) override {
+        return control(true, names, logFileName);
+    }
+
+    bool stopServices(const vector<string>& names, const string& logFileName) override {
+        return control(false, names, logFileName);
+    }
+
+private:
+    static string statusText(const string& active, const string& sub) {
+        if (sub == "running") return "Running";
+        if (active == "activating") return "Start Pending";
+        if (active == "deactivating") return "Stop Pending";
+        if (active == "failed") return "Failed";
+        return "Stopped";
+    }
+
+    // Unit file states in Windows' start-type terms
+    static map<string, string> readStartTypes() {
+        map<string, string> startTypes;
+        FILE* pipe = popen("systemctl list-unit-files --type=service --no-legend --no-pager 2>/dev/null", "r");
+        if (!pipe) return startTypes;
+        char line[512];
+        while (fgets(line, sizeof(line), pipe)) {
+            istringstream fields(line);
+            string unit, state;
+            if (!(fields >> unit >> state)) continue;
+            if (state == "enabled" || state == "enabled-runtime") startTypes[unit] = "Auto";
+            else if (state == "disabled" || state == "masked") startTypes[unit] = "Disabled";
+            else startTypes[unit] = "Manual";
+        }
+        pclose(pipe);
+        return startTypes;
+    }
+
+    static bool isCritical(const string& name) {
+        static const set<string> critical = {
+            "systemd-journald", "systemd-logind", "systemd-udevd", "dbus",
+            "ssh", "sshd", "NetworkManager", "systemd-networkd", "systemd-resolved"
+        };
+        return critical.count(name.substr(0, name.rfind(".service"))) > 0;
+    }
+
+    bool control(bool start, const vector<string>& names, const string& logFileName) {
+        ofstream logFile(logFileName, ios::app);
+        logFile << logHeader(start ? "Service Start Operation Log" : "Service Stop Operation Log");
+
+        vector<ServiceOperation> operations(names.size());
+        for (size_t i = 0; i < names.size(); i++) {
+            operations[i].name = names[i];
+            operations[i].start = start;
+            if (isCritical(names[i])) operations[i].refused = "Cannot modify critical service";
+            else if (!safeUnitName(names[i])) operations[i].refused = "Invalid service name";
+        }
+
+        auto started = chrono::steady_clock::now();
+        SystemdServiceDriver driver;
+        ServiceSchedule schedule = ServiceController(driver).run(operations, chrono::milliseconds(STATE_WAIT_MS));
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+
+        writeServiceResults(logFile, operations, schedule, STATE_WAIT_MS, elapsed);
+        logFile << "=== End of Log ===\n\n";
+        return all_of(operations.begin(), operations.end(),
+            [](const ServiceOperation& operation) { return operation.reached; });
+    }
+};
+
+// The file system through opendir and readdir. The file type comes with each
+// entry, so only files and links cost an fstatat, against the open directory.
+class PosixDirectorySource : public DirectorySource {
+public:
+    bool read(const string& path, vector<DirectoryEntry>& entries) override {
+        DIR* dir = opendir(path.c_str());
+        if (!dir) return false;
+        int dirFd = dirfd(dir);
+        DirectoryEntry entry;
+        while (dirent* found = readdir(dir)) {
+            const char* name = found->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+            entry.name = name;
+            entry.directory = false;
+            entry.link = false;
+            entry.sizeBytes = 0;
+            entry.modified = 0;
+            entry.attributes = 0;
+
+            unsigned char type = found->d_type;
+            struct stat status;
+            if (type == DT_UNKNOWN) {
+                if (fstatat(dirFd, name, &status, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                type = S_ISDIR(status.st_mode) ? DT_DIR : S_ISLNK(status.st_mode) ? DT_LNK :
+                    S_ISREG(status.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+            if (type == DT_DIR) {
+                entry.directory = true;
+            }
+            else if (type == DT_LNK) {
+                // What the link points at; a dangling link lists as an empty file
+                entry.link = true;
+                if (fstatat(dirFd, name, &status, 0) == 0) {
+                    entry.directory = S_ISDIR(status.st_mode);
+                    if (S_ISREG(status.st_mode)) entry.sizeBytes = static_cast<unsigned long long>(status.st_size);
+                    entry.modified = status.st_mtime;
+                    entry.attributes = status.st_mode;
+                }
+            }
+            else if (type == DT_REG) {
+                if (fstatat(dirFd, name, &status, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                entry.sizeBytes = static_cast<unsigned long long>(status.st_size);
+                entry.modified = status.st_mtime;
+                entry.attributes = status.st_mode;
+            }
+            else {
+                continue;   // Devices, sockets and pipes are not files to list
+            }
+            entries.push_back(entry);
+        }
+        closedir(dir);
+        return true;
+    }
+
+    string identity(const string& path) override {
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0) return "";
+        return to_string(status.st_dev) + ":" + to_string(status.st_ino);
+    }
+
+    char separator() const override { return '/'; }
+};
+
+class LinuxFiles : public FileBackend {
+public:
+    bool writeFiles(ostream& outFile) override {
+        const int nameWidth = 30;
+        const int pathWidth = 50;
+        const int sizeWidth = 15;
+
+        outFile << left
+            << setw(nameWidth) << "File Name" << " | "
+            << setw(pathWidth) << "Directory" << " | "
+            << setw(sizeWidth) << "Size (MB)" << endl;
+        outFile << string(nameWidth + pathWidth + sizeWidth + 6, '-') << endl;
+
+        return enumerateFiles([&](const FileInfo& file) {
+            double sizeMB = file.sizeBytes / (1024.0 * 1024.0);
+            outFile << left
+                << setw(nameWidth) << file.name << " | "
+                << setw(pathWidth) << (file.label + ": " + file.path) << " | "
+                << setw(sizeWidth) << fixed << setprecision(2) << sizeMB << endl;
+        });
+    }
+
+    bool enumerateFiles(const function<void(const FileInfo&)>& visit) override {
+        string homeDir = home();
+        FileInfo info;
+        for (const char* label : LABELS) {
+            string dirPath = homeDir + "/" + label;
+            DIR* dir = opendir(dirPath.c_str());
+            if (!dir) continue;
+            while (dirent* entry = readdir(dir)) {
+                info.path = dirPath + "/" + entry->d_name;
+                struct stat status;
+                if (stat(info.path.c_str(), &status) != 0 || !S_ISREG(status.st_mode)) continue;
+                info.name = entry->d_name;
+                info.label = label;
+                info.sizeBytes = static_cast<unsigned long long>(status.st_size);
+                info.modified = status.st_mtime;
+                info.attributes = status.st_mode;
+                visit(info);
+            }
+            closedir(dir);
+        }
+        return true;
+    }
+
+    WalkStats walkFiles(const WalkOptions& options, const function<void(const FileInfo&)>& visit) override {
+        vector<pair<string, string>> roots;
+        for (const auto& root : options.roots) roots.emplace_back(root, "");
+        if (roots.empty()) roots = usualFolders();
+        PosixDirectorySource source;
+        return DirectoryWalker(source, options).run(roots, visit);
+    }
+
+    vector<pair<string, string>> usualFolders() override {
+        string homeDir = home();
+        vector<pair<string, string>> folders;
+        for (const char* label : LABELS) folders.emplace_back(homeDir + "/" + label, label);
+        return folders;
+    }
+
+    char pathSeparator() const override { return '/'; }
+
+    // inotify watches one directory at a time, so every directory under the
+    // roots gets its own watch, and new ones get theirs as they appear. When
+    // the kernel's watch limit runs out, the rest go unwatched.
+    bool watchFiles(const vector<string>& roots, const function<void(const vector<string>& paths)>& changed,
+        const atomic<bool>& stop) override {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return false;
+        map<int, string> watched;
+        for (const auto& root : roots) addWatches(fd, root, watched);
+        if (watched.empty()) {
+            close(fd);
+            return false;
+        }
+
+        alignas(inotify_event) char events[64 * 1024];
+        pollfd waitFor = { fd, POLLIN, 0 };
+        vector<string> paths;
+        while (!stop) {
+            // Wakes twice a second to notice stop
+            if (poll(&waitFor, 1, 500) <= 0) continue;
+            paths.clear();
+            ssize_t length;
+            while ((length = read(fd, events, sizeof(events))) > 0) {
+                for (char* at = events; at < events + length;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(at);
+                    at += sizeof(inotify_event) + event->len;
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        paths.insert(paths.end(), roots.begin(), roots.end());
+                        continue;
+                    }
+                    auto directory = watched.find(event->wd);
+                    if (directory == watched.end()) continue;
+                    if (event->mask & IN_IGNORED) {
+                        watched.erase(directory);
+                        continue;
+                    }
+                    if (event->len == 0) continue;
+                    // A directory's own writes and attributes say nothing about its files
+                    const uint32_t appearedOrWent = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+                    if ((event->mask & IN_ISDIR) && !(event->mask & appearedOrWent)) continue;
+                    string path = directory->second + "/" + event->name;
+                    if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                        addWatches(fd, path, watched);
+                    }
+                    else if ((event->mask & IN_ISDIR) && (event->mask & IN_MOVED_FROM)) {
+                        removeWatches(fd, path, watched);
+                    }
+                    paths.push_back(path);
+                }
+            }
+            if (!paths.empty()) changed(paths);
+        }
+        close(fd);
+        return true;
+    }
+
+    bool isRegularFile(const string& path) override {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+    }
+
+    bool deleteFile(const string& path) override {
+        return unlink(path.c_str()) == 0;
+    }
+
+private:
+    static const char* const LABELS[3];
+
+    static void addWatches(int fd, const string& root, map<int, string>& watched) {
+        const uint32_t mask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+            IN_ONLYDIR | IN_DONT_FOLLOW;
+        vector<string> pending(1, root);
+        while (!pending.empty()) {
+            string directory = pending.back();
+            pending.pop_back();
+            int wd = inotify_add_watch(fd, directory.c_str(), mask);
+            if (wd < 0) {
+                if (errno == ENOSPC) return;
+                continue;
+            }
+            watched[wd] = directory;
+
+            DIR* dir = opendir(directory.c_str());
+            if (!dir) continue;
+            while (dirent* entry = readdir(dir)) {
+                const char* name = entry->d_name;
+                bool maybeDirectory = entry->d_type == DT_DIR || entry->d_type == DT_UNKNOWN;   // IN_ONLYDIR turns away the rest
+                if (!maybeDirectory || (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))) {
+                    continue;
+                }
+                pending.push_back(directory + "/" + name);
+            }
+            closedir(dir);
+        }
+    }
+
+    // A directory moved away is watched again under its new name, if that is under a root
+    static void removeWatches(int fd, const string& root, map<int, string>& watched) {
+        string prefix = root + "/";
+        for (auto it = watched.begin(); it != watched.end();) {
+            if (it->second == root || it->second.compare(0, prefix.size(), prefix) == 0) {
+                inotify_rm_watch(fd, it->first);
+                it = watched.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    static string home() {
+        char* home = nullptr;
+        size_t length = 0;
+        string homeDir = "/root";
+        if (_dupenv_s(&home, &length, "HOME") == 0 && home) {
+            if (*home) homeDir = home;
+            free(home);
+        }
+        return homeDir;
+    }
+};
+
+const char* const LinuxFiles::LABELS[3] = { "Documents", "Downloads", "Desktop" };
+
+class LinuxScreen : public ScreenBackend {
+public:
+    bool captureScreen(const string&) override {
+        cerr << "Screen capture is not available on this platform" << endl;
+        return false;
+    }
+
+    bool captureWebcam(const string&) override {
+        cerr << "Webcam capture is not available on this platform" << endl;
+        return false;
+    }
+
+    TrackingResult trackKeyboard(const string&, int, const function<void(int)>&) override {
+        cerr << "Keyboard tracking is not available on this platform" << endl;
+        return TrackingResult::NotStarted;
+    }
+};
+
+class LinuxPower : public PowerBackend {
+public:
+    bool execute(const string& action) override {
+        if (action == "Shutdown") return runCommand("systemctl poweroff") == 0;
+        if (action == "Restart") return runCommand("systemctl reboot") == 0;
+        if (action == "Hibernate") return runCommand("systemctl hibernate") == 0;
+        if (action == "Sleep") return runCommand("systemctl suspend") == 0;
+        if (action == "Lock") return runCommand("loginctl lock-sessions") == 0;
+        return false;
+    }
+};
+
+}
+
+unique_ptr<Platform> Platform::createNative() {
+    unique_ptr<Platform> platform(new Platform());
+    platform->name = "linux";
+    platform->reportDir = defaultReportDir();
+    platform->processes.reset(new LinuxProcesses());
+    platform->services.reset(new LinuxServices());
+    platform->files.reset(new LinuxFiles());
+    platform->screen.reset(new LinuxScreen());
+    platform->power.reset(new LinuxPower());
+    return platform;
+}
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// A whole file mapped read-only into memory. The view stays valid until
+// close() or destruction, even after the file is renamed or, on Linux,
+// deleted; on Windows the file cannot be replaced while it is open. A file
+// another process is still writing opens too, and the view covers the size
+// it had then.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False when the file cannot be opened or mapped; an empty file opens
+    // with size 0 and a null data()
+    bool open(const string& path);
+    void close();
+
+    const char* data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+    char* view;
+    size_t length;
+};
@@ -0,0 +1,675 @@
+#include "../Platform/Platform.h"
+#include "../Platform/DirectoryWalker.h"
+#include "../Platform/ServiceController.h"
+
+// An in-memory Windows-like machine. Inventories are generated from a fixed
+// seed so runs are comparable, and commands change the model instead of the
+// host: ending a process removes it, stopping a service marks it stopped, a
+// power action is only logged. Captures write synthetic JPEG-sized files so
+// the attachment path still does real work.
+
+namespace {
+
+struct MockProcess {
+    string name;
+    unsigned long processId;
+    unsigned long parentId;     // 0 for a root; may name a process that is gone
+    unsigned long long memoryUsage;
+    // Counters grow at these rates from the moment the process starts
+    chrono::steady_clock::time_point started;
+    double cpuShare;            // Of one CPU
+    unsigned threads;
+    unsigned handles;
+    double readBytesPerSecond;
+    double writeBytesPerSecond;
+};
+
+struct MockService {
+    string name;
+    string displayName;
+    string status;
+    string startType;
+    string description;
+    unsigned long processId;
+    vector<string> dependsOn;   // Services that must be running before this one starts
+    // A start or stop in progress: status becomes settlesTo at settlesAt
+    string settlesTo;
+    chrono::steady_clock::time_point settlesAt;
+};
+
+struct MockFile {
+    string name;
+    string label;
+    string path;
+    double sizeMB;
+    long long modified;   // Seconds since 1970
+};
+
+// Mock files carry the archive bit, as most files on Windows do
+const unsigned MOCK_FILE_ATTRIBUTES = 0x20;
+
+string lower(string text) {
+    transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return text;
+}
+
+string logHeader(const string& title) {
+    time_t now = time(nullptr);
+    char timeStr[26];
+    ctime_s(timeStr, sizeof(timeStr), &now);
+    return "\n=== " + title + " " + timeStr + "===\n";
+}
+
+class MockMachine {
+public:
+    static const int PROCESS_COUNT = 240;
+    static const int SERVICE_COUNT = 180;
+    static const int FILE_COUNT = 400;
+
+    mutex stateMutex;
+    vector<MockProcess> processes;
+    vector<MockService> services;
+    vector<MockFile> files;
+    unsigned long nextProcessId;
+    vector<string> fileChanges;          // Paths deleted since a watcher last looked
+    condition_variable filesChanged;
+
+    MockMachine() : nextProcessId(1000) {
+        mt19937 random(20240601);
+        const char* executables[] = {
+            "svchost.exe", "chrome.exe", "explorer.exe", "RuntimeBroker.exe", "Code.exe",
+            "msedge.exe", "notepad.exe", "Teams.exe", "OneDrive.exe", "conhost.exe",
+            "dllhost.exe", "SearchHost.exe", "spoolsv.exe", "lsass.exe", "winlogon.exe"
+        };
+        // Separate stream, so the inventory stays what it was before rates existed
+        mt19937 rates(20240602);
+        mt19937 parents(20240603);
+        mt19937 dependencies(20240604);
+        mt19937 ages(20240605);
+        auto now = chrono::steady_clock::now();
+        for (int i = 0; i < PROCESS_COUNT; i++) {
+            MockProcess process;
+            process.name = executables[random() % (sizeof(executables) / sizeof(executables[0]))];
+            process.processId = nextProcessId;
+            // A random earlier process as parent; a few point at one that has exited
+            process.parentId = i == 0 ? 0 : parents() % 16 == 0 ? 8 : processes[parents() % i].processId;
+            process.memoryUsage = 1024ULL * (2048 + random() % 400000);
+            // Mostly idle, a few busy ones, like a real desktop
+            process.started = now;
+            process.cpuShare = rates() % 10 == 0 ? (rates() % 150) / 1000.0 : (rates() % 5) / 1000.0;
+            process.threads = 1 + rates() % 60;
+            process.handles = 50 + rates() % 2000;
+            process.readBytesPerSecond = rates() % 4 == 0 ? rates() % 4000000 : rates() % 20000;
+            process.writeBytesPerSecond = rates() % 8 == 0 ? rates() % 2000000 : rates() % 5000;
+            processes.push_back(process);
+            nextProcessId += 4;
+        }
+
+        const char* critical[] = {
+            "wuauserv", "WinDefend", "Dhcp", "Dnscache", "LanmanServer",
+            "LanmanWorkstation", "nsi", "W32Time", "EventLog"
+        };
+        for (int i = 0; i < SERVICE_COUNT; i++) {
+            MockService service;
+            bool isCritical = i < static_cast<int>(sizeof(critical) / sizeof(critical[0]));
+            service.name = isCritical ? critical[i] : "MockSvc" + to_string(i);
+            service.displayName = isCritical ? service.name + " Service" : "Mock Service " + to_string(i);
+            service.status = isCritical || random() % 3 != 0 ? "Running" : "Stopped";
+            service.startType = isCritical ? "Auto" : rates() % 4 == 0 ? "Disabled" : rates() % 2 ? "Auto" : "Manual";
+            if (service.startType == "Disabled") service.status = "Stopped";
+            service.description = "Simulated service " + to_string(i) + " for load testing";
+            service.processId = service.status == "Running" ? 500 + 4 * i : 0;
+            // About a third depend on one or two earlier services, so the graph stays acyclic
+            if (!isCritical && i > 12 && dependencies() % 3 == 0) {
+                int links = 1 + dependencies() % 2;
+                for (int link = 0; link < links; link++) {
+                    const string& needed = services[dependencies() % i].name;
+                    if (find(service.dependsOn.begin(), service.dependsOn.end(), needed) == service.dependsOn.end()) {
+                        service.dependsOn.push_back(needed);
+                    }
+                }
+            }
+            services.push_back(service);
+        }
+
+        const char* labels[] = { "Documents", "Downloads", "Desktop", "AppData", "Program Files" };
+        const char* extensions[] = { ".docx", ".pdf", ".txt", ".zip", ".png", ".xlsx" };
+        for (int i = 0; i < FILE_COUNT; i++) {
+            MockFile file;
+            file.label = labels[i % 5];
+            file.name = "file" + to_string(i) + extensions[random() % 6];
+            file.path = "C:\\Users\\mock\\" + file.label + "\\" + file.name;
+            file.sizeMB = (random() % 500000) / 1000.0;
+            // Written some time in the year before the mock started, so age queries find some
+            file.modified = static_cast<long long>(time(nullptr)) - static_cast<long long>(ages() % (365 * 24 * 3600));
+            files.push_back(file);
+        }
+    }
+
+    // Applies starts and stops whose time has come; caller holds stateMutex
+    void settleServices() {
+        auto now = chrono::steady_clock::now();
+        for (auto& service : services) {
+            if (service.settlesTo.empty() || service.settlesAt > now) continue;
+            service.status = service.settlesTo;
+            service.processId = service.status == "Running" ? nextProcessId += 4 : 0;
+            service.settlesTo.clear();
+        }
+    }
+};
+
+// Services take 20 to 300 ms to start or stop, fixed per name. About one
+// MockSvc in 29 hangs in its pending state, so timeouts can be exercised, and
+// a stop is refused while a dependent service is up, as the SCM does.
+class MockServiceDriver : public ServiceControlDriver {
+public:
+    explicit MockServiceDriver(shared_ptr<MockMachine> machine) : machine(machine) {}
+
+    unsigned long request(const string& name, bool start) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        machine->settleServices();
+        MockService* service = find(name);
+        // Error codes are the ones the Service Control Manager would return
+        if (!service) return 1060;
+        if (start && service->startType == "Disabled") return 1058;
+        if (service->status.find("Pending") != string::npos) return 1061;
+        // Already there: as on Windows, the watch sees the target state at once
+        if ((service->status == "Running") == start) return 0;
+        if (!start && hasActiveDependent(*service)) return 1051;
+
+        unsigned hash = 0;
+        for (unsigned char c : service->name) hash = hash * 31 + c;
+        bool hangs = service->name.compare(0, 7, "MockSvc") == 0 && hash % 29 == 0;
+        service->status = start ? "Start Pending" : "Stop Pending";
+        service->settlesTo = hangs ? "" : start ? "Running" : "Stopped";
+        service->settlesAt = chrono::steady_clock::now() + chrono::milliseconds(20 + hash % 281);
+        return 0;
+    }
+
+    string state(const string& name) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        machine->settleServices();
+        MockService* service = find(name);
+        return service ? service->status : "";
+    }
+
+    void waitForChange(chrono::steady_clock::time_point deadline) override {
+        // The model knows when its next change is due, which stands in for the notification
+        auto wakeAt = deadline;
+        {
+            lock_guard<mutex> lock(machine->stateMutex);
+            for (const auto& service : machine->services) {
+                if (!service.settlesTo.empty()) wakeAt = min(wakeAt, service.settlesAt);
+            }
+        }
+        this_thread::sleep_until(wakeAt);
+    }
+
+    vector<string> dependencies(const string& name) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        MockService* service = find(name);
+        return service ? service->dependsOn : vector<string>();
+    }
+
+private:
+    shared_ptr<MockMachine> machine;
+
+    MockService* find(const string& name) {
+        for (auto& service : machine->services) {
+            if (lower(service.name) == lower(name)) return &service;
+        }
+        return nullptr;
+    }
+
+    // The SCM refuses to stop a service while one that depends on it is still up
+    bool hasActiveDependent(const MockService& service) {
+        for (const auto& other : machine->services) {
+            if (other.status == "Stopped") continue;
+            for (const auto& needed : other.dependsOn) {
+                if (lower(needed) == lower(service.name)) return true;
+            }
+        }
+        return false;
+    }
+};
+
+class MockProcesses : public ProcessBackend {
+public:
+    explicit MockProcesses(shared_ptr<MockMachine> machine) : machine(machine) {}
+
+    bool listProcesses(vector<ProcessInfo>& processes) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        processes.clear();
+        for (const auto& process : machine->processes) {
+            ProcessInfo info;
+            info.name = process.name;
+            info.processId = process.processId;
+            info.memoryUsage = static_cast<SIZE_T>(process.memoryUsage);
+            processes.push_back(info);
+        }
+        sort(processes.begin(), processes.end(),
+            [](const ProcessInfo& a, const ProcessInfo& b) { return a.memoryUsage > b.memoryUsage; });
+        return true;
+    }
+
+    bool writeProcesses(ostream& out) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        for (const auto& process : machine->processes) {
+            out << "Process Name: " << process.name << endl;
+            out << "Process ID: " << process.processId << endl;
+            out << "Memory Usage: " << process.memoryUsage << " bytes" << endl;
+            out << endl;
+        }
+        return true;
+    }
+
+    bool sampleProcesses(vector<ProcessCounters>& counters) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        auto now = chrono::steady_clock::now();
+        counters.resize(machine->processes.size());
+        for (size_t i = 0; i < machine->processes.size(); i++) {
+            const MockProcess& process = machine->processes[i];
+            ProcessCounters& sample = counters[i];
+            double seconds = chrono::duration<double>(now - process.started).count();
+            sample.name.assign(process.name);
+            sample.processId = process.processId;
+            sample.parentProcessId = process.parentId;
+            sample.startTime = static_cast<unsigned long long>(process.started.time_since_epoch().count());
+            sample.cpuMicroseconds = static_cast<unsigned long long>(seconds * process.cpuShare * 1e6);
+            sample.threads = process.threads;
+            sample.handles = process.handles;
+            sample.privateBytes = process.memoryUsage * 3 / 4;
+            sample.workingSet = process.memoryUsage;
+            sample.readBytes = static_cast<unsigned long long>(seconds * process.readBytesPerSecond);
+            sample.writeBytes = static_cast<unsigned long long>(seconds * process.writeBytesPerSecond);
+        }
+        return true;
+    }
+
+    void startProcesses(const vector<string>& names, const string& logFileName) override {
+        ofstream logFile(logFileName, ios::app);
+        logFile << logHeader("App Launch Log");
+        vector<LaunchResult> results;
+        {
+            lock_guard<mutex> lock(machine->stateMutex);
+            for (const auto& appName : names) {
+                MockProcess process;
+                process.name = appName.find('.') == string::npos ? appName + ".exe" : appName;
+                process.processId = machine->nextProcessId;
+                process.parentId = 0;
+                process.memoryUsage = 8ULL * 1024 * 1024;
+                process.started = chrono::steady_clock::now();
+                process.cpuShare = 0.05;
+                process.threads = 8;
+                process.handles = 200;
+                process.readBytesPerSecond = 100000;
+                process.writeBytesPerSecond = 10000;
+                machine->processes.push_back(process);
+                machine->nextProcessId += 4;
+
+                // Model apps are ready as soon as they exist
+                LaunchResult result;
+                result.name = appName;
+                result.started = true;
+                result.processId = process.processId;
+                result.readiness = "idle";
+                results.push_back(result);
+            }
+        }
+        writeLaunchResults(logFile, results, 0);
+        logFile << "=== End of Log ===\n\n";
+    }
+
+    void endProcesses(const vector<string>& names, const string& logFileName) override {
+        unordered_set<string> wanted;
+        for (const auto& appName : names) wanted.insert(lower(appName));
+        vector<ProcessTarget> targets;
+        {
+            lock_guard<mutex> lock(machine->stateMutex);
+            for (const auto& process : machine->processes) {
+                if (wanted.find(lower(process.name)) == wanted.end()) continue;
+                ProcessTarget target;
+                target.name = process.name;
+                target.processId = process.processId;
+                targets.push_back(target);
+            }
+        }
+        terminateProcesses(targets, logFileName);
+    }
+
+    void terminateProcesses(const vector<ProcessTarget>& targets, const string& logFileName) override {
+        ofstream logFile(logFileName, ios::app);
+        logFile << logHeader("Task Termination Log");
+
+        // Model processes exit the moment they are told to
+        lock_guard<mutex> lock(machine->stateMutex);
+        auto& processes = machine->processes;
+        unordered_set<unsigned long> ending;
+        for (const auto& target : targets) {
+            auto it = find_if(processes.begin(), processes.end(),
+                [&](const MockProcess& process) { return process.processId == target.processId; });
+            if (it == processes.end()) {
+                logFile << "Skipped " << target.name << " (PID: " << target.processId << ") - no longer running\n";
+                continue;
+            }
+            unsigned long long startTime = static_cast<unsigned long long>(it->started.time_since_epoch().count());
+            if (target.startTime != 0 && startTime != target.startTime) {
+                logFile << "Skipped " << target.name << " (PID: " << target.processId
+                    << ") - the PID now belongs to another process\n";
+                continue;
+            }
+            logFile << "Successfully terminated " << it->name
+                << " (PID: " << it->processId << ") - exited in 0 ms\n";
+            ending.insert(it->processId);
+        }
+        processes.erase(remove_if(processes.begin(), processes.end(),
+            [&](const MockProcess& process) { return ending.count(process.processId) > 0; }), processes.end());
+        logFile << "Confirmed " << ending.size() << " of " << ending.size() << " terminations in 0 ms\n";
+        logFile << "=== End of Log ===\n\n";
+    }
+
+private:
+    shared_ptr<MockMachine> machine;
+};
+
+class MockServices : public ServiceBackend {
+public:
+    explicit MockServices(shared_ptr<MockMachine> machine) : machine(machine) {}
+
+    bool writeServices(ostream& file) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        machine->settleServices();
+        file << "=== Windows Services List ===\n\n";
+        int index = 0;
+        for (const auto& service : machine->services) {
+            file << "Service #" << ++index << "\n";
+            file << "==================\n";
+            file << "System Name: " << service.name << "\n";
+            file << "Display Name: " << service.displayName << "\n";
+            file << "Status: " << service.status << "\n";
+            file << "Description: " << service.description << "\n";
+            file << "Process ID: " << service.processId << "\n";
+            file << "------------------\n\n";
+        }
+        return true;
+    }
+
+    bool enumerateServices(const function<void(const ServiceInfo&)>& visit) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        machine->settleServices();
+        ServiceInfo info;
+        for (const auto& service : machine->services) {
+            info.name = service.name;
+            info.displayName = service.displayName;
+            info.status = service.status;
+            info.startType = service.startType;
+            info.description = service.description;
+            info.processId = service.processId;
+            visit(info);
+        }
+        return true;
+    }
+
+    bool startServices(const vector<string>& names, const string& logFileName) override {
+        return control(names, logFileName, true);
+    }
+
+    bool stopServices(const vector<string>& names, const string& logFileName) override {
+        return control(names, logFileName, false);
+    }
+
+private:
+    shared_ptr<MockMachine> machine;
+
+    bool control(const vector<string>& names, const string& logFileName, bool start) {
+        static const set<string> critical = {
+            "wuauserv", "WinDefend", "Dhcp", "Dnscache", "LanmanServer",
+            "LanmanWorkstation", "nsi", "W32Time", "EventLog"
+        };
+        ofstream logFile(logFileName, ios::app);
+        logFile << logHeader(start ? "Service Start Operation Log" : "Service Stop Operation Log");
+
+        vector<ServiceOperation> operations(names.size());
+        for (size_t i = 0; i < names.size(); i++) {
+            operations[i].name = names[i];
+            operations[i].start = start;
+            if (critical.count(names[i])) operations[i].refused = "Cannot modify critical service";
+        }
+
+        auto started = chrono::steady_clock::now();
+        MockServiceDriver driver(machine);
+        ServiceSchedule schedule = ServiceController(driver).run(operations, chrono::milliseconds(STATE_WAIT_MS));
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+
+        writeServiceResults(logFile, operations, schedule, STATE_WAIT_MS, elapsed);
+        logFile << "=== End of Log ===\n\n";
+        return all_of(operations.begin(), operations.end(),
+            [](const ServiceOperation& operation) { return operation.reached; });
+    }
+};
+
+// The model's files as a tree of directories, built from their paths when a
+// walk starts, so the walk reads a fixed copy while commands change the model
+class MockDirectorySource : public DirectorySource {
+public:
+    explicit MockDirectorySource(const vector<MockFile>& files) {
+        set<string> added;
+        for (const auto& file : files) {
+            string directory = file.path.substr(0, file.path.rfind('\\'));
+            DirectoryEntry entry;
+            entry.name = file.name;
+            entry.sizeBytes = static_cast<unsigned long long>(file.sizeMB * 1024 * 1024);
+            entry.modified = file.modified;
+            entry.attributes = MOCK_FILE_ATTRIBUTES;
+            directories[directory].push_back(entry);
+
+            // Each directory is added to its parent the first time it is seen
+            while (added.insert(directory).second) {
+                size_t cut = directory.rfind('\\');
+                if (cut == string::npos) break;
+                DirectoryEntry child;
+                child.name = directory.substr(cut + 1);
+                child.directory = true;
+                directory = directory.substr(0, cut);
+                directories[directory].push_back(child);
+            }
+        }
+    }
+
+    bool read(const string& path, vector<DirectoryEntry>& entries) override {
+        auto found = directories.find(path);
+        if (found == directories.end()) return false;
+        entries = found->second;
+        return true;
+    }
+
+    string identity(const string& path) override { return path; }
+    char separator() const override { return '\\'; }
+
+private:
+    map<string, vector<DirectoryEntry>> directories;
+};
+
+class MockFiles : public FileBackend {
+public:
+    explicit MockFiles(shared_ptr<MockMachine> machine) : machine(machine) {}
+
+    bool writeFiles(ostream& outFile) override {
+        const int nameWidth = 30;
+        const int pathWidth = 50;
+        const int sizeWidth = 15;
+
+        outFile << left
+            << setw(nameWidth) << "File Name" << " | "
+            << setw(pathWidth) << "Directory" << " | "
+            << setw(sizeWidth) << "Size (MB)" << endl;
+        outFile << string(nameWidth + pathWidth + sizeWidth + 6, '-') << endl;
+
+        lock_guard<mutex> lock(machine->stateMutex);
+        for (const auto& file : machine->files) {
+            outFile << left
+                << setw(nameWidth) << file.name << " | "
+                << setw(pathWidth) << (file.label + ": " + file.path) << " | "
+                << setw(sizeWidth) << fixed << setprecision(2) << file.sizeMB << endl;
+        }
+        return true;
+    }
+
+    bool enumerateFiles(const function<void(const FileInfo&)>& visit) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        FileInfo info;
+        for (const auto& file : machine->files) {
+            info.name = file.name;
+            info.label = file.label;
+            info.path = file.path;
+            info.sizeBytes = static_cast<unsigned long long>(file.sizeMB * 1024 * 1024);
+            info.modified = file.modified;
+            info.attributes = MOCK_FILE_ATTRIBUTES;
+            visit(info);
+        }
+        return true;
+    }
+
+    WalkStats walkFiles(const WalkOptions& options, const function<void(const FileInfo&)>& visit) override {
+        vector<pair<string, string>> roots;
+        for (const auto& root : options.roots) roots.emplace_back(root, "");
+        if (roots.empty()) roots = usualFolders();
+        unique_ptr<MockDirectorySource> source;
+        {
+            lock_guard<mutex> lock(machine->stateMutex);
+            source.reset(new MockDirectorySource(machine->files));
+        }
+        return DirectoryWalker(*source, options).run(roots, visit);
+    }
+
+    vector<pair<string, string>> usualFolders() override {
+        vector<pair<string, string>> folders;
+        for (const char* label : { "Documents", "Downloads", "Desktop", "AppData", "Program Files" }) {
+            folders.emplace_back(string("C:\\Users\\mock\\") + label, label);
+        }
+        return folders;
+    }
+
+    char pathSeparator() const override { return '\\'; }
+
+    // Only deleteFile changes the model, and it tells the watcher. As with
+    // the real watchers, changes outside roots are not reported.
+    bool watchFiles(const vector<string>& roots, const function<void(const vector<string>& paths)>& changed,
+        const atomic<bool>& stop) override {
+        auto outsideRoots = [&](const string& path) {
+            for (const auto& root : roots) {
+                if (path.size() > root.size() && path.compare(0, root.size(), root) == 0 &&
+                    path[root.size()] == '\\') return false;
+            }
+            return true;
+        };
+        vector<string> paths;
+        while (!stop) {
+            {
+                unique_lock<mutex> lock(machine->stateMutex);
+                machine->filesChanged.wait_for(lock, chrono::milliseconds(500),
+                    [this] { return !machine->fileChanges.empty(); });
+                paths.swap(machine->fileChanges);
+            }
+            paths.erase(remove_if(paths.begin(), paths.end(), outsideRoots), paths.end());
+            if (!paths.empty()) changed(paths);
+            paths.clear();
+        }
+        return true;
+    }
+
+    // Only the model's files exist; sendFile still reads attachments from
+    // disk, so sending one of them reports a failed send
+    bool isRegularFile(const string& path) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        return find(path) != machine->files.end();
+    }
+
+    bool deleteFile(const string& path) override {
+        lock_guard<mutex> lock(machine->stateMutex);
+        auto file = find(path);
+        if (file == machine->files.end()) return false;
+        machine->files.erase(file);
+        machine->fileChanges.push_back(path);
+        machine->filesChanged.notify_all();
+        return true;
+    }
+
+private:
+    shared_ptr<MockMachine> machine;
+
+    vector<MockFile>::iterator find(const string& path) {
+        return find_if(machine->files.begin(), machine->files.end(),
+            [&](const MockFile& file) { return file.path == path; });
+    }
+};
+
+class MockScreen : public ScreenBackend {
+public:
+    static const size_t SCREENSHOT_BYTES = 350 * 1024;
+    static const size_t WEBCAM_BYTES = 120 * 1024;
+
+    bool captureScreen(const string& path) override {
+        return writeImage(path, SCREENSHOT_BYTES);
+    }
+
+    bool captureWebcam(const string& path) override {
+        return writeImage(path, WEBCAM_BYTES);
+    }
+
+    TrackingResult trackKeyboard(const string& path, int seconds,
+        const function<void(int)>& progress) override {
+        ofstream log(path);
+        if (!log.is_open()) return TrackingResult::NotStarted;
+
+        auto startTime = chrono::steady_clock::now();
+        while (true) {
+            auto elapsedSeconds = chrono::duration_cast<chrono::seconds>(
+                chrono::steady_clock::now() - startTime).count();
+            progress(static_cast<int>(elapsedSeconds));
+            if (elapsedSeconds >= seconds) break;
+            log << "[" << elapsedSeconds << "s] mock keystrokes\n";
+            this_thread::sleep_for(chrono::milliseconds(200));
+        }
+        return TrackingResult::Completed;
+    }
+
+private:
+    // JPEG markers around noise, which compresses about as badly as a photo
+    static bool writeImage(const string& path, size_t bytes) {
+        ofstream image(path, ios::binary);
+        if (!image.is_open()) return false;
+        string data(bytes, '\0');
+        mt19937 random(static_cast<unsigned>(bytes));
+        for (auto& byte : data) byte = static_cast<char>(random() & 0xff);
+        data[0] = '\xFF'; data[1] = '\xD8';
+        data[bytes - 2] = '\xFF'; data[bytes - 1] = '\xD9';
+        image.write(data.data(), data.size());
+        return static_cast<bool>(image);
+    }
+};
+
+class MockPower : public PowerBackend {
+public:
+    bool execute(const string& action) override {
+        static const set<string> actions = { "Shutdown", "Restart", "Hibernate", "Sleep", "Lock" };
+        if (!actions.count(action)) return false;
+        cout << "Mock power action: " << action << endl;
+        return true;
+    }
+};
+
+}
+
+unique_ptr<Platform> Platform::createMock() {
+    shared_ptr<MockMachine> machine = make_shared<MockMachine>();
+    unique_ptr<Platform> platform(new Platform());
+    platform->name = "mock";
+    platform->reportDir = defaultReportDir();
+    platform->processes.reset(new MockProcesses(machine));
+    platform->services.reset(new MockServices(machine));
+    platform->files.reset(new MockFiles(machine));
+    platform->screen.reset(new MockScreen());
+    platform->power.reset(new MockPower());
+    return platform;
+}
@@ -0,0 +1,119 @@
+#include "../Platform/Platform.h"
+
+// Out-of-class definitions, for the constants that min() and the like take by reference
+const int ProcessBackend::TERMINATE_WAIT_MS;
+const int ProcessBackend::LAUNCH_READY_MS;
+const int ServiceBackend::STATE_WAIT_MS;
+
+Platform& Platform::native() {
+    static unique_ptr<Platform> platform = createNative();
+    return *platform;
+}
+
+unique_ptr<Platform> Platform::create(const string& backend) {
+    if (backend == "native") return createNative();
+    if (backend == "mock") return createMock();
+    throw invalid_argument("Unknown platform backend: " + backend);
+}
+
+string Platform::defaultReportDir() {
+#ifdef _WIN32
+    return "D:\\";
+#else
+    return "/tmp/";
+#endif
+}
+
+void LaunchResult::write(ostream& log) const {
+    if (!started) {
+        if (error == 0) log << "Failed to find shortcut for: " << name;
+        else log << "Failed to launch: " << name << " (Error code: " << error << ")";
+        for (size_t i = 0; i < suggestions.size(); i++) {
+            log << (i == 0 ? " (did you mean: " : ", ") << suggestions[i];
+        }
+        log << (suggestions.empty() ? "" : "?)") << "\n";
+        return;
+    }
+
+    log << (ready() ? "Successfully launched: " : "Launched: ") << name;
+    if (!note.empty()) log << " (" << note << ")";
+    if (processId != 0) log << " (PID: " << processId << ")";
+    if (readiness == "exited") log << " - exited with code " << exitCode << " after " << readyMs << " ms";
+    else if (readiness == "timed out") log << " - not ready after " << readyMs << " ms";
+    else if (readiness == "unknown") log << " - handed to a running instance, not watched";
+    else log << " - ready in " << readyMs << " ms (" << readiness << ")";
+    log << "\n";
+}
+
+void writeLaunchResults(ostream& log, const vector<LaunchResult>& results, long long elapsedMs) {
+    size_t started = 0, ready = 0;
+    for (const auto& result : results) {
+        result.write(log);
+        if (result.started) started++;
+        if (result.started && result.ready()) ready++;
+    }
+    log << "Started " << started << " of " << results.size() << " apps, "
+        << ready << " ready, in " << elapsedMs << " ms\n";
+}
+
+namespace {
+
+string joined(const vector<string>& names, const string& separator) {
+    string text;
+    for (const auto& name : names) text += (text.empty() ? "" : separator) + name;
+    return text;
+}
+
+}
+
+void ServiceOperation::write(ostream& log, long long timeoutMs) const {
+    string verb = start ? "start" : "stop";
+    if (!refused.empty()) {
+        log << refused << ": " << name << "\n";
+    }
+    else if (!blockedBy.empty()) {
+        log << "Did not " << verb << " service: " << name << " - it waits for " << blockedBy
+            << ", which did not reach " << target() << "\n";
+    }
+    else if (error != 0) {
+        log << "Failed to " << verb << " service: " << name << " - Error code: " << error << "\n";
+    }
+    else if (reached) {
+        log << "Successfully " << (start ? "started" : "stopped") << " service: " << name
+            << " - " << target() << " in " << elapsedMs << " ms";
+        if (!waitedFor.empty()) log << " (after " << joined(waitedFor, ", ") << ")";
+        log << "\n";
+    }
+    else if (timedOut) {
+        log << "Service " << name << " did not reach " << target() << " within " << timeoutMs
+            << " ms (last state: " << (state.empty() ? "unknown" : state) << ")\n";
+    }
+    else {
+        log << "Failed to " << verb << " service: " << name << " - it was " << state
+            << " after " << elapsedMs << " ms\n";
+    }
+}
+
+void ServiceSchedule::write(ostream& log) const {
+    if (!cycle.empty()) {
+        log << "Dependency cycle, sent without waiting on each other: " << joined(cycle, ", ") << "\n";
+    }
+    if (depth <= 1) {
+        log << "Dependency order: no service in the batch waits for another\n";
+        return;
+    }
+    log << "Dependency order: " << depth << " levels; critical path " << joined(criticalPath, " -> ")
+        << " (" << criticalPath.size() << " services, " << criticalPathMs << " ms)\n";
+}
+
+void writeServiceResults(ostream& log, const vector<ServiceOperation>& operations,
+    const ServiceSchedule& schedule, long long timeoutMs, long long elapsedMs) {
+    size_t reached = 0;
+    for (const auto& operation : operations) {
+        operation.write(log, timeoutMs);
+        if (operation.reached) reached++;
+    }
+    schedule.write(log);
+    log << "Reached the target state: " << reached << " of " << operations.size()
+        << " services in " << elapsedMs << " ms\n";
+}
@@ -0,0 +1,263 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// What the command handlers need from the machine they control. ServerManager
+// only talks to these interfaces; Functions/ holds the Windows implementation.
+
+struct ProcessInfo {
+    string name;
+    DWORD processId;
+    SIZE_T memoryUsage;   // Working set, in bytes
+};
+
+// Cumulative counters for one process at one instant; ProcessSampler turns
+// two of them into rates
+struct ProcessCounters {
+    string name;
+    DWORD processId = 0;
+    DWORD parentProcessId = 0;               // As recorded at creation; that PID may since have been reused
+    unsigned long long startTime = 0;        // Backend's own clock; with processId, tells a reused PID apart
+    unsigned long long cpuMicroseconds = 0;  // User plus kernel time
+    unsigned threads = 0;
+    unsigned handles = 0;                    // Open handles; file descriptors on Linux
+    unsigned long long privateBytes = 0;
+    unsigned long long workingSet = 0;
+    unsigned long long readBytes = 0;
+    unsigned long long writeBytes = 0;
+};
+
+// One process to terminate. A nonzero startTime, from ProcessCounters, leaves
+// the PID alone if it now belongs to a process started at another time.
+struct ProcessTarget {
+    string name;
+    DWORD processId = 0;
+    unsigned long long startTime = 0;
+};
+
+// What became of one app startProcesses was asked to launch
+struct LaunchResult {
+    string name;                  // As requested
+    string note;                  // How it resolved when not exactly: "Google Chrome, prefix match"
+    vector<string> suggestions;   // Close names, when it did not resolve
+    bool started = false;
+    DWORD error = 0;              // Why it did not start; 0 when nothing matched the name
+    DWORD processId = 0;          // 0 when the launch went to an instance already running
+    // "input idle" or "window" (Windows GUI), "console", "idle" (Linux),
+    // "exited", "timed out", or "unknown" without a process to watch
+    string readiness;
+    long long readyMs = 0;        // From the launch to readiness or exit
+    int exitCode = 0;             // When readiness is "exited"
+
+    bool ready() const { return readiness != "exited" && readiness != "timed out" && readiness != "unknown"; }
+    void write(ostream& log) const;   // One log line
+};
+
+// The launch log's lines and its "Started K of N" summary
+void writeLaunchResults(ostream& log, const vector<LaunchResult>& results, long long elapsedMs);
+
+class ProcessBackend {
+public:
+    virtual ~ProcessBackend() {}
+    // Largest working set first
+    virtual bool listProcesses(vector<ProcessInfo>& processes) = 0;
+    // "Process Name / Process ID / Memory Usage" blocks, as listProcess mails them
+    virtual bool writeProcesses(ostream& out) = 0;
+    // Overwrites counters with every readable process, keeping the vector's
+    // capacity and the name strings' buffers for the next call
+    virtual bool sampleProcesses(vector<ProcessCounters>& counters) = 0;
+    static const int TERMINATE_WAIT_MS = 5000;   // How long endProcesses waits for all exits together
+    static const int LAUNCH_READY_MS = 10000;    // How long startProcesses waits for each app to come up
+
+    // Launches every name at once and waits for each app to be ready, exit or
+    // time out, then appends one line per name to the log file
+    virtual void startProcesses(const vector<string>& names, const string& logFileName) = 0;
+    // Signals every process whose name matches, case-insensitively, then waits
+    // for them together and logs each PID as exited, with its time to exit, or
+    // still running
+    virtual void endProcesses(const vector<string>& names, const string& logFileName) = 0;
+    // The same signal, wait and log, for processes already picked, in order
+    virtual void terminateProcesses(const vector<ProcessTarget>& targets, const string& logFileName) = 0;
+};
+
+struct ServiceInfo {
+    string name;
+    string displayName;
+    string status;        // "Running", "Stopped", ...
+    string startType;     // "Auto", "Manual", "Disabled", "Boot" or "System"
+    string description;
+    DWORD processId = 0;
+};
+
+// One start or stop of one service, and how it ended
+struct ServiceOperation {
+    string name;
+    bool start = true;
+    string refused;            // Why no request was sent, e.g. "Cannot modify critical service"
+    unsigned long error = 0;   // The request itself failed with this code
+    string state;              // Last state seen: "Running", "Stopped", "Start Pending", ...
+    bool reached = false;      // The target state was seen
+    bool timedOut = false;     // Still on its way when its time ran out
+    long long elapsedMs = 0;   // From the request to the target state, or to giving up
+    vector<string> waitedFor;  // Services in the batch this one was sent after
+    string blockedBy;          // The service it waited for that failed; no request was sent
+
+    string target() const { return start ? "Running" : "Stopped"; }
+    void write(ostream& log, long long timeoutMs) const;   // One log line
+};
+
+// The dependency order a batch of service operations ran in
+struct ServiceSchedule {
+    size_t depth = 0;              // Most services on one chain of waits
+    vector<string> criticalPath;   // The chain that took longest, first to last
+    long long criticalPathMs = 0;  // Its services' times to state, added up
+    vector<string> cycle;          // Services whose waits on each other were dropped
+
+    void write(ostream& log) const;
+};
+
+// The operation log's lines, the schedule and the "Reached the target state" summary
+void writeServiceResults(ostream& log, const vector<ServiceOperation>& operations,
+    const ServiceSchedule& schedule, long long timeoutMs, long long elapsedMs);
+
+struct FileInfo {
+    string name;
+    string label;         // "Documents", "Downloads", ..., or the root a walk found it under
+    string path;
+    unsigned long long sizeBytes = 0;
+    long long modified = 0;   // Last write, in seconds since 1970
+    unsigned attributes = 0;  // FILE_ATTRIBUTE_* on Windows, st_mode on Linux
+};
+
+// How a walk treats symbolic links, and on Windows junctions and mount points
+enum class LinkPolicy {
+    Skip,     // Neither listed nor entered
+    List,     // Listed like files, never entered
+    Follow    // Entered; a directory reached twice is walked once
+};
+
+// What listFile walks when the body names root=, depth=, include=, exclude=,
+// links= or threads=
+struct WalkOptions {
+    vector<string> roots;      // Empty walks the backend's usual folders
+    int maxDepth = -1;         // 0 lists each root's own entries; -1 has no limit
+    vector<string> include;    // File globs; empty takes every file
+    vector<string> exclude;    // File and directory globs; an excluded directory is not entered
+    LinkPolicy links = LinkPolicy::Skip;
+    size_t threads = 0;        // 0 picks twice the CPUs, from 4 to 32
+
+    // True when the options name any of the walk keys
+    static bool requested(const map<string, string>& options);
+    // Lists are comma-separated; throws invalid_argument with a message fit to mail back
+    static WalkOptions parse(const map<string, string>& options);
+};
+
+// What a walk covered
+struct WalkStats {
+    size_t directories = 0;
+    size_t files = 0;          // Handed to visit, after include and exclude
+    size_t unreadable = 0;     // Directories that could not be opened
+    size_t linksSkipped = 0;
+    size_t threads = 0;
+    long long elapsedMs = 0;
+
+    // "walked 1204 directories and 88113 files in 912 ms on 16 threads"
+    string describe() const;
+};
+
+// Every call may throw runtime_error when the service manager cannot be
+// reached; the message is meant for the sender
+class ServiceBackend {
+public:
+    virtual ~ServiceBackend() {}
+    virtual bool writeServices(ostream& out) = 0;
+    // Calls visit once per service as it is read; nothing is kept
+    virtual bool enumerateServices(const function<void(const ServiceInfo&)>& visit) = 0;
+    static const int STATE_WAIT_MS = 30000;   // How long each service gets to reach its target state
+
+    // Each request goes out as soon as the services it depends on (for a
+    // stop, its dependents) are there; each service is then waited on until
+    // it reaches Running or Stopped, or its time runs out. False if any
+    // service failed; critical services are refused.
+    virtual bool startServices(const vector<string>& names, const string& logFileName) = 0;
+    virtual bool stopServices(const vector<string>& names, const string& logFileName) = 0;
+};
+
+class FileBackend {
+public:
+    virtual ~FileBackend() {}
+    virtual bool writeFiles(ostream& out) = 0;
+    virtual bool enumerateFiles(const function<void(const FileInfo&)>& visit) = 0;
+    // Walks the trees in parallel. visit runs on the calling thread while
+    // the walk goes on, so rows stream out and memory stays bounded.
+    virtual WalkStats walkFiles(const WalkOptions& options, const function<void(const FileInfo&)>& visit) = 0;
+    // Path and label of the folders listFile reads when given no root
+    virtual vector<pair<string, string>> usualFolders() = 0;
+    virtual char pathSeparator() const = 0;
+    // Calls changed, from this thread, with batches of paths under roots
+    // that were created, deleted, renamed or written. A directory is only
+    // reported when it appears or goes, and a root stands for changes lost
+    // under it. Returns once stop is set, or at once with false when no root
+    // can be watched.
+    virtual bool watchFiles(const vector<string>& roots,
+        const function<void(const vector<string>& paths)>& changed, const atomic<bool>& stop) = 0;
+    virtual bool isRegularFile(const string& path) = 0;
+    virtual bool deleteFile(const string& path) = 0;
+};
+
+enum class TrackingResult {
+    Completed,
+    NotStarted,
+    Interrupted
+};
+
+// Everything that needs the interactive desktop: screen, webcam and keyboard
+class ScreenBackend {
+public:
+    virtual ~ScreenBackend() {}
+    virtual bool captureScreen(const string& path) = 0;
+    virtual bool captureWebcam(const string& path) = 0;
+    // Logs keystrokes to path for the given time, calling progress with the
+    // elapsed seconds a few times a second
+    virtual TrackingResult trackKeyboard(const string& path, int seconds,
+        const function<void(int elapsedSeconds)>& progress) = 0;
+};
+
+class PowerBackend {
+public:
+    virtual ~PowerBackend() {}
+    // "Shutdown", "Restart", "Hibernate", "Sleep" or "Lock"
+    virtual bool execute(const string& action) = 0;
+};
+
+class FileIndex;
+
+// One machine's set of backends. native() is the host the server runs on;
+// createMock() keeps a made-up machine in memory, so the command pipeline can
+// be driven and benchmarked anywhere without touching the host.
+struct Platform {
+    string name;        // "windows", "linux" or "mock"
+    string reportDir;   // Handlers write report files here before mailing them
+    unique_ptr<ProcessBackend> processes;
+    unique_ptr<ServiceBackend> services;
+    unique_ptr<FileBackend> files;
+    unique_ptr<ScreenBackend> screen;
+    unique_ptr<PowerBackend> power;
+
+    // The index of files' usual folders, loaded and kept current from the
+    // first call until the platform goes; see FileIndex
+    FileIndex& fileIndex();
+
+    string reportPath(const string& fileName) const { return reportDir + fileName; }
+
+    // Created on first use and kept for the life of the process
+    static Platform& native();
+    static unique_ptr<Platform> createNative();
+    static unique_ptr<Platform> createMock();
+    // "native" or "mock"
+    static unique_ptr<Platform> create(const string& backend);
+    static string defaultReportDir();
+
+private:
+    mutex fileIndexMutex;
+    shared_ptr<FileIndex> fileIndexInstance;   // Declared last, so it stops before the backends go
+};
@@ -0,0 +1,176 @@
+#ifndef _WIN32
+#include "../Platform/ProcFs.h"
+#include <dirent.h>
+#include <fcntl.h>
+
+namespace {
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && *p == ' ') p++;
+    return p;
+}
+
+// Unsigned decimal field; null when there is none
+const char* parseNumber(const char* p, const char* end, unsigned long long& value) {
+    p = skipSpaces(p, end);
+    if (p < end && *p == '-') p++;   // Negative fields (nice, priority) are never kept
+    if (p >= end || *p < '0' || *p > '9') return nullptr;
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + static_cast<unsigned>(*p - '0');
+        p++;
+    }
+    return p;
+}
+
+const char* skipField(const char* p, const char* end) {
+    p = skipSpaces(p, end);
+    while (p < end && *p != ' ') p++;
+    return p;
+}
+
+}
+
+ProcFsReader::ProcFsReader(const string& root)
+    : root(root), pageBytes(sysconf(_SC_PAGESIZE)), readStatm(false), readIo(false), countHandles(false) {
+    if (pageBytes <= 0) pageBytes = 4096;
+}
+
+ssize_t ProcFsReader::readFile(const char* filePath) {
+    int fd = open(filePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    // stat and statm are a few hundred bytes; one read gets all of it
+    ssize_t length = read(fd, buffer, BUFFER_SIZE - 1);
+    close(fd);
+    if (length < 0) return -1;
+    buffer[length] = '\0';
+    return length;
+}
+
+bool ProcFsReader::parseStat(const char* text, size_t length, ProcStat& stat) {
+    // "pid (comm) state ppid ..." where comm may itself hold spaces and parentheses
+    const char* end = text + length;
+    const char* open = static_cast<const char*>(memchr(text, '(', length));
+    const char* close = nullptr;
+    for (const char* p = end; p > text; p--) {
+        if (p[-1] == ')') { close = p - 1; break; }
+    }
+    if (!open || !close || close < open) return false;
+
+    unsigned long long value = 0;
+    if (!parseNumber(text, open, value)) return false;
+    stat.pid = static_cast<int>(value);
+
+    size_t nameLength = min<size_t>(static_cast<size_t>(close - open - 1), ProcStat::NAME_CAPACITY - 1);
+    memcpy(stat.name, open + 1, nameLength);
+    stat.name[nameLength] = '\0';
+
+    const char* p = skipSpaces(close + 1, end);
+    if (p >= end) return false;
+    stat.state = *p++;
+
+    // Fields after the state, counting it as field 3 of proc(5)
+    int field = 4;
+    while (p && p < end && field <= 24) {
+        switch (field) {
+        case 4:  p = parseNumber(p, end, value); stat.parentPid = static_cast<int>(value); break;
+        case 14: p = parseNumber(p, end, stat.userTicks); break;
+        case 15: p = parseNumber(p, end, stat.systemTicks); break;
+        case 20: p = parseNumber(p, end, value); stat.threads = static_cast<int>(value); break;
+        case 22: p = parseNumber(p, end, stat.startTicks); break;
+        case 24: p = parseNumber(p, end, stat.residentPages); break;
+        default: p = skipField(p, end); break;
+        }
+        field++;
+    }
+    return p != nullptr && field > 24;
+}
+
+bool ProcFsReader::parseStatm(const char* text, size_t length, ProcStat& stat) {
+    // "size resident shared text lib data dt", in pages
+    const char* end = text + length;
+    unsigned long long size = 0;
+    const char* p = parseNumber(text, end, size);
+    if (p) p = parseNumber(p, end, stat.residentPages);
+    if (p) p = parseNumber(p, end, stat.sharedPages);
+    return p != nullptr;
+}
+
+bool ProcFsReader::parseIo(const char* text, size_t length, ProcStat& stat) {
+    // "rchar: N\nwchar: N\nsyscr: ..." where rchar and wchar count every
+    // read and write, cached or not, like Windows' transfer counters
+    const char* end = text + length;
+    const char* rchar = strstr(text, "rchar:");
+    const char* wchar = strstr(text, "wchar:");
+    if (!rchar || !wchar) return false;
+    return parseNumber(rchar + 6, end, stat.readBytes) && parseNumber(wchar + 6, end, stat.writeBytes);
+}
+
+int ProcFsReader::countEntries(const char* dirPath) {
+    DIR* dir = opendir(dirPath);
+    if (!dir) return 0;
+    int count = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+size_t ProcFsReader::scan(vector<ProcStat>& stats) {
+    stats.clear();
+    DIR* dir = opendir(root.c_str());
+    if (!dir) return 0;
+
+    while (dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (*name < '1' || *name > '9') continue;
+
+        ProcStat stat;
+        int prefix = snprintf(path, sizeof(path), "%s/%s/", root.c_str(), name);
+        if (prefix <= 0 || static_cast<size_t>(prefix) + 8 > sizeof(path)) continue;
+
+        // Processes that exit mid-scan simply drop out
+        memcpy(path + prefix, "stat", 5);
+        ssize_t length = readFile(path);
+        if (length <= 0 || !parseStat(buffer, static_cast<size_t>(length), stat)) continue;
+
+        if (readStatm) {
+            memcpy(path + prefix, "statm", 6);
+            length = readFile(path);
+            if (length > 0) parseStatm(buffer, static_cast<size_t>(length), stat);
+        }
+        if (readIo) {
+            memcpy(path + prefix, "io", 3);
+            length = readFile(path);
+            if (length > 0) parseIo(buffer, static_cast<size_t>(length), stat);
+        }
+        if (countHandles) {
+            memcpy(path + prefix, "fd", 3);
+            stat.handles = countEntries(path);
+        }
+
+        stats.push_back(stat);
+    }
+    closedir(dir);
+    return stats.size();
+}
+
+size_t ProcFsReader::enumerate(vector<ProcessInfo>& processes) {
+    scan(scratch);
+
+    processes.resize(scratch.size());
+    for (size_t i = 0; i < scratch.size(); i++) {
+        ProcessInfo& info = processes[i];
+        info.name.assign(scratch[i].name);   // Reuses the string's buffer from the last scan
+        info.processId = static_cast<DWORD>(scratch[i].pid);
+        info.memoryUsage = static_cast<SIZE_T>(scratch[i].residentPages * pageBytes);
+    }
+
+    sort(processes.begin(), processes.end(),
+        [](const ProcessInfo& a, const ProcessInfo& b) {
+            return a.memoryUsage > b.memoryUsage;
+        });
+    return processes.size();
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef _WIN32
+#include "../Libs/Header.h"
+#include "../Platform/Platform.h"
+#include <climits>
+
+// Counters for one process from /proc/<pid>/stat, and optionally statm, io and fd/
+struct ProcStat {
+    static const size_t NAME_CAPACITY = 64;   // comm is 15 characters on stock kernels
+
+    int pid = 0;
+    int parentPid = 0;
+    char state = '?';
+    int threads = 0;
+    unsigned long long userTicks = 0;
+    unsigned long long systemTicks = 0;
+    unsigned long long startTicks = 0;       // Since boot; with pid, identifies the process
+    unsigned long long residentPages = 0;
+    unsigned long long sharedPages = 0;      // Only filled when statm is read
+    unsigned long long readBytes = 0;        // rchar and wchar from io, when read
+    unsigned long long writeBytes = 0;
+    int handles = 0;                         // Entries in fd/, when counted
+    char name[NAME_CAPACITY] = {};
+};
+
+// Enumerates processes straight from procfs: one open/read/close per file
+// into a reused buffer, hand-rolled number parsing, no iostreams and no
+// per-process heap allocation once the output vector has grown. stat alone
+// carries the name, parent, CPU times, threads and resident set; statm, for
+// shared pages, costs a second file per process and is off by default, as
+// are io and the fd/ listing, which the sampler needs and the listing does not.
+// io and fd/ of other users' processes need privileges; those stay zero.
+class ProcFsReader {
+public:
+    explicit ProcFsReader(const string& root = "/proc");
+
+    // Overwrites stats with every process that could be read, keeping capacity
+    size_t scan(vector<ProcStat>& stats);
+    // Same scan as ProcessInfo records, largest working set first like
+    // RunningApps::getRunningApps
+    size_t enumerate(vector<ProcessInfo>& processes);
+
+    long pageSize() const { return pageBytes; }
+    void setReadStatm(bool enabled) { readStatm = enabled; }
+    void setReadIo(bool enabled) { readIo = enabled; }
+    void setCountHandles(bool enabled) { countHandles = enabled; }
+
+    // Exposed for the benchmark's synthetic trees
+    static bool parseStat(const char* text, size_t length, ProcStat& stat);
+    static bool parseStatm(const char* text, size_t length, ProcStat& stat);
+    static bool parseIo(const char* text, size_t length, ProcStat& stat);
+
+private:
+    static const size_t BUFFER_SIZE = 4096;
+
+    string root;
+    long pageBytes;
+    bool readStatm;
+    bool readIo;
+    bool countHandles;
+    char buffer[BUFFER_SIZE];
+    char path[PATH_MAX];
+    vector<ProcStat> scratch;
+
+    // The file's bytes in buffer, NUL-terminated; -1 if it cannot be read
+    ssize_t readFile(const char* filePath);
+    int countEntries(const char* dirPath);
+};
+#endif
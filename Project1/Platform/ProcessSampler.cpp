@@ -0,0 +1,55 @@
+#include "../Platform/ProcessSampler.h"
+
+const int ProcessSampler::MAX_INTERVAL_MS;   // Taken by reference by min()
+
+ProcessSampler::ProcessSampler(ProcessBackend& backend, size_t expectedProcesses)
+    : backend(backend), cpus(max(thread::hardware_concurrency(), 1u)), elapsed(0) {
+    before.reserve(expectedProcesses);
+    after.reserve(expectedProcesses);
+    usage.reserve(expectedProcesses);
+}
+
+bool ProcessSampler::sample(chrono::milliseconds interval) {
+    if (!backend.sampleProcesses(before)) return false;
+    auto firstTaken = chrono::steady_clock::now();
+    this_thread::sleep_for(interval);
+    if (!backend.sampleProcesses(after)) return false;
+    elapsed = chrono::duration<double>(chrono::steady_clock::now() - firstTaken).count();
+    if (elapsed <= 0) elapsed = 1e-3;
+
+    // Matching by binary search needs only the first snapshot ordered
+    sort(before.begin(), before.end(), byProcessId);
+
+    double cpuMicroseconds = elapsed * 1e6 * cpus;
+    usage.resize(after.size());
+    for (size_t i = 0; i < after.size(); i++) {
+        const ProcessCounters& now = after[i];
+        ProcessUsage& row = usage[i];
+        row.name.assign(now.name);
+        row.processId = now.processId;
+        row.threads = now.threads;
+        row.handles = now.handles;
+        row.privateBytes = now.privateBytes;
+        row.workingSet = now.workingSet;
+
+        auto match = lower_bound(before.begin(), before.end(), now, byProcessId);
+        // A different start time is a new process that got an old PID back
+        row.started = match == before.end() || match->processId != now.processId ||
+            match->startTime != now.startTime;
+        if (row.started) {
+            row.cpuPercent = 0;
+            row.readBytesPerSecond = 0;
+            row.writeBytesPerSecond = 0;
+            continue;
+        }
+
+        // Counters can only go backwards through a wrap or a backend glitch
+        auto delta = [](unsigned long long later, unsigned long long earlier) {
+            return later > earlier ? static_cast<double>(later - earlier) : 0.0;
+        };
+        row.cpuPercent = min(100.0, 100.0 * delta(now.cpuMicroseconds, match->cpuMicroseconds) / cpuMicroseconds);
+        row.readBytesPerSecond = delta(now.readBytes, match->readBytes) / elapsed;
+        row.writeBytesPerSecond = delta(now.writeBytes, match->writeBytes) / elapsed;
+    }
+    return true;
+}
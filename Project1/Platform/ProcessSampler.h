@@ -0,0 +1,48 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Platform/Platform.h"
+
+// One process over a sampling interval
+struct ProcessUsage {
+    string name;
+    DWORD processId = 0;
+    double cpuPercent = 0;            // Of all CPUs together, as Task Manager shows it
+    unsigned threads = 0;
+    unsigned handles = 0;
+    unsigned long long privateBytes = 0;
+    unsigned long long workingSet = 0;
+    double readBytesPerSecond = 0;
+    double writeBytesPerSecond = 0;
+    bool started = false;             // Not in the first snapshot, so its rates cover part of the interval
+};
+
+// Takes two snapshots of the backend's counters an interval apart and turns
+// the differences into per-process rates. Both snapshot buffers and the
+// output rows live as long as the sampler, so a steady process count means no
+// allocation after the first sample. InventoryQuery ranks and prints them.
+class ProcessSampler {
+public:
+    static const int MAX_INTERVAL_MS = 10000;
+
+    explicit ProcessSampler(ProcessBackend& backend, size_t expectedProcesses = 1024);
+
+    // Blocks for the interval and refills results(). Processes that exited
+    // during the interval are left out.
+    bool sample(chrono::milliseconds interval);
+    vector<ProcessUsage>& results() { return usage; }
+
+    unsigned cpuCount() const { return cpus; }
+    double elapsedSeconds() const { return elapsed; }
+
+private:
+    ProcessBackend& backend;
+    unsigned cpus;
+    double elapsed;
+    vector<ProcessCounters> before;   // Sorted by PID after each sample
+    vector<ProcessCounters> after;
+    vector<ProcessUsage> usage;
+
+    static bool byProcessId(const ProcessCounters& a, const ProcessCounters& b) {
+        return a.processId < b.processId;
+    }
+};
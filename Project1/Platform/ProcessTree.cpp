@@ -0,0 +1,185 @@
+#include "../Platform/ProcessTree.h"
+
+namespace {
+
+string megabytes(unsigned long long bytes) {
+    ostringstream text;
+    text << fixed << setprecision(1) << bytes / (1024.0 * 1024.0) << " MB";
+    return text.str();
+}
+
+}
+
+void ProcessTree::build(const vector<ProcessCounters>& processes) {
+    source = &processes;
+    size_t count = processes.size();
+    forest.assign(count, Node());
+    rootNodes.clear();
+
+    // Positions sorted by PID: one binary search per parent
+    vector<int> byPid(count);
+    for (size_t i = 0; i < count; i++) byPid[i] = static_cast<int>(i);
+    sort(byPid.begin(), byPid.end(),
+        [&](int a, int b) { return processes[a].processId < processes[b].processId; });
+
+    for (size_t i = 0; i < count; i++) {
+        const ProcessCounters& process = processes[i];
+        Node& node = forest[i];
+        node.workingSet = process.workingSet;
+        node.privateBytes = process.privateBytes;
+        node.cpuMicroseconds = process.cpuMicroseconds;
+
+        DWORD parentId = process.parentProcessId;
+        if (parentId == 0 || parentId == process.processId) continue;
+        auto found = lower_bound(byPid.begin(), byPid.end(), parentId,
+            [&](int index, DWORD processId) { return processes[index].processId < processId; });
+        if (found == byPid.end() || processes[*found].processId != parentId) {
+            node.orphan = true;
+            continue;
+        }
+        // A parent that started after its child is a newer process on the old PID
+        const ProcessCounters& parent = processes[*found];
+        if (parent.startTime != 0 && process.startTime != 0 && parent.startTime > process.startTime) {
+            node.orphan = true;
+            continue;
+        }
+        node.parent = *found;
+        node.nextSibling = forest[*found].firstChild;
+        forest[*found].firstChild = static_cast<int>(i);
+    }
+
+    // Everything reachable from a root; what is left hangs in a parent cycle,
+    // which only equal start times let through. Each cycle is cut at one node.
+    vector<char> reached(count, 0);
+    vector<int> order;
+    order.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        if (forest[i].parent == NONE) subtree(static_cast<int>(i), order);
+    }
+    for (int index : order) reached[index] = 1;
+    for (size_t i = 0; i < count; i++) {
+        if (reached[i]) continue;
+        Node& node = forest[i];
+        int* link = &forest[node.parent].firstChild;
+        while (*link != static_cast<int>(i)) link = &forest[*link].nextSibling;
+        *link = node.nextSibling;
+        node.parent = NONE;
+        node.nextSibling = NONE;
+        node.orphan = true;
+        size_t before = order.size();
+        subtree(static_cast<int>(i), order);
+        for (size_t j = before; j < order.size(); j++) reached[order[j]] = 1;
+    }
+
+    // Children before parents: each total is final before it is added upwards
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const Node& node = forest[*it];
+        if (node.parent == NONE) continue;
+        Node& parent = forest[node.parent];
+        parent.processes += node.processes;
+        parent.workingSet += node.workingSet;
+        parent.privateBytes += node.privateBytes;
+        parent.cpuMicroseconds += node.cpuMicroseconds;
+    }
+
+    link(order);
+}
+
+// Relinks every sibling list, and the roots, largest subtree first
+void ProcessTree::link(const vector<int>& order) {
+    vector<int> bySize = order;
+    stable_sort(bySize.begin(), bySize.end(),
+        [this](int a, int b) { return forest[a].workingSet > forest[b].workingSet; });
+
+    for (auto& node : forest) {
+        node.firstChild = NONE;
+        node.nextSibling = NONE;
+    }
+    for (auto it = bySize.rbegin(); it != bySize.rend(); ++it) {
+        Node& node = forest[*it];
+        if (node.parent == NONE) continue;
+        node.nextSibling = forest[node.parent].firstChild;
+        forest[node.parent].firstChild = *it;
+    }
+    for (int index : bySize) {
+        if (forest[index].parent == NONE) rootNodes.push_back(index);
+    }
+
+    vector<int> walk;
+    for (int root : rootNodes) {
+        walk.clear();
+        subtree(root, walk);
+        for (int index : walk) {
+            Node& node = forest[index];
+            node.depth = node.parent == NONE ? 0 : forest[node.parent].depth + 1;
+        }
+    }
+}
+
+size_t ProcessTree::orphans() const {
+    size_t count = 0;
+    for (const auto& node : forest) {
+        if (node.orphan) count++;
+    }
+    return count;
+}
+
+void ProcessTree::subtree(int node, vector<int>& out) const {
+    // Down to the first child, else across to the next sibling, else back up
+    int at = node;
+    while (true) {
+        out.push_back(at);
+        if (forest[at].firstChild != NONE) {
+            at = forest[at].firstChild;
+            continue;
+        }
+        while (at != node && forest[at].nextSibling == NONE) at = forest[at].parent;
+        if (at == node) return;
+        at = forest[at].nextSibling;
+    }
+}
+
+vector<int> ProcessTree::topmost(const function<bool(const ProcessCounters&)>& test) const {
+    vector<int> found;
+    for (int root : rootNodes) {
+        int at = root;
+        while (true) {
+            bool matched = test((*source)[at]);
+            if (matched) found.push_back(at);
+            if (!matched && forest[at].firstChild != NONE) {
+                at = forest[at].firstChild;
+                continue;
+            }
+            while (at != root && forest[at].nextSibling == NONE) at = forest[at].parent;
+            if (at == root) break;
+            at = forest[at].nextSibling;
+        }
+    }
+    return found;
+}
+
+void ProcessTree::write(ostream& out, const vector<int>& selected) const {
+    out << right << setw(8) << "PID" << "  " << setw(10) << "Memory" << "  " << setw(12) << "Tree memory"
+        << "  " << setw(10) << "Tree CPU" << "  " << setw(6) << "Procs" << "  " << "Name" << endl;
+    out << string(64, '-') << endl;
+
+    vector<int> walk;
+    for (int top : selected) {
+        walk.clear();
+        subtree(top, walk);
+        for (int index : walk) {
+            const Node& node = forest[index];
+            const ProcessCounters& process = (*source)[index];
+            ostringstream cpu;
+            cpu << fixed << setprecision(1) << node.cpuMicroseconds / 1e6 << " s";
+            out << right << setw(8) << process.processId << "  " << setw(10) << megabytes(process.workingSet)
+                << "  " << setw(12) << megabytes(node.workingSet) << "  " << setw(10) << cpu.str()
+                << "  " << setw(6) << node.processes << "  ";
+            int level = node.depth - forest[top].depth;
+            if (level > 0) out << string(2 * (level - 1), ' ') << "\\_ ";
+            out << process.name;
+            if (node.orphan) out << " (parent PID " << process.parentProcessId << " gone)";
+            out << endl;
+        }
+    }
+}
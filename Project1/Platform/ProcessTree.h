@@ -0,0 +1,48 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Platform/Platform.h"
+
+// The parent/child forest of one process snapshot. Nodes sit at the same
+// positions as the snapshot's processes and link to each other by index
+// (parent, first child, next sibling), so walking a subtree never searches.
+// Parents are resolved once through a PID-sorted index. A child whose parent
+// PID is gone, or now belongs to a process that started after the child (a
+// reused PID), becomes an orphan root. Siblings are ordered by subtree memory.
+class ProcessTree {
+public:
+    static const int NONE = -1;
+
+    struct Node {
+        int parent = NONE;
+        int firstChild = NONE;
+        int nextSibling = NONE;
+        int depth = 0;
+        bool orphan = false;                      // Names a parent that is not in the snapshot
+        // Subtree totals, the node included
+        size_t processes = 1;
+        unsigned long long workingSet = 0;
+        unsigned long long privateBytes = 0;
+        unsigned long long cpuMicroseconds = 0;
+    };
+
+    // Keeps a pointer to processes, which must outlive the tree
+    void build(const vector<ProcessCounters>& processes);
+
+    const vector<Node>& nodes() const { return forest; }
+    const vector<int>& roots() const { return rootNodes; }
+    size_t orphans() const;
+
+    // The node and everything under it, parents before children
+    void subtree(int node, vector<int>& out) const;
+    // The highest nodes that pass the test; their subtrees are not searched further
+    vector<int> topmost(const function<bool(const ProcessCounters&)>& test) const;
+    // One indented line per process under each given node
+    void write(ostream& out, const vector<int>& selected) const;
+
+private:
+    const vector<ProcessCounters>* source = nullptr;
+    vector<Node> forest;
+    vector<int> rootNodes;
+
+    void link(const vector<int>& order);
+};
@@ -0,0 +1,114 @@
+#include "../Platform/ServiceConfigCache.h"
+
+const char* ServiceConfigCache::DEFAULT_FILE = "service_config_cache.json";
+
+ServiceConfigCache::ServiceConfigCache(const string& path)
+    : path(path), loaded(false), dirty(false), hitCount(0), missCount(0) {
+}
+
+void ServiceConfigCache::load() {
+    loaded = true;
+    ifstream file(path);
+    if (!file.is_open()) return;
+
+    Json::Value root;
+    Json::CharReaderBuilder reader;
+    string errors;
+    if (!Json::parseFromStream(reader, file, &root, &errors) || !root.isObject()) {
+        cout << "Ignoring unreadable service config cache " << path << ": " << errors << endl;
+        return;
+    }
+
+    const Json::Value& services = root["services"];
+    for (const auto& name : services.getMemberNames()) {
+        const Json::Value& stored = services[name];
+        Entry entry;
+        entry.marker = stored.get("marker", 0).asUInt64();
+        entry.config.description = stored.get("description", "").asString();
+        entry.config.startType = stored.get("startType", "").asString();
+        entries[name] = entry;
+    }
+}
+
+void ServiceConfigCache::beginPass() {
+    lock_guard<mutex> lock(cacheMutex);
+    if (!loaded) load();
+    hitCount = 0;
+    missCount = 0;
+    for (auto& entry : entries) entry.second.seen = false;
+}
+
+bool ServiceConfigCache::lookup(const string& name, unsigned long long marker, ServiceConfig& config) {
+    lock_guard<mutex> lock(cacheMutex);
+    if (!loaded) load();
+    auto it = entries.find(name);
+    if (it != entries.end()) it->second.seen = true;
+    if (marker == 0 || it == entries.end() || it->second.marker != marker) {
+        missCount++;
+        return false;
+    }
+    hitCount++;
+    config = it->second.config;
+    return true;
+}
+
+void ServiceConfigCache::store(const string& name, unsigned long long marker, const ServiceConfig& config) {
+    lock_guard<mutex> lock(cacheMutex);
+    Entry& entry = entries[name];
+    entry.marker = marker;
+    entry.config = config;
+    entry.seen = true;
+    dirty = true;
+}
+
+bool ServiceConfigCache::save() {
+    lock_guard<mutex> lock(cacheMutex);
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.seen) {
+            ++it;
+            continue;
+        }
+        it = entries.erase(it);
+        dirty = true;
+    }
+    if (!dirty) return true;
+
+    ofstream file(path);
+    if (!file.is_open()) return false;
+
+    Json::Value root;
+    root["version"] = 1;
+    Json::Value& services = root["services"];
+    services = Json::Value(Json::objectValue);
+    for (const auto& entry : entries) {
+        Json::Value stored;
+        stored["marker"] = Json::Value::UInt64(entry.second.marker);
+        stored["description"] = entry.second.config.description;
+        stored["startType"] = entry.second.config.startType;
+        services[entry.first] = stored;
+    }
+
+    Json::StyledWriter writer;
+    file << writer.write(root);
+    dirty = false;
+    return true;
+}
+
+size_t ServiceConfigCache::hits() const {
+    lock_guard<mutex> lock(cacheMutex);
+    return hitCount;
+}
+
+size_t ServiceConfigCache::misses() const {
+    lock_guard<mutex> lock(cacheMutex);
+    return missCount;
+}
+
+string ServiceConfigCache::describe() const {
+    lock_guard<mutex> lock(cacheMutex);
+    size_t total = hitCount + missCount;
+    ostringstream text;
+    text << hitCount << " of " << total << " service configs from cache";
+    if (total > 0) text << " (" << fixed << setprecision(1) << 100.0 * hitCount / total << "%)";
+    return text.str();
+}
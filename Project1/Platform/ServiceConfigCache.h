@@ -0,0 +1,51 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// The parts of a service's configuration that cost a round trip each to read
+struct ServiceConfig {
+    string description;
+    string startType;
+};
+
+// Service configurations kept on disk between runs, since descriptions and
+// start types almost never change but take an OpenService and two queries per
+// service to read. Each entry carries the change marker it was read under (on
+// Windows, the last write time of the service's registry key), and a lookup
+// with any other marker is a miss. Services not looked up since beginPass()
+// are dropped on save. A missing or unreadable file is an empty cache.
+class ServiceConfigCache {
+public:
+    static const char* DEFAULT_FILE;   // "service_config_cache.json", beside the other state files
+
+    explicit ServiceConfigCache(const string& path);
+
+    // Starts an enumeration: resets the counts and the seen marks
+    void beginPass();
+    // True, with config filled, when the stored marker equals marker; 0 never hits
+    bool lookup(const string& name, unsigned long long marker, ServiceConfig& config);
+    void store(const string& name, unsigned long long marker, const ServiceConfig& config);
+    // Writes the file if an entry was stored or dropped; false if it cannot be written
+    bool save();
+
+    size_t hits() const;
+    size_t misses() const;
+    // "298 of 302 service configs from cache (98.7%)"
+    string describe() const;
+
+private:
+    struct Entry {
+        unsigned long long marker = 0;
+        ServiceConfig config;
+        bool seen = false;
+    };
+
+    string path;
+    mutable mutex cacheMutex;
+    map<string, Entry> entries;
+    bool loaded;
+    bool dirty;
+    size_t hitCount;
+    size_t missCount;
+
+    void load();   // Caller holds cacheMutex
+};
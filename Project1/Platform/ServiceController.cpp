@@ -0,0 +1,214 @@
+#include "../Platform/ServiceController.h"
+
+namespace {
+
+// Nothing known yet counts as pending too
+bool isPending(const string& state) {
+    static const string suffix = "Pending";
+    return state.empty() ||
+        (state.size() >= suffix.size() && state.compare(state.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+// Service names are case-insensitive on Windows
+string caseFolded(string name) {
+    transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return name;
+}
+
+bool contains(const vector<size_t>& list, size_t value) {
+    return find(list.begin(), list.end(), value) != list.end();
+}
+
+}
+
+ServiceController::ServiceController(ServiceControlDriver& driver) : driver(driver) {
+}
+
+const vector<string>& ServiceController::dependenciesOf(const string& name) {
+    string key = caseFolded(name);
+    auto it = dependencyLists.find(key);
+    if (it == dependencyLists.end()) it = dependencyLists.emplace(key, driver.dependencies(name)).first;
+    return it->second;
+}
+
+vector<vector<size_t>> ServiceController::order(const vector<ServiceOperation>& operations,
+    ServiceSchedule& schedule, vector<size_t>& topological) {
+    size_t count = operations.size();
+    map<string, size_t> inBatch;
+    for (size_t i = 0; i < count; i++) {
+        if (operations[i].refused.empty()) inBatch.emplace(caseFolded(operations[i].name), i);
+    }
+
+    // Everything each service needs, directly or through services outside the
+    // batch, so the lists are closed under "needs"
+    vector<vector<size_t>> waitsFor(count);
+    for (size_t i = 0; i < count; i++) {
+        if (!operations[i].refused.empty()) continue;
+        set<string> seen;
+        vector<string> stack = dependenciesOf(operations[i].name);
+        while (!stack.empty()) {
+            string name = stack.back();
+            stack.pop_back();
+            if (!seen.insert(caseFolded(name)).second) continue;
+            auto found = inBatch.find(caseFolded(name));
+            if (found != inBatch.end() && found->second != i) {
+                // A stop goes the other way: the dependency waits for its dependent
+                if (operations[i].start) waitsFor[i].push_back(found->second);
+                else waitsFor[found->second].push_back(i);
+            }
+            const vector<string>& next = dependenciesOf(name);
+            stack.insert(stack.end(), next.begin(), next.end());
+        }
+    }
+    for (auto& list : waitsFor) {
+        sort(list.begin(), list.end());
+        list.erase(unique(list.begin(), list.end()), list.end());
+    }
+
+    // In a closed relation every edge of a cycle runs both ways
+    vector<vector<size_t>> acyclic(count);
+    for (size_t i = 0; i < count; i++) {
+        bool inCycle = false;
+        for (size_t j : waitsFor[i]) {
+            if (contains(waitsFor[j], i)) inCycle = true;
+            else acyclic[i].push_back(j);
+        }
+        if (inCycle) schedule.cycle.push_back(operations[i].name);
+    }
+
+    // Only the waits no other wait implies: a start after B, which is after A, is not also after A
+    vector<vector<size_t>> direct(count);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j : acyclic[i]) {
+            bool implied = any_of(acyclic[i].begin(), acyclic[i].end(),
+                [&](size_t k) { return k != j && contains(acyclic[k], j); });
+            if (!implied) direct[i].push_back(j);
+        }
+    }
+
+    vector<size_t> unmet(count, 0);
+    vector<vector<size_t>> waiters(count);
+    for (size_t i = 0; i < count; i++) {
+        unmet[i] = direct[i].size();
+        for (size_t j : direct[i]) waiters[j].push_back(i);
+    }
+    topological.clear();
+    for (size_t i = 0; i < count; i++) {
+        if (unmet[i] == 0) topological.push_back(i);
+    }
+    for (size_t at = 0; at < topological.size(); at++) {
+        for (size_t k : waiters[topological[at]]) {
+            if (--unmet[k] == 0) topological.push_back(k);
+        }
+    }
+    return direct;
+}
+
+ServiceSchedule ServiceController::run(vector<ServiceOperation>& operations, chrono::milliseconds timeout) {
+    typedef chrono::steady_clock Clock;
+    size_t count = operations.size();
+    ServiceSchedule schedule;
+    vector<size_t> topological;
+    vector<vector<size_t>> waitsFor = order(operations, schedule, topological);
+
+    vector<vector<size_t>> waiters(count);
+    vector<size_t> unmet(count, 0);
+    for (size_t i = 0; i < count; i++) {
+        unmet[i] = waitsFor[i].size();
+        for (size_t j : waitsFor[i]) {
+            waiters[j].push_back(i);
+            operations[i].waitedFor.push_back(operations[j].name);
+        }
+    }
+
+    vector<Clock::time_point> issuedAt(count);
+    vector<size_t> ready;      // Everything they wait for has arrived
+    vector<size_t> finished;   // Settled, failed or blocked; their waiters have not heard yet
+    vector<size_t> pending;    // Sent and on their way
+    for (size_t i = 0; i < count; i++) {
+        if (operations[i].refused.empty() && unmet[i] == 0) ready.push_back(i);
+    }
+
+    while (true) {
+        while (!ready.empty() || !finished.empty()) {
+            for (size_t i : ready) {
+                ServiceOperation& operation = operations[i];
+                issuedAt[i] = Clock::now();
+                operation.error = driver.request(operation.name, operation.start);
+                if (operation.error == 0) pending.push_back(i);
+                else finished.push_back(i);
+            }
+            ready.clear();
+
+            while (!finished.empty()) {
+                size_t i = finished.back();
+                finished.pop_back();
+                for (size_t k : waiters[i]) {
+                    if (!operations[k].blockedBy.empty()) continue;
+                    if (!operations[i].reached) {
+                        operations[k].blockedBy = operations[i].name;
+                        finished.push_back(k);
+                    }
+                    else if (--unmet[k] == 0) {
+                        ready.push_back(k);
+                    }
+                }
+            }
+        }
+        if (pending.empty()) break;
+
+        Clock::time_point now = Clock::now();
+        Clock::time_point nextDeadline = Clock::time_point::max();
+        size_t kept = 0;
+        for (size_t i : pending) {
+            ServiceOperation& operation = operations[i];
+            operation.state = driver.state(operation.name);
+            operation.elapsedMs = chrono::duration_cast<chrono::milliseconds>(now - issuedAt[i]).count();
+            if (!isPending(operation.state)) {
+                operation.reached = operation.state == operation.target();
+                finished.push_back(i);
+                continue;
+            }
+            if (now >= issuedAt[i] + timeout) {
+                operation.timedOut = true;
+                finished.push_back(i);
+                continue;
+            }
+            nextDeadline = min(nextDeadline, issuedAt[i] + timeout);
+            pending[kept++] = i;
+        }
+        pending.resize(kept);
+        if (finished.empty()) driver.waitForChange(nextDeadline);
+    }
+
+    // Longest chain of waits, by services and by the time its services took
+    vector<size_t> levels(count, 0);
+    vector<long long> pathMs(count, 0);
+    vector<size_t> previous(count, count);
+    for (size_t i : topological) {
+        if (!operations[i].refused.empty()) continue;
+        long long ownMs = operations[i].reached ? operations[i].elapsedMs : 0;
+        levels[i] = 1;
+        pathMs[i] = ownMs;
+        for (size_t j : waitsFor[i]) {
+            levels[i] = max(levels[i], levels[j] + 1);
+            if (pathMs[j] + ownMs > pathMs[i] || previous[i] == count) {
+                pathMs[i] = pathMs[j] + ownMs;
+                previous[i] = j;
+            }
+        }
+        schedule.depth = max(schedule.depth, levels[i]);
+    }
+    size_t last = count;
+    for (size_t i : topological) {
+        if (!operations[i].refused.empty()) continue;
+        if (last == count || pathMs[i] > pathMs[last] ||
+            (pathMs[i] == pathMs[last] && levels[i] > levels[last])) last = i;
+    }
+    if (last != count) {
+        schedule.criticalPathMs = pathMs[last];
+        for (size_t at = last; at != count; at = previous[at]) schedule.criticalPath.push_back(operations[at].name);
+        reverse(schedule.criticalPath.begin(), schedule.criticalPath.end());
+    }
+    return schedule;
+}
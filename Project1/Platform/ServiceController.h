@@ -0,0 +1,53 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Platform/Platform.h"
+
+// What ServiceController needs from one service manager: the Windows SCM,
+// systemd or the mock. Every call comes from the controller's thread.
+class ServiceControlDriver {
+public:
+    virtual ~ServiceControlDriver() {}
+    // Sends a start or stop without waiting for it, and arranges to be told
+    // when the service settles. Returns 0, or the error that kept the request
+    // from going out.
+    virtual unsigned long request(const string& name, bool start) = 0;
+    // Latest state known for a requested service. "Start Pending" and other
+    // states ending in "Pending" are on their way; any other state, such as
+    // "Running", "Stopped" or "Failed (exit code 5)", is settled. Empty when
+    // nothing is known yet.
+    virtual string state(const string& name) = 0;
+    // Returns once a requested service may have settled, or at the deadline
+    virtual void waitForChange(chrono::steady_clock::time_point deadline) = 0;
+    // The services this one needs running before it can start; empty when
+    // it needs none or they cannot be read
+    virtual vector<string> dependencies(const string& name) = 0;
+};
+
+// Starts or stops a batch of services together, in dependency order. Before
+// anything is sent, each service's dependencies are followed, through
+// services outside the batch, to the ones inside it; that gives a DAG over
+// the batch. A start waits for the services it depends on, and a stop waits
+// for the services that depend on it. A service is sent as soon as the last
+// one it waits for arrives, so independent branches run side by side. The
+// controller sleeps until the driver reports a change, never on a polling
+// interval. Each service has its own deadline, counted from its own request.
+// A service that settles in the other state (Stopped after a start) has
+// failed, and nothing that waits for it is sent.
+class ServiceController {
+public:
+    explicit ServiceController(ServiceControlDriver& driver);
+
+    // Operations with refused set are left alone and hold nothing back
+    ServiceSchedule run(vector<ServiceOperation>& operations, chrono::milliseconds timeout);
+
+private:
+    ServiceControlDriver& driver;
+    map<string, vector<string>> dependencyLists;   // By case-folded name; one driver query each
+
+    const vector<string>& dependenciesOf(const string& name);
+    // For each operation, the operations it waits for, with edges implied by
+    // others left out. topological receives the operations in an order that
+    // puts every operation after the ones it waits for.
+    vector<vector<size_t>> order(const vector<ServiceOperation>& operations,
+        ServiceSchedule& schedule, vector<size_t>& topological);
+};
@@ -0,0 +1,200 @@
+#include "../Platform/ShortcutIndex.h"
+
+namespace {
+
+const size_t MAX_PREFIX_KEYS = 256;   // Keys examined for a very short prefix like "a"
+
+bool startsWith(const string& text, const string& prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Every character of wanted in order; fewer gaps score higher
+int subsequenceScore(const string& text, const string& wanted) {
+    size_t at = 0;
+    int gaps = 0;
+    for (char c : wanted) {
+        size_t found = text.find(c, at);
+        if (found == string::npos) return 0;
+        if (found != at) gaps++;
+        at = found + 1;
+    }
+    return max(1, 150 - 25 * gaps);
+}
+
+}
+
+ShortcutIndex::ShortcutIndex(Scanner scanner) : scanner(scanner), stale(true) {
+}
+
+string ShortcutIndex::normalize(const string& name) {
+    string text = name;
+    size_t slash = text.find_last_of("\\/");
+    if (slash != string::npos) text = text.substr(slash + 1);
+
+    string lower;
+    lower.reserve(text.size());
+    for (unsigned char c : text) lower += static_cast<char>(tolower(c));
+    for (const char* extension : { ".lnk", ".desktop", ".exe", ".url" }) {
+        size_t length = strlen(extension);
+        if (lower.size() > length && lower.compare(lower.size() - length, length, extension) == 0) {
+            lower.resize(lower.size() - length);
+            break;
+        }
+    }
+
+    string normalized;
+    bool space = false;
+    for (unsigned char c : lower) {
+        if (isalnum(c) || c >= 0x80) {
+            if (space && !normalized.empty()) normalized += ' ';
+            normalized += static_cast<char>(c);
+            space = false;
+        }
+        else {
+            space = true;
+        }
+    }
+    return normalized;
+}
+
+void ShortcutIndex::invalidate() {
+    lock_guard<mutex> lock(indexMutex);
+    stale = true;
+}
+
+size_t ShortcutIndex::size() {
+    lock_guard<mutex> lock(indexMutex);
+    if (stale) rebuild();
+    return entries.size();
+}
+
+// Caller holds indexMutex
+void ShortcutIndex::rebuild() {
+    vector<ShortcutEntry> scanned;
+    scanner(scanned);
+
+    entries.clear();
+    names.clear();
+    keys.clear();
+    set<string> seen;
+    for (auto& entry : scanned) {
+        string normalized = normalize(entry.name);
+        // Earlier locations win, as they did with the first wildcard hit
+        if (normalized.empty() || !seen.insert(normalized).second) continue;
+
+        size_t index = entries.size();
+        for (size_t at = 0; at < normalized.size(); at = normalized.find(' ', at) + 1) {
+            keys.push_back({ normalized.substr(at), index, at == 0 });
+            if (normalized.find(' ', at) == string::npos) break;
+        }
+        entries.push_back(move(entry));
+        names.push_back(normalized);
+    }
+    sort(keys.begin(), keys.end(), [](const Key& a, const Key& b) { return a.text < b.text; });
+    stale = false;
+}
+
+int ShortcutIndex::editDistance(const string& a, const string& b, int limit) {
+    if (abs(static_cast<int>(a.size()) - static_cast<int>(b.size())) > limit) return limit + 1;
+    vector<int> previous(b.size() + 1), current(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++) previous[j] = static_cast<int>(j);
+    for (size_t i = 1; i <= a.size(); i++) {
+        current[0] = static_cast<int>(i);
+        int rowBest = current[0];
+        for (size_t j = 1; j <= b.size(); j++) {
+            int substitute = previous[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            current[j] = min(substitute, min(previous[j], current[j - 1]) + 1);
+            rowBest = min(rowBest, current[j]);
+        }
+        if (rowBest > limit) return limit + 1;
+        swap(previous, current);
+    }
+    return previous[b.size()];
+}
+
+// Caller holds indexMutex
+void ShortcutIndex::rank(const string& wanted, vector<ShortcutMatch>& matches, size_t count) {
+    // Scores by entry; a prefix hit touches only the entries it reaches
+    unordered_map<size_t, pair<int, const char*>> best;
+    auto offer = [&](size_t entry, int score, const char* kind) {
+        auto& slot = best[entry];
+        if (score > slot.first) slot = { score, kind };
+    };
+
+    // Whole-name and word prefixes, from one binary search
+    auto first = lower_bound(keys.begin(), keys.end(), wanted,
+        [](const Key& key, const string& text) { return key.text < text; });
+    size_t examined = 0;
+    bool strong = false;
+    for (auto it = first; it != keys.end() && startsWith(it->text, wanted) && examined < MAX_PREFIX_KEYS; ++it, examined++) {
+        int extra = static_cast<int>(min<size_t>(it->text.size() - wanted.size(), 100));
+        if (it->wholeName) {
+            if (it->text.size() == wanted.size()) offer(it->entry, 1000, "exact");
+            else offer(it->entry, 800 - extra, "prefix");
+        }
+        else {
+            offer(it->entry, 600 - extra, "word prefix");
+        }
+        strong = true;
+    }
+
+    // Only a miss, or a request for suggestions, pays for the scan
+    if (!strong || count > 1) {
+        int limit = wanted.size() >= 8 ? 2 : 1;
+        for (size_t i = 0; i < names.size(); i++) {
+            const string& name = names[i];
+            size_t at = name.find(wanted);
+            if (at != string::npos) {
+                offer(i, 400 - static_cast<int>(min<size_t>(at, 100)), "substring");
+                continue;
+            }
+            if (wanted.size() < 3) continue;
+            int distance = editDistance(name, wanted, limit);
+            if (distance <= limit) offer(i, 300 - 50 * distance, "fuzzy");
+            int subsequence = subsequenceScore(name, wanted);
+            if (subsequence > 0) offer(i, subsequence, "fuzzy");
+        }
+    }
+
+    for (const auto& scored : best) {
+        if (scored.second.first <= 0) continue;
+        ShortcutMatch match;
+        match.entry = entries[scored.first];
+        match.score = scored.second.first;
+        match.kind = scored.second.second;
+        matches.push_back(match);
+    }
+    // Shorter names first on a tie: "word" over "word viewer"
+    auto better = [](const ShortcutMatch& a, const ShortcutMatch& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.entry.name.size() < b.entry.name.size();
+    };
+    count = min(count, matches.size());
+    partial_sort(matches.begin(), matches.begin() + count, matches.end(), better);
+    matches.resize(count);
+}
+
+bool ShortcutIndex::lookup(const string& name, ShortcutMatch& match) {
+    string wanted = normalize(name);
+    if (wanted.empty()) return false;
+
+    lock_guard<mutex> lock(indexMutex);
+    if (stale) rebuild();
+    vector<ShortcutMatch> matches;
+    rank(wanted, matches, 1);
+    // A lone scattered subsequence is too weak to launch anything
+    if (matches.empty() || matches[0].score < 100) return false;
+    match = matches[0];
+    return true;
+}
+
+vector<ShortcutMatch> ShortcutIndex::suggest(const string& name, size_t count) {
+    vector<ShortcutMatch> matches;
+    string wanted = normalize(name);
+    if (wanted.empty()) return matches;
+
+    lock_guard<mutex> lock(indexMutex);
+    if (stale) rebuild();
+    rank(wanted, matches, count);
+    return matches;
+}
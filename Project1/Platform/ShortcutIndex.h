@@ -0,0 +1,56 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// A launchable shortcut: a Start Menu .lnk on Windows, a .desktop entry on Linux
+struct ShortcutEntry {
+    string name;      // As shown to users: "Google Chrome"
+    string path;      // The shortcut file
+    string command;   // What to run, when the shortcut file itself cannot be opened (Linux Exec=)
+};
+
+struct ShortcutMatch {
+    ShortcutEntry entry;
+    int score = 0;
+    const char* kind = "";   // "exact", "prefix", "word prefix", "substring" or "fuzzy"
+};
+
+// Every shortcut name, normalized (lower case, extension dropped, runs of
+// punctuation folded to one space) and kept in a vector sorted by every word
+// suffix, so "chrome" and "google ch" both land on "google chrome" with one
+// binary search. Names that no prefix reaches fall back to a ranked scan for
+// substrings, subsequences and small typos. The scanner fills the index from
+// disk; a directory watcher calls invalidate() and the next lookup rescans.
+class ShortcutIndex {
+public:
+    typedef function<void(vector<ShortcutEntry>&)> Scanner;
+
+    explicit ShortcutIndex(Scanner scanner);
+
+    // Best match for the name, or false when nothing comes close
+    bool lookup(const string& name, ShortcutMatch& match);
+    // Up to count matches, best first, for "did you mean" replies
+    vector<ShortcutMatch> suggest(const string& name, size_t count);
+
+    void invalidate();
+    size_t size();
+
+    static string normalize(const string& name);
+
+private:
+    struct Key {
+        string text;     // Normalized name from one word onwards
+        size_t entry;
+        bool wholeName;  // Starts at the first word
+    };
+
+    Scanner scanner;
+    mutex indexMutex;
+    vector<ShortcutEntry> entries;
+    vector<string> names;    // Normalized, by entry
+    vector<Key> keys;        // Sorted by text
+    bool stale;
+
+    void rebuild();
+    void rank(const string& wanted, vector<ShortcutMatch>& matches, size_t count);
+    static int editDistance(const string& a, const string& b, int limit);
+};
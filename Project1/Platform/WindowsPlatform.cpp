@@ -0,0 +1,191 @@
+#ifdef _WIN32
+#include "../Platform/Platform.h"
+#include "../Functions/RunningApps.h"
+#include "../Functions/ServiceList.h"
+#include "../Functions/FileList.h"
+#include "../Functions/ScreenshotHandler.h"
+#include "../Functions/WebcamCapture.h"
+#include "../Functions/KeyboardTracker.h"
+#include "../Functions/Power.h"
+
+// Adapters from the Platform interfaces onto Functions/
+
+namespace {
+
+class WindowsProcesses : public ProcessBackend {
+public:
+    bool listProcesses(vector<ProcessInfo>& processes) override {
+        processes = RunningApps::getRunningApps();
+        return true;
+    }
+
+    bool writeProcesses(ostream& out) override {
+        return RunningApps::writeAppsToStream(out);
+    }
+
+    bool sampleProcesses(vector<ProcessCounters>& counters) override {
+        return RunningApps::sampleProcesses(counters);
+    }
+
+    void startProcesses(const vector<string>& names, const string& logFileName) override {
+        RunningApps::startAppsFromShortcuts(names, logFileName);
+    }
+
+    void endProcesses(const vector<string>& names, const string& logFileName) override {
+        RunningApps::endSelectedTasks(names, logFileName);
+    }
+
+    void terminateProcesses(const vector<ProcessTarget>& targets, const string& logFileName) override {
+        RunningApps::terminateProcesses(targets, logFileName);
+    }
+};
+
+class WindowsServices : public ServiceBackend {
+public:
+    bool writeServices(ostream& out) override {
+        return services.writeServicesToStream(out);
+    }
+
+    bool enumerateServices(const function<void(const ServiceInfo&)>& visit) override {
+        return services.enumerateServices(visit);
+    }
+
+    bool startServices(const vector<string>& names, const string& logFileName) override {
+        return services.startService(names, logFileName);
+    }
+
+    bool stopServices(const vector<string>& names, const string& logFileName) override {
+        return services.stopService(names, logFileName);
+    }
+
+private:
+    // Holds no state of its own; the SCM connection is the shared ScmSession
+    ServiceList services;
+};
+
+class WindowsFiles : public FileBackend {
+public:
+    bool writeFiles(ostream& out) override {
+        FileList files;
+        return files.writeFilesToStream(out);
+    }
+
+    bool enumerateFiles(const function<void(const FileInfo&)>& visit) override {
+        FileList files;
+        return files.enumerateFiles(visit);
+    }
+
+    WalkStats walkFiles(const WalkOptions& options, const function<void(const FileInfo&)>& visit) override {
+        FileList files;
+        return files.walkFiles(options, visit);
+    }
+
+    vector<pair<string, string>> usualFolders() override {
+        FileList files;
+        return files.usualFolders();
+    }
+
+    char pathSeparator() const override { return '\\'; }
+
+    bool watchFiles(const vector<string>& roots, const function<void(const vector<string>& paths)>& changed,
+        const atomic<bool>& stop) override {
+        FileList files;
+        return files.watchFiles(roots, changed, stop);
+    }
+
+    bool isRegularFile(const string& path) override {
+        DWORD fileAttributes = GetFileAttributesA(path.c_str());
+        return fileAttributes != INVALID_FILE_ATTRIBUTES &&
+            !(fileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+    }
+
+    bool deleteFile(const string& path) override {
+        return DeleteFileA(path.c_str()) != 0;
+    }
+};
+
+class WindowsScreen : public ScreenBackend {
+public:
+    bool captureScreen(const string& path) override {
+        ScreenshotHandler screenshotHandler;
+        return screenshotHandler.captureWindow(path);
+    }
+
+    bool captureWebcam(const string& path) override {
+        WebcamCapture webcamCapture;
+        return webcamCapture.captureImage(path.c_str());
+    }
+
+    TrackingResult trackKeyboard(const string& path, int seconds,
+        const function<void(int)>& progress) override {
+        KeyboardTracker tracker;
+        if (!tracker.StartTracking(path, seconds)) {
+            return TrackingResult::NotStarted;
+        }
+
+        // The low-level hook only fires while this thread pumps messages
+        MSG msg;
+        bool interrupted = false;
+        auto startTime = chrono::system_clock::now();
+
+        while (!interrupted) {
+            auto elapsedSeconds = chrono::duration_cast<chrono::seconds>(
+                chrono::system_clock::now() - startTime).count();
+            progress(static_cast<int>(elapsedSeconds));
+
+            if (elapsedSeconds >= seconds) {
+                cout << "Duration completed" << endl;
+                break;
+            }
+
+            if (!tracker.isTracking) {
+                cout << "Tracking stopped unexpectedly" << endl;
+                interrupted = true;
+                break;
+            }
+
+            while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+                if (msg.message == WM_QUIT) {
+                    interrupted = true;
+                    break;
+                }
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
+
+            if (!interrupted) {
+                ::Sleep(200);
+            }
+        }
+
+        tracker.StopTracking();
+        return interrupted ? TrackingResult::Interrupted : TrackingResult::Completed;
+    }
+};
+
+class WindowsPower : public PowerBackend {
+public:
+    bool execute(const string& action) override {
+        if (action == "Shutdown") return PowerManager::Shutdown(false);
+        if (action == "Restart") return PowerManager::Restart(false);
+        if (action == "Hibernate") return PowerManager::Hibernate();
+        if (action == "Sleep") return PowerManager::Sleep();
+        if (action == "Lock") return PowerManager::Lock();
+        return false;
+    }
+};
+
+}
+
+unique_ptr<Platform> Platform::createNative() {
+    unique_ptr<Platform> platform(new Platform());
+    platform->name = "windows";
+    platform->reportDir = defaultReportDir();
+    platform->processes.reset(new WindowsProcesses());
+    platform->services.reset(new WindowsServices());
+    platform->files.reset(new WindowsFiles());
+    platform->screen.reset(new WindowsScreen());
+    platform->power.reset(new WindowsPower());
+    return platform;
+}
+#endif
@@ -0,0 +1,20 @@
+#include "../Server/ActivityLog.h"
+
+mutex ActivityLog::logMutex;
+
+void ActivityLog::append(const string& logFile, const string& source, const string& activity) {
+    time_t now = time(nullptr);
+    char timeStr[26];
+    ctime_s(timeStr, sizeof(timeStr), &now);
+    // ctime_s ends with a newline
+    string stamp(timeStr);
+    if (!stamp.empty() && stamp.back() == '\n') stamp.pop_back();
+
+    lock_guard<mutex> lock(logMutex);
+    ofstream log(logFile, ios::app);
+    log << stamp << ": ";
+    if (!source.empty()) {
+        log << "[" << source << "] ";
+    }
+    log << activity << endl;
+}
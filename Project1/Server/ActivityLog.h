@@ -0,0 +1,11 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// Process-wide activity log shared by every mailbox's ServerManager
+class ActivityLog {
+public:
+    static void append(const string& logFile, const string& source, const string& activity);
+
+private:
+    static mutex logMutex;
+};
@@ -0,0 +1,202 @@
+#include "../Server/CommandScheduler.h"
+#include "../Server/Metrics.h"
+
+static string classLabel(CommandClass priority) {
+    return MetricsRegistry::label("class", CommandScheduler::className(priority));
+}
+
+CommandClass CommandScheduler::classify(const string& name) {
+    static const set<string> control = {
+        "Shutdown", "Restart", "Sleep", "Lock", "Hibernate", "endProcess"
+    };
+    static const set<string> bulk = {
+        "sendFile", "searchFile", "trackKeyboard", "batch"
+    };
+    if (control.count(name)) return CommandClass::Control;
+    if (bulk.count(name)) return CommandClass::Bulk;
+    return CommandClass::Interactive;
+}
+
+const char* CommandScheduler::className(CommandClass priority) {
+    switch (priority) {
+    case CommandClass::Control: return "control";
+    case CommandClass::Interactive: return "interactive";
+    default: return "bulk";
+    }
+}
+
+CommandScheduler::CommandScheduler(size_t capacity, int agingSeconds)
+    : capacity(max<size_t>(capacity, 1)), agingStep(max(agingSeconds, 1)), queued(0), virtualTime(0), running(false) {
+}
+
+CommandScheduler::~CommandScheduler() {
+    stop();
+}
+
+void CommandScheduler::start(Executor executor) {
+    lock_guard<mutex> lock(queueMutex);
+    if (running) return;
+    this->executor = executor;
+    running = true;
+    lanes.emplace_back(&CommandScheduler::laneLoop, this, true);
+    lanes.emplace_back(&CommandScheduler::laneLoop, this, false);
+}
+
+void CommandScheduler::stop() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (!running) return;
+        running = false;
+    }
+    available.notify_all();
+    for (auto& lane : lanes) {
+        if (lane.joinable()) lane.join();
+    }
+    lanes.clear();
+}
+
+bool CommandScheduler::submit(QueuedCommand item) {
+    CommandClass priority = item.priority;
+    {
+        lock_guard<mutex> lock(queueMutex);
+        auto now = chrono::steady_clock::now();
+        promoteDue(now);
+        bool due = item.notBefore <= now;
+        if (!running || (due && queued >= limitFor(priority))) {
+            Metrics().counter("remotecontrol_commands_rejected_total",
+                "Commands rejected because the queue was saturated", classLabel(priority)).inc();
+            return false;
+        }
+
+        item.enqueuedAt = now;
+        item.enqueuedMicros = Tracer::nowMicros();
+        if (item.notBefore < item.enqueuedAt) {
+            item.notBefore = item.enqueuedAt;
+        }
+
+        // Every command costs one unit; a heavier weight earns a sender more turns
+        double& senderFinish = lastFinish[item.sender];
+        item.finishTag = max(virtualTime, senderFinish) + 1.0 / max(item.weight, 0.01);
+        senderFinish = item.finishTag;
+        senderCommands[item.sender]++;
+        if (due) {
+            queues[static_cast<int>(priority)].push_back(move(item));
+            queued++;
+        }
+        else {
+            auto notBefore = item.notBefore;
+            deferred.emplace(notBefore, move(item));
+        }
+    }
+    Metrics().gauge("remotecontrol_queue_depth", "Commands waiting to run", classLabel(priority)).inc();
+    available.notify_all();
+    return true;
+}
+
+bool CommandScheduler::hasRoom(CommandClass priority, size_t promised) const {
+    lock_guard<mutex> lock(queueMutex);
+    size_t due = distance(deferred.begin(), deferred.upper_bound(chrono::steady_clock::now()));
+    return running && queued + due + promised < limitFor(priority);
+}
+
+size_t CommandScheduler::limitFor(CommandClass priority) const {
+    return capacity + (priority == CommandClass::Control ? CONTROL_RESERVE : 0);
+}
+
+size_t CommandScheduler::depth() const {
+    lock_guard<mutex> lock(queueMutex);
+    return queued + deferred.size();
+}
+
+// Deferred commands join their class queue when due, even past the capacity;
+// the poller holds new mail back until the queue drains again
+void CommandScheduler::promoteDue(chrono::steady_clock::time_point now) {
+    while (!deferred.empty() && deferred.begin()->first <= now) {
+        QueuedCommand& item = deferred.begin()->second;
+        queues[static_cast<int>(item.priority)].push_back(move(item));
+        deferred.erase(deferred.begin());
+        queued++;
+    }
+}
+
+bool CommandScheduler::popNext(bool controlOnly, QueuedCommand& out,
+    chrono::steady_clock::time_point& nextEligible) {
+    // A command's class improves by one per aging step waited. Among equal
+    // ranks the smallest fair-queuing finish tag goes first. Deferred commands
+    // wait for their notBefore time; control commands are never deferred.
+    auto now = chrono::steady_clock::now();
+    promoteDue(now);
+    int bestClass = -1;
+    size_t bestIndex = 0;
+    long long bestRank = 0;
+    nextEligible = (controlOnly || deferred.empty()) ? (chrono::steady_clock::time_point::max)() : deferred.begin()->first;
+
+    for (int cls = 0; cls < (controlOnly ? 1 : CLASS_COUNT); cls++) {
+        for (size_t i = 0; i < queues[cls].size(); i++) {
+            const QueuedCommand& item = queues[cls][i];
+            long long rank = cls - chrono::duration_cast<chrono::seconds>(now - item.enqueuedAt).count() / agingStep.count();
+            if (bestClass >= 0) {
+                const QueuedCommand& best = queues[bestClass][bestIndex];
+                if (rank > bestRank) continue;
+                if (rank == bestRank && (item.finishTag > best.finishTag ||
+                    (item.finishTag == best.finishTag && item.enqueuedAt >= best.enqueuedAt))) {
+                    continue;
+                }
+            }
+            bestClass = cls;
+            bestIndex = i;
+            bestRank = rank;
+        }
+    }
+    if (bestClass < 0) return false;
+
+    out = move(queues[bestClass][bestIndex]);
+    queues[bestClass].erase(queues[bestClass].begin() + bestIndex);
+    queued--;
+    virtualTime = max(virtualTime, out.finishTag);
+
+    // Once a sender has nothing waiting, its last finish tag is at most the
+    // virtual time, so the entry can go
+    auto count = senderCommands.find(out.sender);
+    if (count != senderCommands.end() && --count->second == 0) {
+        senderCommands.erase(count);
+        lastFinish.erase(out.sender);
+    }
+    return true;
+}
+
+void CommandScheduler::laneLoop(bool controlOnly) {
+    while (true) {
+        QueuedCommand item;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            chrono::steady_clock::time_point nextEligible;
+            while (running && !popNext(controlOnly, item, nextEligible)) {
+                if (nextEligible == (chrono::steady_clock::time_point::max)()) {
+                    available.wait(lock);
+                }
+                else {
+                    available.wait_until(lock, nextEligible);
+                }
+            }
+            if (!running) return;
+        }
+
+        string label = classLabel(item.priority);
+        Metrics().gauge("remotecontrol_queue_depth", "Commands waiting to run", label).dec();
+        auto waited = chrono::steady_clock::now() - item.enqueuedAt;
+        Metrics().histogram("remotecontrol_queue_wait_seconds",
+            "Time commands spent queued before running", label).observe(waited);
+        if (item.trace) {
+            item.trace->addSpan({ string("queueWait:") + className(item.priority), item.enqueuedMicros,
+                chrono::duration_cast<chrono::microseconds>(waited).count(), Tracer::threadId() });
+        }
+
+        try {
+            executor(item);
+        }
+        catch (const exception& e) {
+            cerr << "Error running command " << item.name << ": " << e.what() << endl;
+        }
+    }
+}
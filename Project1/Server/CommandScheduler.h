@@ -0,0 +1,82 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Server/Tracing.h"
+
+// Priority classes, served in this order
+enum class CommandClass {
+    Control = 0,      // Power and kill commands; must not wait behind anything
+    Interactive = 1,  // Short inventory and capture commands
+    Bulk = 2          // Uploads and long-running sessions
+};
+
+struct QueuedCommand {
+    Json::Value command;    // Details of the command email
+    string name;
+    CommandClass priority = CommandClass::Interactive;
+    chrono::steady_clock::time_point enqueuedAt;
+    long long enqueuedMicros = 0;   // Wall clock, for the trace
+    shared_ptr<Trace> trace;
+
+    string sender;
+    double weight = 1;              // Sender's fair-queuing weight
+    chrono::steady_clock::time_point notBefore;  // Deferred by the sender's rate limit
+    double finishTag = 0;           // Fair-queuing virtual finish time, set on submit
+};
+
+// Bounded priority queue in front of command execution. A control lane serves
+// only control commands, so a Lock never waits behind a running upload; the
+// general lane serves every class by priority. Waiting commands age one class
+// up per aging step, so bulk work is never starved. Within a class, senders
+// share execution by weighted fair queuing (self-clocked finish tags), so one
+// busy sender cannot push everyone else's commands back. Commands deferred by
+// their sender's rate limit wait outside the capacity until they are due, so
+// a throttled sender cannot fill the queue; the limiter bounds how many each
+// sender can have waiting.
+class CommandScheduler {
+public:
+    typedef function<void(QueuedCommand&)> Executor;
+
+    static const size_t DEFAULT_CAPACITY = 16;
+    static const size_t CONTROL_RESERVE = 4;    // Extra slots only control commands may use
+    static const int DEFAULT_AGING_SECONDS = 30;
+
+    static CommandClass classify(const string& name);
+    static const char* className(CommandClass priority);
+
+    explicit CommandScheduler(size_t capacity = DEFAULT_CAPACITY, int agingSeconds = DEFAULT_AGING_SECONDS);
+    ~CommandScheduler();
+
+    void start(Executor executor);
+    void stop();
+
+    // Returns false when the queue is saturated; the caller sends the rejection
+    bool submit(QueuedCommand item);
+    // Whether a command of this class still fits once the promised ones are
+    // queued; pollers leave mail that would not in the mailbox
+    bool hasRoom(CommandClass priority, size_t promised) const;
+    size_t depth() const;
+    size_t getCapacity() const { return capacity; }
+
+private:
+    static const int CLASS_COUNT = 3;
+
+    size_t capacity;
+    chrono::seconds agingStep;
+    Executor executor;
+
+    deque<QueuedCommand> queues[CLASS_COUNT];
+    size_t queued;                      // In the class queues; deferred ones do not count
+    multimap<chrono::steady_clock::time_point, QueuedCommand> deferred;  // By notBefore
+    double virtualTime;                 // Finish tag of the last command started
+    map<string, double> lastFinish;     // Per sender with commands queued or deferred
+    map<string, size_t> senderCommands; // Queued or deferred, per sender
+    bool running;
+    mutable mutex queueMutex;
+    condition_variable available;
+    vector<thread> lanes;
+
+    size_t limitFor(CommandClass priority) const;
+    void promoteDue(chrono::steady_clock::time_point now);
+    bool popNext(bool controlOnly, QueuedCommand& out, chrono::steady_clock::time_point& nextEligible);
+    void laneLoop(bool controlOnly);
+};
@@ -7,4 +7,6 @@ struct ServerConfig {
     int serverPort;
     int checkInterval;  // milliseconds
     string logFile;
+    string mailboxName;  // Tags log lines and metrics when several mailboxes share a process
+    int snapshotMaxAge;  // seconds an inventory snapshot may be served for
 };
\ No newline at end of file
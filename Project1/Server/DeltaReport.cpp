@@ -0,0 +1,118 @@
+#include "../Server/DeltaReport.h"
+
+namespace {
+
+const double MB = 1024.0 * 1024.0;
+
+string formatAmount(double amount, const string& unit) {
+    ostringstream out;
+    out << fixed << setprecision(1) << amount / MB << " " << unit;
+    return out.str();
+}
+
+}
+
+DeltaRow DeltaRow::from(const ProcessInfo& process) {
+    DeltaRow row;
+    row.key = DeltaStore::hash(to_string(process.processId) + "|" + process.name);
+    row.label = process.name + " (PID " + to_string(process.processId) + ")";
+    // Working sets drift constantly; only a move of 5 MB or 5% is a change
+    row.amount = static_cast<double>(process.memoryUsage);
+    row.tolerance = max(5 * MB, row.amount * 0.05);
+    row.unit = "MB";
+    return row;
+}
+
+DeltaRow DeltaRow::from(const ServiceInfo& service) {
+    DeltaRow row;
+    row.key = DeltaStore::hash(service.name);
+    row.label = service.name;
+    row.state = service.status + ", " + service.startType + ", PID " + to_string(service.processId);
+    return row;
+}
+
+DeltaRow DeltaRow::from(const FileInfo& file) {
+    DeltaRow row;
+    row.key = DeltaStore::hash(file.path);
+    row.label = file.path;
+    row.amount = static_cast<double>(file.sizeBytes);
+    row.unit = "MB";
+    return row;
+}
+
+string DeltaRow::describe() const {
+    string text = label;
+    if (!state.empty()) text += "  " + state;
+    if (!unit.empty()) text += "  " + formatAmount(amount, unit);
+    return text;
+}
+
+void DeltaResult::write(ostream& out) const {
+    for (const auto* row : added) out << "+ " << row->describe() << "\n";
+    for (const auto* row : removed) out << "- " << row->describe() << "\n";
+    for (const auto& change : changed) {
+        const DeltaRow& before = *change.first;
+        const DeltaRow& after = *change.second;
+        out << "~ " << after.label;
+        if (before.state != after.state) out << "  " << before.state << " -> " << after.state;
+        if (before.amount != after.amount && !after.unit.empty()) {
+            out << "  " << formatAmount(before.amount, after.unit) << " -> " << formatAmount(after.amount, after.unit);
+        }
+        out << "\n";
+    }
+}
+
+bool DeltaStore::find(const string& key, Baseline& baseline) {
+    lock_guard<mutex> lock(storeMutex);
+    auto it = baselines.find(key);
+    if (it == baselines.end()) return false;
+    baseline = it->second;
+    return true;
+}
+
+void DeltaStore::remember(const string& key, Baseline baseline) {
+    lock_guard<mutex> lock(storeMutex);
+    baselines[key] = move(baseline);
+    if (baselines.size() > MAX_BASELINES) {
+        auto oldest = baselines.begin();
+        for (auto it = baselines.begin(); it != baselines.end(); ++it) {
+            if (it->second.takenAt < oldest->second.takenAt) oldest = it;
+        }
+        baselines.erase(oldest);
+    }
+}
+
+void DeltaStore::prepare(vector<DeltaRow>& rows) {
+    sort(rows.begin(), rows.end(), [](const DeltaRow& a, const DeltaRow& b) { return a.key < b.key; });
+}
+
+void DeltaStore::diff(const vector<DeltaRow>& before, const vector<DeltaRow>& after, DeltaResult& result) {
+    size_t i = 0, j = 0;
+    while (i < before.size() || j < after.size()) {
+        if (j == after.size() || (i < before.size() && before[i].key < after[j].key)) {
+            result.removed.push_back(&before[i++]);
+        }
+        else if (i == before.size() || after[j].key < before[i].key) {
+            result.added.push_back(&after[j++]);
+        }
+        else {
+            const DeltaRow& old = before[i++];
+            const DeltaRow& now = after[j++];
+            if (old.state != now.state || fabs(now.amount - old.amount) > old.tolerance) {
+                result.changed.push_back({ &old, &now });
+            }
+            else {
+                result.unchanged++;
+            }
+        }
+    }
+}
+
+unsigned long long DeltaStore::hash(const string& identity) {
+    unsigned long long value = 14695981039346656037ULL;
+    for (unsigned char c : identity) {
+        value ^= c;
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../Platform/Platform.h"
+
+// One inventory row reduced to what a delta compares: a hash of the columns
+// that identify it, the text printed for it, and the values that count as a
+// change when they differ
+struct DeltaRow {
+    unsigned long long key = 0;   // FNV-1a of the identity, e.g. "1234|chrome.exe"
+    string label;                 // "chrome.exe (PID 1234)"
+    string state;                 // Compared exactly: "Running, Auto"
+    double amount = 0;            // Compared within tolerance: working set, file size
+    double tolerance = 0;
+    string unit;                  // How amount is printed: "MB"
+
+    static DeltaRow from(const ProcessInfo& process);
+    static DeltaRow from(const ServiceInfo& service);
+    static DeltaRow from(const FileInfo& file);
+    string describe() const;      // Label with its state and amount
+};
+
+struct DeltaResult {
+    vector<const DeltaRow*> added;
+    vector<const DeltaRow*> removed;
+    vector<pair<const DeltaRow*, const DeltaRow*>> changed;   // Before, after
+    size_t unchanged = 0;
+
+    size_t changes() const { return added.size() + removed.size() + changed.size(); }
+    // "+ added", "- removed" and "~ before -> after" lines
+    void write(ostream& out) const;
+};
+
+// The rows last sent to each sender for each command. A baseline is only
+// replaced once the reply carrying it went out, so a failed send never makes
+// the next delta skip changes. Kept in memory; after a restart the first
+// delta is a full resync.
+class DeltaStore {
+public:
+    static const size_t MAX_BASELINES = 256;   // Oldest dropped first
+
+    struct Baseline {
+        vector<DeltaRow> rows;    // Sorted by key
+        time_t takenAt = 0;
+    };
+
+    // False when the key has no baseline
+    bool find(const string& key, Baseline& baseline);
+    void remember(const string& key, Baseline baseline);
+
+    // Sorts rows by key, the order diff and remember expect
+    static void prepare(vector<DeltaRow>& rows);
+    // One merge pass over two key-sorted row sets
+    static void diff(const vector<DeltaRow>& before, const vector<DeltaRow>& after, DeltaResult& result);
+    static unsigned long long hash(const string& identity);
+
+private:
+    mutex storeMutex;
+    map<string, Baseline> baselines;
+};
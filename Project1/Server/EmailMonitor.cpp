@@ -1,6 +1,7 @@
-﻿#include "..\Server\EmailMonitor.h"
-#include "..\Server\ServerManager.h"
-#include "..\GmailAPI\GmailAPI.h"
+﻿#include "../Server/EmailMonitor.h"
+#include "../Server/ServerManager.h"
+#include "../GmailAPI/GmailAPI.h"
+#include "../Server/Tracing.h"
 
 EmailMonitor::EmailMonitor(GmailAPI& api, ServerConfig& cfg, ServerManager& mgr)
     : gmail(api), config(cfg), server(mgr) {
@@ -9,7 +10,12 @@ EmailMonitor::EmailMonitor(GmailAPI& api, ServerConfig& cfg, ServerManager& mgr)
 
 bool EmailMonitor::checkForCommands() {
     try {
-        auto emails = gmail.getEmailNow();
+        // Backpressure: mail the queue has no room for stays in the mailbox for
+        // a later poll, while control commands may still take the reserve
+        size_t promised = 0;
+        auto emails = gmail.getEmailNow([&](const Json::Value& emailData) {
+            return server.admitCommand(emailData["emailDetails"], promised);
+        });
         bool foundCommand = false;
 
         for (const auto& email : emails) {
@@ -37,9 +43,9 @@ bool EmailMonitor::checkForCommands() {
 
                 // Kiểm tra Subject có chứa lệnh hay không
                 if (subject.find("Command") != string::npos) {
-                    server.handleCommand(emailData["emailDetails"]);
+                    shared_ptr<Trace> trace = Tracer::instance().take(emailData["id"].asString());
+                    server.submitCommand(emailData["emailDetails"], trace);
                     foundCommand = true;
-                    break;
                 }
             }
 
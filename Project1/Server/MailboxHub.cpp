@@ -0,0 +1,188 @@
+#include "../Server/MailboxHub.h"
+#include "../Server/ActivityLog.h"
+#include "../Server/Metrics.h"
+#include "../Server/MetricsServer.h"
+
+const char* MailboxHub::CONFIG_FILE = "mailboxes.json";
+const char* MailboxHub::STATS_FILE = "mailbox_stats.txt";
+
+bool MailboxHub::hasConfig(const string& path) {
+    ifstream file(path);
+    return file.is_open();
+}
+
+MailboxHub::MailboxHub(const string& path)
+    : sharedCurl(3), checkInterval(10000), metricsPort(MetricsServer::DEFAULT_PORT), cursor(0), running(false) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        throw runtime_error("Cannot open mailbox config: " + path);
+    }
+
+    Json::Value root;
+    Json::CharReaderBuilder reader;
+    string errors;
+    if (!Json::parseFromStream(reader, file, &root, &errors)) {
+        throw runtime_error("Failed to parse mailbox config: " + errors);
+    }
+    if (!root.isMember("mailboxes") || !root["mailboxes"].isArray() || root["mailboxes"].empty()) {
+        throw runtime_error("Mailbox config has no mailboxes");
+    }
+
+    checkInterval = root.get("checkInterval", 10000).asInt();
+    metricsPort = root.get("metricsPort", MetricsServer::DEFAULT_PORT).asInt();
+    int snapshotMaxAge = root.get("snapshotMaxAge", 60).asInt();
+    ServerManager::configureSnapshots(sharedSnapshots, snapshotMaxAge);
+
+    for (const auto& entry : root["mailboxes"]) {
+        unique_ptr<Mailbox> mailbox(new Mailbox());
+        MailboxConfig& config = mailbox->config;
+        config.name = entry["name"].asString();
+        config.clientSecrets = entry["clientSecrets"].asString();
+        config.tokenStore = entry.get("tokenStore", "token_" + config.name + ".json").asString();
+        config.checkpoint = entry.get("checkpoint", "checkpoint_" + config.name + ".json").asString();
+
+        auto secrets = GmailAPI::ReadClientSecrets(config.clientSecrets);
+        mailbox->api.reset(new GmailAPI(
+            secrets["installed"]["client_id"].asString(),
+            secrets["installed"]["client_secret"].asString(),
+            "http://localhost:8080",
+            sharedCurl, config.tokenStore, config.checkpoint));
+
+        mailbox->server.reset(new ServerManager(*mailbox->api, &sharedSnapshots, config.name));
+        mailbox->server->config.checkInterval = checkInterval;
+        mailbox->server->config.snapshotMaxAge = snapshotMaxAge;
+        mailbox->server->externalPolling = true;
+
+        mailboxes.push_back(move(mailbox));
+    }
+
+    // Polls mostly wait on the network, so a few threads cover many mailboxes
+    int defaultWorkers = min(static_cast<int>(mailboxes.size()), 4);
+    workers.reset(new WorkerPool(root.get("workers", defaultWorkers).asInt()));
+}
+
+MailboxHub::~MailboxHub() {
+    stop();
+    workers->shutdown();
+    sharedSnapshots.stop();
+}
+
+void MailboxHub::activate(size_t index) {
+    Mailbox& mailbox = *mailboxes[index];
+    {
+        // The GUI may activate a mailbox again while the dispatcher runs
+        lock_guard<mutex> lock(stateMutex);
+        mailbox.nextPoll = chrono::steady_clock::now();
+        mailbox.active = true;
+    }
+    ActivityLog::append("server.log", mailbox.config.name, "Mailbox activated");
+    wakeup.notify_all();
+}
+
+void MailboxHub::start() {
+    lock_guard<mutex> lock(stateMutex);
+    if (running) return;
+    running = true;
+    dispatcher = thread(&MailboxHub::dispatchLoop, this);
+}
+
+void MailboxHub::stop() {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        if (!running) return;
+        running = false;
+    }
+    wakeup.notify_all();
+    if (dispatcher.joinable()) {
+        dispatcher.join();
+    }
+}
+
+void MailboxHub::dispatchLoop() {
+    while (true) {
+        auto now = chrono::steady_clock::now();
+        const size_t count = mailboxes.size();
+
+        // Rotate the starting mailbox so no mailbox is always first in line
+        vector<Mailbox*> due;
+        {
+            lock_guard<mutex> lock(stateMutex);
+            for (size_t offset = 0; offset < count; offset++) {
+                Mailbox& mailbox = *mailboxes[(cursor + offset) % count];
+                if (!mailbox.active || mailbox.inFlight || now < mailbox.nextPoll) {
+                    continue;
+                }
+
+                mailbox.inFlight = true;
+                mailbox.nextPoll = now + chrono::milliseconds(checkInterval);
+                due.push_back(&mailbox);
+            }
+        }
+        for (Mailbox* mailbox : due) {
+            workers->submit([this, mailbox] { pollMailbox(*mailbox); });
+        }
+        cursor = (cursor + 1) % count;
+
+        if (now >= nextStatsDump) {
+            dumpStats();
+            nextStatsDump = now + chrono::minutes(1);
+        }
+
+        unique_lock<mutex> lock(stateMutex);
+        wakeup.wait_for(lock, chrono::milliseconds(200), [this] { return !running; });
+        if (!running) return;
+    }
+}
+
+void MailboxHub::pollMailbox(Mailbox& mailbox) {
+    const string label = MetricsRegistry::label("mailbox", mailbox.config.name);
+    auto started = chrono::steady_clock::now();
+    try {
+        if (mailbox.server->processCommands()) {
+            mailbox.stats.commands++;
+            Metrics().counter("remotecontrol_mailbox_commands_total",
+                "Commands handled per mailbox", label).inc();
+        }
+    }
+    catch (const exception& e) {
+        mailbox.stats.pollErrors++;
+        Metrics().counter("remotecontrol_mailbox_poll_errors_total",
+            "Failed polls per mailbox", label).inc();
+        ActivityLog::append(mailbox.server->config.logFile, mailbox.config.name,
+            string("Poll failed: ") + e.what());
+    }
+
+    auto elapsed = chrono::steady_clock::now() - started;
+    long long elapsedMs = chrono::duration_cast<chrono::milliseconds>(elapsed).count();
+    Metrics().histogram("remotecontrol_mailbox_poll_duration_seconds",
+        "Poll and command handling time per mailbox", label).observe(elapsed);
+    mailbox.stats.polls++;
+    mailbox.stats.lastPollMs = elapsedMs;
+    mailbox.stats.totalPollMs += elapsedMs;
+    mailbox.inFlight = false;
+}
+
+void MailboxHub::dumpStats() {
+    ofstream file(STATS_FILE);
+    if (file.is_open()) {
+        writeStats(file);
+    }
+}
+
+void MailboxHub::writeStats(ostream& out) const {
+    out << "=== Mailbox Statistics ===\n";
+    out << "Workers: " << workers->size() << " (busy " << workers->busyWorkers()
+        << ", queued " << workers->queueDepth() << ")\n\n";
+
+    for (const auto& mailbox : mailboxes) {
+        long long polls = mailbox->stats.polls;
+        out << "Mailbox: " << mailbox->config.name << "\n";
+        out << "Active: " << (mailbox->active ? "yes" : "no") << "\n";
+        out << "Polls: " << polls << "\n";
+        out << "Commands: " << mailbox->stats.commands << "\n";
+        out << "Poll errors: " << mailbox->stats.pollErrors << "\n";
+        out << "Last poll: " << mailbox->stats.lastPollMs << " ms\n";
+        out << "Average poll: " << (polls ? mailbox->stats.totalPollMs / polls : 0) << " ms\n";
+        out << "------------------\n";
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "../Libs/Header.h"
+#include "../GmailAPI/GmailAPI.h"
+#include "../Server/ServerManager.h"
+#include "../Server/WorkerPool.h"
+
+struct MailboxConfig {
+    string name;
+    string clientSecrets;   // Path to the OAuth client secrets file
+    string tokenStore;      // Per-mailbox token file
+    string checkpoint;      // Per-mailbox sync checkpoint file
+};
+
+struct MailboxStats {
+    atomic<long long> polls{ 0 };
+    atomic<long long> commands{ 0 };
+    atomic<long long> pollErrors{ 0 };
+    atomic<long long> lastPollMs{ 0 };
+    atomic<long long> totalPollMs{ 0 };
+};
+
+struct Mailbox {
+    MailboxConfig config;
+    unique_ptr<GmailAPI> api;
+    unique_ptr<ServerManager> server;
+    MailboxStats stats;
+    atomic<bool> active{ false };    // Has tokens and is being polled
+    atomic<bool> inFlight{ false };  // A poll for this mailbox is queued or running
+    chrono::steady_clock::time_point nextPoll;  // Guarded by the hub's stateMutex
+};
+
+// Runs several control mailboxes in one process. Mailboxes keep their own tokens
+// and checkpoints but share the curl connection pool, inventory snapshots, worker
+// threads and server.log. Polls are dispatched round-robin with at most one in
+// flight per mailbox, so a slow mailbox cannot starve the others.
+class MailboxHub {
+public:
+    static const char* CONFIG_FILE;
+    static const char* STATS_FILE;
+
+    static bool hasConfig(const string& path = CONFIG_FILE);
+    explicit MailboxHub(const string& path = CONFIG_FILE);
+    ~MailboxHub();
+
+    size_t size() const { return mailboxes.size(); }
+    int getMetricsPort() const { return metricsPort; }
+    Mailbox& at(size_t index) { return *mailboxes[index]; }
+
+    // Starts polling a mailbox once it holds valid tokens
+    void activate(size_t index);
+    void start();
+    void stop();
+
+    void writeStats(ostream& out) const;
+
+private:
+    MyCurlWrapper sharedCurl;
+    SnapshotCache sharedSnapshots;
+    unique_ptr<WorkerPool> workers;
+    vector<unique_ptr<Mailbox>> mailboxes;
+    int checkInterval;      // milliseconds between polls of one mailbox
+    int metricsPort;
+    size_t cursor;          // Mailbox that goes first in the next dispatch round
+    chrono::steady_clock::time_point nextStatsDump;
+
+    bool running;
+    mutex stateMutex;
+    condition_variable wakeup;
+    thread dispatcher;
+
+    void dispatchLoop();
+    void pollMailbox(Mailbox& mailbox);
+    void dumpStats();
+};
@@ -0,0 +1,138 @@
+#include "../Server/Metrics.h"
+
+const double Histogram::BUCKET_BOUNDS[Histogram::BUCKET_COUNT] = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120
+};
+
+void Histogram::observe(double seconds) {
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT && seconds > BUCKET_BOUNDS[bucket]) {
+        bucket++;
+    }
+    buckets[bucket].fetch_add(1, memory_order_relaxed);
+    total.fetch_add(1, memory_order_relaxed);
+    sumMicros.fetch_add(static_cast<long long>(seconds * 1e6), memory_order_relaxed);
+}
+
+void Histogram::observe(chrono::steady_clock::duration elapsed) {
+    observe(chrono::duration<double>(elapsed).count());
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const string& name, const string& help, Type type) {
+    auto it = families.find(name);
+    if (it == families.end()) {
+        Family& created = families[name];
+        created.type = type;
+        created.help = help;
+        return created;
+    }
+    if (it->second.type != type) {
+        throw logic_error("Metric registered with two types: " + name);
+    }
+    return it->second;
+}
+
+Counter& MetricsRegistry::counter(const string& name, const string& help, const string& labels) {
+    lock_guard<mutex> lock(registryMutex);
+    auto& cells = family(name, help, Type::CounterType).counters;
+    auto& cell = cells[labels];
+    if (!cell) cell.reset(new Counter());
+    return *cell;
+}
+
+Gauge& MetricsRegistry::gauge(const string& name, const string& help, const string& labels) {
+    lock_guard<mutex> lock(registryMutex);
+    auto& cells = family(name, help, Type::GaugeType).gauges;
+    auto& cell = cells[labels];
+    if (!cell) cell.reset(new Gauge());
+    return *cell;
+}
+
+Histogram& MetricsRegistry::histogram(const string& name, const string& help, const string& labels) {
+    lock_guard<mutex> lock(registryMutex);
+    auto& cells = family(name, help, Type::HistogramType).histograms;
+    auto& cell = cells[labels];
+    if (!cell) cell.reset(new Histogram());
+    return *cell;
+}
+
+void MetricsRegistry::addCollector(Collector collector) {
+    lock_guard<mutex> lock(registryMutex);
+    collectors.push_back(collector);
+}
+
+string MetricsRegistry::label(const string& key, const string& value) {
+    string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return key + "=\"" + escaped + "\"";
+}
+
+string MetricsRegistry::series(const string& name, const string& labels, const string& extraLabel) {
+    string all = labels;
+    if (!extraLabel.empty()) {
+        all += (all.empty() ? "" : ",") + extraLabel;
+    }
+    return all.empty() ? name : name + "{" + all + "}";
+}
+
+void MetricsRegistry::writePrometheus(ostream& out) const {
+    lock_guard<mutex> lock(registryMutex);
+
+    for (const auto& entry : families) {
+        const string& name = entry.first;
+        const Family& family = entry.second;
+
+        out << "# HELP " << name << " " << family.help << "\n";
+        switch (family.type) {
+        case Type::CounterType:
+            out << "# TYPE " << name << " counter\n";
+            for (const auto& cell : family.counters) {
+                out << series(name, cell.first) << " " << cell.second->get() << "\n";
+            }
+            break;
+
+        case Type::GaugeType:
+            out << "# TYPE " << name << " gauge\n";
+            for (const auto& cell : family.gauges) {
+                out << series(name, cell.first) << " " << cell.second->get() << "\n";
+            }
+            break;
+
+        case Type::HistogramType:
+            out << "# TYPE " << name << " histogram\n";
+            for (const auto& cell : family.histograms) {
+                const Histogram& histogram = *cell.second;
+                long long cumulative = 0;
+                for (int i = 0; i < Histogram::BUCKET_COUNT; i++) {
+                    cumulative += histogram.bucketCount(i);
+                    ostringstream bound;
+                    bound << Histogram::BUCKET_BOUNDS[i];
+                    out << series(name + "_bucket", cell.first, label("le", bound.str()))
+                        << " " << cumulative << "\n";
+                }
+                cumulative += histogram.bucketCount(Histogram::BUCKET_COUNT);
+                out << series(name + "_bucket", cell.first, "le=\"+Inf\"") << " " << cumulative << "\n";
+                out << series(name + "_sum", cell.first) << " " << histogram.sumSeconds() << "\n";
+                out << series(name + "_count", cell.first) << " " << histogram.count() << "\n";
+            }
+            break;
+        }
+    }
+
+    for (const auto& collector : collectors) {
+        collector(out);
+    }
+}
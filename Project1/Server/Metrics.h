@@ -0,0 +1,99 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// Lock-free metric cells. Lookups go through MetricsRegistry, but updates on the
+// hot paths are single atomic operations on a cell the caller already holds.
+class Counter {
+public:
+    void inc(long long amount = 1) { value.fetch_add(amount, memory_order_relaxed); }
+    long long get() const { return value.load(memory_order_relaxed); }
+
+private:
+    atomic<long long> value{ 0 };
+};
+
+class Gauge {
+public:
+    void set(long long newValue) { value.store(newValue, memory_order_relaxed); }
+    void inc(long long amount = 1) { value.fetch_add(amount, memory_order_relaxed); }
+    void dec(long long amount = 1) { value.fetch_sub(amount, memory_order_relaxed); }
+    long long get() const { return value.load(memory_order_relaxed); }
+
+private:
+    atomic<long long> value{ 0 };
+};
+
+// Latency histogram with fixed bucket bounds in seconds
+class Histogram {
+public:
+    static const int BUCKET_COUNT = 14;
+    static const double BUCKET_BOUNDS[BUCKET_COUNT];
+
+    void observe(double seconds);
+    void observe(chrono::steady_clock::duration elapsed);
+
+    long long bucketCount(int bucket) const { return buckets[bucket].load(memory_order_relaxed); }
+    long long count() const { return total.load(memory_order_relaxed); }
+    double sumSeconds() const { return sumMicros.load(memory_order_relaxed) / 1e6; }
+
+private:
+    atomic<long long> buckets[BUCKET_COUNT + 1] = {};  // Last bucket is +Inf
+    atomic<long long> total{ 0 };
+    atomic<long long> sumMicros{ 0 };
+};
+
+// Measures the lifetime of a scope into a histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram(histogram), started(chrono::steady_clock::now()) {}
+    ~ScopedTimer() { histogram.observe(chrono::steady_clock::now() - started); }
+
+private:
+    Histogram& histogram;
+    chrono::steady_clock::time_point started;
+};
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // Returns the cell for name{labels}, creating it on first use. Cells are never
+    // freed, so callers may keep the reference for the lifetime of the process.
+    Counter& counter(const string& name, const string& help, const string& labels = "");
+    Gauge& gauge(const string& name, const string& help, const string& labels = "");
+    Histogram& histogram(const string& name, const string& help, const string& labels = "");
+
+    // Collectors append families computed at scrape time, such as rolling summaries
+    typedef function<void(ostream&)> Collector;
+    void addCollector(Collector collector);
+
+    // Builds a label pair such as command="listProcess" with the value escaped
+    static string label(const string& key, const string& value);
+
+    // Prometheus text exposition format 0.0.4
+    void writePrometheus(ostream& out) const;
+
+private:
+    enum class Type { CounterType, GaugeType, HistogramType };
+
+    struct Family {
+        Type type;
+        string help;
+        map<string, unique_ptr<Counter>> counters;
+        map<string, unique_ptr<Gauge>> gauges;
+        map<string, unique_ptr<Histogram>> histograms;
+    };
+
+    mutable mutex registryMutex;
+    map<string, Family> families;
+    vector<Collector> collectors;
+
+    Family& family(const string& name, const string& help, Type type);
+    static string series(const string& name, const string& labels, const string& extraLabel = "");
+};
+
+// Shorthand for the process-wide registry
+inline MetricsRegistry& Metrics() {
+    return MetricsRegistry::instance();
+}
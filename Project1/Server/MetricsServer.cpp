@@ -0,0 +1,115 @@
+#include "../Server/MetricsServer.h"
+#include "../Server/Metrics.h"
+
+MetricsServer::MetricsServer(int port)
+    : port(port), listenSocket(INVALID_SOCKET), running(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start() {
+    if (running) return true;
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        cerr << "Metrics: failed to initialize WinSock" << endl;
+        return false;
+    }
+
+    listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        cerr << "Metrics: failed to create socket" << endl;
+        WSACleanup();
+        return false;
+    }
+
+#ifndef _WIN32
+    // Rebinding right after a restart would otherwise wait out TIME_WAIT
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+    // Loopback only: the endpoint exposes server internals
+    sockaddr_in serverAddr = {};
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(static_cast<u_short>(port));
+    inet_pton(AF_INET, "127.0.0.1", &serverAddr.sin_addr);
+
+    if (bind(listenSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR ||
+        listen(listenSocket, SOMAXCONN) == SOCKET_ERROR) {
+        cerr << "Metrics: failed to listen on port " << port << endl;
+        closesocket(listenSocket);
+        listenSocket = INVALID_SOCKET;
+        WSACleanup();
+        return false;
+    }
+
+    running = true;
+    acceptThread = thread(&MetricsServer::acceptLoop, this);
+    cout << "Metrics available at http://127.0.0.1:" << port << "/metrics" << endl;
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running.exchange(false)) return;
+
+    // Shutting the socket down unblocks the accept loop
+    shutdown(listenSocket, SD_BOTH);
+    closesocket(listenSocket);
+    listenSocket = INVALID_SOCKET;
+    if (acceptThread.joinable()) {
+        acceptThread.join();
+    }
+    WSACleanup();
+}
+
+void MetricsServer::acceptLoop() {
+    while (running) {
+        SOCKET clientSocket = accept(listenSocket, NULL, NULL);
+        if (clientSocket == INVALID_SOCKET) {
+            if (!running) break;
+            continue;
+        }
+        serveClient(clientSocket);
+        closesocket(clientSocket);
+    }
+}
+
+void MetricsServer::serveClient(SOCKET clientSocket) {
+    // Scrapers send small requests; the first read holds the request line
+    char buffer[2048] = { 0 };
+    int received = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+    if (received <= 0) return;
+
+    string request(buffer, received);
+    string status = "200 OK";
+    string contentType = "text/plain; version=0.0.4; charset=utf-8";
+    string body;
+
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+        ostringstream out;
+        MetricsRegistry::instance().writePrometheus(out);
+        body = out.str();
+    }
+    else {
+        status = "404 Not Found";
+        contentType = "text/plain";
+        body = "Not found\n";
+    }
+
+    string response =
+        "HTTP/1.1 " + status + "\r\n"
+        "Content-Type: " + contentType + "\r\n"
+        "Content-Length: " + to_string(body.size()) + "\r\n"
+        "Connection: close\r\n"
+        "\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        int result = send(clientSocket, response.c_str() + sent, static_cast<int>(response.size() - sent), 0);
+        if (result == SOCKET_ERROR) break;
+        sent += result;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// Serves MetricsRegistry in Prometheus text format on 127.0.0.1 only
+class MetricsServer {
+public:
+    static const int DEFAULT_PORT = 9464;
+
+    explicit MetricsServer(int port = DEFAULT_PORT);
+    ~MetricsServer();
+
+    bool start();
+    void stop();
+    int getPort() const { return port; }
+
+private:
+    int port;
+    SOCKET listenSocket;
+    atomic<bool> running;
+    thread acceptThread;
+
+    void acceptLoop();
+    void serveClient(SOCKET clientSocket);
+};
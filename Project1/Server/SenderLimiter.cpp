@@ -0,0 +1,78 @@
+#include "../Server/SenderLimiter.h"
+
+const char* SenderLimiter::CONFIG_FILE = "sender_limits.json";
+
+SenderPolicy SenderLimiter::parsePolicy(const Json::Value& value, const SenderPolicy& base) {
+    SenderPolicy policy = base;
+    policy.ratePerMinute = max(value.get("ratePerMinute", base.ratePerMinute).asDouble(), 0.01);
+    policy.burst = max(value.get("burst", base.burst).asDouble(), 1.0);
+    policy.weight = max(value.get("weight", base.weight).asDouble(), 0.01);
+    return policy;
+}
+
+void SenderLimiter::load(const string& path) {
+    ifstream file(path);
+    if (!file.is_open()) return;  // Defaults apply to everyone
+
+    Json::Value root;
+    Json::CharReaderBuilder reader;
+    string errors;
+    if (!Json::parseFromStream(reader, file, &root, &errors)) {
+        cerr << "Failed to parse sender limits: " << errors << endl;
+        return;
+    }
+
+    lock_guard<mutex> lock(limiterMutex);
+    defaults = parsePolicy(root["default"], SenderPolicy());
+    overrides.clear();
+    const Json::Value& senders = root["senders"];
+    for (const auto& sender : senders.getMemberNames()) {
+        overrides[sender] = parsePolicy(senders[sender], defaults);
+    }
+    buckets.clear();
+}
+
+SenderPolicy SenderLimiter::policyFor(const string& sender) const {
+    lock_guard<mutex> lock(limiterMutex);
+    auto it = overrides.find(sender);
+    return it == overrides.end() ? defaults : it->second;
+}
+
+SenderLimiter::Bucket& SenderLimiter::refill(const string& sender, const SenderPolicy& policy,
+    chrono::steady_clock::time_point now) {
+    auto it = buckets.find(sender);
+    if (it == buckets.end()) {
+        Bucket& created = buckets[sender];
+        created.tokens = policy.burst;
+        created.updated = now;
+        return created;
+    }
+
+    Bucket& bucket = it->second;
+    double elapsed = chrono::duration<double>(now - bucket.updated).count();
+    bucket.tokens = min(policy.burst, bucket.tokens + elapsed * policy.ratePerMinute / 60.0);
+    bucket.updated = now;
+    return bucket;
+}
+
+double SenderLimiter::reserve(const string& sender) {
+    lock_guard<mutex> lock(limiterMutex);
+    auto it = overrides.find(sender);
+    const SenderPolicy& policy = it == overrides.end() ? defaults : it->second;
+
+    Bucket& bucket = refill(sender, policy, chrono::steady_clock::now());
+    double wait = bucket.tokens >= 1 ? 0 : (1 - bucket.tokens) * 60.0 / policy.ratePerMinute;
+    if (wait > MAX_DEFERRAL_SECONDS) {
+        return -1;
+    }
+    bucket.tokens -= 1;
+    return wait;
+}
+
+void SenderLimiter::release(const string& sender) {
+    lock_guard<mutex> lock(limiterMutex);
+    auto it = buckets.find(sender);
+    if (it != buckets.end()) {
+        it->second.tokens += 1;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../Libs/Header.h"
+
+struct SenderPolicy {
+    double ratePerMinute = 6;  // Sustained commands per minute
+    double burst = 5;          // Commands that may arrive back to back
+    double weight = 1;         // Share of the execution queue against other senders
+};
+
+// Per-sender token buckets. A command that finds the bucket empty reserves a
+// future token, so throttled commands are deferred and spaced at the sender's
+// rate instead of being dropped, up to MAX_DEFERRAL_SECONDS.
+class SenderLimiter {
+public:
+    static const char* CONFIG_FILE;
+    static const int MAX_DEFERRAL_SECONDS = 300;
+
+    // Optional sender_limits.json: {"default": {...}, "senders": {"a@b.c": {...}}}
+    void load(const string& path = CONFIG_FILE);
+
+    SenderPolicy policyFor(const string& sender) const;
+
+    // Takes one token. Returns the seconds until it is available (0 when it is
+    // available now), or -1 if that is past MAX_DEFERRAL_SECONDS and nothing was taken.
+    double reserve(const string& sender);
+
+    // Returns a reserved token when the command could not be queued after all
+    void release(const string& sender);
+
+private:
+    struct Bucket {
+        double tokens;
+        chrono::steady_clock::time_point updated;
+    };
+
+    SenderPolicy defaults;
+    map<string, SenderPolicy> overrides;
+    map<string, Bucket> buckets;
+    mutable mutex limiterMutex;
+
+    static SenderPolicy parsePolicy(const Json::Value& value, const SenderPolicy& base);
+    Bucket& refill(const string& sender, const SenderPolicy& policy, chrono::steady_clock::time_point now);
+};
@@ -1,14 +1,19 @@
-﻿#include "..\Server\ServerManager.h"
-#include "..\Functions\RunningApps.h"
-#include "..\Functions\WebcamCapture.h"
-#include "..\Functions\KeyboardTracker.h"
-#include "..\Functions\ScreenshotHandler.h"
-#include "..\Functions\ServiceList.h"
-#include "..\Functions\FileList.h"
-#include "..\Functions\Power.h"
-
-ServerManager::ServerManager(GmailAPI& api)
-    : gmail(api), monitor(api, config, *this), running(false) {
+﻿#include "../Server/ServerManager.h"
+#include "../Server/ActivityLog.h"
+#include "../Server/Metrics.h"
+#include "../Server/Tracing.h"
+#include "../Server/ZipArchive.h"
+#include "../Platform/FileIndex.h"
+#include "../Platform/ContentSearch.h"
+
+// Handlers report into the command they are running: a lane's own record while
+// the scheduler runs it, the shared currentCommand otherwise
+static thread_local CommandStatus* workingCommand = nullptr;
+// Set while a batch runs its steps on this thread; the other lane's replies still go out
+static thread_local vector<CollectedReply>* replyCollector = nullptr;
+
+ServerManager::ServerManager(GmailAPI& api, SnapshotCache* sharedSnapshots, const string& mailboxName, Platform* host)
+    : snapshots(sharedSnapshots), platform(host ? *host : Platform::native()), sampler(*platform.processes), gmail(api), monitor(api, config, *this), running(false), externalPolling(false) {
     // Initialize config
     char hostname[256];
     gethostname(hostname, sizeof(hostname));
@@ -23,6 +28,38 @@ ServerManager::ServerManager(GmailAPI& api)
     }
     config.checkInterval = 10000; // 10 seconds
     config.logFile = "server.log";
+    config.snapshotMaxAge = 60; // 1 minute
+    config.mailboxName = mailboxName;
+
+    if (!snapshots) {
+        ownedSnapshots.reset(new SnapshotCache());
+        snapshots = ownedSnapshots.get();
+        configureSnapshots(*snapshots, config.snapshotMaxAge, platform);
+    }
+
+    senderLimits.load();
+    scheduler.reset(new CommandScheduler());
+    scheduler->start([this](QueuedCommand& item) { executeQueued(item); });
+}
+
+ServerManager::~ServerManager() {
+    scheduler->stop();
+    if (ownedSnapshots) ownedSnapshots->stop();
+}
+
+void ServerManager::configureSnapshots(SnapshotCache& cache, int maxAgeSeconds, Platform& platform) {
+    // Keep the read-only inventories warm in the background
+    Platform* host = &platform;
+    cache.registerProducer(SnapshotKind::Processes, [host](ostream& out) {
+        return host->processes->writeProcesses(out);
+    });
+    cache.registerProducer(SnapshotKind::Services, [host](ostream& out) {
+        return host->services->writeServices(out);
+    });
+    cache.registerProducer(SnapshotKind::Files, [host](ostream& out) {
+        return host->files->writeFiles(out);
+    });
+    cache.start(maxAgeSeconds);
 }
 
 string ServerManager::getServerName() {
@@ -34,7 +71,7 @@ void ServerManager::start() {
     logActivity("Server started");
     while (running) {
         processCommands();
-        Sleep(config.checkInterval);
+        this_thread::sleep_for(chrono::milliseconds(config.checkInterval));
     }
 }
 
@@ -43,23 +80,164 @@ void ServerManager::stop() {
     logActivity("Server stopped");
 }
 
-void ServerManager::processCommands() {
+bool ServerManager::processCommands() {
+    lock_guard<mutex> lock(commandMutex);
     if (monitor.checkForCommands()) {
         //logActivity("Processing commands");
+        return true;
     }
     else {
         this->currentCommand.content = "";
         this->currentCommand.from = "";
         this->currentCommand.message = "";
+        return false;
+    }
+}
+
+CommandStatus& ServerManager::activeCommand() {
+    return workingCommand ? *workingCommand : this->currentCommand;
+}
+
+
+// A batch is scheduled at the class of its heaviest step, but never as
+// control: that would skip the sender's rate limit and take the reserve
+static CommandClass commandClassFor(const string& name, const Json::Value& command) {
+    if (name != "batch") return CommandScheduler::classify(name);
+
+    CommandClass heaviest = CommandClass::Interactive;
+    stringstream script(command["Content"].asString());
+    string line;
+    while (getline(script, line, ';')) {
+        istringstream words(line);
+        string step;
+        if (words >> step) {
+            heaviest = max(heaviest, step == "batch" ? CommandClass::Bulk : CommandScheduler::classify(step));
+        }
+    }
+    return heaviest;
+}
+
+// The name after "Command::" in the subject, empty when there is none; a
+// subject ending in "Command" or "Command:" has none either
+static string commandNameFor(const Json::Value& command) {
+    string subject = command["Subject"].asString();
+    size_t marker = subject.find("Command");
+    return marker == string::npos || marker + 9 > subject.size() ? "" : subject.substr(marker + 9);
+}
+
+bool ServerManager::admitCommand(const Json::Value& command, size_t& promised) {
+    // Access requests and refusals are answered inline and need no slot
+    string name = commandNameFor(command);
+    if (name.empty() || name == "requestAccess" || !isEmailApproved(command["From"].asString())) {
+        return true;
+    }
+    if (!scheduler->hasRoom(commandClassFor(name, command), promised)) {
+        return false;
+    }
+    promised++;
+    return true;
+}
+
+bool ServerManager::submitCommand(const Json::Value& command, const shared_ptr<Trace>& trace) {
+    string name = commandNameFor(command);
+    string fromEmail = command["From"].asString();
+
+    // Access requests and refusals are answered inline; the monitor window
+    // picks access requests up from currentCommand
+    if (name.empty() || name == "requestAccess" || !isEmailApproved(fromEmail)) {
+        {
+            TraceScope traceScope(trace);
+            Span dispatchSpan("dispatch");
+            handleCommand(command);
+        }
+        Tracer::instance().finish(trace);
+        return true;
+    }
+
+    QueuedCommand item;
+    item.command = command;
+    item.name = name;
+    item.priority = commandClassFor(name, command);
+    item.trace = trace;
+
+    // Per-sender rate limit; control commands must never wait, so they bypass it
+    const string senderLabel = MetricsRegistry::label("sender", fromEmail);
+    SenderPolicy policy = senderLimits.policyFor(fromEmail);
+    string limitText = to_string(static_cast<int>(policy.ratePerMinute)) + " commands per minute (burst " +
+        to_string(static_cast<int>(policy.burst)) + ")";
+    double deferSeconds = 0;
+    if (item.priority != CommandClass::Control) {
+        deferSeconds = senderLimits.reserve(fromEmail);
+        if (deferSeconds < 0) {
+            Metrics().counter("remotecontrol_sender_throttled_total", "Commands throttled per sender",
+                senderLabel + "," + MetricsRegistry::label("outcome", "rejected")).inc();
+            gmail.sendSimpleEmail(fromEmail, "Rate Limited",
+                "Command::" + name + " was not run. You are limited to " + limitText +
+                " and your next slot is more than " + to_string(SenderLimiter::MAX_DEFERRAL_SECONDS / 60) +
+                " minutes away. Please send it again later.");
+            logActivity("Rate limited " + name + " from " + fromEmail);
+            Tracer::instance().finish(trace);
+            return false;
+        }
+    }
+    item.sender = fromEmail;
+    item.weight = policy.weight;
+    item.notBefore = chrono::steady_clock::now() + chrono::milliseconds(static_cast<long long>(deferSeconds * 1000));
+
+    if (!scheduler->submit(item)) {
+        senderLimits.release(fromEmail);
+        // Saturated: tell the sender rather than silently dropping the command
+        gmail.sendSimpleEmail(fromEmail, "Server Busy",
+            "Command::" + name + " was not run because " + to_string(scheduler->depth()) +
+            " commands are already queued. Please send it again later.");
+        logActivity("Rejected " + name + " from " + fromEmail + ": command queue is full");
+        Tracer::instance().finish(trace);
+        return false;
+    }
+    Metrics().counter("remotecontrol_sender_commands_total", "Commands accepted per sender", senderLabel).inc();
+
+    if (deferSeconds > 0) {
+        Metrics().counter("remotecontrol_sender_throttled_total", "Commands throttled per sender",
+            senderLabel + "," + MetricsRegistry::label("outcome", "deferred")).inc();
+        gmail.sendSimpleEmail(fromEmail, "Command Deferred",
+            "Command::" + name + " is queued and will run in about " +
+            to_string(static_cast<int>(ceil(deferSeconds))) + " seconds. You are limited to " + limitText + ".");
+    }
+
+    if (this->currentCommand.content != "requestAccess") {
+        this->currentCommand.content = name;
+        this->currentCommand.from = fromEmail;
+        this->currentCommand.message = string("Queued as ") + CommandScheduler::className(item.priority);
+    }
+    return true;
+}
+
+void ServerManager::executeQueued(QueuedCommand& item) {
+    CommandStatus working;
+    working.content = item.name;
+    working.from = item.command["From"].asString();
+
+    workingCommand = &working;
+    {
+        // Execution time per sender shows who is consuming the machine
+        ScopedTimer senderTimer(Metrics().histogram("remotecontrol_sender_execution_seconds",
+            "Command execution time per sender", MetricsRegistry::label("sender", item.sender)));
+        TraceScope traceScope(item.trace);
+        Span dispatchSpan("dispatch");
+        runCommand(item.name, item.command);
+    }
+    workingCommand = nullptr;
+    Tracer::instance().finish(item.trace);
+
+    // Publish the outcome for the monitor window
+    lock_guard<mutex> lock(commandMutex);
+    if (this->currentCommand.content != "requestAccess") {
+        this->currentCommand = working;
     }
 }
 
 void ServerManager::logActivity(const string& activity) {
-    ofstream log(config.logFile, ios::app);
-    time_t now = time(nullptr);
-    char timeStr[26];
-    ctime_s(timeStr, sizeof(timeStr), &now);
-    log << timeStr << ": " << activity << endl;
+    ActivityLog::append(config.logFile, config.mailboxName, activity);
 }
 
 void ServerManager::handleCommand(const Json::Value& command) {
@@ -70,16 +248,16 @@ void ServerManager::handleCommand(const Json::Value& command) {
     string subject = command["Subject"].asString();
     if (subject.find("Command") != string::npos) {
         // Xử lý lệnh
-        this->currentCommand.content = subject.substr(subject.find("Command") + 9);
+        activeCommand().content = commandNameFor(command);
 
         string subject = command["Subject"].asString();
         string fromEmail = command["From"].asString();
-        this->currentCommand.from = fromEmail;
+        activeCommand().from = fromEmail;
 
 
         // Xử lý request access trước
-        if (this->currentCommand.content == "requestAccess") {
-            this->currentCommand.from = fromEmail;
+        if (activeCommand().content == "requestAccess") {
+            activeCommand().from = fromEmail;
             return;
         }
 
@@ -87,79 +265,123 @@ void ServerManager::handleCommand(const Json::Value& command) {
         if (!isEmailApproved(fromEmail)) {
             gmail.sendSimpleEmail(fromEmail, "Access Denied",
                 "You need to request access first.");
-            this->currentCommand.message = "Access denied. Request access first.";
+            activeCommand().message = "Access denied. Request access first.";
 
             return;
         }
 
-        else if (this->currentCommand.content == "listProcess") {
-            handleProcessListCommand(command);
-            return;
-        }
-        else if (this->currentCommand.content == "startProcess") {
-            handleStartProcess(command);
-            return;
-        }
-        else if (this->currentCommand.content == "endProcess") {
-            handleEndProcess(command);
-            return;
-        }
-        else if (this->currentCommand.content == "readRecentEmails") {
-            handleReadRecentEmailsCommand(command);
-            return;
-        }
-        else if (this->currentCommand.content == "captureScreen") {
-            handleCaptureScreen(command);
-            return;
-        }
-        else if (this->currentCommand.content == "captureWebcam") {
-            handleCaptureWebcam(command);
-            return;
-        }
-        else if (this->currentCommand.content == "trackKeyboard") {
-            handleTrackKeyboard(command); // Default 5 seconds
-            return;
-        }
-        else if (this->currentCommand.content == "listService") {
-            handleListService(command);
-            return;
-        }
-        else if (this->currentCommand.content == "startService") {
-            handleStartService(command);
-            return;
-        }
-        else if (this->currentCommand.content == "endService") {
-			handleEndService(command);
-            return;
-        }
-        else if (this->currentCommand.content == "listFile") {
-            handleListFile(command);
-            return;
-        }
-		else if (this->currentCommand.content == "sendFile") {
-			handleSendFile(command);
-			return;
-		}
-        else if (this->currentCommand.content == "deleteFile") {
-			handleDeleteFile(command);
-            return;
-        }
-        else if (this->currentCommand.content == "Shutdown" || this->currentCommand.content == "Restart" || this->currentCommand.content == "Sleep" || this->currentCommand.content == "Lock" || this->currentCommand.content == "Hibernate") {
-            handlePowerCommand(command);
-            return;
-        }
-        else {
-            // Handle unknown command
-            response["message"] = "Unknown command";
-            this->currentCommand.message = "Unknown command";
-        }
+        string name = activeCommand().content;
+        runCommand(name, command);
     }
     else {
         response["message"] = "Invalid command format";
-        this->currentCommand.message = "Invalid command format";
+        activeCommand().message = "Invalid command format";
     }
 }
 
+// Metric labels and trace stages take only known names, since the rest come
+// straight from mail and would grow them without bound
+static bool isKnownCommand(const string& name) {
+    static const set<string> knownCommands = {
+        "listProcess", "startProcess", "endProcess", "readRecentEmails", "captureScreen",
+        "captureWebcam", "trackKeyboard", "listService", "startService", "endService",
+        "listFile", "sendFile", "deleteFile", "searchFile", "Shutdown", "Restart", "Sleep", "Lock", "Hibernate",
+        "batch"
+    };
+    return knownCommands.count(name) > 0;
+}
+
+static string batchStageFor(const string& step) {
+    return "batch:" + (isKnownCommand(step) ? step : string("unknown"));
+}
+
+// Runs an admitted command: access has already been checked
+void ServerManager::runCommand(const string& name, const Json::Value& command) {
+    // Command latency, labelled only with known names to bound cardinality
+    bool known = isKnownCommand(name);
+    ScopedTimer commandTimer(Metrics().histogram("remotecontrol_command_duration_seconds",
+        "Time to execute a command and send its reply",
+        MetricsRegistry::label("command", known ? name : "unknown")));
+    if (Tracer::current()) {
+        Tracer::current()->setCommand(name);
+    }
+    Span handlerSpan(known ? "handler:" + name : "handler");
+
+    if (name == "batch") {
+        handleBatch(command);
+        return;
+    }
+    if (!dispatchCommand(name, command)) {
+        // Handle unknown command
+        activeCommand().message = "Unknown command";
+    }
+}
+
+// Runs a known command's handler; returns false for unknown names
+bool ServerManager::dispatchCommand(const string& name, const Json::Value& command) {
+    if (name == "listProcess") {
+        handleProcessListCommand(command);
+        return true;
+    }
+    else if (name == "startProcess") {
+        handleStartProcess(command);
+        return true;
+    }
+    else if (name == "endProcess") {
+        handleEndProcess(command);
+        return true;
+    }
+    else if (name == "readRecentEmails") {
+        handleReadRecentEmailsCommand(command);
+        return true;
+    }
+    else if (name == "captureScreen") {
+        handleCaptureScreen(command);
+        return true;
+    }
+    else if (name == "captureWebcam") {
+        handleCaptureWebcam(command);
+        return true;
+    }
+    else if (name == "trackKeyboard") {
+        handleTrackKeyboard(command); // Default 5 seconds
+        return true;
+    }
+    else if (name == "listService") {
+        handleListService(command);
+        return true;
+    }
+    else if (name == "startService") {
+        handleStartService(command);
+        return true;
+    }
+    else if (name == "endService") {
+		handleEndService(command);
+        return true;
+    }
+    else if (name == "listFile") {
+        handleListFile(command);
+        return true;
+    }
+	else if (name == "sendFile") {
+		handleSendFile(command);
+		return true;
+	}
+    else if (name == "deleteFile") {
+		handleDeleteFile(command);
+        return true;
+    }
+    else if (name == "searchFile") {
+        handleSearchFile(command);
+        return true;
+    }
+    else if (name == "Shutdown" || name == "Restart" || name == "Sleep" || name == "Lock" || name == "Hibernate") {
+        handlePowerCommand(command);
+        return true;
+    }
+    return false;
+}
+
 bool ServerManager::isAccessValid(const AccessInfo& access) const {
     time_t now = time(nullptr);
     double hours = difftime(now, access.grantedTime) / 3600.0;
@@ -219,44 +441,452 @@ bool ServerManager::isEmailApproved(const string& email) {
     return false;
 }
 
+bool ServerManager::wantsFreshSnapshot(const Json::Value& command) {
+    istringstream iss(command["Content"].asString());
+    string arg;
+    while (iss >> arg) {
+        if (arg == "fresh") return true;
+    }
+    return false;
+}
+
+bool ServerManager::writeSnapshotReport(SnapshotKind kind, const Json::Value& command,
+    const string& filename, Snapshot& snapshot) {
+    if (!snapshots->get(kind, wantsFreshSnapshot(command), snapshot)) {
+        return false;
+    }
+
+    ofstream file(filename);
+    if (!file.is_open()) return false;
+
+    file << SnapshotCache::describeAge(snapshot) << endl << endl;
+    file << snapshot.report;
+    file.close();
+    return true;
+}
+
+bool ServerManager::sendReply(const string& subject, const string& body, const string& attachmentPath) {
+    if (!replyCollector) {
+        if (attachmentPath.empty()) {
+            return gmail.sendSimpleEmail(activeCommand().from, subject, body);
+        }
+        return gmail.sendEmail(activeCommand().from, subject, body, attachmentPath);
+    }
+
+    vector<string> attachmentPaths;
+    if (!attachmentPath.empty()) attachmentPaths.push_back(attachmentPath);
+    return sendReplyWithAttachments(subject, body, attachmentPaths);
+}
+
+bool ServerManager::sendReplyWithAttachments(const string& subject, const string& body, const vector<string>& attachmentPaths) {
+    if (!replyCollector) {
+        return gmail.sendEmailWithAttachments(activeCommand().from, subject, body, attachmentPaths);
+    }
+
+    // Read now: some handlers delete their log file once the reply is out
+    CollectedReply reply;
+    reply.subject = subject;
+    reply.body = body;
+    for (const auto& path : attachmentPaths) {
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) return false;
+        string contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        reply.attachments.push_back({ path.substr(path.find_last_of("\\/") + 1), contents });
+    }
+    replyCollector->push_back(reply);
+    return true;
+}
+
 void ServerManager::handleProcessListCommand(const Json::Value& command) {
     cout << "Handling process list command..." << endl;
     // Get the sender's email address
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
-    // Get process list
-    vector<ProcessInfo> processes = RunningApps::getRunningApps();
+    string filename = platform.reportPath("process_list_" + to_string(time(nullptr)) + ".txt");
+    if (sendProcessTree(command, filename) ||
+        sendDeltaReport(SnapshotKind::Processes, command, "listProcess", "Process List") ||
+        sendInventoryQuery(SnapshotKind::Processes, command, filename, "Process List")) {
+        return;
+    }
 
-    // Ghi process list vào file
-    string filename = "D:\\process_list_" + to_string(time(nullptr)) + ".txt";
-    ofstream file(filename);
-    for (const auto& process : processes) {
-        file << "Process Name: " << process.name << endl;
-        file << "Process ID: " << process.processId << endl;
-        file << "Memory Usage: " << process.memoryUsage << " bytes" << endl;
-        file << endl;
+    // Ghi process list vào file, served from the warm snapshot
+    Snapshot snapshot;
+    if (!writeSnapshotReport(SnapshotKind::Processes, command, filename, snapshot)) {
+        cout << "Failed to build process list" << endl;
+        activeCommand().message = "Failed to build process list";
+        return;
     }
-    file.close();
     string subject = "Process List";
-    string body = "";
+    string body = SnapshotCache::describeAge(snapshot);
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, filename)) {
+    if (sendReply(subject, body, filename)) {
         cout << "Process list sent successfully via email" << endl;
-        this->currentCommand.message = "Process list sent successfully via email";
+        activeCommand().message = "Process list sent successfully via email";
     }
     else {
         cout << "Failed to send process list via email" << endl;
-        this->currentCommand.message = "Failed to send process list via email";
+        activeCommand().message = "Failed to send process list via email";
+    }
+}
+
+template <typename Row>
+static string writeQueryResult(InventoryQuery<Row>& query, const string& noun, const string& detail, ostream& out) {
+    size_t shown = query.finish().size();
+    string summary = to_string(query.matched()) + " of " + to_string(query.seen()) + " " + noun + " matched";
+    if (shown < query.matched()) summary += ", showing the first " + to_string(shown);
+    summary += detail;
+    out << summary << endl << endl;
+    query.writeTable(out);
+    return summary;
+}
+
+string ServerManager::writeInventoryQuery(SnapshotKind kind, const QuerySpec& spec, ostream& out) {
+    if (kind != SnapshotKind::Processes && spec.options.count("interval")) {
+        throw invalid_argument("interval= only applies to listProcess");
+    }
+    bool walk = WalkOptions::requested(spec.options);
+    if (kind != SnapshotKind::Files && walk) {
+        throw invalid_argument("root=, depth=, include=, exclude=, links= and threads= only apply to listFile");
+    }
+
+    if (kind == SnapshotKind::Services) {
+        InventoryQuery<ServiceInfo> query(spec, serviceFields(), "name");
+        if (!platform.services->enumerateServices([&](const ServiceInfo& service) { query.offer(service); })) {
+            throw runtime_error("Failed to enumerate services");
+        }
+        return writeQueryResult(query, "services", "", out);
+    }
+    if (kind == SnapshotKind::Files) {
+        // Without walk options, the usual folders' own files, as enumerateFiles lists them
+        WalkOptions options = walk ? WalkOptions::parse(spec.options) : WalkOptions();
+        if (!walk) options.maxDepth = 0;
+        InventoryQuery<FileInfo> query(spec, fileFields(), "name");
+
+        // A walk with nothing to sort writes rows as they are found, and the summary last
+        bool streamed = walk && spec.sortField.empty() && spec.top == 0;
+        if (streamed) query.writeHeader(out);
+        auto visit = [&](const FileInfo& file) {
+            if (!streamed) query.offer(file);
+            else if (query.pass(file)) query.writeRow(out, file);
+        };
+
+        // The index answers unless the sender asked for a fresh read
+        FileIndex& index = platform.fileIndex();
+        string detail;
+        if (!spec.fresh && index.walk(options, visit)) {
+            detail = ", from the " + index.describe();
+        }
+        else if (walk) {
+            detail = ", " + platform.files->walkFiles(options, visit).describe();
+        }
+        else if (!platform.files->enumerateFiles(visit)) {
+            throw runtime_error("Failed to enumerate files");
+        }
+        if (!streamed) return writeQueryResult(query, "files", detail, out);
+
+        string summary = to_string(query.matched()) + " of " + to_string(query.seen()) + " files matched" + detail;
+        out << endl << summary << endl;
+        return summary;
+    }
+
+    // Rates, handles and the like only exist in a sample
+    bool sampled = spec.options.count("interval") > 0;
+    for (const auto& field : sampledProcessFields()) {
+        const auto& plain = processFields();
+        bool inPlain = any_of(plain.begin(), plain.end(),
+            [&](const InventoryField<ProcessInfo>& other) { return string(other.name) == field.name; });
+        if (!inPlain && spec.mentions(field.name)) sampled = true;
+    }
+
+    if (!sampled) {
+        InventoryQuery<ProcessInfo> query(spec, processFields(), "memory");
+        vector<ProcessInfo> processes;
+        if (!platform.processes->listProcesses(processes)) {
+            throw runtime_error("Failed to list processes");
+        }
+        for (const auto& process : processes) query.offer(process);
+        return writeQueryResult(query, "processes", "", out);
+    }
+
+    int intervalMs = 1000;
+    auto interval = spec.options.find("interval");
+    if (interval != spec.options.end()) {
+        intervalMs = static_cast<int>(parseQuantity(interval->second));
+        intervalMs = min(max(intervalMs, 100), ProcessSampler::MAX_INTERVAL_MS);
+    }
+
+    // Built before sampling, so a bad query fails without the wait
+    InventoryQuery<ProcessUsage> query(spec, sampledProcessFields(), "cpu");
+    lock_guard<mutex> lock(samplerMutex);
+    if (!sampler.sample(chrono::milliseconds(intervalMs))) {
+        throw runtime_error("Failed to sample processes");
+    }
+    for (const auto& usage : sampler.results()) query.offer(usage);
+
+    ostringstream detail;
+    detail << fixed << setprecision(2) << ", sampled over " << sampler.elapsedSeconds()
+        << " s on " << sampler.cpuCount() << " CPUs";
+    return writeQueryResult(query, "processes", detail.str(), out);
+}
+
+bool ServerManager::sendInventoryQuery(SnapshotKind kind, const Json::Value& command,
+    const string& filename, const string& subject) {
+    string summary;
+    try {
+        QuerySpec spec = QuerySpec::parse(command["Content"].asString());
+        if (spec.empty()) return false;
+
+        ofstream file(filename);
+        if (!file.is_open()) throw runtime_error("Failed to write " + filename);
+        summary = writeInventoryQuery(kind, spec, file);
+    }
+    catch (const exception& e) {
+        cout << "Inventory query failed: " << e.what() << endl;
+        activeCommand().message = e.what();
+        sendReply(subject, e.what(), "");
+        return true;
     }
+
+    if (sendReply(subject, summary, filename)) {
+        cout << subject << " query sent successfully via email" << endl;
+        activeCommand().message = summary;
+    }
+    else {
+        cout << "Failed to send " << subject << " query via email" << endl;
+        activeCommand().message = "Failed to send query results via email";
+    }
+    return true;
+}
+
+void ServerManager::collectDeltaRows(SnapshotKind kind, const QuerySpec& spec, vector<DeltaRow>& rows) {
+    if (kind == SnapshotKind::Services) {
+        InventoryQuery<ServiceInfo> query(spec, serviceFields(), "name");
+        if (!platform.services->enumerateServices([&](const ServiceInfo& service) {
+            if (query.matches(service)) rows.push_back(DeltaRow::from(service));
+        })) {
+            throw runtime_error("Failed to enumerate services");
+        }
+    }
+    else if (kind == SnapshotKind::Files) {
+        InventoryQuery<FileInfo> query(spec, fileFields(), "name");
+        auto visit = [&](const FileInfo& file) {
+            if (query.matches(file)) rows.push_back(DeltaRow::from(file));
+        };
+        WalkOptions usualFolders;
+        usualFolders.maxDepth = 0;
+        if (!platform.fileIndex().walk(usualFolders, visit) && !platform.files->enumerateFiles(visit)) {
+            throw runtime_error("Failed to enumerate files");
+        }
+    }
+    else {
+        InventoryQuery<ProcessInfo> query(spec, processFields(), "memory");
+        vector<ProcessInfo> processes;
+        if (!platform.processes->listProcesses(processes)) {
+            throw runtime_error("Failed to list processes");
+        }
+        for (const auto& process : processes) {
+            if (query.matches(process)) rows.push_back(DeltaRow::from(process));
+        }
+    }
+    DeltaStore::prepare(rows);
+}
+
+bool ServerManager::sendDeltaReport(SnapshotKind kind, const Json::Value& command,
+    const string& commandName, const string& subject) {
+    const size_t INLINE_LIMIT = 4096;   // Smaller reports go in the body, with nothing to open
+
+    string content = command["Content"].asString();
+    istringstream words(content);
+    string word;
+    bool delta = false, resync = false;
+    while (words >> word) {
+        if (word == "delta") delta = true;
+        else if (word == "resync") resync = true;
+    }
+    if (!delta) return false;
+
+    // Filters are part of the key: a delta of chrome* is not a delta of everything
+    string key = activeCommand().from + "|" + commandName;
+    DeltaStore::Baseline current;
+    try {
+        QuerySpec spec = QuerySpec::parse(content);
+        if (!spec.sortField.empty() || spec.top > 0 || !spec.fields.empty() || !spec.options.empty()) {
+            throw invalid_argument("delta takes filters only; sort=, top=, fields=, interval= and the walk options do not apply");
+        }
+        for (const auto& condition : spec.conditions) key += " " + condition.toText();
+        current.takenAt = time(nullptr);
+        collectDeltaRows(kind, spec, current.rows);
+    }
+    catch (const exception& e) {
+        cout << "Delta report failed: " << e.what() << endl;
+        activeCommand().message = e.what();
+        sendReply(subject, e.what(), "");
+        return true;
+    }
+
+    ostringstream report;
+    string summary;
+    DeltaStore::Baseline baseline;
+    if (resync || !deltas.find(key, baseline)) {
+        summary = "Full resync of " + commandName + ": " + to_string(current.rows.size()) + " rows" +
+            (resync ? "" : " (no earlier delta to compare against)");
+        report << summary << "\n\n";
+        for (const auto& row : current.rows) report << "+ " << row.describe() << "\n";
+    }
+    else {
+        DeltaResult result;
+        DeltaStore::diff(baseline.rows, current.rows, result);
+        Snapshot since;
+        since.takenAt = baseline.takenAt;
+        since.valid = true;
+        summary = commandName + ": " + to_string(result.added.size()) + " added, " +
+            to_string(result.removed.size()) + " removed, " + to_string(result.changed.size()) + " changed, " +
+            to_string(result.unchanged) + " unchanged since the last delta. " +
+            "Baseline: " + SnapshotCache::describeAge(since);
+        report << summary << "\n\n";
+        result.write(report);
+    }
+
+    string text = report.str();
+    string body = text;
+    string filename;
+    if (text.size() > INLINE_LIMIT) {
+        filename = platform.reportPath(commandName + "_delta_" + to_string(time(nullptr)) + ".txt");
+        ofstream file(filename);
+        file << text;
+        body = summary;
+    }
+
+    if (sendReply(subject, body, filename)) {
+        deltas.remember(key, move(current));
+        cout << "Delta report sent successfully via email: " << summary << endl;
+        activeCommand().message = summary;
+    }
+    else {
+        cout << "Failed to send delta report via email" << endl;
+        activeCommand().message = "Failed to send delta report via email";
+    }
+    return true;
+}
+
+static bool hasWord(const string& content, const string& wanted) {
+    istringstream words(content);
+    string word;
+    while (words >> word) {
+        if (word == wanted) return true;
+    }
+    return false;
+}
+
+bool ServerManager::sendProcessTree(const Json::Value& command, const string& filename) {
+    const string subject = "Process Tree";
+    string content = command["Content"].asString();
+    if (!hasWord(content, "tree")) return false;
+
+    string summary;
+    try {
+        QuerySpec spec = QuerySpec::parse(content);
+        if (!spec.sortField.empty() || spec.top > 0 || !spec.fields.empty() || !spec.options.empty()) {
+            throw invalid_argument("tree takes filters only; sort=, top=, fields= and interval= do not apply");
+        }
+        if (hasWord(content, "delta")) {
+            throw invalid_argument("tree and delta do not combine");
+        }
+        // Filters pick the subtrees to show, by the process at their top
+        InventoryQuery<ProcessInfo> query(spec, processFields(), "memory");
+
+        vector<ProcessCounters> processes;
+        if (!platform.processes->sampleProcesses(processes)) {
+            throw runtime_error("Failed to list processes");
+        }
+        ProcessTree tree;
+        tree.build(processes);
+        vector<int> selected = tree.roots();
+        if (!spec.conditions.empty()) {
+            selected = tree.topmost([&](const ProcessCounters& process) {
+                ProcessInfo info;
+                info.name = process.name;
+                info.processId = process.processId;
+                info.memoryUsage = static_cast<SIZE_T>(process.workingSet);
+                return query.matches(info);
+            });
+        }
+
+        summary = to_string(processes.size()) + " processes in " + to_string(tree.roots().size()) + " trees, " +
+            to_string(tree.orphans()) + " orphaned";
+        if (!spec.conditions.empty()) summary += ", " + to_string(selected.size()) + " subtrees matched";
+
+        ofstream file(filename);
+        if (!file.is_open()) throw runtime_error("Failed to write " + filename);
+        file << summary << endl << endl;
+        tree.write(file, selected);
+    }
+    catch (const exception& e) {
+        cout << "Process tree failed: " << e.what() << endl;
+        activeCommand().message = e.what();
+        sendReply(subject, e.what(), "");
+        return true;
+    }
+
+    if (sendReply(subject, summary, filename)) {
+        cout << "Process tree sent successfully via email" << endl;
+        activeCommand().message = summary;
+    }
+    else {
+        cout << "Failed to send process tree via email" << endl;
+        activeCommand().message = "Failed to send process tree via email";
+    }
+    return true;
+}
+
+void ServerManager::endProcessTrees(const vector<string>& names, const string& logFileName) {
+    unordered_set<string> wanted;
+    for (const auto& name : names) {
+        string folded = name;
+        transform(folded.begin(), folded.end(), folded.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        wanted.insert(folded);
+        // Linux cuts process names to 15 characters
+        if (folded.size() > 15) wanted.insert(folded.substr(0, 15));
+    }
+
+    vector<ProcessCounters> processes;
+    if (!platform.processes->sampleProcesses(processes)) {
+        throw runtime_error("Failed to list processes");
+    }
+    ProcessTree tree;
+    tree.build(processes);
+
+    string folded;
+    vector<int> tops = tree.topmost([&](const ProcessCounters& process) {
+        folded = process.name;
+        transform(folded.begin(), folded.end(), folded.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        return wanted.count(folded) > 0;
+    });
+
+    // Parents first, so none is left running to replace the children it loses
+    vector<ProcessTarget> targets;
+    vector<int> walk;
+    for (int top : tops) {
+        walk.clear();
+        tree.subtree(top, walk);
+        for (int index : walk) {
+            ProcessTarget target;
+            target.name = processes[index].name;
+            target.processId = processes[index].processId;
+            target.startTime = processes[index].startTime;
+            targets.push_back(target);
+        }
+    }
+    platform.processes->terminateProcesses(targets, logFileName);
 }
 
 void ServerManager::handleStartProcess(const Json::Value& command) {
     cout << "Handling start process command..." << endl;
 
     // Get sender email
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
     // Get process names from content
     vector<string> processesToStart;
@@ -270,22 +900,22 @@ void ServerManager::handleStartProcess(const Json::Value& command) {
     }
 
     // Generate log filename
-    string logFileName = "D:\\process_start_" + to_string(time(nullptr)) + ".txt";
+    string logFileName = platform.reportPath("process_start_" + to_string(time(nullptr)) + ".txt");
 
     // Start processes and log results
-    RunningApps::startAppsFromShortcuts(processesToStart, logFileName);
+    platform.processes->startProcesses(processesToStart, logFileName);
 
     // Send email with results
     string subject = "Process Start Results";
     string body = "Process start operation log attached.";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, logFileName)) {
+    if (sendReply(subject, body, logFileName)) {
         cout << "Start operation results sent successfully via email" << endl;
-        this->currentCommand.message = "Start operation results sent successfully";
+        activeCommand().message = "Start operation results sent successfully";
     }
     else {
         cout << "Failed to send start operation results via email" << endl;
-        this->currentCommand.message = "Failed to send start operation results";
+        activeCommand().message = "Failed to send start operation results";
     }
 }
 
@@ -293,44 +923,59 @@ void ServerManager::handleEndProcess(const Json::Value& command) {
     cout << "Handling end process command..." << endl;
 
     // Get sender email
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
     // Get process names from content
     vector<string> processesToEnd;
     string content = command["Content"].asString();
 
-    // Split content by spaces
+    // Split content by spaces; "tree" takes each process's descendants too
     istringstream iss(content);
     string process;
+    bool tree = false;
     while (iss >> process) {
-        processesToEnd.push_back(process);
+        if (process == "tree") tree = true;
+        else processesToEnd.push_back(process);
     }
 
     // Generate log filename
-    string logFileName = "D:\\process_end_" + to_string(time(nullptr)) + ".txt";
+    string logFileName = platform.reportPath("process_end_" + to_string(time(nullptr)) + ".txt");
 
     // End processes and log results
-    RunningApps::endSelectedTasks(processesToEnd, logFileName);
+    if (tree) {
+        try {
+            endProcessTrees(processesToEnd, logFileName);
+        }
+        catch (const exception& e) {
+            cout << "Process tree termination failed: " << e.what() << endl;
+            activeCommand().message = e.what();
+            sendReply("Process Termination", e.what(), "");
+            return;
+        }
+    }
+    else {
+        platform.processes->endProcesses(processesToEnd, logFileName);
+    }
 
     // Send email with results
     string subject = "Process Termination";
     string body = "Process termination log attached.";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, logFileName)) {
+    if (sendReply(subject, body, logFileName)) {
         cout << "Termination results sent successfully via email" << endl;
-        this->currentCommand.message = "Termination results sent successfully";
+        activeCommand().message = "Termination results sent successfully";
     }
     else {
         cout << "Failed to send termination results via email" << endl;
-        this->currentCommand.message = "Failed to send termination results";
+        activeCommand().message = "Failed to send termination results";
     }
 }
 
 void ServerManager::handleReadRecentEmailsCommand(const Json::Value& command) {
     cout << "Handling read recent emails command..." << endl;
     // Get the sender's email address
-    this->currentCommand.from = command["From"].asString();
+    activeCommand().from = command["From"].asString();
 
     // Get the recent emails from Gmail API
     vector<string> recentEmails = gmail.getRecentEmails();
@@ -351,56 +996,50 @@ void ServerManager::handleReadRecentEmailsCommand(const Json::Value& command) {
     string subject = "Recent emails";
     string body = "";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, filename)) {
+    if (sendReply(subject, body, filename)) {
         cout << "Recent received emails sent successfully via email" << endl;
-        this->currentCommand.message = "Recent received emails sent successfully via email";
+        activeCommand().message = "Recent received emails sent successfully via email";
     }
     else {
         cout << "Failed to send recent received emails via email" << endl;
-        this->currentCommand.message = "Failed to send recent received emails via email";
+        activeCommand().message = "Failed to send recent received emails via email";
     }
 }
 
 void ServerManager::handleCaptureWebcam(const Json::Value& command) {
-    // Tạo đối tượng WebcamCapture
-    WebcamCapture webcamCapture;
-
     // Get the sender's email address
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
-    string path = "D:\\webcam_capture" + to_string(time(nullptr)) + ".jpg";
+    string path = platform.reportPath("webcam_capture" + to_string(time(nullptr)) + ".jpg");
 
     // Gọi hàm captureImage
-    if (webcamCapture.captureImage(path.c_str())) {
+    if (platform.screen->captureWebcam(path)) {
         cout << "Webcam captured successfully. Saved in: " << path << endl;
-        this->currentCommand.message = "Webcam captured successfully. Saved in: " + path;
+        activeCommand().message = "Webcam captured successfully. Saved in: " + path;
     }
     else {
         cout << "Webcam capture failed" << endl;
-        this->currentCommand.message = "Webcam capture failed";
+        activeCommand().message = "Webcam capture failed";
     }
 
     string subject = "Webcam Capture";
     string body = "";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, path)) {
+    if (sendReply(subject, body, path)) {
         cout << "Webcam capture sent successfully via email" << endl;
-        this->currentCommand.message += "\nWebcam capture sent successfully via email";
+        activeCommand().message += "\nWebcam capture sent successfully via email";
     }
     else {
         cout << "Failed to send webcam capture via email" << endl;
-        this->currentCommand.message += "\nFailed to send webcam capture via email";
+        activeCommand().message += "\nFailed to send webcam capture via email";
     }
 }
 
 void ServerManager::handleCaptureScreen(const Json::Value& command) {
-    // Create screenshot handler
-    ScreenshotHandler screenshotHandler;
-
     // Get the sender's email address
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
     // Create filename with timestamp
     time_t now = time(nullptr);
@@ -409,10 +1048,10 @@ void ServerManager::handleCaptureScreen(const Json::Value& command) {
     char timestamp[64];
     strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &timeinfo);
 
-    std::string filename = "D:\\screenshot_" + std::string(timestamp) + ".jpg";
+    std::string filename = platform.reportPath("screenshot_" + std::string(timestamp) + ".jpg");
 
     // Capture screenshot
-    if (screenshotHandler.captureWindow(filename)) {
+    if (platform.screen->captureScreen(filename)) {
         std::cout << "Screenshot captured successfully. Saved to: " << filename << std::endl;
     }
     else {
@@ -422,7 +1061,7 @@ void ServerManager::handleCaptureScreen(const Json::Value& command) {
     string subject = "Screen Capture";
     string body = "";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, filename)) {
+    if (sendReply(subject, body, filename)) {
         cout << "Screen capture sent successfully via email" << endl;
     }
     else {
@@ -445,9 +1084,9 @@ void ServerManager::handleTrackKeyboard(const Json::Value& command) {
         }
     }
 
-    this->currentCommand.from = command["From"].asString();
-    this->currentCommand.message = "Starting tracking for " + to_string(duration) + " seconds...";
-    cout << this->currentCommand.message << endl;
+    activeCommand().from = command["From"].asString();
+    activeCommand().message = "Starting tracking for " + to_string(duration) + " seconds...";
+    cout << activeCommand().message << endl;
 
     // Create filename with timestamp
     time_t now = time(nullptr);
@@ -455,78 +1094,42 @@ void ServerManager::handleTrackKeyboard(const Json::Value& command) {
     localtime_s(&timeinfo, &now);
     char timestamp[64];
     strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &timeinfo);
-    string filename = "D:\\keyboard_log_" + string(timestamp) + ".txt";
+    string filename = platform.reportPath("keyboard_log_" + string(timestamp) + ".txt");
 
     // Start tracking
-    KeyboardTracker tracker;
-    if (!tracker.StartTracking(filename, duration)) {
-        this->currentCommand.message = "Failed to start tracking";
-        return;
-    }
-
     cout << "Started tracking at: " << time(nullptr) << endl;
-
-    // Message loop
-    MSG msg;
-    auto startTime = std::chrono::system_clock::now();
-
-    while (!trackingFailed) {
-        auto currentTime = std::chrono::system_clock::now();
-        auto elapsedSeconds = std::chrono::duration_cast<std::chrono::seconds>(
-            currentTime - startTime).count();
-
+    TrackingResult result = platform.screen->trackKeyboard(filename, duration, [&](int elapsedSeconds) {
         cout << "Progress: " << elapsedSeconds << "/" << duration << " seconds" << endl;
-        this->currentCommand.message = "Tracking in progress: " +
+        activeCommand().message = "Tracking in progress: " +
             to_string(elapsedSeconds) + "/" + to_string(duration) + " seconds";
-
-        if (elapsedSeconds >= duration) {
-            cout << "Duration completed" << endl;
-            break;
-        }
-
-        if (!tracker.isTracking) {
-            cout << "Tracking stopped unexpectedly" << endl;
-            trackingFailed = true;
-            break;
-        }
-
-        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
-            if (msg.message == WM_QUIT) {
-                trackingFailed = true;
-                goto cleanup;
-            }
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
-        }
-
-        Sleep(200); 
+    });
+    if (result == TrackingResult::NotStarted) {
+        activeCommand().message = "Failed to start tracking";
+        return;
     }
-
-cleanup:
-    tracker.StopTracking();
+    trackingFailed = result == TrackingResult::Interrupted;
     cout << "Tracking stopped at: " << time(nullptr) << endl;
 
     if (!trackingFailed) {
-        if (gmail.sendEmail(this->currentCommand.from,
-            "Keyboard Log",
+        if (sendReply("Keyboard Log",
             "Tracking completed: " + to_string(duration) + " seconds",
             filename)) {
-            this->currentCommand.message = "Keyboard tracking completed and sent successfully";
+            activeCommand().message = "Keyboard tracking completed and sent successfully";
         }
         else {
-            this->currentCommand.message = "Tracking completed but failed to send email";
+            activeCommand().message = "Tracking completed but failed to send email";
         }
     }
     else {
-        this->currentCommand.message = "Tracking failed or was interrupted";
+        activeCommand().message = "Tracking failed or was interrupted";
     }
 }
 
 void ServerManager::handleListService(const Json::Value& command) {
 
     // Get the sender's email address
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
     // Create timestamp for filename
     time_t now = time(nullptr);
@@ -536,29 +1139,39 @@ void ServerManager::handleListService(const Json::Value& command) {
     strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &timeinfo);
 
     // Create filename
-    std::string filename = "D:\\service_list_" + std::string(timestamp) + ".txt";
+    std::string filename = platform.reportPath("service_list_" + std::string(timestamp) + ".txt");
 
-    // Create and use ServiceList
-    ServiceList services;
-    if (services.writeServicesToFile(filename)) {
+    if (sendDeltaReport(SnapshotKind::Services, command, "listService", "List of Services") ||
+        sendInventoryQuery(SnapshotKind::Services, command, filename, "List of Services")) {
+        return;
+    }
+
+    // Serve the services list from the warm snapshot
+    Snapshot snapshot;
+    if (writeSnapshotReport(SnapshotKind::Services, command, filename, snapshot)) {
         std::cout << "Services list saved to: " << filename << std::endl;
-        this->currentCommand.message = "Services list saved to: " + filename;
+        activeCommand().message = "Services list saved to: " + filename;
     }
     else {
         std::cout << "Failed to save services list" << std::endl;
-        this->currentCommand.message = "Failed to save services list";
+        activeCommand().message = "Failed to save services list";
+        if (!snapshot.error.empty()) {
+            activeCommand().message += ": " + snapshot.error;
+            sendReply("List of Services", "Failed to list services: " + snapshot.error, "");
+            return;
+        }
     }
 
     string subject = "List of Services";
-    string body = "";
+    string body = snapshot.valid ? SnapshotCache::describeAge(snapshot) : "";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, filename)) {
+    if (sendReply(subject, body, filename)) {
         cout << "Screen capture sent successfully via email" << endl;
-        this->currentCommand.message += "\nScreen capture sent successfully via email";
+        activeCommand().message += "\nScreen capture sent successfully via email";
     }
     else {
         cout << "Failed to send screen capture via email" << endl;
-        this->currentCommand.message += "\nFailed to send screen capture via email";
+        activeCommand().message += "\nFailed to send screen capture via email";
     }
 }
 
@@ -566,8 +1179,8 @@ void ServerManager::handleStartService(const Json::Value& command) {
     cout << "Handling start service command..." << endl;
 
     // Get sender email
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
     // Get service names from content
     vector<string> servicesToStart;
@@ -581,23 +1194,30 @@ void ServerManager::handleStartService(const Json::Value& command) {
     }
 
     // Generate log filename
-    string logFileName = "D:\\service_start_" + to_string(time(nullptr)) + ".txt";
+    string logFileName = platform.reportPath("service_start_" + to_string(time(nullptr)) + ".txt");
 
     // Start services and log results
-    ServiceList serviceList;
-    serviceList.startService(servicesToStart, logFileName);
+    try {
+        platform.services->startServices(servicesToStart, logFileName);
+    }
+    catch (const exception& e) {
+        cout << "Service start failed: " << e.what() << endl;
+        activeCommand().message = e.what();
+        sendReply("Service Start Results", e.what(), "");
+        return;
+    }
 
     // Send email with results
     string subject = "Service Start Results";
     string body = "Service start operation log attached.";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, logFileName)) {
+    if (sendReply(subject, body, logFileName)) {
         cout << "Service start results sent successfully via email" << endl;
-        this->currentCommand.message = "Service start results sent successfully";
+        activeCommand().message = "Service start results sent successfully";
     }
     else {
         cout << "Failed to send service start results via email" << endl;
-        this->currentCommand.message = "Failed to send service start results";
+        activeCommand().message = "Failed to send service start results";
     }
 }
 
@@ -605,8 +1225,8 @@ void ServerManager::handleEndService(const Json::Value& command) {
     cout << "Handling stop service command..." << endl;
 
     // Get sender email
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
     // Get service names from content
     vector<string> servicesToStop;
@@ -620,30 +1240,37 @@ void ServerManager::handleEndService(const Json::Value& command) {
     }
 
     // Generate log filename
-    string logFileName = "D:\\service_stop_" + to_string(time(nullptr)) + ".txt";
+    string logFileName = platform.reportPath("service_stop_" + to_string(time(nullptr)) + ".txt");
 
     // Stop services and log results
-    ServiceList serviceList;
-    serviceList.stopService(servicesToStop, logFileName);
+    try {
+        platform.services->stopServices(servicesToStop, logFileName);
+    }
+    catch (const exception& e) {
+        cout << "Service stop failed: " << e.what() << endl;
+        activeCommand().message = e.what();
+        sendReply("Service Stop Results", e.what(), "");
+        return;
+    }
 
     // Send email with results
     string subject = "Service Stop Results";
     string body = "Service stop operation log attached.";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, logFileName)) {
+    if (sendReply(subject, body, logFileName)) {
         cout << "Service stop results sent successfully via email" << endl;
-        this->currentCommand.message = "Service stop results sent successfully";
+        activeCommand().message = "Service stop results sent successfully";
     }
     else {
         cout << "Failed to send service stop results via email" << endl;
-        this->currentCommand.message = "Failed to send service stop results";
+        activeCommand().message = "Failed to send service stop results";
     }
 }
 
 void ServerManager::handleListFile(const Json::Value& command) {
     // Get the sender's email address
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
     // Create timestamp for filename
     time_t now = time(nullptr);
@@ -653,35 +1280,72 @@ void ServerManager::handleListFile(const Json::Value& command) {
     strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &timeinfo);
 
     // Create filename
-    std::string filename = "D:\\file_list_" + std::string(timestamp) + ".txt";
+    std::string filename = platform.reportPath("file_list_" + std::string(timestamp) + ".txt");
 
-    // Create and use FileList
-    FileList files;
-    if (files.writeFilesToFile(filename)) {
+    if (sendDeltaReport(SnapshotKind::Files, command, "listFile", "File list") ||
+        sendInventoryQuery(SnapshotKind::Files, command, filename, "File list")) {
+        return;
+    }
+
+    // Serve the files list from the warm snapshot
+    Snapshot snapshot;
+    if (writeSnapshotReport(SnapshotKind::Files, command, filename, snapshot)) {
         std::cout << "Files list saved to: " << filename << std::endl;
-        this->currentCommand.message = "Files list saved to: " + filename;
+        activeCommand().message = "Files list saved to: " + filename;
     }
     else {
         std::cout << "Failed to save files list" << std::endl;
-        this->currentCommand.message = "Failed to save files list";
+        activeCommand().message = "Failed to save files list";
     }
 
     string subject = "File list";
     string body = "Here's your file list!";
+    if (snapshot.valid) {
+        body += "\n" + SnapshotCache::describeAge(snapshot);
+    }
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, filename)) {
+    if (sendReply(subject, body, filename)) {
         cout << "Screen capture sent successfully via email" << endl;
-        this->currentCommand.message += "\nFile list sent successfully via email";
+        activeCommand().message += "\nFile list sent successfully via email";
     }
     else {
         cout << "Failed to send screen capture via email" << endl;
-        this->currentCommand.message += "\nFailed to send file list via email";
+        activeCommand().message += "\nFailed to send file list via email";
+    }
+}
+
+vector<string> ServerManager::expandFilePatterns(const vector<string>& paths) {
+    const size_t MAX_PATTERN_FILES = 256;    // Per pattern, so one stray * cannot fill a mail
+    const chrono::seconds INDEX_WAIT(30);    // For the first walk, on a server that just started
+
+    vector<string> expanded;
+    for (const auto& path : paths) {
+        if (path.find_first_of("*?") == string::npos) {
+            expanded.push_back(path);
+            continue;
+        }
+        FileIndex& index = platform.fileIndex();
+        vector<string> matches;
+        if (!index.waitUntilReady(INDEX_WAIT) || !index.expand(path, MAX_PATTERN_FILES + 1, matches)) {
+            activeCommand().message += "\nFile index not ready yet, skipped: " + path;
+            continue;
+        }
+        if (matches.size() > MAX_PATTERN_FILES) {
+            matches.resize(MAX_PATTERN_FILES);
+            activeCommand().message += "\n" + path + " matches more than " + to_string(MAX_PATTERN_FILES) +
+                " files; taking the first " + to_string(MAX_PATTERN_FILES);
+        }
+        else {
+            activeCommand().message += "\n" + path + " matches " + to_string(matches.size()) + " files";
+        }
+        expanded.insert(expanded.end(), matches.begin(), matches.end());
     }
+    return expanded;
 }
 
 void ServerManager::handleSendFile(const Json::Value& command) {
-    this->currentCommand.from = command["From"].asString();
-    this->currentCommand.message = "Processing file send request...";
+    activeCommand().from = command["From"].asString();
+    activeCommand().message = "Processing file send request...";
 
     vector<string> filePaths;
     string content = command["Content"].asString();
@@ -694,39 +1358,38 @@ void ServerManager::handleSendFile(const Json::Value& command) {
             filePaths.push_back(path);
         }
     }
+    filePaths = expandFilePatterns(filePaths);
 
     vector<string> validFiles;
     for (const auto& file : filePaths) {
-        DWORD fileAttributes = GetFileAttributesA(file.c_str());
-        if (fileAttributes != INVALID_FILE_ATTRIBUTES &&
-            !(fileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        if (platform.files->isRegularFile(file)) {
             validFiles.push_back(file);
-            this->currentCommand.message += "\nValid file found: " + file;
+            activeCommand().message += "\nValid file found: " + file;
         }
         else {
-            this->currentCommand.message += "\nInvalid file: " + file;
+            activeCommand().message += "\nInvalid file: " + file;
         }
     }
 
     if (validFiles.empty()) {
-        this->currentCommand.message += "\nNo valid files found to send";
+        activeCommand().message += "\nNo valid files found to send";
         return;
     }
 
     string subject = "Requested Files";
     string body = "Attached are the files you requested.";
 
-    if (gmail.sendEmailWithAttachments(this->currentCommand.from, subject, body, validFiles)) {
-        this->currentCommand.message += "\nFiles sent successfully via email";
+    if (sendReplyWithAttachments(subject, body, validFiles)) {
+        activeCommand().message += "\nFiles sent successfully via email";
     }
     else {
-        this->currentCommand.message += "\nFailed to send files via email";
+        activeCommand().message += "\nFailed to send files via email";
     }
 }
 
 void ServerManager::handleDeleteFile(const Json::Value& command) {
-    this->currentCommand.from = command["From"].asString();
-    this->currentCommand.message = "Processing file delete request...";
+    activeCommand().from = command["From"].asString();
+    activeCommand().message = "Processing file delete request...";
 
     vector<string> filePaths;
     string content = command["Content"].asString();
@@ -741,33 +1404,32 @@ void ServerManager::handleDeleteFile(const Json::Value& command) {
     }
 
     vector<pair<string, bool>> deletionResults;
-    string logFileName = "D:\\file_deletion_" + to_string(time(nullptr)) + ".txt";
+    string logFileName = platform.reportPath("file_deletion_" + to_string(time(nullptr)) + ".txt");
     ofstream logFile(logFileName);
 
     if (!logFile.is_open()) {
-        this->currentCommand.message += "\nFailed to create log file";
+        activeCommand().message += "\nFailed to create log file";
         return;
     }
 
     for (const auto& file : filePaths) {
-        DWORD fileAttributes = GetFileAttributesA(file.c_str());
-        if (fileAttributes != INVALID_FILE_ATTRIBUTES &&
-            !(fileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        if (platform.files->isRegularFile(file)) {
 
-            bool deleted = DeleteFileA(file.c_str()) != 0;
+            bool deleted = platform.files->deleteFile(file);
             deletionResults.push_back({ file, deleted });
+            if (deleted) platform.fileIndex().forget(file);
 
             logFile << "File: " << file << "\n";
             logFile << "Status: " << (deleted ? "Deleted successfully" : "Failed to delete") << "\n";
             logFile << "Time: " << time(nullptr) << "\n\n";
 
-            this->currentCommand.message += "\n" + file +
+            activeCommand().message += "\n" + file +
                 (deleted ? ": Deleted successfully" : ": Failed to delete");
         }
         else {
             logFile << "File: " << file << "\n";
             logFile << "Status: Invalid file or directory\n\n";
-            this->currentCommand.message += "\nInvalid file: " + file;
+            activeCommand().message += "\nInvalid file: " + file;
         }
     }
 
@@ -777,61 +1439,278 @@ void ServerManager::handleDeleteFile(const Json::Value& command) {
     string subject = "File Deletion Results";
     string body = "Detailed deletion results are attached.";
 
-    if (gmail.sendEmail(this->currentCommand.from, subject, body, logFileName)) {
-        this->currentCommand.message += "\nDeletion log sent successfully via email";
+    if (sendReply(subject, body, logFileName)) {
+        activeCommand().message += "\nDeletion log sent successfully via email";
     }
     else {
-        this->currentCommand.message += "\nFailed to send deletion log via email";
+        activeCommand().message += "\nFailed to send deletion log via email";
     }
 
     // Cleanup log file
-    DeleteFileA(logFileName.c_str());
+    remove(logFileName.c_str());
+}
+
+void ServerManager::handleSearchFile(const Json::Value& command) {
+    const size_t INLINE_LIMIT = 4096;   // Smaller results go in the body, with nothing to open
+
+    activeCommand().from = command["From"].asString();
+    cout << "Handling search file command from: " << activeCommand().from << endl;
+
+    string subject = "File search";
+    string filename = platform.reportPath("file_search_" + to_string(time(nullptr)) + ".txt");
+    string summary;
+    try {
+        SearchOptions options = SearchOptions::parse(command["Content"].asString());
+        ofstream file(filename);
+        if (!file.is_open()) throw runtime_error("Failed to write " + filename);
+        file << "Searching for \"" << options.text << "\"" << (options.regex ? " (regex)" : "") << "\n\n";
+
+        // Matches are written as each file finishes, while the rest are still being listed
+        ContentSearch search(options, file);
+        struct Enough {};
+        auto visit = [&](const FileInfo& found) {
+            if (!search.add(found.path)) throw Enough();
+        };
+        FileIndex& index = platform.fileIndex();
+        string detail;
+        vector<string> indexed;
+        try {
+            // The index is locked only while its paths are copied out; add()
+            // waits on the search threads, and so would every other index user
+            if (!options.fresh && index.walk(options.walk, [&](const FileInfo& found) { indexed.push_back(found.path); })) {
+                detail = ", files from the " + index.describe();
+                for (const auto& path : indexed) {
+                    if (!search.add(path)) break;
+                }
+            }
+            else platform.files->walkFiles(options.walk, visit);
+        }
+        catch (const Enough&) {
+            // The match limit was reached; the files not yet listed are not needed
+        }
+        summary = search.finish().describe() + detail;
+        file << summary << endl;
+    }
+    catch (const exception& e) {
+        cout << "File search failed: " << e.what() << endl;
+        activeCommand().message = e.what();
+        sendReply(subject, e.what(), "");
+        remove(filename.c_str());
+        return;
+    }
+
+    string body = summary;
+    string attachment = filename;
+    ifstream written(filename, ios::binary | ios::ate);
+    if (written.is_open() && static_cast<size_t>(written.tellg()) <= INLINE_LIMIT) {
+        written.seekg(0);
+        body.assign(istreambuf_iterator<char>(written), istreambuf_iterator<char>());
+        attachment.clear();
+    }
+    written.close();
+
+    if (sendReply(subject, body, attachment)) {
+        cout << "File search sent successfully via email: " << summary << endl;
+        activeCommand().message = summary;
+    }
+    else {
+        cout << "Failed to send file search via email" << endl;
+        activeCommand().message = "Failed to send file search via email";
+    }
+    remove(filename.c_str());
 }
 
 void ServerManager::handlePowerCommand(const Json::Value& command) {
     // Get sender's email
-    this->currentCommand.from = command["From"].asString();
-    cout << "Sender email: " << this->currentCommand.from << endl;
+    activeCommand().from = command["From"].asString();
+    cout << "Sender email: " << activeCommand().from << endl;
 
     // Get power action type from subject
-    string actionType = command["Subject"].asString();
-    actionType = actionType.substr(actionType.find("Command") + 9); // Skip "Command::"
+    string actionType = commandNameFor(command);
 
     bool success = false;
     string resultMessage;
 
     // Execute power action based on command
-    if (actionType == "Shutdown") {
-        success = PowerManager::Shutdown(false);
-        resultMessage = "Shutdown command executed";
-        this->currentCommand.message = "Shutdown command executed";
-    }
-    else if (actionType == "Restart") {
-        success = PowerManager::Restart(false);
-        resultMessage = "Restart command executed";
-        this->currentCommand.message = "Restart command executed";
-    }
-    else if (actionType == "Hibernate") {
-        success = PowerManager::Hibernate();
-        resultMessage = "Hibernate command executed";
-        this->currentCommand.message = "Hibernate command executed";
-    }
-    else if (actionType == "Sleep") {
-        success = PowerManager::Sleep();
-        resultMessage = "Sleep command executed";
-        this->currentCommand.message = "Sleep command executed";
-    }
-    else if (actionType == "Lock") {
-        success = PowerManager::Lock();
-        resultMessage = "Lock command executed";
-        this->currentCommand.message = "Lock command executed";
+    static const set<string> powerActions = { "Shutdown", "Restart", "Hibernate", "Sleep", "Lock" };
+    if (powerActions.count(actionType)) {
+        success = platform.power->execute(actionType);
+        resultMessage = actionType + " command executed";
+        activeCommand().message = resultMessage;
     }
 
     // Send response email
     string subject = "Power Command Result";
     string body = success ? "Successfully executed: " + actionType : "Failed to execute: " + actionType;
 
-    gmail.sendEmail(this->currentCommand.from, subject, body, "");
-    cout << "Power command response sent to: " << this->currentCommand.from << endl;
-    this->currentCommand.message += "\nPower command response sent to: " + this->currentCommand.from;
-}
\ No newline at end of file
+    sendReply(subject, body, "");
+    cout << "Power command response sent to: " << activeCommand().from << endl;
+    activeCommand().message += "\nPower command response sent to: " + activeCommand().from;
+}
+
+// Inventory commands served from snapshots; they share no state, so a batch runs them together
+static bool snapshotKindFor(const string& name, SnapshotKind& kind) {
+    if (name == "listProcess") kind = SnapshotKind::Processes;
+    else if (name == "listService") kind = SnapshotKind::Services;
+    else if (name == "listFile") kind = SnapshotKind::Files;
+    else return false;
+    return true;
+}
+
+struct BatchStep {
+    string name;
+    Json::Value command;    // Same shape as a single command email
+    bool ok = false;
+    string summary;
+    vector<pair<string, string>> attachments;
+    long long elapsedMs = 0;
+};
+
+void ServerManager::handleBatch(const Json::Value& command) {
+    const size_t MAX_BATCH_STEPS = 10;
+    activeCommand().from = command["From"].asString();
+    cout << "Handling batch command from: " << activeCommand().from << endl;
+
+    // Steps are separated by ';' since the Gmail snippet folds line breaks
+    vector<BatchStep> steps;
+    stringstream script(command["Content"].asString());
+    string line;
+    while (getline(script, line, ';')) {
+        istringstream words(line);
+        BatchStep step;
+        if (!(words >> step.name)) continue;
+        string args, word;
+        while (words >> word) args += (args.empty() ? "" : " ") + word;
+
+        step.command["Subject"] = "Command::" + step.name;
+        step.command["From"] = activeCommand().from;
+        step.command["Content"] = args;
+        steps.push_back(step);
+    }
+
+    if (steps.empty() || steps.size() > MAX_BATCH_STEPS) {
+        activeCommand().message = "Invalid batch: expected 1 to " + to_string(MAX_BATCH_STEPS) + " steps separated by ';'";
+        sendReply("Batch Results", activeCommand().message, "");
+        return;
+    }
+
+    Trace* trace = Tracer::current();
+    auto runInventoryStep = [this, trace](BatchStep& step, SnapshotKind kind) {
+        TraceScope traceScope(trace);
+        Span stepSpan(batchStageFor(step.name));
+        auto started = chrono::steady_clock::now();
+
+        // A query runs live; exceptions must not leave this thread
+        try {
+            QuerySpec spec = QuerySpec::parse(step.command["Content"].asString());
+            if (!spec.empty()) {
+                ostringstream report;
+                step.summary = writeInventoryQuery(kind, spec, report);
+                step.attachments.push_back({ step.name + ".txt", report.str() });
+                step.ok = true;
+                step.elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+                return;
+            }
+        }
+        catch (const exception& e) {
+            step.summary = e.what();
+            step.elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+            return;
+        }
+
+        Snapshot snapshot;
+        step.ok = snapshots->get(kind, wantsFreshSnapshot(step.command), snapshot);
+        if (step.ok) {
+            step.summary = SnapshotCache::describeAge(snapshot);
+            step.attachments.push_back({ step.name + ".txt",
+                SnapshotCache::describeAge(snapshot) + "\n\n" + snapshot.report });
+        }
+        else {
+            step.summary = snapshot.error.empty() ? "Failed to build inventory" : snapshot.error;
+        }
+        step.elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+    };
+
+    size_t next = 0;
+    while (next < steps.size()) {
+        SnapshotKind kind;
+        if (snapshotKindFor(steps[next].name, kind)) {
+            // Consecutive inventory steps run in parallel; any other step is a barrier,
+            // so a listProcess after an endProcess still sees the result
+            vector<thread> group;
+            while (next < steps.size() && snapshotKindFor(steps[next].name, kind)) {
+                group.emplace_back(runInventoryStep, ref(steps[next]), kind);
+                next++;
+            }
+            for (auto& worker : group) worker.join();
+            continue;
+        }
+
+        BatchStep& step = steps[next++];
+        Span stepSpan(batchStageFor(step.name));
+        auto started = chrono::steady_clock::now();
+
+        if (step.name == "batch" || step.name == "requestAccess" ||
+            step.name == "Shutdown" || step.name == "Restart" || step.name == "Sleep" ||
+            step.name == "Lock" || step.name == "Hibernate") {
+            step.summary = "Not allowed in a batch; send it as its own command";
+        }
+        else {
+            vector<CollectedReply> replies;
+            activeCommand().message = "";
+            replyCollector = &replies;
+            bool known = dispatchCommand(step.name, step.command);
+            replyCollector = nullptr;
+
+            step.ok = known && !replies.empty();
+            step.summary = known ? activeCommand().message : "Unknown command";
+            for (auto& reply : replies) {
+                if (!reply.body.empty()) {
+                    step.summary += (step.summary.empty() ? "" : "\n") + reply.body;
+                }
+                for (auto& attachment : reply.attachments) {
+                    step.attachments.push_back(attachment);
+                }
+            }
+        }
+        step.elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+    }
+
+    // One reply: a per-step summary in the body, every output in one archive
+    ZipArchive archive;
+    ostringstream body;
+    int succeeded = 0;
+    for (size_t i = 0; i < steps.size(); i++) {
+        const BatchStep& step = steps[i];
+        if (step.ok) succeeded++;
+
+        string args = step.command["Content"].asString();
+        body << (i + 1) << ". " << step.name << (args.empty() ? "" : " " + args)
+            << ": " << (step.ok ? "OK" : "FAILED") << " (" << step.elapsedMs << " ms)\n";
+        if (!step.summary.empty()) body << step.summary << "\n";
+        body << "\n";
+
+        char prefix[8];
+        snprintf(prefix, sizeof(prefix), "%02d_", static_cast<int>(i + 1));
+        for (const auto& attachment : step.attachments) {
+            archive.add(prefix + attachment.first, attachment.second);
+        }
+    }
+
+    string subject = "Batch Results (" + to_string(succeeded) + "/" + to_string(steps.size()) + " succeeded)";
+    string archivePath;
+    if (archive.size() > 0) {
+        archivePath = platform.reportPath("batch_" + to_string(time(nullptr)) + ".zip");
+        if (!archive.save(archivePath)) {
+            body << "Failed to write the results archive\n";
+            archivePath.clear();
+        }
+    }
+
+    if (sendReply(subject, body.str(), archivePath)) {
+        activeCommand().message = "Batch of " + to_string(steps.size()) + " steps sent via email";
+    }
+    else {
+        activeCommand().message = "Failed to send batch results via email";
+    }
+}
@@ -1,8 +1,16 @@
 #pragma once
-#include "..\Libs\Header.h"
-#include "..\GmailAPI\GmailAPI.h"
-#include "..\Server\EmailMonitor.h"
-#include "..\Server\Config.h"
+#include "../Libs/Header.h"
+#include "../GmailAPI/GmailAPI.h"
+#include "../Server/EmailMonitor.h"
+#include "../Server/Config.h"
+#include "../Server/SnapshotCache.h"
+#include "../Server/CommandScheduler.h"
+#include "../Server/SenderLimiter.h"
+#include "../Server/DeltaReport.h"
+#include "../Platform/Platform.h"
+#include "../Platform/ProcessSampler.h"
+#include "../Platform/InventoryQuery.h"
+#include "../Platform/ProcessTree.h"
 
 
 struct AccessInfo {
@@ -11,7 +19,15 @@ struct AccessInfo {
     static const int VALIDITY_HOURS = 24;
 };
 
-struct currentCommand {
+// Reply captured from a batch step instead of being mailed
+struct CollectedReply {
+    string subject;
+    string body;
+    vector<pair<string, string>> attachments;  // File name, file contents
+};
+
+// What the GUI shows for the command being handled
+struct CommandStatus {
 	string content;
 	string from;
 	string message;
@@ -21,23 +37,81 @@ class ServerManager {
 private:
     void logActivity(const string& activity);
 
+    unique_ptr<SnapshotCache> ownedSnapshots;
+    SnapshotCache* snapshots;  // Shared across mailboxes in multi-mailbox mode
+    static bool wantsFreshSnapshot(const Json::Value& command);
+    bool writeSnapshotReport(SnapshotKind kind, const Json::Value& command,
+        const string& filename, Snapshot& snapshot);
+
+    // Replies go to the sender, or into the collector of the batch running on this thread
+    bool sendReply(const string& subject, const string& body, const string& attachmentPath);
+    bool sendReplyWithAttachments(const string& subject, const string& body, const vector<string>& attachmentPaths);
+    bool dispatchCommand(const string& name, const Json::Value& command);
+    void runCommand(const string& name, const Json::Value& command);
+
+    unique_ptr<CommandScheduler> scheduler;
+    SenderLimiter senderLimits;
+    void executeQueued(QueuedCommand& item);
+    CommandStatus& activeCommand();
+
+    Platform& platform;  // Where handlers act: the host, or a mock for benchmarks
+
+    // Inventory commands whose body holds a query skip the snapshot cache and
+    // filter the live enumeration. Sampled fields need two snapshots; one
+    // sample at a time keeps the sampler's buffers reused.
+    ProcessSampler sampler;
+    mutex samplerMutex;
+    // Throws invalid_argument on a bad query, runtime_error when the backend fails
+    string writeInventoryQuery(SnapshotKind kind, const QuerySpec& spec, ostream& out);
+    // False when the body holds no query, so the snapshot report applies
+    bool sendInventoryQuery(SnapshotKind kind, const Json::Value& command,
+        const string& filename, const string& subject);
+
+    // "delta" in an inventory command: only what changed since this sender's
+    // last delta of the same command and filters; false without the word
+    DeltaStore deltas;
+    bool sendDeltaReport(SnapshotKind kind, const Json::Value& command,
+        const string& commandName, const string& subject);
+    void collectDeltaRows(SnapshotKind kind, const QuerySpec& spec, vector<DeltaRow>& rows);
+
+    // "tree" in listProcess: the parent/child forest with subtree totals, from
+    // one snapshot; false without the word
+    bool sendProcessTree(const Json::Value& command, const string& filename);
+    // "tree" in endProcess: each named process and everything under it,
+    // parents first; throws runtime_error when the snapshot fails
+    void endProcessTrees(const vector<string>& names, const string& logFileName);
+
+    // sendFile paths with * or ? stand for the indexed files they match, up
+    // to 256 each; what each matched goes into the message
+    vector<string> expandFilePatterns(const vector<string>& paths);
+
 public:
     GmailAPI& gmail;  // Ensure this declaration
     EmailMonitor monitor;
     bool running;
     ServerConfig config;
+    mutex commandMutex;      // Held while a poll and its command run
+    bool externalPolling;    // True when a MailboxHub drives processCommands()
     bool isAccessValid(const AccessInfo& access) const;
     void cleanupExpiredAccess();
     void saveAccessList() const;
     void loadAccessList();
 	bool isEmailApproved(const string& email);
     vector<AccessInfo> approvedAccess;  // Store access info with timestamps
-    ServerManager(GmailAPI& api);
+    ServerManager(GmailAPI& api, SnapshotCache* sharedSnapshots = nullptr, const string& mailboxName = "",
+        Platform* host = nullptr);
+    static void configureSnapshots(SnapshotCache& cache, int maxAgeSeconds, Platform& platform = Platform::native());
+    ~ServerManager();
     void start();
     void stop();
     bool isRunning() const;
-    void processCommands();
+    bool processCommands();
     void handleCommand(const Json::Value& command); // Move to public
+    // Queues an approved command by priority; access requests run inline
+    bool submitCommand(const Json::Value& command, const shared_ptr<Trace>& trace);
+    // True when the command can be answered now, counting it in promised when
+    // it takes a queue slot; false leaves it in the mailbox for a later poll
+    bool admitCommand(const Json::Value& command, size_t& promised);
 
     void handleProcessListCommand(const Json::Value& command);
 	void handleStartProcess(const Json::Value& command);
@@ -58,13 +132,16 @@ public:
 	void handleListFile(const Json::Value& command);
 	void handleSendFile(const Json::Value& command);
 	void handleDeleteFile(const Json::Value& command);
+	void handleSearchFile(const Json::Value& command);
 
     void handlePowerCommand(const Json::Value& command);
 
+    void handleBatch(const Json::Value& command);
+
 	
 
 	
 
 	string getServerName();
-	currentCommand currentCommand;
+	CommandStatus currentCommand;
 };
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "../Server/SnapshotCache.h"
+
+long long Snapshot::ageSeconds() const {
+    if (!valid) return -1;
+    return static_cast<long long>(difftime(time(nullptr), takenAt));
+}
+
+SnapshotCache::SnapshotCache() : maxAge(60), running(false) {
+}
+
+SnapshotCache::~SnapshotCache() {
+    stop();
+}
+
+void SnapshotCache::registerProducer(SnapshotKind kind, Producer producer) {
+    lock_guard<mutex> lock(dataMutex);
+    entries[static_cast<int>(kind)].producer = producer;
+}
+
+void SnapshotCache::start(int maxAgeSeconds) {
+    lock_guard<mutex> lock(stateMutex);
+    if (running) return;
+
+    maxAge = max(maxAgeSeconds, 2);
+    running = true;
+    refresher = thread(&SnapshotCache::refreshLoop, this);
+}
+
+void SnapshotCache::stop() {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        if (!running) return;
+        running = false;
+    }
+    wakeup.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+}
+
+bool SnapshotCache::get(SnapshotKind kind, bool fresh, Snapshot& out) {
+    Entry& entry = entries[static_cast<int>(kind)];
+    time_t requestedAt = time(nullptr);
+
+    if (!fresh) {
+        lock_guard<mutex> lock(dataMutex);
+        if (entry.snapshot.valid && entry.snapshot.ageSeconds() <= maxAge) {
+            out = entry.snapshot;
+            return true;
+        }
+    }
+
+    // Refresher is behind or the sender asked for fresh data: compute now,
+    // but reuse a result that another thread finished after we asked
+    {
+        lock_guard<mutex> refreshLock(entry.refreshMutex);
+        bool upToDate;
+        {
+            lock_guard<mutex> lock(dataMutex);
+            upToDate = entry.snapshot.valid && entry.snapshot.takenAt >= requestedAt;
+        }
+        if (!upToDate && !refresh(kind)) {
+            lock_guard<mutex> lock(dataMutex);
+            out.error = entry.lastError;
+            return false;
+        }
+    }
+
+    lock_guard<mutex> lock(dataMutex);
+    out = entry.snapshot;
+    return out.valid;
+}
+
+string SnapshotCache::describeAge(const Snapshot& snapshot) {
+    struct tm timeinfo;
+    localtime_s(&timeinfo, &snapshot.takenAt);
+    char timeStr[64];
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
+
+    return "Snapshot taken at " + string(timeStr) +
+        " (age " + to_string(snapshot.ageSeconds()) + " seconds)";
+}
+
+// Caller must hold the entry's refreshMutex
+bool SnapshotCache::refresh(SnapshotKind kind) {
+    Entry& entry = entries[static_cast<int>(kind)];
+
+    Producer producer;
+    {
+        lock_guard<mutex> lock(dataMutex);
+        producer = entry.producer;
+    }
+    if (!producer) return false;
+
+    time_t takenAt = time(nullptr);
+    ostringstream report;
+    try {
+        if (!producer(report)) {
+            lock_guard<mutex> lock(dataMutex);
+            entry.lastError = "The inventory could not be read";
+            return false;
+        }
+    }
+    catch (const exception& e) {
+        cerr << "Snapshot refresh failed: " << e.what() << endl;
+        lock_guard<mutex> lock(dataMutex);
+        entry.lastError = e.what();
+        return false;
+    }
+
+    lock_guard<mutex> lock(dataMutex);
+    entry.lastError.clear();
+    entry.snapshot.report = report.str();
+    entry.snapshot.takenAt = takenAt;
+    entry.snapshot.valid = true;
+    return true;
+}
+
+void SnapshotCache::refreshLoop() {
+    // Refresh at half the staleness bound so readers practically never wait
+    const int refreshInterval = maxAge / 2;
+
+    while (true) {
+        for (int i = 0; i < KIND_COUNT; i++) {
+            {
+                lock_guard<mutex> lock(stateMutex);
+                if (!running) return;
+            }
+
+            Entry& entry = entries[i];
+            bool due;
+            {
+                lock_guard<mutex> lock(dataMutex);
+                due = entry.producer &&
+                    (!entry.snapshot.valid || entry.snapshot.ageSeconds() >= refreshInterval);
+            }
+            if (!due) continue;
+
+            lock_guard<mutex> refreshLock(entry.refreshMutex);
+            refresh(static_cast<SnapshotKind>(i));
+        }
+
+        unique_lock<mutex> lock(stateMutex);
+        wakeup.wait_for(lock, chrono::seconds(refreshInterval), [this] { return !running; });
+        if (!running) return;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// Inventories kept warm by the background refresher
+enum class SnapshotKind {
+    Processes,
+    Services,
+    Files
+};
+
+struct Snapshot {
+    string report;      // Rendered inventory text
+    time_t takenAt = 0; // When the inventory was computed
+    bool valid = false;
+    string error;       // Why the inventory could not be computed, when it could not
+
+    long long ageSeconds() const;
+};
+
+class SnapshotCache {
+public:
+    // Writes a full inventory report into the stream, returns false on failure
+    typedef function<bool(ostream&)> Producer;
+
+    SnapshotCache();
+    ~SnapshotCache();
+
+    void registerProducer(SnapshotKind kind, Producer producer);
+
+    // Starts the refresher; snapshots are never served older than maxAgeSeconds
+    void start(int maxAgeSeconds);
+    void stop();
+
+    // Serves the cached snapshot, recomputing only when forced or past the staleness bound
+    bool get(SnapshotKind kind, bool fresh, Snapshot& out);
+
+    static string describeAge(const Snapshot& snapshot);
+
+private:
+    struct Entry {
+        Producer producer;
+        Snapshot snapshot;
+        string lastError;   // From the producer's last failed run
+        mutex refreshMutex; // Serializes recomputation of one inventory
+    };
+
+    static const int KIND_COUNT = 3;
+    Entry entries[KIND_COUNT];
+    mutex dataMutex;    // Guards every Entry::snapshot
+
+    int maxAge;
+    bool running;
+    mutex stateMutex;
+    condition_variable wakeup;
+    thread refresher;
+
+    bool refresh(SnapshotKind kind);
+    void refreshLoop();
+};
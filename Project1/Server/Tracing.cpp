@@ -0,0 +1,222 @@
+#include "../Server/Tracing.h"
+#include "../Server/Metrics.h"
+
+static thread_local Trace* currentTrace = nullptr;
+
+// Small stable thread numbers keep the Chrome trace view readable
+static size_t traceThreadId() {
+    static atomic<size_t> nextId{ 1 };
+    static thread_local size_t id = nextId++;
+    return id;
+}
+
+static string jsonEscape(const string& value) {
+    string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') escaped += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        escaped += c;
+    }
+    return escaped;
+}
+
+Trace::Trace(const string& id)
+    : id(id), createdMicros(Tracer::nowMicros()), originMicros(0) {
+}
+
+void Trace::setOrigin(long long epochMicros) {
+    lock_guard<mutex> lock(spanMutex);
+    originMicros = epochMicros;
+}
+
+void Trace::setCommand(const string& name) {
+    lock_guard<mutex> lock(spanMutex);
+    command = name;
+}
+
+void Trace::addSpan(const TraceSpan& span) {
+    lock_guard<mutex> lock(spanMutex);
+    spans.push_back(span);
+}
+
+void Trace::writeChromeJson(ostream& out) const {
+    lock_guard<mutex> lock(spanMutex);
+
+    long long origin = originMicros;
+    if (origin == 0) {
+        origin = createdMicros;
+        for (const auto& span : spans) origin = min(origin, span.startMicros);
+    }
+
+    // Delivery delay: from Gmail accepting the message until we started fetching it
+    long long firstStart = spans.empty() ? origin : spans.front().startMicros;
+    for (const auto& span : spans) firstStart = min(firstStart, span.startMicros);
+
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"mailboxWait\",\"cat\":\"remotecontrol\",\"ph\":\"X\",\"ts\":0,\"dur\":"
+        << max(firstStart - origin, 0LL) << ",\"pid\":1,\"tid\":0}";
+
+    for (const auto& span : spans) {
+        out << ",\n{\"name\":\"" << jsonEscape(span.name) << "\",\"cat\":\"remotecontrol\",\"ph\":\"X\""
+            << ",\"ts\":" << (span.startMicros - origin)
+            << ",\"dur\":" << span.durationMicros
+            << ",\"pid\":1,\"tid\":" << span.threadId << "}";
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"messageId\":\"" << jsonEscape(id)
+        << "\",\"command\":\"" << jsonEscape(command)
+        << "\",\"internalDateMicros\":" << originMicros << "}}\n";
+}
+
+StageStats::StageStats() : window(WINDOW, 0), next(0), total(0), sumMicros(0) {
+}
+
+void StageStats::add(long long durationMicros) {
+    window[next] = durationMicros;
+    next = (next + 1) % WINDOW;
+    total++;
+    sumMicros += durationMicros;
+}
+
+vector<double> StageStats::quantiles(const vector<double>& points) const {
+    size_t filled = static_cast<size_t>(min<long long>(total, WINDOW));
+    vector<double> result(points.size(), 0.0);
+    if (filled == 0) return result;
+
+    vector<long long> sorted(window.begin(), window.begin() + filled);
+    for (size_t i = 0; i < points.size(); i++) {
+        size_t rank = min(static_cast<size_t>(points[i] * filled), filled - 1);
+        nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        result[i] = sorted[rank] / 1e6;
+    }
+    return result;
+}
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer() : outputDir("traces"), outputReady(false) {
+    Metrics().addCollector([this](ostream& out) { writeSummary(out); });
+}
+
+long long Tracer::nowMicros() {
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::setOutputDir(const string& dir) {
+    lock_guard<mutex> lock(tracerMutex);
+    outputDir = dir;
+    outputReady = false;
+}
+
+shared_ptr<Trace> Tracer::begin(const string& id) {
+    auto trace = make_shared<Trace>(id);
+
+    lock_guard<mutex> lock(tracerMutex);
+    // Messages fetched but skipped by the dispatcher are never taken
+    long long cutoff = trace->getCreatedMicros() - PENDING_TTL_MICROS;
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (it->second->getCreatedMicros() < cutoff) it = pending.erase(it);
+        else ++it;
+    }
+    pending[id] = trace;
+    return trace;
+}
+
+shared_ptr<Trace> Tracer::take(const string& id) {
+    lock_guard<mutex> lock(tracerMutex);
+    auto it = pending.find(id);
+    if (it == pending.end()) return nullptr;
+    shared_ptr<Trace> trace = it->second;
+    pending.erase(it);
+    return trace;
+}
+
+void Tracer::finish(const shared_ptr<Trace>& trace) {
+    if (!trace) return;
+
+    string path;
+    {
+        lock_guard<mutex> lock(tracerMutex);
+        if (outputDir.empty()) return;
+        if (!outputReady) {
+            _mkdir(outputDir.c_str());
+            outputReady = true;
+        }
+        path = outputDir + "/" + trace->getId() + ".json";
+    }
+
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "Failed to write trace: " << path << endl;
+        return;
+    }
+    trace->writeChromeJson(file);
+}
+
+void Tracer::record(const string& stage, long long durationMicros) {
+    lock_guard<mutex> lock(tracerMutex);
+    stages[stage].add(durationMicros);
+}
+
+void Tracer::writeSummary(ostream& out) const {
+    static const vector<double> points = { 0.5, 0.9, 0.99 };
+    const char* name = "remotecontrol_stage_duration_seconds";
+
+    lock_guard<mutex> lock(tracerMutex);
+    if (stages.empty()) return;
+
+    out << "# HELP " << name << " Command lifecycle stage latency over the last "
+        << StageStats::WINDOW << " samples\n";
+    out << "# TYPE " << name << " summary\n";
+    for (const auto& entry : stages) {
+        string stage = MetricsRegistry::label("stage", entry.first);
+        vector<double> values = entry.second.quantiles(points);
+        for (size_t i = 0; i < points.size(); i++) {
+            out << name << "{" << stage << ",quantile=\"" << points[i] << "\"} " << values[i] << "\n";
+        }
+        out << name << "_sum{" << stage << "} " << entry.second.sumSeconds() << "\n";
+        out << name << "_count{" << stage << "} " << entry.second.count() << "\n";
+    }
+}
+
+size_t Tracer::threadId() {
+    return traceThreadId();
+}
+
+Trace* Tracer::current() {
+    return currentTrace;
+}
+
+TraceScope::TraceScope(const shared_ptr<Trace>& trace)
+    : trace(trace), previous(currentTrace) {
+    currentTrace = trace.get();
+}
+
+TraceScope::TraceScope(Trace* trace)
+    : previous(currentTrace) {
+    currentTrace = trace;
+}
+
+TraceScope::~TraceScope() {
+    currentTrace = previous;
+}
+
+Span::Span(const string& name)
+    : name(name), startMicros(Tracer::nowMicros()), started(chrono::steady_clock::now()) {
+}
+
+Span::~Span() {
+    long long duration = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - started).count();
+    Tracer::instance().record(name, duration);
+
+    Trace* trace = Tracer::current();
+    if (trace) {
+        trace->addSpan({ name, startMicros, duration, traceThreadId() });
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "../Libs/Header.h"
+
+struct TraceSpan {
+    string name;
+    long long startMicros;     // Wall clock, microseconds since the epoch
+    long long durationMicros;
+    size_t threadId;
+};
+
+// Spans of one command, from Gmail delivery to the reply being posted
+class Trace {
+public:
+    explicit Trace(const string& id);
+
+    const string& getId() const { return id; }
+    long long getCreatedMicros() const { return createdMicros; }
+
+    // Gmail internalDate of the command email; trace timestamps are relative to it
+    void setOrigin(long long epochMicros);
+    void setCommand(const string& name);
+    void addSpan(const TraceSpan& span);
+
+    // Chrome trace-event format, loadable in chrome://tracing or Perfetto
+    void writeChromeJson(ostream& out) const;
+
+private:
+    string id;
+    long long createdMicros;
+    mutable mutex spanMutex;
+    long long originMicros;
+    string command;
+    vector<TraceSpan> spans;
+};
+
+// Percentiles over the most recent durations of one stage
+class StageStats {
+public:
+    static const size_t WINDOW = 1024;
+
+    StageStats();
+    void add(long long durationMicros);
+    // Quantiles in seconds over the window, in the order requested
+    vector<double> quantiles(const vector<double>& points) const;
+    long long count() const { return total; }
+    double sumSeconds() const { return sumMicros / 1e6; }
+
+private:
+    vector<long long> window;  // Ring buffer, preallocated
+    size_t next;
+    long long total;
+    long long sumMicros;
+};
+
+// Process-wide tracer. A trace is bound to the thread working on its command
+// through TraceScope; Span timers record into the bound trace, if any, and
+// always into the per-stage rolling summaries.
+class Tracer {
+public:
+    static Tracer& instance();
+    static long long nowMicros();
+
+    void setOutputDir(const string& dir);
+
+    // Pending traces are created while fetching and picked up by the dispatcher
+    shared_ptr<Trace> begin(const string& id);
+    shared_ptr<Trace> take(const string& id);
+    // Writes traces/<id>.json
+    void finish(const shared_ptr<Trace>& trace);
+
+    void record(const string& stage, long long durationMicros);
+    void writeSummary(ostream& out) const;
+
+    static Trace* current();
+    static size_t threadId();
+
+private:
+    friend class TraceScope;
+    static const long long PENDING_TTL_MICROS = 10LL * 60 * 1000000;  // Fetched but never dispatched
+
+    Tracer();
+
+    mutable mutex tracerMutex;
+    string outputDir;
+    bool outputReady;
+    map<string, shared_ptr<Trace>> pending;
+    map<string, StageStats> stages;
+};
+
+// Binds a trace to the calling thread for the lifetime of the scope
+class TraceScope {
+public:
+    explicit TraceScope(const shared_ptr<Trace>& trace);
+    // Rebinds a trace owned elsewhere, e.g. on helper threads of one command
+    explicit TraceScope(Trace* trace);
+    ~TraceScope();
+
+private:
+    shared_ptr<Trace> trace;
+    Trace* previous;
+};
+
+// Times one stage of the current command
+class Span {
+public:
+    explicit Span(const string& name);
+    ~Span();
+
+private:
+    string name;
+    long long startMicros;
+    chrono::steady_clock::time_point started;
+};
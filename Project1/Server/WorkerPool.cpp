@@ -0,0 +1,77 @@
+#include "../Server/WorkerPool.h"
+#include "../Server/Metrics.h"
+
+static Gauge& queueDepthGauge() {
+    static Gauge& gauge = Metrics().gauge("remotecontrol_worker_queue_depth",
+        "Tasks waiting for a shared worker thread");
+    return gauge;
+}
+
+static Gauge& busyWorkersGauge() {
+    static Gauge& gauge = Metrics().gauge("remotecontrol_worker_busy",
+        "Shared worker threads currently running a task");
+    return gauge;
+}
+
+WorkerPool::WorkerPool(int threadCount) : stopping(false), busy(0) {
+    threadCount = max(threadCount, 1);
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    shutdown();
+}
+
+void WorkerPool::submit(Task task) {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (stopping) return;
+        tasks.push_back(move(task));
+    }
+    queueDepthGauge().inc();
+    available.notify_one();
+}
+
+void WorkerPool::shutdown() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+size_t WorkerPool::queueDepth() const {
+    lock_guard<mutex> lock(queueMutex);
+    return tasks.size();
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        Task task;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+        queueDepthGauge().dec();
+
+        busy++;
+        busyWorkersGauge().inc();
+        try {
+            task();
+        }
+        catch (const exception& e) {
+            cerr << "Worker task failed: " << e.what() << endl;
+        }
+        busy--;
+        busyWorkersGauge().dec();
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// Fixed-size thread pool shared by every mailbox in the process
+class WorkerPool {
+public:
+    typedef function<void()> Task;
+
+    explicit WorkerPool(int threadCount);
+    ~WorkerPool();
+
+    void submit(Task task);
+    void shutdown();
+
+    size_t queueDepth() const;
+    int busyWorkers() const { return busy.load(); }
+    int size() const { return static_cast<int>(workers.size()); }
+
+private:
+    vector<thread> workers;
+    deque<Task> tasks;
+    mutable mutex queueMutex;
+    condition_variable available;
+    bool stopping;
+    atomic<int> busy;
+
+    void workerLoop();
+};
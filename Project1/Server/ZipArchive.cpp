@@ -0,0 +1,115 @@
+#include "../Server/ZipArchive.h"
+#include <zlib.h>
+
+static void put16(string& out, uint16_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+static void put32(string& out, uint32_t value) {
+    put16(out, static_cast<uint16_t>(value & 0xFFFF));
+    put16(out, static_cast<uint16_t>(value >> 16));
+}
+
+// Raw deflate stream (no zlib header), as the zip format expects
+static bool deflateRaw(const string& data, string& compressed) {
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    compressed.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+    stream.avail_out = static_cast<uInt>(compressed.size());
+
+    int result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+
+void ZipArchive::add(const string& name, const string& data) {
+    Entry entry;
+    entry.name = name;
+    entry.originalSize = static_cast<uint32_t>(data.size());
+    entry.crc = static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(data.data()),
+        static_cast<uInt>(data.size())));
+
+    string compressed;
+    if (!data.empty() && deflateRaw(data, compressed) && compressed.size() < data.size()) {
+        entry.method = 8;
+        entry.payload = move(compressed);
+    }
+    else {
+        entry.method = 0;
+        entry.payload = data;
+    }
+    entries.push_back(move(entry));
+}
+
+bool ZipArchive::save(const string& path) const {
+    // MS-DOS date and time, as stored in zip headers
+    tm local;
+    localtime_s(&local, &createdAt);
+    uint16_t dosTime = static_cast<uint16_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+    uint16_t dosDate = static_cast<uint16_t>(((local.tm_year - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+    const uint16_t UTF8_NAMES = 0x0800;
+
+    string archive;
+    string directory;
+    for (const auto& entry : entries) {
+        uint32_t offset = static_cast<uint32_t>(archive.size());
+
+        put32(archive, 0x04034b50);  // Local file header
+        put16(archive, 20);
+        put16(archive, UTF8_NAMES);
+        put16(archive, entry.method);
+        put16(archive, dosTime);
+        put16(archive, dosDate);
+        put32(archive, entry.crc);
+        put32(archive, static_cast<uint32_t>(entry.payload.size()));
+        put32(archive, entry.originalSize);
+        put16(archive, static_cast<uint16_t>(entry.name.size()));
+        put16(archive, 0);
+        archive += entry.name;
+        archive += entry.payload;
+
+        put32(directory, 0x02014b50);  // Central directory header
+        put16(directory, 20);
+        put16(directory, 20);
+        put16(directory, UTF8_NAMES);
+        put16(directory, entry.method);
+        put16(directory, dosTime);
+        put16(directory, dosDate);
+        put32(directory, entry.crc);
+        put32(directory, static_cast<uint32_t>(entry.payload.size()));
+        put32(directory, entry.originalSize);
+        put16(directory, static_cast<uint16_t>(entry.name.size()));
+        put16(directory, 0);
+        put16(directory, 0);
+        put16(directory, 0);
+        put16(directory, 0);
+        put32(directory, 0);
+        put32(directory, offset);
+        directory += entry.name;
+    }
+
+    uint32_t directoryOffset = static_cast<uint32_t>(archive.size());
+    archive += directory;
+
+    put32(archive, 0x06054b50);  // End of central directory
+    put16(archive, 0);
+    put16(archive, 0);
+    put16(archive, static_cast<uint16_t>(entries.size()));
+    put16(archive, static_cast<uint16_t>(entries.size()));
+    put32(archive, static_cast<uint32_t>(directory.size()));
+    put32(archive, directoryOffset);
+    put16(archive, 0);
+
+    ofstream file(path, ios::binary);
+    if (!file.is_open()) return false;
+    file.write(archive.data(), archive.size());
+    return file.good();
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "../Libs/Header.h"
+
+// Minimal in-memory .zip writer for bundling reply attachments. Entries are
+// deflated, or stored when deflate does not shrink them (JPEGs, archives).
+class ZipArchive {
+public:
+    void add(const string& name, const string& data);
+    bool save(const string& path) const;
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        string name;
+        string payload;        // Compressed or stored bytes
+        uint32_t crc;
+        uint32_t originalSize;
+        uint16_t method;       // 0 = stored, 8 = deflate
+    };
+
+    vector<Entry> entries;
+    time_t createdAt = time(nullptr);
+};
@@ -0,0 +1,151 @@
+#include "../Platform/Platform.h"
+#include "../Platform/ServiceController.h"
+
+// Runs ServiceController against a scripted service manager, then the mock
+// backend's service commands end to end. Exits non-zero on any failure.
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << endl; \
+            failures++; \
+        } \
+    } while (0)
+
+// Every request settles on the next state() call, in the target state
+// unless the service is listed in fails
+class ScriptedDriver : public ServiceControlDriver {
+public:
+    map<string, vector<string>> needs;
+    set<string> fails;
+    vector<string> requested;   // In the order the controller sent them
+
+    unsigned long request(const string& name, bool start) override {
+        requested.push_back(name);
+        states[name] = start ? "Start Pending" : "Stop Pending";
+        targets[name] = fails.count(name) ? (start ? "Stopped" : "Running") : (start ? "Running" : "Stopped");
+        return 0;
+    }
+
+    string state(const string& name) override {
+        auto it = states.find(name);
+        if (it == states.end()) return "";
+        it->second = targets[name];
+        return it->second;
+    }
+
+    void waitForChange(chrono::steady_clock::time_point) override {
+    }
+
+    vector<string> dependencies(const string& name) override {
+        auto it = needs.find(name);
+        return it == needs.end() ? vector<string>() : it->second;
+    }
+
+private:
+    map<string, string> states;
+    map<string, string> targets;
+};
+
+static vector<ServiceOperation> batch(const vector<string>& names, bool start) {
+    vector<ServiceOperation> operations(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        operations[i].name = names[i];
+        operations[i].start = start;
+    }
+    return operations;
+}
+
+static size_t position(const vector<string>& list, const string& name) {
+    return find(list.begin(), list.end(), name) - list.begin();
+}
+
+static void startsFollowDependencies() {
+    // A needs B, B needs X outside the batch, X needs C
+    ScriptedDriver driver;
+    driver.needs = { { "A", { "B" } }, { "B", { "X" } }, { "X", { "C" } } };
+    vector<ServiceOperation> operations = batch({ "A", "B", "C" }, true);
+    ServiceSchedule schedule = ServiceController(driver).run(operations, chrono::milliseconds(1000));
+
+    CHECK((driver.requested == vector<string>{ "C", "B", "A" }));
+    CHECK((operations[0].waitedFor == vector<string>{ "B" }));   // Not C too: B already waits for it
+    CHECK((operations[1].waitedFor == vector<string>{ "C" }));
+    CHECK(schedule.depth == 3);
+    CHECK(schedule.cycle.empty());
+    for (const auto& operation : operations) CHECK(operation.reached);
+}
+
+static void stopsRunTheOtherWay() {
+    ScriptedDriver driver;
+    driver.needs = { { "A", { "B" } }, { "B", { "C" } } };
+    vector<ServiceOperation> operations = batch({ "C", "B", "A" }, false);
+    ServiceController(driver).run(operations, chrono::milliseconds(1000));
+
+    CHECK((driver.requested == vector<string>{ "A", "B", "C" }));
+}
+
+static void cyclesAreDropped() {
+    ScriptedDriver driver;
+    driver.needs = { { "P", { "Q" } }, { "Q", { "P" } }, { "R", { "P" } } };
+    vector<ServiceOperation> operations = batch({ "P", "Q", "R" }, true);
+    ServiceSchedule schedule = ServiceController(driver).run(operations, chrono::milliseconds(1000));
+
+    CHECK(driver.requested.size() == 3);
+    CHECK(position(schedule.cycle, "P") < schedule.cycle.size());
+    CHECK(position(schedule.cycle, "Q") < schedule.cycle.size());
+    CHECK(position(schedule.cycle, "R") == schedule.cycle.size());
+    CHECK(position(driver.requested, "P") < position(driver.requested, "R"));
+    for (const auto& operation : operations) CHECK(operation.reached);
+}
+
+static void refusedOperationsHoldNothingBack() {
+    ScriptedDriver driver;
+    driver.needs = { { "D", { "Critical" } } };
+    vector<ServiceOperation> operations = batch({ "D", "Critical" }, true);
+    operations[1].refused = "Cannot modify critical service";
+    ServiceController(driver).run(operations, chrono::milliseconds(1000));
+
+    CHECK((driver.requested == vector<string>{ "D" }));
+    CHECK(operations[0].reached);
+    CHECK(operations[0].waitedFor.empty());
+    CHECK(!operations[1].reached);
+}
+
+static void failuresBlockTheirWaiters() {
+    ScriptedDriver driver;
+    driver.needs = { { "F", { "Broken" } } };
+    driver.fails = { "Broken" };
+    vector<ServiceOperation> operations = batch({ "F", "Broken" }, true);
+    ServiceController(driver).run(operations, chrono::milliseconds(1000));
+
+    CHECK((driver.requested == vector<string>{ "Broken" }));
+    CHECK(!operations[1].reached);
+    CHECK(operations[0].blockedBy == "Broken");
+}
+
+static void mockBackendRefusesCriticalServices() {
+    unique_ptr<Platform> platform = Platform::createMock();
+    string logFileName = "service_controller_test.log";
+    remove(logFileName.c_str());
+
+    CHECK(!platform->services->startServices({ "Dhcp" }, logFileName));
+    ifstream log(logFileName);
+    string text((istreambuf_iterator<char>(log)), istreambuf_iterator<char>());
+    CHECK(text.find("Cannot modify critical service") != string::npos);
+    CHECK(text.find("Reached the target state: 0 of 1 services") != string::npos);
+    log.close();
+    remove(logFileName.c_str());
+}
+
+int main() {
+    startsFollowDependencies();
+    stopsRunTheOtherWay();
+    cyclesAreDropped();
+    refusedOperationsHoldNothingBack();
+    failuresBlockTheirWaiters();
+    mockBackendRefusesCriticalServices();
+    cout << (failures == 0 ? "All checks passed" : to_string(failures) + " checks failed") << endl;
+    return failures == 0 ? 0 : 1;
+}